@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "benchmark.hxx"
+
+namespace po = boost::program_options;
+
+namespace {
+  std::atomic<std::uint64_t> gAllocations {0};
+
+  void write_result(std::ostream & out, Benchmark const & benchmark, BenchmarkContext const & context,
+                    double const seconds, std::uint64_t const allocations)
+  {
+    auto const & latencies = context.latencies();
+    auto const frames = context.frames();
+
+    out << "{\"benchmark\": \"" << benchmark.m_name << "\""
+        << ", \"iterations\": " << context.iterations()
+        << ", \"operations\": " << context.operations()
+        << ", \"frames\": " << frames
+        << ", \"seconds\": " << seconds
+        << ", \"operations_per_second\": " << (seconds > 0.0 ? context.operations() / seconds : 0.0)
+        << ", \"p50_ns\": " << latencies.percentile(0.5)
+        << ", \"p99_ns\": " << latencies.percentile(0.99)
+        << ", \"max_ns\": " << latencies.max()
+        << ", \"allocations\": " << allocations
+        << ", \"allocations_per_frame\": " << (frames ? static_cast<double>(allocations) / frames : 0.0);
+    for (auto const & metric : context.metrics())
+      out << ", \"" << metric.first << "\": " << metric.second;
+    out << "}" << std::endl;
+  }
+}
+
+void * operator new(std::size_t size)
+{
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto const memory = std::malloc(size ? size : 1))
+    return memory;
+  throw std::bad_alloc {};
+}
+
+void operator delete(void * memory) noexcept
+{
+  std::free(memory);
+}
+
+void operator delete(void * memory, std::size_t /* size */) noexcept
+{
+  std::free(memory);
+}
+
+std::uint64_t allocation_count()
+{
+  return gAllocations.load(std::memory_order_relaxed);
+}
+
+std::vector<Benchmark> & benchmarks()
+{
+  static std::vector<Benchmark> registered {};
+  return registered;
+}
+
+/**
+ * @brief Runs all (or the selected) benchmarks and reports one JSON object per line.
+ */
+int main(int argc, char ** argv)
+{
+  std::uint64_t iterations = 0;
+  std::string filter {};
+  std::string outFile {};
+
+  po::options_description desc {"Allowed options"};
+  desc.add_options()
+      ("help,h", "show this help")
+      ("list", "list the available benchmarks")
+      (
+          "iterations,n",
+          po::value<std::uint64_t>(&iterations)->default_value(100000),
+          "set the number of iterations each benchmark runs"
+      )
+      (
+          "filter",
+          po::value<std::string>(&filter),
+          "only run benchmarks whose name contains this string"
+      )
+      (
+          "out,o",
+          po::value<std::string>(&outFile),
+          "write the results to this file instead of stdout"
+      );
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (vm.count("list"))
+  {
+    for (auto const & benchmark : benchmarks())
+      std::cout << benchmark.m_name << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  std::ofstream file {};
+  if (!outFile.empty())
+    file.open(outFile);
+  auto & out = outFile.empty() ? std::cout : file;
+
+  for (auto const & benchmark : benchmarks())
+  {
+    if (std::string {benchmark.m_name}.find(filter) == std::string::npos)
+      continue;
+
+    BenchmarkContext context {iterations};
+    auto const allocationsBefore = allocation_count();
+    auto const start = std::chrono::steady_clock::now();
+    benchmark.m_function(context);
+    auto const seconds = std::chrono::duration<double> {std::chrono::steady_clock::now() - start}.count();
+    auto const allocations = allocation_count() - allocationsBefore;
+
+    write_result(out, benchmark, context, seconds, allocations);
+  }
+
+  return out ? EXIT_SUCCESS : EXIT_FAILURE;
+}
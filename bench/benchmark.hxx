@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_BENCHMARK_HXX
+#define OVENBRICK_BENCHMARK_HXX
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "../game/profiler.hxx"
+
+/**
+ * @return The number of calls to the global operator new so far.
+ */
+std::uint64_t allocation_count();
+
+/**
+ * @brief Handed to every benchmark to scale the workload and collect measurements.
+ */
+class BenchmarkContext final : private sf::NonCopyable
+{
+  using clock = std::chrono::steady_clock;
+
+  std::uint64_t const m_iterations;
+  std::uint64_t m_operations = 0;
+  std::uint64_t m_frames = 0;
+  LatencyHistogram m_latencies;
+  std::vector<std::pair<std::string, double>> m_metrics;
+
+public:
+  explicit inline BenchmarkContext(std::uint64_t iterations)
+      : m_iterations {iterations}
+  {
+  }
+
+  /**
+   * @return How many iterations the benchmark is supposed to run.
+   */
+  inline std::uint64_t iterations() const
+  {
+    return m_iterations;
+  }
+
+  /**
+   * @brief Run and time a single operation.
+   * @param fn The operation.
+   */
+  template <typename Fn>
+  inline void measure(Fn && fn)
+  {
+    auto const start = clock::now();
+    fn();
+    auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+    m_latencies.record(static_cast<std::uint64_t>(elapsed.count()));
+    ++m_operations;
+  }
+
+  /**
+   * @brief Mark the end of a simulated frame, allocations are reported per frame.
+   */
+  inline void next_frame()
+  {
+    ++m_frames;
+  }
+
+  /**
+   * @brief Report a benchmark specific figure along with the default ones.
+   * @param name The name of the JSON field.
+   * @param value The figure.
+   */
+  inline void report(std::string name, double value)
+  {
+    m_metrics.emplace_back(std::move(name), value);
+  }
+
+  inline std::uint64_t operations() const
+  {
+    return m_operations;
+  }
+
+  inline std::uint64_t frames() const
+  {
+    return m_frames;
+  }
+
+  inline LatencyHistogram const & latencies() const
+  {
+    return m_latencies;
+  }
+
+  inline std::vector<std::pair<std::string, double>> const & metrics() const
+  {
+    return m_metrics;
+  }
+};
+
+using BenchmarkFunction = void (*)(BenchmarkContext &);
+
+struct Benchmark final
+{
+  char const * m_name;
+  BenchmarkFunction m_function;
+};
+
+/**
+ * @return All registered benchmarks.
+ */
+std::vector<Benchmark> & benchmarks();
+
+/**
+ * @brief Registers a benchmark during static initialization.
+ */
+struct BenchmarkRegistration final
+{
+  inline BenchmarkRegistration(char const * name, BenchmarkFunction function)
+  {
+    benchmarks().push_back(Benchmark {name, function});
+  }
+};
+
+/**
+ * @brief Define and register a benchmark.
+ * @param name The name used for filtering and reporting.
+ */
+#define OVENBRICK_BENCHMARK(name) \
+  static void OVENBRICK_CONCAT(ovenbrickBenchmark, __LINE__)(BenchmarkContext &); \
+  static BenchmarkRegistration const OVENBRICK_CONCAT(ovenbrickBenchmarkRegistration, __LINE__) { \
+    name, &OVENBRICK_CONCAT(ovenbrickBenchmark, __LINE__) \
+  }; \
+  static void OVENBRICK_CONCAT(ovenbrickBenchmark, __LINE__)(BenchmarkContext & context)
+
+#endif // OVENBRICK_BENCHMARK_HXX
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "benchmark.hxx"
+
+#include "../game/card_database.hxx"
+
+namespace {
+  constexpr CardId CARD_COUNT = 4096; ///< A generously sized card library.
+
+  std::unique_ptr<CardDatabase> make_database()
+  {
+    std::vector<CardDefinition> cards {};
+    for (CardId id = 1; id <= CARD_COUNT; ++id)
+    {
+      auto const type = static_cast<CardType>(id % CARD_TYPE_COUNT);
+      auto const cost = static_cast<std::uint8_t>(id % 11);
+      auto const keywords = keyword_bit(static_cast<Keyword>(id % KEYWORD_COUNT));
+      cards.push_back(CardDefinition {id, "Card", type, cost, 3, 3, keywords, "Some rules text."});
+    }
+
+    std::ostringstream out {};
+    CardDatabase::write(out, cards);
+    auto const image = out.str();
+    auto const buffer = std::make_shared<std::vector<char>>(image.begin(), image.end());
+    return std::unique_ptr<CardDatabase> {new CardDatabase {Asset {buffer, buffer->data(), buffer->size()}}};
+  }
+}
+
+OVENBRICK_BENCHMARK("cards/find_by_id")
+{
+  auto const cards = make_database();
+  CardId id = 0;
+  for (std::uint64_t n = 0; n < context.iterations(); ++n)
+  {
+    id = id % CARD_COUNT + 1;
+    context.measure([&cards, id] { static_cast<void>(cards->find(id)); });
+    context.next_frame();
+  }
+}
+
+OVENBRICK_BENCHMARK("cards/deck_builder_filter")
+{
+  // cheap minions with taunt, as a deck builder filter would ask for them
+  auto const cards = make_database();
+  std::uint64_t found = 0;
+  for (std::uint64_t n = 0; n < context.iterations(); ++n)
+  {
+    context.measure([&cards, &found] {
+      for (auto const index : cards->costing(0, 3))
+        if (cards->type(index) == CardType::Minion && cards->has(index, Keyword::Taunt))
+          ++found;
+    });
+    context.next_frame();
+  }
+  static_cast<void>(found);
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <memory>
+#include <typeinfo>
+
+#include <ddic.hxx>
+
+#include "benchmark.hxx"
+
+#include "../game/game_state_manager.hxx"
+
+namespace {
+  /**
+   * @brief Fill a container with a realistic amount of unrelated registrations.
+   */
+  template <std::size_t N>
+  struct Filler
+  {
+    static void register_with(ddic::container & c)
+    {
+      c.register_type<Filler<N>>();
+      Filler<N - 1>::register_with(c);
+    }
+  };
+
+  template <>
+  struct Filler<0>
+  {
+    static void register_with(ddic::container &)
+    {
+    }
+  };
+
+  std::shared_ptr<ddic::container> make_container()
+  {
+    auto const c = std::make_shared<ddic::container>();
+    Filler<32>::register_with(*c);
+    c->register_type<GameStateManager, ddic::creation_policy::always_same>();
+    return c;
+  }
+
+  template <typename Resolve>
+  void run(BenchmarkContext & context, Resolve resolve)
+  {
+    for (std::uint64_t n = 0; n < context.iterations(); ++n)
+    {
+      context.measure(resolve);
+      context.next_frame();
+    }
+  }
+}
+
+OVENBRICK_BENCHMARK("ddic/resolve_by_name")
+{
+  auto const c = make_container();
+  run(context, [&c] { c->resolve<GameStateManager>(typeid(GameStateManager).name()); });
+}
+
+OVENBRICK_BENCHMARK("ddic/resolve_by_type")
+{
+  auto const c = make_container();
+  run(context, [&c] { c->resolve<GameStateManager>(); });
+}
+
+OVENBRICK_BENCHMARK("ddic/resolve_by_name_through_parent")
+{
+  auto const c = make_container();
+  auto const child = std::make_shared<ddic::container>(c);
+  run(context, [&child] { child->resolve<GameStateManager>(typeid(GameStateManager).name()); });
+}
+
+OVENBRICK_BENCHMARK("ddic/resolve_by_type_through_parent")
+{
+  auto const c = make_container();
+  auto const child = std::make_shared<ddic::container>(c);
+  run(context, [&child] { child->resolve<GameStateManager>(); });
+}
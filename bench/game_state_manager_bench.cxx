@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdint>
+#include <memory>
+
+#include <SFML/System/Time.hpp>
+#include <SFML/Window/Event.hpp>
+
+#include <ddic.hxx>
+
+#include "benchmark.hxx"
+
+#include "../game/frame_scheduler.hxx"
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+
+namespace {
+  /**
+   * @brief A state doing just enough work to not be optimized away.
+   */
+  struct BenchGameState final : public GameState
+  {
+    using autowire = ddic::inject<GameStateManager>;
+
+    std::uint64_t m_checksum = 0;
+
+    explicit BenchGameState(std::shared_ptr<GameStateManager> gsm)
+        : GameState {std::move(gsm)}
+    {
+    }
+
+    void set_up() override
+    {
+      ++m_checksum;
+    }
+
+    void handle_event(sf::Event const & event) override
+    {
+      if (event.type == sf::Event::KeyPressed)
+        m_checksum += static_cast<std::uint64_t>(event.key.code);
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+      m_checksum += static_cast<std::uint64_t>(elapsed.asMicroseconds());
+    }
+
+    void render(float alpha) override
+    {
+      m_checksum += static_cast<std::uint64_t>(alpha * 100.f);
+    }
+
+    void tear_down() override
+    {
+      --m_checksum;
+    }
+  };
+
+  constexpr auto const EVENTS_PER_FRAME = 64;
+  constexpr auto const STACK_DEPTH = 32;
+
+  template <ddic::creation_policy Policy = ddic::creation_policy::always_new>
+  void configure_dependencies(ddic::container & c)
+  {
+    c.register_type<GameStateManager, ddic::creation_policy::always_same>();
+    c.autowire_type<BenchGameState, Policy>().reserve(STACK_DEPTH);
+  }
+
+  void clear(GameStateManager & gsm)
+  {
+    while (!gsm.is_empty())
+      gsm.pop_state();
+  }
+
+  template <ddic::creation_policy Policy>
+  void push_pop_churn(BenchmarkContext & context)
+  {
+    ddic::container c;
+    configure_dependencies<Policy>(c);
+    auto const gsm = c.resolve<GameStateManager>();
+
+    // each iteration is one screen transition, a full stack is unwound every STACK_DEPTH frames
+    for (std::uint64_t n = 0; n < context.iterations(); ++n)
+    {
+      if (n % (2 * STACK_DEPTH) < STACK_DEPTH)
+        context.measure([&c, &gsm] { gsm->push_state(c.resolve<BenchGameState>()); });
+      else
+        context.measure([&gsm] { gsm->pop_state(); });
+
+      gsm->update(sf::milliseconds(16));
+      context.next_frame();
+    }
+
+    clear(*gsm);
+  }
+}
+
+OVENBRICK_BENCHMARK("gsm/event_storm")
+{
+  ddic::container c;
+  configure_dependencies(c);
+  auto const gsm = c.resolve<GameStateManager>();
+  gsm->push_state(c.resolve<BenchGameState>());
+
+  sf::Event event {};
+  for (std::uint64_t n = 0; n < context.iterations(); ++n)
+  {
+    event.type = (n % 2) ? sf::Event::KeyReleased : sf::Event::KeyPressed;
+    event.key.code = static_cast<sf::Keyboard::Key>(n % sf::Keyboard::KeyCount);
+    context.measure([&gsm, &event] { gsm->handle_event(event); });
+
+    if (n % EVENTS_PER_FRAME == EVENTS_PER_FRAME - 1)
+    {
+      gsm->update(sf::milliseconds(16));
+      gsm->render(0.f);
+      context.next_frame();
+    }
+  }
+
+  clear(*gsm);
+}
+
+OVENBRICK_BENCHMARK("gsm/push_pop_churn")
+{
+  push_pop_churn<ddic::creation_policy::always_new>(context);
+}
+
+OVENBRICK_BENCHMARK("gsm/push_pop_churn_pooled")
+{
+  push_pop_churn<ddic::creation_policy::pooled>(context);
+}
+
+OVENBRICK_BENCHMARK("gsm/long_update")
+{
+  ddic::container c;
+  configure_dependencies(c);
+  auto const gsm = c.resolve<GameStateManager>();
+  gsm->push_state(c.resolve<BenchGameState>());
+
+  FrameRate rate {};
+  rate.m_tickRate = 60;
+
+  // simulated time advances by exactly one tick per frame
+  sf::Time now {};
+  FrameScheduler scheduler {rate, [&now] { return now; }, [](sf::Time const &) {}};
+  auto const tick = scheduler.tick_duration();
+  auto const nothing = [] {};
+
+  for (std::uint64_t n = 0; n < context.iterations(); ++n)
+  {
+    now += tick;
+    context.measure([&] { scheduler.run_frame(*gsm, nothing, nothing); });
+    context.next_frame();
+  }
+
+  clear(*gsm);
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <vector>
+
+#include "benchmark.hxx"
+
+#include "../game/job_system.hxx"
+
+namespace {
+  constexpr std::size_t FAN_OUT = 64; ///< Jobs per frame in jobs/fan_out.
+
+  void report(BenchmarkContext & context, JobSystem const & jobs)
+  {
+    auto const statistics = jobs.statistics();
+    context.report("threads", jobs.thread_count());
+    context.report("executed", static_cast<double>(statistics.m_executed));
+    context.report("stolen", static_cast<double>(statistics.m_stolen));
+    context.report("helped", static_cast<double>(statistics.m_helped));
+  }
+}
+
+OVENBRICK_BENCHMARK("jobs/schedule_wait")
+{
+  JobSystem jobs {JobSystem::Settings {}};
+  for (std::uint64_t n = 0; n < context.iterations(); ++n)
+  {
+    // the round trip of a single empty job
+    context.measure([&jobs] { jobs.wait(jobs.schedule([] {})); });
+    context.next_frame();
+  }
+  report(context, jobs);
+}
+
+OVENBRICK_BENCHMARK("jobs/fan_out")
+{
+  JobSystem jobs {JobSystem::Settings {}};
+  std::vector<JobHandle> handles {};
+  handles.reserve(FAN_OUT);
+  for (std::uint64_t n = 0; n < context.iterations(); n += FAN_OUT)
+  {
+    context.measure([&jobs, &handles] {
+      handles.clear();
+      for (std::size_t job = 0; job < FAN_OUT; ++job)
+        handles.push_back(jobs.schedule([] {}));
+      jobs.wait(jobs.schedule([] {}, handles));
+    });
+    context.next_frame();
+  }
+  context.report("jobs_per_operation", FAN_OUT + 1);
+  report(context, jobs);
+}
+
+OVENBRICK_BENCHMARK("jobs/nested")
+{
+  JobSystem jobs {JobSystem::Settings {}};
+  for (std::uint64_t n = 0; n < context.iterations(); n += FAN_OUT)
+  {
+    // every job schedules a child and waits for it, which the workers steal or run themselves
+    context.measure([&jobs] {
+      jobs.parallel_for(FAN_OUT, 1, [&jobs](std::size_t) { jobs.wait(jobs.schedule([] {})); });
+    });
+    context.next_frame();
+  }
+  context.report("jobs_per_operation", 2 * FAN_OUT);
+  report(context, jobs);
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <memory>
+#include <streambuf>
+#include <string>
+
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/make_shared.hpp>
+
+#include "benchmark.hxx"
+
+#include "../game/async_log.hxx"
+
+namespace {
+  class NullBuffer final : public std::streambuf
+  {
+  protected:
+    std::streamsize xsputn(char const * /* text */, std::streamsize const count) override
+    {
+      return count;
+    }
+
+    int_type overflow(int_type const c) override
+    {
+      return traits_type::not_eof(c);
+    }
+  };
+}
+
+OVENBRICK_BENCHMARK("log/async_record")
+{
+  NullBuffer buffer {};
+  auto const log = std::make_shared<AsyncLog>(std::unique_ptr<std::ostream> {new std::ostream {&buffer}},
+                                              AsyncLog::Settings {});
+  auto const sink = boost::make_shared<boost::log::sinks::unlocked_sink<AsyncLogBackend>>(
+      boost::make_shared<AsyncLogBackend>(log));
+  boost::log::core::get()->add_sink(sink);
+
+  for (std::uint64_t n = 0; n < context.iterations(); ++n)
+  {
+    // a typical per-move record, formatted on the calling thread
+    context.measure([n] { BOOST_LOG_TRIVIAL(info) << "Computer: Play card " << n << " on the enemy hero"; });
+    context.next_frame();
+  }
+
+  boost::log::core::get()->flush();
+  boost::log::core::get()->remove_sink(sink);
+  context.report("dropped", static_cast<double>(log->dropped()));
+}
@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hxx"
+
+#include "../game/card_database.hxx"
+#include "../game/job_system.hxx"
+#include "../game/match.hxx"
+#include "../game/match_simulator.hxx"
+#include "../game/mcts.hxx"
+
+namespace {
+  constexpr std::uint64_t PLAYOUTS_PER_SEARCH = 256; ///< Per thread.
+
+  std::unique_ptr<CardDatabase> make_database()
+  {
+    // a cut down version of the shipped cards
+    std::vector<CardDefinition> cards {
+        {1, "Crumb Goblin", CardType::Minion, 1, 1, 2, 0, ""},
+        {2, "Pantry Guard", CardType::Minion, 2, 1, 4, keyword_bit(Keyword::Taunt), ""},
+        {3, "Hasty Baker", CardType::Minion, 2, 3, 1, keyword_bit(Keyword::Charge), ""},
+        {4, "Glazed Knight", CardType::Minion, 3, 2, 3, keyword_bit(Keyword::DivineShield), ""},
+        {6, "Oven Mitt Brawler", CardType::Minion, 4, 3, 5, keyword_bit(Keyword::Taunt) | keyword_bit(Keyword::Lifesteal), ""},
+        {7, "Twin Whisk", CardType::Minion, 4, 2, 4, keyword_bit(Keyword::Windfury), ""},
+        {9, "Burnt Edge Assassin", CardType::Minion, 3, 1, 3, keyword_bit(Keyword::Stealth) | keyword_bit(Keyword::Poisonous), ""},
+        {10, "Rolling Pin Rider", CardType::Minion, 5, 5, 3, keyword_bit(Keyword::Rush), ""},
+        {11, "Great Brick Oven", CardType::Minion, 8, 8, 8, keyword_bit(Keyword::Taunt), ""},
+        {102, "Scorch", CardType::Spell, 2, 3, 0, 0, ""},
+        {103, "Kitchen Fire", CardType::Spell, 5, 6, 0, 0, ""},
+    };
+
+    std::ostringstream out {};
+    CardDatabase::write(out, cards);
+    auto const image = out.str();
+    auto const buffer = std::make_shared<std::vector<char>>(image.begin(), image.end());
+    return std::unique_ptr<CardDatabase> {new CardDatabase {Asset {buffer, buffer->data(), buffer->size()}}};
+  }
+
+  /**
+   * @brief A match a few turns in, so there is something on the board to think about.
+   */
+  Match make_midgame(CardDatabase const & cards)
+  {
+    Match match {cards, Match::random_deck(cards, 1), Match::random_deck(cards, 2), 3};
+    MoveList moves {};
+    while (match.turn() < 9 && !match.is_over())
+    {
+      match.legal_moves(moves);
+      match.apply(moves[moves.size() - 1]);
+    }
+    return match;
+  }
+}
+
+OVENBRICK_BENCHMARK("mcts/random_playout")
+{
+  auto const cards = make_database();
+  auto const start = make_midgame(*cards);
+  MoveList moves {};
+  std::uint64_t choice = 0;
+  for (std::uint64_t n = 0; n < context.iterations(); n += 100)
+  {
+    context.measure([&] {
+      auto match = start;
+      while (!match.is_over())
+      {
+        match.legal_moves(moves);
+        choice = choice * 6364136223846793005u + 1442695040888963407u;
+        match.apply(moves[(choice >> 33u) % moves.size()]);
+      }
+    });
+    context.next_frame();
+  }
+}
+
+OVENBRICK_BENCHMARK("mcts/playouts_per_core")
+{
+  auto const cards = make_database();
+  auto const match = make_midgame(*cards);
+
+  MctsSearch::Settings settings {};
+  settings.m_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  settings.m_budget = std::chrono::hours {1};
+  settings.m_maxPlayouts = PLAYOUTS_PER_SEARCH;
+  MctsSearch search {settings};
+
+  std::uint64_t playouts = 0;
+  std::chrono::nanoseconds elapsed {0};
+  for (std::uint64_t n = 0; n < context.iterations(); n += 1000)
+  {
+    context.measure([&search, &match] {
+      search.start(match);
+      static_cast<void>(search.result());
+    });
+    playouts += search.statistics().m_playouts;
+    elapsed += search.statistics().m_elapsed;
+    context.next_frame();
+  }
+
+  auto const seconds = std::chrono::duration<double> {elapsed}.count();
+  context.report("threads", settings.m_threads);
+  context.report("playouts", static_cast<double>(playouts));
+  context.report("playouts_per_second_per_core", seconds > 0.0 ? playouts / seconds / settings.m_threads : 0.0);
+}
+
+OVENBRICK_BENCHMARK("mcts/simulate")
+{
+  auto const cards = make_database();
+  JobSystem jobs {JobSystem::Settings {}};
+
+  MatchSimulator::Settings settings {};
+  settings.m_matches = 8;
+  settings.m_computer.m_budget = std::chrono::hours {1};
+  settings.m_computer.m_maxPlayouts = 16;
+  MatchSimulator const simulator {*cards, settings};
+
+  std::uint64_t matches = 0;
+  std::chrono::nanoseconds elapsed {0};
+  for (std::uint64_t n = 0; n < context.iterations(); n += 1000)
+  {
+    MatchSimulator::Statistics statistics {};
+    context.measure([&simulator, &jobs, &statistics] {
+      statistics = simulator.run(jobs);
+    });
+    matches += statistics.m_matches;
+    elapsed += statistics.m_elapsed;
+    context.next_frame();
+  }
+
+  auto const threads = jobs.thread_count() + 1;
+  auto const seconds = std::chrono::duration<double> {elapsed}.count();
+  context.report("threads", threads);
+  context.report("matches", static_cast<double>(matches));
+  context.report("matches_per_second_per_core", seconds > 0.0 ? matches / seconds / threads : 0.0);
+}
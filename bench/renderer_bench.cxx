@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <vector>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include "benchmark.hxx"
+
+#include "../game/renderer.hxx"
+
+namespace {
+  constexpr unsigned WIDTH = 320;
+  constexpr unsigned HEIGHT = 240;
+
+  /**
+   * @brief Two boards of seven cards and a hand of ten, each card with a few glyph sized quads on top.
+   */
+  std::vector<Sprite> card_table(sf::Texture const & cards, sf::Texture const & glyphs)
+  {
+    std::vector<Sprite> sprites {};
+    auto const add_card = [&](float const x, float const y, float const width, float const height) {
+      sprites.push_back(Sprite {sf::FloatRect {x, y, width, height}, sf::FloatRect {0.f, 0.f, 64.f, 64.f}, &cards});
+      for (unsigned n = 0; n < 8; ++n)
+        sprites.push_back(Sprite {sf::FloatRect {x + 2.f + 5.f * n, y + 2.f, 5.f, 8.f},
+                                  sf::FloatRect {5.f * n, 0.f, 5.f, 8.f}, &glyphs, sf::Color::Black, 1});
+    };
+
+    for (unsigned n = 0; n < 7; ++n)
+    {
+      add_card(4.f + 45.f * n, 16.f, 42.f, 50.f);
+      add_card(4.f + 45.f * n, 72.f, 42.f, 50.f);
+    }
+    for (unsigned n = 0; n < 10; ++n)
+      add_card(4.f + 31.f * n, 142.f, 29.f, 44.f);
+    return sprites;
+  }
+
+  struct Scene final
+  {
+    sf::RenderTexture m_screen;
+    sf::Texture m_cards;
+    sf::Texture m_glyphs;
+    std::vector<Sprite> m_sprites;
+
+    Scene()
+    {
+      m_screen.create(WIDTH, HEIGHT);
+      m_cards.create(64, 64);
+      m_glyphs.create(64, 64);
+      m_sprites = card_table(m_cards, m_glyphs);
+    }
+  };
+}
+
+OVENBRICK_BENCHMARK("render/static_table")
+{
+  Scene scene {};
+  Renderer renderer {sf::Vector2u {WIDTH, HEIGHT}};
+  for (std::uint64_t n = 0; n < context.iterations(); n += 10)
+  {
+    context.measure([&] {
+      for (auto const & sprite : scene.m_sprites)
+        renderer.draw(sprite);
+      renderer.present(scene.m_screen);
+    });
+    context.next_frame();
+  }
+  context.report("redrawn_items_last_frame", static_cast<double>(renderer.statistics().m_redrawnItems));
+}
+
+OVENBRICK_BENCHMARK("render/one_card_changes")
+{
+  Scene scene {};
+  Renderer renderer {sf::Vector2u {WIDTH, HEIGHT}};
+  std::uint64_t redrawn = 0;
+  std::uint64_t drawCalls = 0;
+  for (std::uint64_t n = 0; n < context.iterations(); n += 10)
+  {
+    // a card in hand is highlighted, one after the other
+    auto & highlighted = scene.m_sprites[(14 + n / 10 % 10) * 9];
+    highlighted.m_color = sf::Color::Yellow;
+    context.measure([&] {
+      for (auto const & sprite : scene.m_sprites)
+        renderer.draw(sprite);
+      renderer.present(scene.m_screen);
+    });
+    highlighted.m_color = sf::Color::White;
+    redrawn += renderer.statistics().m_redrawnItems;
+    drawCalls += renderer.statistics().m_drawCalls;
+    context.next_frame();
+  }
+  auto const frames = static_cast<double>(context.frames());
+  context.report("redrawn_items_per_frame", frames > 0.0 ? redrawn / frames : 0.0);
+  context.report("draw_calls_per_frame", frames > 0.0 ? drawCalls / frames : 0.0);
+  context.report("items_per_frame", static_cast<double>(scene.m_sprites.size()));
+}
+
+OVENBRICK_BENCHMARK("render/full_redraw")
+{
+  Scene scene {};
+  Renderer renderer {sf::Vector2u {WIDTH, HEIGHT}};
+  for (std::uint64_t n = 0; n < context.iterations(); n += 10)
+  {
+    renderer.invalidate();
+    context.measure([&] {
+      for (auto const & sprite : scene.m_sprites)
+        renderer.draw(sprite);
+      renderer.present(scene.m_screen);
+    });
+    context.next_frame();
+  }
+  context.report("draw_calls_per_frame", static_cast<double>(renderer.statistics().m_drawCalls));
+}
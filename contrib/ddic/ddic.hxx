@@ -19,7 +19,11 @@
 #define DDIC_HXX
 
 #include "ddic_creation_policy.hxx"
+#include "ddic_threading_policy.hxx"
+#include "ddic_type_id.hxx"
+#include "ddic_pool.hxx"
 #include "ddic_factory.hxx"
+#include "ddic_factory_table.hxx"
 #include "ddic_register_proxy.hxx"
 #include "ddic_container.hxx"
 
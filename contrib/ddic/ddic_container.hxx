@@ -19,9 +19,18 @@
 #define DDIC_CONTAINER_HXX
 
 #include "ddic_factory.hxx"
+#include "ddic_factory_table.hxx"
 #include "ddic_register_proxy.hxx"
+#include "ddic_threading_policy.hxx"
+#include "ddic_type_id.hxx"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <typeinfo>
 #include <type_traits>
@@ -51,11 +60,26 @@ namespace ddic
    *
    * Objects of this class manage types registered with them
    * and help managing dependencies.
+   *
+   * With threading_policy::multi_threaded the registered factories are kept in an immutable snapshot.
+   * Registrations copy the snapshot and publish the modified copy, so resolutions do not wait for
+   * the copy being modified, only for the exchange of the snapshot pointer.
+   * That exchange uses std::atomic_load/std::atomic_store on std::shared_ptr, which is not lock-free
+   * with common standard libraries (libstdc++ guards it with a small pool of mutexes).
    */
   class container
   {
   public:
-    container() {} ///< Default constructor.
+    /**
+     * \brief Default constructor.
+     *
+     * \param[in] threading Declare whether the container is shared between threads.
+     */
+    container(threading_policy threading = threading_policy::single_threaded)
+        : threading_(threading)
+        , registry_(std::make_shared<registry>())
+        , epoch_(std::make_shared<std::atomic<std::size_t>>(0))
+    {}
 
     /**
      * \brief Constructor taking parent container.
@@ -65,10 +89,21 @@ namespace ddic
      * the request is propagated to its parent.
      *
      * \param[in] parent The parent container.
+     * \param[in] threading Declare whether the container is shared between threads.
+     *
+     * \throws std::invalid_argument if a multi_threaded container is given a single_threaded parent.
+     *  Resolving through the parent updates its caches, which must be safe from any thread then.
      */
-    container(std::weak_ptr<container> && parent)
+    container(std::weak_ptr<container> && parent, threading_policy threading = threading_policy::single_threaded)
         : parent_(std::move(parent))
-    {}
+        , threading_(threading)
+        , registry_(std::make_shared<registry>())
+        , epoch_(family_epoch(parent_))
+    {
+      auto const locked = parent_.lock();
+      if (threading_ == threading_policy::multi_threaded && locked && locked->threading() == threading_policy::single_threaded)
+        throw std::invalid_argument("a multi_threaded ddic::container needs a multi_threaded parent");
+    }
 
     // non copyable and non movable
     container(container const &) = delete;
@@ -92,8 +127,7 @@ namespace ddic
     -> typename std::enable_if<std::is_default_constructible<Type>::value, register_proxy>::type
     {
       auto factory = std::make_shared<default_factory<Type, Policy>>();
-      factories_[typeid(Type).name()] = factory;
-      return register_proxy(factory, *this);
+      return add<Type>(factory);
     }
 
     /**
@@ -114,8 +148,7 @@ namespace ddic
     -> typename std::enable_if<std::is_copy_constructible<Type>::value, register_proxy>::type
     {
       auto factory = std::make_shared<prototype_factory<Type, Policy>>(proto);
-      factories_[typeid(Type).name()] = factory;
-      return register_proxy(factory, *this);
+      return add<Type>(factory);
     }
 
     /**
@@ -135,8 +168,7 @@ namespace ddic
     register_proxy register_type(std::function<Type* (container &)> const & fn)
     {
       auto factory = std::make_shared<functor_factory<container, Type, Policy>>(fn, *this);
-      factories_[typeid(Type).name()] = factory;
-      return register_proxy(factory, *this);
+      return add<Type>(factory);
     }
 
     /**
@@ -157,9 +189,8 @@ namespace ddic
     template <typename Type, creation_policy Policy = creation_policy::always_new, typename... Types>
     register_proxy register_type(inject<Types...> const &)
     {
-      return register_type<Type, Policy>([](container & c) {
-        return new Type(c.resolve<Types>()...);
-      });
+      auto factory = std::make_shared<inject_factory<container, Type, Policy, Types...>>(*this);
+      return add<Type>(factory);
     }
 
     /**
@@ -184,12 +215,48 @@ namespace ddic
     }
 
     /**
-     * \brief Resolve a dependency.
+     * \brief Resolve a dependency by type.
+     *
+     * This function checks if a factory for Type is known to the container
+     * or any of its parents. If so, the dependency is instantiated according to the
+     * creation policy used at registration.
+     * The lookup is keyed by ddic::type_id_of<Type>(), so no strings are involved.
+     * Factories found in a parent are cached, so later resolutions stay local.
+     * Types that cannot be resolved are remembered as well, until anything is registered
+     * with the container, its parents or their children.
+     *
+     * \tparam[in] Type The type of the dependency to be resolved.
+     *
+     * \return If the dependency was resolved, an instance of the dependency, otherwise an empty std::shared_ptr.
+     *
+     * \remark The cache assumes parents do not replace registrations their children already resolved.
+     * \remark Once a parent is destroyed, nothing is resolved through it anymore, cached or not.
+     */
+    template <typename Type>
+    std::shared_ptr<Type> resolve()
+    {
+      auto const id = type_id_of<Type>();
+      // read before looking anything up, so registrations meanwhile invalidate what is learned
+      auto const epoch = epoch_->load(std::memory_order_acquire);
+      auto const factory = find_factory(id);
+      if (factory)
+        return std::static_pointer_cast<Type>(factory->create());
+      if (is_unknown(*snapshot(), id))
+        return std::shared_ptr<Type>();
+
+      // it might still be known by its (mangled) name only
+      auto instance = resolve<Type>(typeid(Type).name());
+      if (!instance)
+        remember_unknown(id, epoch);
+      return instance;
+    }
+
+    /**
+     * \brief Resolve a dependency by name.
      *
      * This function checks if a factory with the provided name is known to the container
      * or any of its parents. If so, the dependency is instantiated according to the
      * creation policy used at registration.
-     * If no name is provided, the implementation defined type name of Type is used.
      *
      * \tparam[in] Type The type of the dependency to be resolved.
      *
@@ -198,25 +265,267 @@ namespace ddic
      * \return If the dependency was resolved, an instance of the dependency, otherwise an empty std::shared_ptr.
      */
     template <typename Type>
-    std::shared_ptr<Type> resolve(std::string const & name = typeid(Type).name())
+    std::shared_ptr<Type> resolve(std::string const & name)
     {
       // try resolving it here
-      auto it = factories_.find(name);
-      if (it != factories_.end())
+      auto const current = snapshot();
+      auto it = current->factories.find(name);
+      if (it != current->factories.end())
         return std::static_pointer_cast<Type>(it->second->create());
 
       // maybe the parent can
       auto parent = parent_.lock();
       if (parent)
-        return parent->resolve<Type>();
+        return parent->resolve<Type>(name);
 
       // nope, cannot resolve the requested thing
       return std::shared_ptr<Type>();
     }
 
+    /**
+     * \return The threading policy the container was created with.
+     */
+    threading_policy threading() const
+    {
+      return threading_;
+    }
+
   private:
+    /**
+     * \brief All factories known to a container.
+     */
+    struct registry
+    {
+      std::unordered_map<std::string, std::shared_ptr<abstract_factory>> factories; ///< All the registered factories by name.
+      factory_table types; ///< All the registered factories by type.
+      factory_table inherited; ///< Factories already resolved through the parents.
+      std::vector<type_id> unknown; ///< Sorted identifiers of types that could not be resolved.
+      std::size_t unknown_epoch = 0; ///< The epoch unknown was learned in, it is outdated once the epoch moves on.
+    };
+
+    /**
+     * \brief Share the registration counter of the parent.
+     *
+     * \param[in] parent The parent container.
+     *
+     * \return The counter of the parent or a new one, if there is no parent.
+     */
+    static std::shared_ptr<std::atomic<std::size_t>> family_epoch(std::weak_ptr<container> const & parent)
+    {
+      auto const locked = parent.lock();
+      if (locked)
+        return locked->epoch_;
+      return std::make_shared<std::atomic<std::size_t>>(0);
+    }
+
+    /**
+     * \brief Acquire the current registry.
+     *
+     * \return The registry, which stays valid even if registrations happen meanwhile.
+     */
+    std::shared_ptr<registry const> snapshot() const
+    {
+      if (threading_ == threading_policy::multi_threaded)
+        return std::atomic_load(&registry_);
+      return registry_;
+    }
+
+    /**
+     * \brief Apply a modification to the registry.
+     *
+     * Single threaded containers are modified in place.
+     * Otherwise the registry is copied, modified and published again, concurrent modifications wait for each other.
+     *
+     * \param[in] fn Function object modifying the registry.
+     */
+    template <typename Fn>
+    void modify(Fn && fn)
+    {
+      if (threading_ == threading_policy::single_threaded)
+      {
+        fn(*registry_);
+        return;
+      }
+
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      auto copy = std::make_shared<registry>(*std::atomic_load(&registry_));
+      fn(*copy);
+      std::atomic_store(&registry_, std::move(copy));
+    }
+
+    /**
+     * \brief Make a factory known by type and by name.
+     *
+     * \tparam[in] Type The registered type.
+     *
+     * \param[in] factory The factory for Type.
+     *
+     * \return A proxy for registering aliases.
+     */
+    template <typename Type>
+    register_proxy add(std::shared_ptr<abstract_factory> const & factory)
+    {
+      add(type_id_of<Type>(), typeid(Type).name(), factory);
+      return register_proxy(factory, *this);
+    }
+
+    /**
+     * \brief Make a factory known by type and by name.
+     *
+     * \param[in] id The identifier of the type.
+     * \param[in] name The name of the type.
+     * \param[in] factory The factory for the type.
+     */
+    void add(type_id id, std::string const & name, std::shared_ptr<abstract_factory> const & factory)
+    {
+      modify([&](registry & r) {
+        r.types.insert(id, factory);
+        r.factories[name] = factory;
+      });
+      epoch_->fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * \brief Make a factory known by name only.
+     *
+     * \param[in] name The name under which the factory is registered.
+     * \param[in] factory The factory.
+     */
+    void add(std::string const & name, std::shared_ptr<abstract_factory> const & factory)
+    {
+      modify([&](registry & r) {
+        r.factories[name] = factory;
+      });
+      epoch_->fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * \brief Check whether a type is known to be unresolvable.
+     *
+     * \param[in] current The registry to check.
+     * \param[in] id The identifier of the type.
+     *
+     * \return Whether resolving the type failed since the last registration.
+     */
+    bool is_unknown(registry const & current, type_id id) const
+    {
+      return current.unknown_epoch == epoch_->load(std::memory_order_acquire)
+          && std::binary_search(current.unknown.cbegin(), current.unknown.cend(), id, std::less<type_id>());
+    }
+
+    /**
+     * \brief Remember that a type could not be resolved.
+     *
+     * \param[in] id The identifier of the type.
+     * \param[in] epoch The epoch read before the type was looked up.
+     */
+    void remember_unknown(type_id id, std::size_t epoch)
+    {
+      modify([id, epoch](registry & r) {
+        if (r.unknown_epoch != epoch)
+        {
+          r.unknown.clear();
+          r.unknown_epoch = epoch;
+        }
+
+        auto const it = std::lower_bound(r.unknown.cbegin(), r.unknown.cend(), id, std::less<type_id>());
+        if (it == r.unknown.cend() || *it != id)
+          r.unknown.insert(it, id);
+      });
+    }
+
+    /**
+     * \brief Factory cached from a parent container.
+     *
+     * Factories may refer to the container they were registered with.
+     * The parent is kept alive while an instance is created, once it is gone nothing is created anymore.
+     */
+    class inherited_factory final
+        : public abstract_factory
+    {
+    public:
+      /**
+       * \param[in] owner The parent the factory was found in.
+       * \param[in] factory The factory found in the parent.
+       */
+      inherited_factory(std::weak_ptr<container> const & owner, std::shared_ptr<abstract_factory> && factory)
+          : owner_(owner)
+          , factory_(std::move(factory))
+          , next_(std::dynamic_pointer_cast<inherited_factory>(factory_))
+      {}
+
+      std::shared_ptr<void> create() override
+      {
+        auto const owner = owner_.lock();
+        if (!owner)
+          return std::shared_ptr<void>();
+        return factory_->create();
+      }
+
+      void reserve(std::size_t count) override
+      {
+        factory_->reserve(count);
+      }
+
+      /**
+       * \return Whether the parent or any container further up the factory came from is gone.
+       */
+      bool expired() const
+      {
+        return owner_.expired() || (next_ && next_->expired());
+      }
+
+    private:
+      std::weak_ptr<container> owner_; ///< The parent the factory was found in.
+      std::shared_ptr<abstract_factory> factory_; ///< The factory found in the parent.
+      std::shared_ptr<inherited_factory const> next_; ///< Set if the parent inherited the factory itself.
+    };
+
+    /**
+     * \brief Find the factory for a type here, in the cache or in the parents.
+     *
+     * Factories found in the parents are added to the cache.
+     * Cached factories whose parent is gone are dropped, the type is unknown then.
+     *
+     * \param[in] id The identifier of the requested type.
+     *
+     * \return The factory or an empty std::shared_ptr, if the type is unknown.
+     */
+    std::shared_ptr<abstract_factory> find_factory(type_id id)
+    {
+      auto const current = snapshot();
+      auto factory = current->types.find_shared(id);
+      if (factory)
+        return factory;
+
+      factory = current->inherited.find_shared(id);
+      if (factory)
+      {
+        if (!std::static_pointer_cast<inherited_factory>(factory)->expired())
+          return factory;
+        modify([id](registry & r) { r.inherited.erase(id); });
+      }
+      if (is_unknown(*current, id))
+        return std::shared_ptr<abstract_factory>();
+
+      auto parent = parent_.lock();
+      if (!parent)
+        return std::shared_ptr<abstract_factory>();
+
+      factory = parent->find_factory(id);
+      if (!factory)
+        return factory;
+
+      factory = std::make_shared<inherited_factory>(parent_, std::move(factory));
+      modify([&](registry & r) { r.inherited.insert(id, factory); });
+      return factory;
+    }
+
     std::weak_ptr<container> parent_; ///< Pointer to the parent container.
-    std::unordered_map<std::string, std::shared_ptr<abstract_factory>> factories_; ///< All the registered factories.
+    threading_policy const threading_; ///< Whether the container is shared between threads.
+    std::shared_ptr<registry> registry_; ///< All known factories, replaced as a whole when shared between threads.
+    std::mutex write_mutex_; ///< Serializes modifications of shared containers.
+    std::shared_ptr<std::atomic<std::size_t>> const epoch_; ///< Counts registrations, shared by a container and all its descendants.
     friend class register_proxy; ///< The register_proxy is used to created aliases, so it needs to access some internals.
   };
 }
@@ -39,6 +39,7 @@ namespace ddic
   {
     always_new = 0, ///< \e resolve always returns a new instance of the registered type
     always_same = 1, ///< \e resolve always returns the same instance of the registered type (can be used for singletons)
+    pooled = 2, ///< \e resolve always returns a new instance of the registered type, placed in recycled storage
   };
 }
 
@@ -21,12 +21,16 @@
 #ifndef DDIC_FACTORY_HXX
 #define DDIC_FACTORY_HXX
 
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <type_traits>
 
 #include "ddic_creation_policy.hxx"
+#include "ddic_pool.hxx"
 
 namespace ddic
 {
@@ -50,6 +54,19 @@ namespace ddic
      * \return An instance of the registered type.
      **/
     virtual std::shared_ptr<void> create() = 0;
+
+    /**
+     * \brief pre-warms the factory.
+     *
+     * Only factories recycling storage (creation_policy::pooled) make use of this,
+     * all others ignore it.
+     *
+     * \param[in] count The number of instances to prepare storage for.
+     **/
+    virtual void reserve(std::size_t count)
+    {
+      static_cast<void>(count);
+    }
   };
 
   /**
@@ -99,17 +116,57 @@ namespace ddic
      *
      * When first called, this method creates a new instance of the registered type.
      * Subsequent calls will just return the existing instance.
+     * Concurrent first calls create exactly one instance, once it exists no locks are taken.
      **/
     virtual std::shared_ptr<void> create() override
     {
       // lazy creation
-      if (!instance_)
-        instance_ = std::make_shared<Type>();
+      if (!created_.load(std::memory_order_acquire))
+        std::call_once(once_, [this] {
+          instance_ = std::make_shared<Type>();
+          created_.store(true, std::memory_order_release);
+        });
       return instance_;
     }
 
   private:
     std::shared_ptr<Type> instance_; ///< The internally stored instance.
+    std::atomic<bool> created_{false}; ///< Whether instance_ was already created.
+    std::once_flag once_; ///< Guards the creation of instance_.
+  };
+
+  template <typename Type>
+  class default_factory<Type, creation_policy::pooled>
+      : public abstract_factory
+  {
+    static_assert(std::is_default_constructible<Type>::value, "Type must be default constructible!");
+
+  public:
+    default_factory()
+        : pool_(object_pool::make())
+    {
+    }
+
+    virtual ~default_factory() = default; ///< Default virtual destructor.
+
+    /**
+     * \brief creates a new instance of a registered type.
+     *
+     * This method creates a new instance of the registered type everytime it is called.
+     * The storage of released instances is reused.
+     **/
+    virtual std::shared_ptr<void> create() override
+    {
+      return std::allocate_shared<Type>(pool_allocator<Type>(pool_.get()));
+    }
+
+    virtual void reserve(std::size_t count) override
+    {
+      pool_->reserve(count);
+    }
+
+  private:
+    object_pool::handle pool_; ///< The storage of all instances.
   };
 
   /**
@@ -189,6 +246,46 @@ namespace ddic
     std::shared_ptr<Type> instance_; ///< Copy of the original prototype.
   };
 
+  template <typename Type>
+  class prototype_factory<Type, creation_policy::pooled>
+      : public abstract_factory
+  {
+    static_assert(std::is_copy_constructible<Type>::value, "Type must be copy constructible!");
+
+  public:
+    /**
+     * \brief takes a prototype instance and stores it for later use.
+     * \param[in] proto The prototype instance.
+     */
+    prototype_factory(Type const & proto)
+        : proto_(proto)
+        , pool_(object_pool::make())
+    {
+    }
+
+    virtual ~prototype_factory() = default; ///< Default virtual destructor.
+
+    /**
+     * \brief creates a new instance of a registered type.
+     *
+     * This method creates a new instance of the registered type by copying the stored prototype.
+     * The storage of released instances is reused.
+     **/
+    virtual std::shared_ptr<void> create() override
+    {
+      return std::allocate_shared<Type>(pool_allocator<Type>(pool_.get()), proto_);
+    }
+
+    virtual void reserve(std::size_t count) override
+    {
+      pool_->reserve(count);
+    }
+
+  private:
+    Type proto_; ///< The internally stored prototype.
+    object_pool::handle pool_; ///< The storage of all instances.
+  };
+
   /**
    * \author Felix Bytow
    * \brief is a factory for types with more complex construction.
@@ -261,11 +358,15 @@ namespace ddic
      *
      * When first called, this method calls the creator function object to create a new object of the registered type.
      * Subsequent calls simply return a pointer to that object.
+     * Concurrent first calls create exactly one object, once it exists no locks are taken.
      **/
     virtual std::shared_ptr<void> create() override
     {
-      if (!instance_)
-        instance_.reset(fn_(c_));
+      if (!created_.load(std::memory_order_acquire))
+        std::call_once(once_, [this] {
+          instance_.reset(fn_(c_));
+          created_.store(true, std::memory_order_release);
+        });
       return instance_;
     }
 
@@ -273,6 +374,139 @@ namespace ddic
     std::function<Type* (Container &)> fn_; ///< The creator function.
     Container & c_; ///< The DI container for dependency resolution.
     std::shared_ptr<Type> instance_; ///< The internally stored instance.
+    std::atomic<bool> created_{false}; ///< Whether instance_ was already created.
+    std::once_flag once_; ///< Guards the creation of instance_.
+  };
+
+  template <typename Container, typename Type>
+  class functor_factory<Container, Type, creation_policy::pooled>
+  {
+    static_assert(sizeof(Type) == 0, "Factory functions allocate on their own, use ddic::inject to pool instances!");
+  };
+
+  /**
+   * \author Felix Bytow
+   * \brief is a factory for types with an injection friendly constructor.
+   * \since 0.1.2
+   *
+   * This class is used when registering types with ddic::inject or an autowire typedef.
+   * Unlike a functor_factory it constructs the object itself,
+   * so there is no indirect call and the object shares its allocation with the reference count.
+   *
+   * \tparam Container The container type.
+   * \tparam Type The registered type.
+   * \tparam Policy The creation policy.
+   * \tparam Dependencies The types injected into the constructor.
+   */
+  template <typename Container, typename Type, creation_policy Policy, typename... Dependencies>
+  class inject_factory;
+
+  template <typename Container, typename Type, typename... Dependencies>
+  class inject_factory<Container, Type, creation_policy::always_new, Dependencies...>
+      : public abstract_factory
+  {
+  public:
+    /**
+     * \brief takes the container to resolve dependencies with.
+     * \param[in] c A DI container used to resolve dependencies.
+     */
+    inject_factory(Container & c)
+        : c_(c)
+    {
+    }
+
+    virtual ~inject_factory() = default; ///< Default virtual destructor.
+
+    /**
+     * \brief creates a new instance of a registered type.
+     *
+     * This method resolves the dependencies and creates a new instance everytime it is called.
+     **/
+    virtual std::shared_ptr<void> create() override
+    {
+      return std::make_shared<Type>(c_.template resolve<Dependencies>()...);
+    }
+
+  private:
+    Container & c_; ///< The DI container for dependency resolution.
+  };
+
+  template <typename Container, typename Type, typename... Dependencies>
+  class inject_factory<Container, Type, creation_policy::always_same, Dependencies...>
+      : public abstract_factory
+  {
+  public:
+    /**
+     * \brief takes the container to resolve dependencies with.
+     * \param[in] c A DI container used to resolve dependencies.
+     */
+    inject_factory(Container & c)
+        : c_(c)
+    {
+    }
+
+    virtual ~inject_factory() = default; ///< Default virtual destructor.
+
+    /**
+     * \brief creates a new instance of a registered type.
+     *
+     * When first called, this method resolves the dependencies and creates the instance.
+     * Subsequent calls simply return a pointer to that object.
+     * Concurrent first calls create exactly one object, once it exists no locks are taken.
+     **/
+    virtual std::shared_ptr<void> create() override
+    {
+      if (!created_.load(std::memory_order_acquire))
+        std::call_once(once_, [this] {
+          instance_ = std::make_shared<Type>(c_.template resolve<Dependencies>()...);
+          created_.store(true, std::memory_order_release);
+        });
+      return instance_;
+    }
+
+  private:
+    Container & c_; ///< The DI container for dependency resolution.
+    std::shared_ptr<Type> instance_; ///< The internally stored instance.
+    std::atomic<bool> created_{false}; ///< Whether instance_ was already created.
+    std::once_flag once_; ///< Guards the creation of instance_.
+  };
+
+  template <typename Container, typename Type, typename... Dependencies>
+  class inject_factory<Container, Type, creation_policy::pooled, Dependencies...>
+      : public abstract_factory
+  {
+  public:
+    /**
+     * \brief takes the container to resolve dependencies with.
+     * \param[in] c A DI container used to resolve dependencies.
+     */
+    inject_factory(Container & c)
+        : c_(c)
+        , pool_(object_pool::make())
+    {
+    }
+
+    virtual ~inject_factory() = default; ///< Default virtual destructor.
+
+    /**
+     * \brief creates a new instance of a registered type.
+     *
+     * This method resolves the dependencies and creates a new instance everytime it is called.
+     * The storage of released instances is reused.
+     **/
+    virtual std::shared_ptr<void> create() override
+    {
+      return std::allocate_shared<Type>(pool_allocator<Type>(pool_.get()), c_.template resolve<Dependencies>()...);
+    }
+
+    virtual void reserve(std::size_t count) override
+    {
+      pool_->reserve(count);
+    }
+
+  private:
+    Container & c_; ///< The DI container for dependency resolution.
+    object_pool::handle pool_; ///< The storage of all instances.
   };
 }
 
@@ -0,0 +1,131 @@
+#pragma once
+
+/*********************************************************************
+ * Copyright © 2015 - 2016, Felix Bytow <felix.bytow@googlemail.com> *
+ *                                                                   *
+ * See the file COPYING for copying permissions.                     *
+ *********************************************************************/
+
+/**
+ * \file ddic_factory_table.hxx
+ * \author Felix Bytow
+ * \since 0.1.2
+ * \brief Flat lookup table from type identifiers to factories.
+ *
+ * This file contains the ddic::factory_table class.
+ * It is used by ddic::container to resolve dependencies by type.
+ */
+
+#ifndef DDIC_FACTORY_TABLE_HXX
+#define DDIC_FACTORY_TABLE_HXX
+
+#include "ddic_factory.hxx"
+#include "ddic_type_id.hxx"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace ddic
+{
+  /**
+   * \author Felix Bytow
+   * \brief maps type identifiers to factories.
+   * \since 0.1.2
+   *
+   * The identifiers are kept sorted in one contiguous array,
+   * so a lookup is a binary search over a few cache lines.
+   * The factories are stored in a parallel array and only touched on a hit.
+   * Insertion is linear, which is fine as registration happens rarely compared to resolution.
+   */
+  class factory_table
+  {
+  public:
+    /**
+     * \brief Add or replace the factory for a type.
+     *
+     * \param[in] id The identifier of the type.
+     * \param[in] factory The factory creating instances of the type.
+     */
+    void insert(type_id id, std::shared_ptr<abstract_factory> const & factory)
+    {
+      auto const it = lower_bound(id);
+      auto const index = std::distance(ids_.cbegin(), it);
+      if (it != ids_.cend() && *it == id)
+      {
+        factories_[index] = factory;
+        return;
+      }
+
+      ids_.insert(it, id);
+      factories_.insert(factories_.cbegin() + index, factory);
+    }
+
+    /**
+     * \brief Forget the factory for a type.
+     *
+     * \param[in] id The identifier of the type.
+     */
+    void erase(type_id id)
+    {
+      auto const it = lower_bound(id);
+      if (it == ids_.cend() || *it != id)
+        return;
+
+      auto const index = std::distance(ids_.cbegin(), it);
+      ids_.erase(it);
+      factories_.erase(factories_.cbegin() + index);
+    }
+
+    /**
+     * \brief Look up the factory for a type.
+     *
+     * \param[in] id The identifier of the type.
+     *
+     * \return The factory or nullptr, if the type is unknown.
+     */
+    abstract_factory * find(type_id id) const
+    {
+      auto const it = lower_bound(id);
+      if (it == ids_.cend() || *it != id)
+        return nullptr;
+      return factories_[std::distance(ids_.cbegin(), it)].get();
+    }
+
+    /**
+     * \brief Look up the factory for a type including shared ownership.
+     *
+     * \param[in] id The identifier of the type.
+     *
+     * \return The factory or an empty std::shared_ptr, if the type is unknown.
+     */
+    std::shared_ptr<abstract_factory> find_shared(type_id id) const
+    {
+      auto const it = lower_bound(id);
+      if (it == ids_.cend() || *it != id)
+        return std::shared_ptr<abstract_factory>();
+      return factories_[std::distance(ids_.cbegin(), it)];
+    }
+
+    /**
+     * \return The number of known types.
+     */
+    std::size_t size() const
+    {
+      return ids_.size();
+    }
+
+  private:
+    std::vector<type_id>::const_iterator lower_bound(type_id id) const
+    {
+      return std::lower_bound(ids_.cbegin(), ids_.cend(), id, std::less<type_id>());
+    }
+
+    std::vector<type_id> ids_; ///< Sorted type identifiers.
+    std::vector<std::shared_ptr<abstract_factory>> factories_; ///< Factories, same order as ids_.
+  };
+}
+
+#endif // DDIC_FACTORY_TABLE_HXX
@@ -0,0 +1,106 @@
+/*********************************************************************
+ * Copyright © 2015 - 2016, Felix Bytow <felix.bytow@googlemail.com> *
+ *                                                                   *
+ * See the file COPYING for copying permissions.                     *
+ *********************************************************************/
+
+#include "ddic_pool.hxx"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ddic
+{
+  std::size_t const object_pool::default_reserve;
+
+  void * object_pool::allocate(std::size_t size)
+  {
+    std::lock_guard<spin_lock> lock(lock_);
+
+    if (slot_size_ == 0)
+    {
+      // round up, so every slot stays suitably aligned
+      auto const alignment = sizeof(std::max_align_t);
+      slot_size_ = (std::max(size, sizeof(free_slot)) + alignment - 1) / alignment * alignment;
+      grow(std::max<std::size_t>(reserve_, 1));
+    }
+    assert(size <= slot_size_);
+
+    if (!free_)
+      grow(std::max<std::size_t>(reserve_, 1));
+
+    auto const slot = free_;
+    free_ = slot->next;
+    --available_;
+    return slot;
+  }
+
+  void object_pool::deallocate(void * p) noexcept
+  {
+    bool unused = false;
+    {
+      std::lock_guard<spin_lock> lock(lock_);
+
+      auto const slot = new (p) free_slot;
+      slot->next = free_;
+      free_ = slot;
+      ++available_;
+      unused = released_ && available_ == capacity_;
+    }
+
+    // the last object outliving the owner turns off the lights
+    if (unused)
+      delete this;
+  }
+
+  void object_pool::reserve(std::size_t count)
+  {
+    std::lock_guard<spin_lock> lock(lock_);
+
+    reserve_ = count;
+    if (slot_size_ != 0 && capacity_ < count)
+      grow(count - capacity_);
+  }
+
+  std::size_t object_pool::capacity() const
+  {
+    std::lock_guard<spin_lock> lock(lock_);
+    return capacity_;
+  }
+
+  std::size_t object_pool::available() const
+  {
+    std::lock_guard<spin_lock> lock(lock_);
+    return available_;
+  }
+
+  void object_pool::release()
+  {
+    bool unused = false;
+    {
+      std::lock_guard<spin_lock> lock(lock_);
+      released_ = true;
+      unused = available_ == capacity_;
+    }
+
+    if (unused)
+      delete this;
+  }
+
+  void object_pool::grow(std::size_t count)
+  {
+    auto const units = slot_size_ / sizeof(std::max_align_t);
+    chunks_.emplace_back(new std::max_align_t[units * count]);
+
+    auto const memory = chunks_.back().get();
+    for (auto n = count; n--;)
+    {
+      auto const slot = new (memory + n * units) free_slot;
+      slot->next = free_;
+      free_ = slot;
+    }
+
+    capacity_ += count;
+    available_ += count;
+  }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+/*********************************************************************
+ * Copyright © 2015 - 2016, Felix Bytow <felix.bytow@googlemail.com> *
+ *                                                                   *
+ * See the file COPYING for copying permissions.                     *
+ *********************************************************************/
+
+/**
+ * \file ddic_pool.hxx
+ * \author Felix Bytow
+ * \since 0.1.2
+ * \brief Storage pools backing creation_policy::pooled.
+ *
+ * This file contains the ddic::object_pool class and the ddic::pool_allocator.
+ * Factories using creation_policy::pooled create their instances with std::allocate_shared
+ * and a pool_allocator, so the object and its reference count share one recycled slot.
+ */
+
+#ifndef DDIC_POOL_HXX
+#define DDIC_POOL_HXX
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace ddic
+{
+  /**
+   * \author Felix Bytow
+   * \brief is a minimal spin lock.
+   * \since 0.1.2
+   *
+   * Pool operations only take a handful of instructions,
+   * so spinning is cheaper than a std::mutex, whose overhead would dominate.
+   */
+  class spin_lock
+  {
+  public:
+    void lock()
+    {
+      while (flag_.test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+    }
+
+    void unlock()
+    {
+      flag_.clear(std::memory_order_release);
+    }
+
+  private:
+    std::atomic_flag flag_ = ATOMIC_FLAG_INIT; ///< Set while the lock is held.
+  };
+
+  /**
+   * \author Felix Bytow
+   * \brief hands out fixed size slots of memory and takes them back.
+   * \since 0.1.2
+   *
+   * The slot size is fixed by the first allocation, as the type actually allocated
+   * (the shared pointer control block including the object) is only known then.
+   * Memory is requested from the system in chunks of reserve() slots
+   * and only given back when the pool is destroyed.
+   */
+  class object_pool
+  {
+    struct releaser
+    {
+      void operator () (object_pool * pool) const
+      {
+        pool->release();
+      }
+    };
+
+  public:
+    static std::size_t const default_reserve = 8; ///< Slots per chunk if nothing else was requested.
+
+    /**
+     * \brief Owning handle of a pool.
+     *
+     * Destroying the handle destroys the pool as soon as all of its slots were returned,
+     * so pooled objects may outlive the factory that created them.
+     */
+    using handle = std::unique_ptr<object_pool, releaser>;
+
+    /**
+     * \brief Create a new pool.
+     *
+     * \return The handle owning the pool.
+     */
+    static handle make()
+    {
+      return handle(new object_pool());
+    }
+
+    // non copyable and non movable
+    object_pool(object_pool const &) = delete;
+    object_pool(object_pool &&) = delete;
+    object_pool & operator = (object_pool const &) = delete;
+    object_pool & operator = (object_pool &&) = delete;
+
+    /**
+     * \brief Take a slot out of the pool, growing the pool if necessary.
+     *
+     * \param[in] size The requested size, which must not change between calls.
+     *
+     * \return Storage for an object of the given size.
+     */
+    void * allocate(std::size_t size);
+
+    /**
+     * \brief Return a slot to the pool.
+     *
+     * \param[in] p Storage previously returned by allocate.
+     */
+    void deallocate(void * p) noexcept;
+
+    /**
+     * \brief Pre-warm the pool.
+     *
+     * Ensures there are at least count slots in total.
+     * If the slot size is not known yet, the slots are created on the first allocation.
+     * Later growth happens in steps of count slots as well.
+     *
+     * \param[in] count The number of slots.
+     */
+    void reserve(std::size_t count);
+
+    /**
+     * \return The number of slots created so far.
+     */
+    std::size_t capacity() const;
+
+    /**
+     * \return The number of slots currently not in use.
+     */
+    std::size_t available() const;
+
+  private:
+    struct free_slot
+    {
+      free_slot * next; ///< The next unused slot.
+    };
+
+    object_pool() = default; ///< Pools are only created through make().
+
+    void grow(std::size_t count); ///< Add count slots, requires the lock to be held.
+    void release(); ///< Called when the owning handle is gone.
+
+    mutable spin_lock lock_; ///< Guards all of the following.
+    std::size_t slot_size_ = 0; ///< Size of a single slot, 0 until the first allocation.
+    std::size_t reserve_ = default_reserve; ///< Slots per chunk.
+    std::size_t capacity_ = 0; ///< Slots created so far.
+    std::size_t available_ = 0; ///< Slots in the free list.
+    bool released_ = false; ///< Whether the owning handle is gone.
+    free_slot * free_ = nullptr; ///< Singly linked list of unused slots.
+    std::vector<std::unique_ptr<std::max_align_t[]>> chunks_; ///< The memory backing all slots.
+  };
+
+  /**
+   * \author Felix Bytow
+   * \brief is a standard allocator drawing from an object_pool.
+   * \since 0.1.2
+   *
+   * The allocator does not own the pool, see object_pool::handle on how pools stay alive.
+   *
+   * \tparam Type The allocated type.
+   */
+  template <typename Type>
+  class pool_allocator
+  {
+  public:
+    using value_type = Type;
+
+    /**
+     * \brief takes the pool to allocate from.
+     * \param[in] pool The pool.
+     */
+    explicit pool_allocator(object_pool * pool)
+        : pool_(pool)
+    {
+    }
+
+    template <typename Other>
+    pool_allocator(pool_allocator<Other> const & other)
+        : pool_(other.pool())
+    {
+    }
+
+    Type * allocate(std::size_t n)
+    {
+      static_assert(alignof(Type) <= alignof(std::max_align_t), "Over-aligned types cannot be pooled!");
+      if (n != 1)
+        throw std::bad_alloc();
+      return static_cast<Type *>(pool_->allocate(sizeof(Type)));
+    }
+
+    void deallocate(Type * p, std::size_t)
+    {
+      pool_->deallocate(p);
+    }
+
+    object_pool * pool() const
+    {
+      return pool_;
+    }
+
+  private:
+    object_pool * pool_; ///< The pool slots are taken from.
+  };
+
+  template <typename Lhs, typename Rhs>
+  bool operator == (pool_allocator<Lhs> const & lhs, pool_allocator<Rhs> const & rhs)
+  {
+    return lhs.pool() == rhs.pool();
+  }
+
+  template <typename Lhs, typename Rhs>
+  bool operator != (pool_allocator<Lhs> const & lhs, pool_allocator<Rhs> const & rhs)
+  {
+    return !(lhs == rhs);
+  }
+}
+
+#endif // DDIC_POOL_HXX
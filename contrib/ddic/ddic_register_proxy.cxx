@@ -20,7 +20,19 @@ namespace ddic
 
   register_proxy & register_proxy::as(std::string const & what)
   {
-    c_.factories_[what] = p_;
+    c_.add(what, p_);
+    return *this;
+  }
+
+  register_proxy & register_proxy::reserve(std::size_t count)
+  {
+    p_->reserve(count);
+    return *this;
+  }
+
+  register_proxy & register_proxy::as(type_id id, std::string const & what)
+  {
+    c_.add(id, what, p_);
     return *this;
   }
 }
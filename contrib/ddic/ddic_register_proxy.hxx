@@ -19,6 +19,13 @@
 #ifndef DDIC_REGISTER_PROXY_HXX
 #define DDIC_REGISTER_PROXY_HXX
 
+#include "ddic_type_id.hxx"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <typeinfo>
+
 namespace ddic
 {
   struct abstract_factory;
@@ -52,16 +59,39 @@ namespace ddic
 
     /**
      * \brief Registers an alias for the registered type.
+     *
+     * The alias can be resolved by type as well as by the name of the type.
+     *
      * \tparam Type The other type the registered one provides.
      * \return The register_proxy itself.
      */
     template <typename Type>
     register_proxy & as()
     {
-      return as(typeid(Type).name());
+      return as(type_id_of<Type>(), typeid(Type).name());
     }
 
+    /**
+     * \brief Pre-warms the factory of the registered type.
+     *
+     * For creation_policy::pooled this prepares storage for count instances,
+     * which is taken when the type is resolved for the first time.
+     * Other policies ignore this.
+     *
+     * \param[in] count The number of instances to prepare storage for.
+     * \return The register_proxy itself.
+     */
+    register_proxy & reserve(std::size_t count);
+
   private:
+    /**
+     * \brief Registers an alias for the registered type by type and by name.
+     * \param[in] id The identifier of the other type.
+     * \param[in] what The name of the other type.
+     * \return The register_proxy itself.
+     */
+    register_proxy & as(type_id id, std::string const & what);
+
     std::shared_ptr<abstract_factory> p_; ///< A pointer to the factory for the registered type.
     container & c_; ///< The container used to register the type.
   };
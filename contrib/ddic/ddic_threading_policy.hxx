@@ -0,0 +1,42 @@
+#pragma once
+
+/*********************************************************************
+ * Copyright © 2015 - 2016, Felix Bytow <felix.bytow@googlemail.com> *
+ *                                                                   *
+ * See the file COPYING for copying permissions.                     *
+ *********************************************************************/
+
+/**
+ * \file ddic_threading_policy.hxx
+ * \author Felix Bytow
+ * \since 0.1.2
+ * \brief Policy enum declaring whether a container is shared between threads.
+ *
+ * This file contains the ddic::threading_policy enum class.
+ * The policy can be specified when constructing a ddic::container.
+ */
+
+#ifndef DDIC_THREADING_POLICY_HXX
+#define DDIC_THREADING_POLICY_HXX
+
+#include <cstdint>
+
+namespace ddic
+{
+  /**
+   * \author Felix Bytow
+   * \brief is used to declare from how many threads a container is used.
+   * \since 0.1.2
+   *
+   * Singletons (creation_policy::always_same) are created exactly once regardless of this policy.
+   * The policy only affects registrations and the bookkeeping of the container itself.
+   */
+  enum class threading_policy
+      : std::uint8_t
+  {
+    single_threaded = 0, ///< registration and resolution happen on one thread at a time
+    multi_threaded = 1, ///< registration and resolution may happen concurrently from any thread
+  };
+}
+
+#endif // DDIC_THREADING_POLICY_HXX
@@ -0,0 +1,66 @@
+#pragma once
+
+/*********************************************************************
+ * Copyright © 2015 - 2016, Felix Bytow <felix.bytow@googlemail.com> *
+ *                                                                   *
+ * See the file COPYING for copying permissions.                     *
+ *********************************************************************/
+
+/**
+ * \file ddic_type_id.hxx
+ * \author Felix Bytow
+ * \since 0.1.2
+ * \brief Compile time type identifiers.
+ *
+ * This file contains ddic::type_id and ddic::type_id_of.
+ * Unlike typeid(Type).name() these identifiers are plain pointers,
+ * so comparing and ordering them neither allocates nor touches any strings.
+ */
+
+#ifndef DDIC_TYPE_ID_HXX
+#define DDIC_TYPE_ID_HXX
+
+#include <type_traits>
+
+namespace ddic
+{
+  /**
+   * \brief identifies a type.
+   *
+   * Every type has exactly one identifier, which is the address of a static object.
+   */
+  using type_id = void const *;
+
+  /**
+   * \author Felix Bytow
+   * \brief provides a unique address per type.
+   * \since 0.1.2
+   *
+   * \tparam Type The identified type.
+   */
+  template <typename Type>
+  struct type_tag
+  {
+    static char const id; ///< The object whose address identifies Type.
+  };
+
+  template <typename Type>
+  char const type_tag<Type>::id = 0;
+
+  /**
+   * \brief Acquire the identifier of a type.
+   *
+   * Like typeid, top level cv-qualifiers are ignored.
+   *
+   * \tparam Type The type to be identified.
+   *
+   * \return The identifier of Type.
+   */
+  template <typename Type>
+  constexpr type_id type_id_of()
+  {
+    return &type_tag<typename std::remove_cv<Type>::type>::id;
+  }
+}
+
+#endif // DDIC_TYPE_ID_HXX
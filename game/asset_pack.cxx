@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <zlib.h>
+
+#include "asset_pack.hxx"
+
+namespace {
+  static_assert(std::is_standard_layout<AssetPack::Entry>::value && sizeof(AssetPack::Entry) == 40,
+                "unexpected entry layout");
+
+  int compare_name(char const * name, std::size_t length, std::string const & other)
+  {
+    auto const result = std::memcmp(name, other.data(), std::min(length, other.size()));
+    if (result != 0)
+      return result;
+    return (length < other.size()) ? -1 : (length > other.size() ? 1 : 0);
+  }
+}
+
+char const AssetPack::MAGIC[4] = {'O', 'B', 'P', 'K'};
+std::uint32_t const AssetPack::VERSION;
+
+void write_asset_pack(std::ostream & out, std::vector<AssetSource> const & sources, int const level)
+{
+  std::vector<AssetSource const *> sorted {};
+  sorted.reserve(sources.size());
+  for (auto const & source : sources)
+    sorted.push_back(&source);
+  std::sort(sorted.begin(), sorted.end(), [](AssetSource const * lhs, AssetSource const * rhs) {
+    return lhs->m_name < rhs->m_name;
+  });
+
+  auto const duplicate = std::adjacent_find(sorted.begin(), sorted.end(),
+                                            [](AssetSource const * lhs, AssetSource const * rhs) {
+                                              return lhs->m_name == rhs->m_name;
+                                            });
+  if (duplicate != sorted.end())
+    throw std::invalid_argument {"Duplicate asset name: " + (*duplicate)->m_name}; // NOLINT(cert-err60-cpp)
+
+  std::vector<AssetPack::Entry> entries(sorted.size());
+  std::vector<std::vector<char>> packed(sorted.size());
+  std::vector<IndexedFileItem> items(sorted.size());
+  for (std::size_t n = 0; n < sorted.size(); ++n)
+  {
+    auto const & data = sorted[n]->m_data;
+    auto & entry = entries[n];
+
+    auto compressed = false;
+    auto bound = compressBound(static_cast<uLong>(data.size()));
+    if (sorted[n]->m_compress)
+    {
+      packed[n].resize(bound);
+      auto const result = compress2(reinterpret_cast<Bytef *>(packed[n].data()), &bound,
+                                    reinterpret_cast<Bytef const *>(data.data()), static_cast<uLong>(data.size()),
+                                    level);
+      compressed = (result == Z_OK && bound < data.size());
+    }
+
+    if (compressed)
+    {
+      packed[n].resize(bound);
+      entry.m_compression = AssetPack::Compression::Zlib;
+    }
+    else
+    {
+      packed[n] = data;
+      entry.m_compression = AssetPack::Compression::Stored;
+    }
+
+    entry.m_packedSize = packed[n].size();
+    entry.m_size = data.size();
+    entry.m_reserved = 0;
+    items[n] = IndexedFileItem {&sorted[n]->m_name, &packed[n]};
+  }
+
+  write_indexed_file(out, AssetPack::MAGIC, AssetPack::VERSION, entries, items);
+}
+
+AssetPack::AssetPack(std::string const & filename)
+    : m_file {filename, "asset pack", MAGIC, VERSION, sizeof(Entry)}, m_entries {m_file.checked_index<Entry>()}
+{
+}
+
+AssetPack::~AssetPack() = default;
+
+std::size_t AssetPack::size() const
+{
+  return m_file.size();
+}
+
+AssetPack::Entry const * AssetPack::find(std::string const & name) const
+{
+  auto const data = m_file.data();
+  auto const end = m_entries + m_file.size();
+  auto const it = std::lower_bound(m_entries, end, name, [data](Entry const & entry, std::string const & key) {
+    return compare_name(data + entry.m_nameOffset, entry.m_nameLength, key) < 0;
+  });
+
+  if (it == end || compare_name(data + it->m_nameOffset, it->m_nameLength, name) != 0)
+    return nullptr;
+  return it;
+}
+
+std::string AssetPack::name(Entry const & entry) const
+{
+  return std::string {m_file.data() + entry.m_nameOffset, entry.m_nameLength};
+}
+
+Asset AssetPack::read(Entry const & entry) const
+{
+  auto const packed = m_file.data() + entry.m_offset;
+  switch (entry.m_compression)
+  {
+    case Compression::Stored:
+      if (entry.m_packedSize != entry.m_size)
+        m_file.malformed("size mismatch of stored entry " + name(entry));
+      return Asset {m_file.owner(), packed, static_cast<std::size_t>(entry.m_size)};
+
+    case Compression::Zlib:
+    {
+      auto buffer = std::make_shared<std::vector<char>>(static_cast<std::size_t>(entry.m_size));
+      auto size = static_cast<uLongf>(entry.m_size);
+      auto const result = uncompress(reinterpret_cast<Bytef *>(buffer->data()), &size,
+                                     reinterpret_cast<Bytef const *>(packed), static_cast<uLong>(entry.m_packedSize));
+      if (result != Z_OK || size != entry.m_size)
+        m_file.malformed("cannot inflate entry " + name(entry));
+      auto const data = buffer->data();
+      return Asset {std::move(buffer), data, static_cast<std::size_t>(entry.m_size)};
+    }
+  }
+
+  m_file.malformed("unknown compression of entry " + name(entry));
+}
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_ASSET_PACK_HXX
+#define OVENBRICK_ASSET_PACK_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "indexed_file.hxx"
+
+/**
+ * @brief Read-only view of an asset, keeping its storage alive.
+ */
+class Asset final
+{
+  std::shared_ptr<void const> m_owner;
+  char const * m_data = nullptr;
+  std::size_t m_size = 0;
+
+public:
+  Asset() = default;
+
+  /**
+   * @param owner Whatever keeps the bytes alive.
+   * @param data The first byte.
+   * @param size The number of bytes.
+   */
+  inline Asset(std::shared_ptr<void const> owner, char const * data, std::size_t size)
+      : m_owner {std::move(owner)}, m_data {data}, m_size {size}
+  {
+  }
+
+  inline char const * data() const
+  {
+    return m_data;
+  }
+
+  inline std::size_t size() const
+  {
+    return m_size;
+  }
+
+  inline explicit operator bool() const
+  {
+    return m_data != nullptr;
+  }
+};
+
+/**
+ * @brief An asset to be written into a pack.
+ */
+struct AssetSource final
+{
+  std::string m_name;
+  std::vector<char> m_data;
+  bool m_compress = true; ///< false keeps the entry mappable in place, e.g. for data used without parsing.
+};
+
+/**
+ * @brief Write an indexed asset pack.
+ *
+ * Every entry is compressed with zlib on its own, entries which do not get smaller
+ * (e.g. already compressed sounds or images) or should not be compressed are stored as they are.
+ *
+ * @param out The binary output stream.
+ * @param sources The assets, names must be unique.
+ * @param level The zlib compression level (0..9).
+ */
+void write_asset_pack(std::ostream & out, std::vector<AssetSource> const & sources, int level = 9);
+
+/**
+ * @brief Memory-mapped asset pack.
+ *
+ * An IndexedFile with the entries sorted by name.
+ * Opening a pack only maps it, nothing is read until an entry is requested,
+ * so neither startup time nor resident memory depend on the size of the pack.
+ */
+class AssetPack final : private sf::NonCopyable
+{
+public:
+  static char const MAGIC[4];
+  static std::uint32_t const VERSION = 1;
+
+  enum class Compression : std::uint32_t
+  {
+    Stored = 0,
+    Zlib = 1,
+  };
+
+  /**
+   * @brief An entry of the index, exactly as stored in the pack.
+   */
+  struct Entry final
+  {
+    std::uint64_t m_offset; ///< Of the data, from the start of the pack.
+    std::uint64_t m_packedSize; ///< Size of the data in the pack.
+    std::uint64_t m_size; ///< Size of the data once decoded.
+    std::uint32_t m_nameOffset; ///< Of the name, from the start of the pack.
+    std::uint32_t m_nameLength;
+    Compression m_compression;
+    std::uint32_t m_reserved;
+
+    inline std::uint64_t stored_size() const
+    {
+      return m_packedSize;
+    }
+  };
+
+  /**
+   * @brief Map a pack.
+   * @param filename The path of the pack.
+   * @throws std::runtime_error If the file cannot be mapped or is no valid pack.
+   */
+  explicit AssetPack(std::string const & filename);
+
+  ~AssetPack();
+
+  /**
+   * @return The number of entries.
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Look up an entry.
+   * @param name The name of the entry.
+   * @return The entry or nullptr, if there is no such entry.
+   */
+  Entry const * find(std::string const & name) const;
+
+  /**
+   * @param entry An entry of this pack.
+   * @return The name of the entry.
+   */
+  std::string name(Entry const & entry) const;
+
+  /**
+   * @brief Decode an entry.
+   * @param entry An entry of this pack.
+   * @return Stored entries point right into the mapping, compressed ones are inflated into a new buffer.
+   * @throws std::runtime_error If the entry cannot be decoded.
+   */
+  Asset read(Entry const & entry) const;
+
+private:
+  IndexedFile m_file;
+  Entry const * m_entries;
+};
+
+#endif // OVENBRICK_ASSET_PACK_HXX
@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/log/expressions/message.hpp>
+
+#include "async_log.hxx"
+
+namespace {
+  constexpr char ELLIPSIS[] = "...";
+  constexpr std::size_t ELLIPSIS_LENGTH = sizeof(ELLIPSIS) - 1;
+
+  std::size_t round_up_to_power_of_two(std::size_t const value)
+  {
+    std::size_t result = 2;
+    while (result < value)
+      result <<= 1u;
+    return result;
+  }
+}
+
+std::size_t const AsyncLog::CACHE_LINE;
+
+AsyncLog::AsyncLog(std::unique_ptr<std::ostream> out, Settings const & settings)
+    : m_settings {settings}
+    , m_out {std::move(out)}
+    , m_mask {round_up_to_power_of_two(settings.m_capacity) - 1}
+    , m_slots {}
+    , m_text {}
+    , m_tail {0}
+    , m_tailPadding {}
+    , m_head {0}
+    , m_headPadding {}
+    , m_dropped {0}
+    , m_written {0}
+    , m_mutex {}
+    , m_wakeup {}
+    , m_flushed {}
+    , m_awake {false}
+    , m_flushTarget {0}
+    , m_flushedUpTo {0}
+    , m_stop {false}
+    , m_reported {0}
+    , m_writer {}
+{
+  if (!m_out)
+    throw std::invalid_argument {"The log needs a stream to write to"}; // NOLINT(cert-err60-cpp)
+  if (m_settings.m_recordSize <= ELLIPSIS_LENGTH)
+    throw std::invalid_argument {"The log records are too small"}; // NOLINT(cert-err60-cpp)
+
+  m_settings.m_capacity = m_mask + 1;
+  m_slots.reset(new Slot[m_settings.m_capacity]);
+  for (std::size_t n = 0; n < m_settings.m_capacity; ++n)
+  {
+    m_slots[n].m_sequence.store(n, std::memory_order_relaxed);
+    m_slots[n].m_length = 0;
+  }
+  m_text.resize(m_settings.m_capacity * m_settings.m_recordSize);
+
+  m_writer = std::thread {&AsyncLog::write, this};
+}
+
+AsyncLog::~AsyncLog()
+{
+  {
+    std::lock_guard<std::mutex> const lock {m_mutex};
+    m_stop = true;
+    m_flushTarget = m_tail.load(std::memory_order_relaxed);
+  }
+  m_wakeup.notify_one();
+  m_writer.join();
+}
+
+bool AsyncLog::push(char const * const text, std::size_t const length)
+{
+  // bounded queue after Dmitry Vyukov, every slot knows which lap of the ring it is free for
+  auto position = m_tail.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    auto const sequence = m_slots[position & m_mask].m_sequence.load(std::memory_order_acquire);
+    auto const difference = static_cast<std::ptrdiff_t>(sequence - position);
+    if (difference == 0)
+    {
+      if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (difference < 0)
+    {
+      wake();
+      if (m_settings.m_overflow == Overflow::Drop)
+      {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      std::this_thread::yield();
+      position = m_tail.load(std::memory_order_relaxed);
+    }
+    else
+      position = m_tail.load(std::memory_order_relaxed);
+  }
+
+  auto & slot = m_slots[position & m_mask];
+  auto const target = &m_text[(position & m_mask) * m_settings.m_recordSize];
+  if (length <= m_settings.m_recordSize)
+  {
+    std::memcpy(target, text, length);
+    slot.m_length = length;
+  }
+  else
+  {
+    auto const kept = m_settings.m_recordSize - ELLIPSIS_LENGTH;
+    std::memcpy(target, text, kept);
+    std::memcpy(target + kept, ELLIPSIS, ELLIPSIS_LENGTH);
+    slot.m_length = m_settings.m_recordSize;
+  }
+  slot.m_sequence.store(position + 1, std::memory_order_release);
+
+  // write early rather than drop
+  if (position - m_head.load(std::memory_order_relaxed) >= m_settings.m_capacity / 2)
+    wake();
+  return true;
+}
+
+void AsyncLog::flush()
+{
+  std::unique_lock<std::mutex> lock {m_mutex};
+  auto const target = m_tail.load(std::memory_order_relaxed);
+  m_flushTarget = std::max(m_flushTarget, target);
+  m_awake.store(true, std::memory_order_relaxed);
+  m_wakeup.notify_one();
+  m_flushed.wait(lock, [this, target] { return m_flushedUpTo >= target; });
+}
+
+std::uint64_t AsyncLog::dropped() const
+{
+  return m_dropped.load(std::memory_order_relaxed);
+}
+
+std::uint64_t AsyncLog::written() const
+{
+  return m_written.load(std::memory_order_relaxed);
+}
+
+AsyncLog::Settings const & AsyncLog::settings() const
+{
+  return m_settings;
+}
+
+void AsyncLog::write()
+{
+  std::string batch {};
+  batch.reserve(m_settings.m_capacity * m_settings.m_recordSize / 4);
+
+  std::unique_lock<std::mutex> lock {m_mutex};
+  for (;;)
+  {
+    m_wakeup.wait_for(lock, m_settings.m_flushInterval, [this] {
+      return m_stop || m_awake.load(std::memory_order_relaxed);
+    });
+    auto const stop = m_stop;
+    auto const target = m_flushTarget;
+    m_awake.store(false, std::memory_order_relaxed);
+    lock.unlock();
+
+    drain(batch);
+    // records claimed before flush() was called are about to be committed
+    while (m_head.load(std::memory_order_relaxed) < target)
+    {
+      std::this_thread::yield();
+      drain(batch);
+    }
+
+    if (!batch.empty())
+    {
+      m_out->write(batch.data(), static_cast<std::streamsize>(batch.size()));
+      m_out->flush();
+      batch.clear();
+    }
+
+    lock.lock();
+    m_flushedUpTo = m_head.load(std::memory_order_relaxed);
+    m_flushed.notify_all();
+    if (stop)
+      break;
+  }
+}
+
+bool AsyncLog::drain(std::string & batch)
+{
+  auto const start = m_head.load(std::memory_order_relaxed);
+  auto head = start;
+  for (;; ++head)
+  {
+    auto & slot = m_slots[head & m_mask];
+    if (slot.m_sequence.load(std::memory_order_acquire) != head + 1)
+      break;
+
+    batch.append(&m_text[(head & m_mask) * m_settings.m_recordSize], slot.m_length);
+    batch.push_back('\n');
+    slot.m_sequence.store(head + m_settings.m_capacity, std::memory_order_release);
+  }
+  m_head.store(head, std::memory_order_relaxed);
+  m_written.fetch_add(head - start, std::memory_order_relaxed);
+
+  auto const dropped = m_dropped.load(std::memory_order_relaxed);
+  if (dropped != m_reported)
+  {
+    batch += "[" + std::to_string(dropped - m_reported) + " log records dropped]\n";
+    m_reported = dropped;
+  }
+  return head != start;
+}
+
+void AsyncLog::wake()
+{
+  if (m_awake.exchange(true, std::memory_order_relaxed))
+    return;
+
+  std::lock_guard<std::mutex> const lock {m_mutex};
+  m_wakeup.notify_one();
+}
+
+AsyncLogBackend::AsyncLogBackend(std::shared_ptr<AsyncLog> log)
+    : m_log {std::move(log)}
+{
+}
+
+void AsyncLogBackend::consume(boost::log::record_view const & record)
+{
+  auto const message = record[boost::log::expressions::smessage];
+  if (message)
+    m_log->push(message.get().data(), message.get().size());
+  else
+    m_log->push("", 0);
+}
+
+void AsyncLogBackend::flush()
+{
+  m_log->flush();
+}
+
+AsyncLog & AsyncLogBackend::log() const
+{
+  return *m_log;
+}
+
+bool from_string(std::string const & name, AsyncLog::Overflow & overflow)
+{
+  if (name == "drop")
+    overflow = AsyncLog::Overflow::Drop;
+  else if (name == "block")
+    overflow = AsyncLog::Overflow::Block;
+  else
+    return false;
+  return true;
+}
@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_ASYNC_LOG_HXX
+#define OVENBRICK_ASYNC_LOG_HXX
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/log/core/record_view.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/frontend_requirements.hpp>
+
+#include <SFML/System/NonCopyable.hpp>
+
+/**
+ * @brief Log file written by a background thread, so logging threads never wait for the disk.
+ *
+ * Records are copied into preallocated slots of a bounded lock-free queue. The writer thread wakes up
+ * periodically (or once the queue is half full), writes everything queued as one batch and flushes it.
+ * Records longer than a slot are cut off. What happens when the queue is full is up to the Overflow policy,
+ * dropped records are counted and noted in the file where they are missing.
+ */
+class AsyncLog final : private sf::NonCopyable
+{
+public:
+  enum class Overflow
+  {
+    Drop, ///< Discard the new record, logging never waits.
+    Block, ///< Wait for the writer, no record gets lost.
+  };
+
+  struct Settings final
+  {
+    std::size_t m_capacity = 1024; ///< Records, rounded up to a power of two.
+    std::size_t m_recordSize = 256; ///< Bytes per record, longer ones are cut off.
+    Overflow m_overflow = Overflow::Drop;
+    std::chrono::milliseconds m_flushInterval {250}; ///< Longest time a record stays queued.
+  };
+
+  /**
+   * @brief Start the writer thread.
+   * @param out Where the records go, one per line.
+   * @param settings How much to queue and what to do when full.
+   */
+  AsyncLog(std::unique_ptr<std::ostream> out, Settings const & settings);
+
+  /**
+   * @brief Writes all queued records and stops the writer thread.
+   */
+  ~AsyncLog();
+
+  /**
+   * @brief Queue a record, safe to call from any thread.
+   * @param text The record without line break.
+   * @param length The length of the text.
+   * @return false, if the record was dropped.
+   */
+  bool push(char const * text, std::size_t length);
+
+  /**
+   * @brief Wait until all records queued before the call are written and flushed.
+   */
+  void flush();
+
+  /**
+   * @return The number of records dropped because the queue was full.
+   */
+  std::uint64_t dropped() const;
+
+  /**
+   * @return The number of records written so far.
+   */
+  std::uint64_t written() const;
+
+  Settings const & settings() const;
+
+private:
+  struct Slot final
+  {
+    std::atomic<std::size_t> m_sequence;
+    std::size_t m_length;
+  };
+
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  void write();
+  bool drain(std::string & batch);
+  void wake();
+
+  Settings m_settings;
+  std::unique_ptr<std::ostream> m_out;
+  std::size_t m_mask;
+  std::unique_ptr<Slot[]> m_slots;
+  std::vector<char> m_text; ///< m_recordSize bytes per slot.
+
+  std::atomic<std::size_t> m_tail; ///< Next slot to claim, shared by the producers.
+  char m_tailPadding[CACHE_LINE - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> m_head; ///< Next slot to write, only advanced by the writer.
+  char m_headPadding[CACHE_LINE - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::uint64_t> m_dropped;
+  std::atomic<std::uint64_t> m_written;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wakeup; ///< Tells the writer to write now.
+  std::condition_variable m_flushed; ///< Tells flush() that the writer caught up.
+  std::atomic<bool> m_awake; ///< The writer was told already, so producers spare the notification.
+  std::size_t m_flushTarget; ///< Guarded by m_mutex.
+  std::size_t m_flushedUpTo; ///< Guarded by m_mutex.
+  bool m_stop; ///< Guarded by m_mutex.
+  std::uint64_t m_reported; ///< Dropped records noted in the file, only used by the writer.
+  std::thread m_writer;
+};
+
+/**
+ * @brief Boost.Log sink backend queueing the message of every record into an AsyncLog.
+ * @remarks Meant for an unlocked_sink, the queue is safe to feed from several threads.
+ */
+class AsyncLogBackend final
+    : public boost::log::sinks::basic_sink_backend<
+        boost::log::sinks::combine_requirements<
+            boost::log::sinks::concurrent_feeding, boost::log::sinks::flushing
+        >::type
+    >
+{
+public:
+  explicit AsyncLogBackend(std::shared_ptr<AsyncLog> log);
+
+  void consume(boost::log::record_view const & record);
+
+  void flush();
+
+  AsyncLog & log() const;
+
+private:
+  std::shared_ptr<AsyncLog> m_log;
+};
+
+/**
+ * @brief Parse the overflow policy from the command line.
+ * @param name drop or block.
+ * @param overflow Receives the policy.
+ * @return false, if the name is unknown.
+ */
+bool from_string(std::string const & name, AsyncLog::Overflow & overflow);
+
+#endif // OVENBRICK_ASYNC_LOG_HXX
@@ -0,0 +1,393 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include "card_database.hxx"
+
+namespace {
+  struct Header final
+  {
+    char m_magic[4];
+    std::uint32_t m_version;
+    std::uint32_t m_count;
+    std::uint32_t m_keywordEntries; ///< Total length of all keyword postings.
+    std::uint32_t m_stringBytes;
+    std::uint32_t m_reserved;
+  };
+
+  static_assert(std::is_standard_layout<Header>::value && sizeof(Header) == 24, "unexpected header layout");
+
+  constexpr std::size_t COLUMN_ALIGNMENT = 8;
+  constexpr std::size_t STRING_REF_SIZE = 8;
+
+  std::array<char const *, CARD_TYPE_COUNT> const TYPE_NAMES {{"minion", "spell", "weapon", "hero"}};
+  std::array<char const *, KEYWORD_COUNT> const KEYWORD_NAMES {{
+      "taunt", "charge", "rush", "divine_shield", "windfury", "stealth", "battlecry", "deathrattle", "lifesteal",
+      "poisonous",
+  }};
+
+  /**
+   * @brief Byte offsets of all columns, derived from the header alone.
+   */
+  struct Columns final
+  {
+    std::size_t m_ids;
+    std::size_t m_types;
+    std::size_t m_costs;
+    std::size_t m_attacks;
+    std::size_t m_healths;
+    std::size_t m_keywords;
+    std::size_t m_names;
+    std::size_t m_texts;
+    std::size_t m_typeOffsets;
+    std::size_t m_byType;
+    std::size_t m_costOffsets;
+    std::size_t m_byCost;
+    std::size_t m_keywordOffsets;
+    std::size_t m_byKeyword;
+    std::size_t m_strings;
+    std::size_t m_end;
+
+    explicit Columns(Header const & header)
+    {
+      std::size_t offset = sizeof(Header);
+      auto const column = [&offset](std::size_t bytes) {
+        offset = (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+        auto const start = offset;
+        offset += bytes;
+        return start;
+      };
+
+      std::size_t const count = header.m_count;
+      m_ids = column(sizeof(CardId) * count);
+      m_types = column(sizeof(CardType) * count);
+      m_costs = column(count);
+      m_attacks = column(count);
+      m_healths = column(count);
+      m_keywords = column(sizeof(std::uint32_t) * count);
+      m_names = column(STRING_REF_SIZE * count);
+      m_texts = column(STRING_REF_SIZE * count);
+      m_typeOffsets = column(sizeof(std::uint32_t) * (CARD_TYPE_COUNT + 1));
+      m_byType = column(sizeof(CardIndex) * count);
+      m_costOffsets = column(sizeof(std::uint32_t) * (MAX_CARD_COST + 2));
+      m_byCost = column(sizeof(CardIndex) * count);
+      m_keywordOffsets = column(sizeof(std::uint32_t) * (KEYWORD_COUNT + 1));
+      m_byKeyword = column(sizeof(CardIndex) * header.m_keywordEntries);
+      m_strings = column(header.m_stringBytes);
+      m_end = offset;
+    }
+  };
+
+  [[noreturn]] void malformed(std::string const & what)
+  {
+    throw std::runtime_error {"Malformed card database: " + what}; // NOLINT(cert-err60-cpp)
+  }
+
+  template <typename Enum, std::size_t N>
+  bool lookup(std::array<char const *, N> const & names, std::string const & name, Enum & value)
+  {
+    auto const it = std::find(names.begin(), names.end(), name);
+    if (it == names.end())
+      return false;
+    value = static_cast<Enum>(it - names.begin());
+    return true;
+  }
+}
+
+char const CardDatabase::MAGIC[4] = {'O', 'B', 'C', 'D'};
+std::uint32_t const CardDatabase::VERSION;
+CardIndex const CardDatabase::NONE = std::numeric_limits<CardIndex>::max();
+
+char const * to_string(CardType const type)
+{
+  return TYPE_NAMES.at(static_cast<std::size_t>(type));
+}
+
+char const * to_string(Keyword const keyword)
+{
+  return KEYWORD_NAMES.at(static_cast<std::size_t>(keyword));
+}
+
+bool from_string(std::string const & name, CardType & type)
+{
+  return lookup(TYPE_NAMES, name, type);
+}
+
+bool from_string(std::string const & name, Keyword & keyword)
+{
+  return lookup(KEYWORD_NAMES, name, keyword);
+}
+
+void CardDatabase::write(std::ostream & out, std::vector<CardDefinition> cards)
+{
+  std::sort(cards.begin(), cards.end(), [](CardDefinition const & lhs, CardDefinition const & rhs) {
+    return lhs.m_id < rhs.m_id;
+  });
+  auto const duplicate = std::adjacent_find(cards.begin(), cards.end(),
+                                            [](CardDefinition const & lhs, CardDefinition const & rhs) {
+                                              return lhs.m_id == rhs.m_id;
+                                            });
+  if (duplicate != cards.end())
+    throw std::invalid_argument {"Duplicate card id " + std::to_string(duplicate->m_id)}; // NOLINT(cert-err60-cpp)
+
+  static_assert(sizeof(StringRef) == STRING_REF_SIZE, "unexpected string reference layout");
+
+  auto const count = static_cast<CardIndex>(cards.size());
+  std::vector<CardIndex> all(count);
+  for (CardIndex n = 0; n < count; ++n)
+    all[n] = n;
+
+  auto byType = all;
+  std::stable_sort(byType.begin(), byType.end(), [&cards](CardIndex lhs, CardIndex rhs) {
+    return std::make_pair(cards[lhs].m_type, cards[lhs].m_cost) < std::make_pair(cards[rhs].m_type, cards[rhs].m_cost);
+  });
+  std::vector<std::uint32_t> typeOffsets(CARD_TYPE_COUNT + 1, 0);
+  for (auto const & card : cards)
+    ++typeOffsets[static_cast<std::size_t>(card.m_type) + 1];
+
+  auto byCost = all;
+  std::stable_sort(byCost.begin(), byCost.end(), [&cards](CardIndex lhs, CardIndex rhs) {
+    return cards[lhs].m_cost < cards[rhs].m_cost;
+  });
+  std::vector<std::uint32_t> costOffsets(MAX_CARD_COST + 2, 0);
+  for (auto const & card : cards)
+    ++costOffsets[card.m_cost + 1u];
+
+  std::vector<CardIndex> byKeyword {};
+  std::vector<std::uint32_t> keywordOffsets(KEYWORD_COUNT + 1, 0);
+  for (unsigned keyword = 0; keyword < KEYWORD_COUNT; ++keyword)
+  {
+    for (CardIndex n = 0; n < count; ++n)
+      if (cards[n].m_keywords & keyword_bit(static_cast<Keyword>(keyword)))
+        byKeyword.push_back(n);
+    keywordOffsets[keyword + 1] = static_cast<std::uint32_t>(byKeyword.size());
+  }
+
+  // counts to running offsets
+  std::partial_sum(typeOffsets.begin(), typeOffsets.end(), typeOffsets.begin());
+  std::partial_sum(costOffsets.begin(), costOffsets.end(), costOffsets.begin());
+
+  std::string strings {};
+  std::vector<StringRef> names(count);
+  std::vector<StringRef> texts(count);
+  auto const intern = [&strings](std::string const & text) {
+    StringRef const ref {static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(text.size())};
+    strings += text;
+    return ref;
+  };
+  for (CardIndex n = 0; n < count; ++n)
+  {
+    names[n] = intern(cards[n].m_name);
+    texts[n] = intern(cards[n].m_text);
+  }
+
+  Header header {};
+  std::copy(std::begin(MAGIC), std::end(MAGIC), header.m_magic);
+  header.m_version = VERSION;
+  header.m_count = count;
+  header.m_keywordEntries = static_cast<std::uint32_t>(byKeyword.size());
+  header.m_stringBytes = static_cast<std::uint32_t>(strings.size());
+
+  Columns const columns {header};
+  std::vector<char> image(columns.m_end, 0);
+  auto const put = [&image](std::size_t offset, void const * data, std::size_t bytes) {
+    if (bytes > 0)
+      std::memcpy(image.data() + offset, data, bytes);
+  };
+  auto const column = [&image](std::size_t offset) { return image.data() + offset; };
+
+  put(0, &header, sizeof(header));
+  for (CardIndex n = 0; n < count; ++n)
+  {
+    auto const & card = cards[n];
+    std::memcpy(column(columns.m_ids) + n * sizeof(CardId), &card.m_id, sizeof(CardId));
+    column(columns.m_types)[n] = static_cast<char>(card.m_type);
+    column(columns.m_costs)[n] = static_cast<char>(card.m_cost);
+    column(columns.m_attacks)[n] = static_cast<char>(card.m_attack);
+    column(columns.m_healths)[n] = static_cast<char>(card.m_health);
+    std::memcpy(column(columns.m_keywords) + n * sizeof(std::uint32_t), &card.m_keywords, sizeof(std::uint32_t));
+  }
+  put(columns.m_names, names.data(), sizeof(StringRef) * names.size());
+  put(columns.m_texts, texts.data(), sizeof(StringRef) * texts.size());
+  put(columns.m_typeOffsets, typeOffsets.data(), sizeof(std::uint32_t) * typeOffsets.size());
+  put(columns.m_byType, byType.data(), sizeof(CardIndex) * byType.size());
+  put(columns.m_costOffsets, costOffsets.data(), sizeof(std::uint32_t) * costOffsets.size());
+  put(columns.m_byCost, byCost.data(), sizeof(CardIndex) * byCost.size());
+  put(columns.m_keywordOffsets, keywordOffsets.data(), sizeof(std::uint32_t) * keywordOffsets.size());
+  put(columns.m_byKeyword, byKeyword.data(), sizeof(CardIndex) * byKeyword.size());
+  put(columns.m_strings, strings.data(), strings.size());
+
+  out.write(image.data(), static_cast<std::streamsize>(image.size()));
+}
+
+CardDatabase::CardDatabase(Asset asset)
+    : m_asset {std::move(asset)}
+{
+  Header header {};
+  if (m_asset.size() < sizeof(header))
+    malformed("truncated header");
+  std::memcpy(&header, m_asset.data(), sizeof(header));
+  if (!std::equal(std::begin(MAGIC), std::end(MAGIC), header.m_magic))
+    malformed("bad magic");
+  if (header.m_version != VERSION)
+    malformed("unsupported version " + std::to_string(header.m_version));
+  if (reinterpret_cast<std::uintptr_t>(m_asset.data()) % COLUMN_ALIGNMENT != 0)
+    malformed("misaligned");
+
+  Columns const columns {header};
+  if (columns.m_end != m_asset.size())
+    malformed("size mismatch");
+
+  auto const column = [this](std::size_t offset) { return m_asset.data() + offset; };
+  m_count = header.m_count;
+  m_ids = reinterpret_cast<CardId const *>(column(columns.m_ids));
+  m_types = reinterpret_cast<CardType const *>(column(columns.m_types));
+  m_costs = reinterpret_cast<std::uint8_t const *>(column(columns.m_costs));
+  m_attacks = reinterpret_cast<std::uint8_t const *>(column(columns.m_attacks));
+  m_healths = reinterpret_cast<std::uint8_t const *>(column(columns.m_healths));
+  m_keywords = reinterpret_cast<std::uint32_t const *>(column(columns.m_keywords));
+  m_names = reinterpret_cast<StringRef const *>(column(columns.m_names));
+  m_texts = reinterpret_cast<StringRef const *>(column(columns.m_texts));
+  m_typeOffsets = reinterpret_cast<std::uint32_t const *>(column(columns.m_typeOffsets));
+  m_byType = reinterpret_cast<CardIndex const *>(column(columns.m_byType));
+  m_costOffsets = reinterpret_cast<std::uint32_t const *>(column(columns.m_costOffsets));
+  m_byCost = reinterpret_cast<CardIndex const *>(column(columns.m_byCost));
+  m_keywordOffsets = reinterpret_cast<std::uint32_t const *>(column(columns.m_keywordOffsets));
+  m_byKeyword = reinterpret_cast<CardIndex const *>(column(columns.m_byKeyword));
+  m_strings = column(columns.m_strings);
+
+  // check everything the accessors rely on once, so they never have to
+  auto const ascending = [](std::uint32_t const * offsets, std::size_t length, std::uint32_t last) {
+    return std::is_sorted(offsets, offsets + length) && offsets[0] == 0 && offsets[length - 1] == last;
+  };
+  if (!ascending(m_typeOffsets, CARD_TYPE_COUNT + 1, header.m_count)
+      || !ascending(m_costOffsets, MAX_CARD_COST + 2, header.m_count)
+      || !ascending(m_keywordOffsets, KEYWORD_COUNT + 1, header.m_keywordEntries))
+    malformed("bad index offsets");
+
+  auto const inBounds = [&header](CardIndex const * indexes, std::size_t length) {
+    return std::all_of(indexes, indexes + length, [&header](CardIndex n) { return n < header.m_count; });
+  };
+  if (!inBounds(m_byType, m_count) || !inBounds(m_byCost, m_count) || !inBounds(m_byKeyword, header.m_keywordEntries))
+    malformed("index out of bounds");
+
+  auto const validString = [&header](StringRef const & ref) {
+    return ref.m_offset <= header.m_stringBytes && ref.m_length <= header.m_stringBytes - ref.m_offset;
+  };
+  if (!std::all_of(m_names, m_names + m_count, validString) || !std::all_of(m_texts, m_texts + m_count, validString))
+    malformed("string out of bounds");
+
+  if (std::any_of(m_types, m_types + m_count, [](CardType type) {
+    return static_cast<unsigned>(type) >= CARD_TYPE_COUNT;
+  }))
+    malformed("unknown card type");
+
+  if (!std::is_sorted(m_ids, m_ids + m_count) || std::adjacent_find(m_ids, m_ids + m_count) != m_ids + m_count)
+    malformed("ids not strictly ascending");
+}
+
+std::size_t CardDatabase::size() const
+{
+  return m_count;
+}
+
+CardIndex CardDatabase::find(CardId const id) const
+{
+  auto const end = m_ids + m_count;
+  auto const it = std::lower_bound(m_ids, end, id);
+  return (it != end && *it == id) ? static_cast<CardIndex>(it - m_ids) : NONE;
+}
+
+CardId CardDatabase::id(CardIndex const index) const
+{
+  return m_ids[index];
+}
+
+CardType CardDatabase::type(CardIndex const index) const
+{
+  return m_types[index];
+}
+
+unsigned CardDatabase::cost(CardIndex const index) const
+{
+  return m_costs[index];
+}
+
+unsigned CardDatabase::attack(CardIndex const index) const
+{
+  return m_attacks[index];
+}
+
+unsigned CardDatabase::health(CardIndex const index) const
+{
+  return m_healths[index];
+}
+
+std::uint32_t CardDatabase::keywords(CardIndex const index) const
+{
+  return m_keywords[index];
+}
+
+bool CardDatabase::has(CardIndex const index, Keyword const keyword) const
+{
+  return (m_keywords[index] & keyword_bit(keyword)) != 0;
+}
+
+boost::string_ref CardDatabase::name(CardIndex const index) const
+{
+  return boost::string_ref {m_strings + m_names[index].m_offset, m_names[index].m_length};
+}
+
+boost::string_ref CardDatabase::text(CardIndex const index) const
+{
+  return boost::string_ref {m_strings + m_texts[index].m_offset, m_texts[index].m_length};
+}
+
+gsl::span<CardIndex const> CardDatabase::of_type(CardType const type) const
+{
+  auto const n = static_cast<std::size_t>(type);
+  return {m_byType + m_typeOffsets[n], static_cast<std::ptrdiff_t>(m_typeOffsets[n + 1] - m_typeOffsets[n])};
+}
+
+gsl::span<CardIndex const> CardDatabase::costing(unsigned const cost) const
+{
+  return costing(cost, cost);
+}
+
+gsl::span<CardIndex const> CardDatabase::costing(unsigned const minimum, unsigned const maximum) const
+{
+  if (minimum > maximum || minimum > MAX_CARD_COST)
+    return {};
+
+  auto const first = m_costOffsets[minimum];
+  auto const last = m_costOffsets[std::min(maximum, MAX_CARD_COST) + 1];
+  return {m_byCost + first, static_cast<std::ptrdiff_t>(last - first)};
+}
+
+gsl::span<CardIndex const> CardDatabase::with(Keyword const keyword) const
+{
+  auto const n = static_cast<std::size_t>(keyword);
+  return {m_byKeyword + m_keywordOffsets[n], static_cast<std::ptrdiff_t>(m_keywordOffsets[n + 1] - m_keywordOffsets[n])};
+}
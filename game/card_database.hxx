@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_CARD_DATABASE_HXX
+#define OVENBRICK_CARD_DATABASE_HXX
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_ref.hpp>
+
+#include <gsl/span>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "asset_pack.hxx"
+
+using CardId = std::uint32_t; ///< Stable identifier of a card, as used in decks and save games.
+using CardIndex = std::uint32_t; ///< Position of a card in a CardDatabase, only valid for that database.
+
+enum class CardType : std::uint8_t
+{
+  Minion,
+  Spell,
+  Weapon,
+  Hero,
+};
+
+enum class Keyword : std::uint8_t
+{
+  Taunt,
+  Charge,
+  Rush,
+  DivineShield,
+  Windfury,
+  Stealth,
+  Battlecry,
+  Deathrattle,
+  Lifesteal,
+  Poisonous,
+};
+
+constexpr unsigned CARD_TYPE_COUNT = 4;
+constexpr unsigned KEYWORD_COUNT = 10;
+constexpr unsigned MAX_CARD_COST = 255;
+
+/**
+ * @return The bit of the keyword in a keyword mask.
+ */
+constexpr std::uint32_t keyword_bit(Keyword keyword)
+{
+  return std::uint32_t {1} << static_cast<unsigned>(keyword);
+}
+
+/**
+ * @return The name of the type as used in card sources.
+ */
+char const * to_string(CardType type);
+
+/**
+ * @return The name of the keyword as used in card sources.
+ */
+char const * to_string(Keyword keyword);
+
+/**
+ * @brief Look up a type by its name.
+ * @return false, if there is no type of that name.
+ */
+bool from_string(std::string const & name, CardType & type);
+
+/**
+ * @brief Look up a keyword by its name.
+ * @return false, if there is no keyword of that name.
+ */
+bool from_string(std::string const & name, Keyword & keyword);
+
+/**
+ * @brief A single card, as written by the card compiler.
+ */
+struct CardDefinition final
+{
+  CardId m_id;
+  std::string m_name;
+  CardType m_type;
+  std::uint8_t m_cost;
+  std::uint8_t m_attack;
+  std::uint8_t m_health; ///< Durability of weapons.
+  std::uint32_t m_keywords; ///< Mask of keyword_bit()s.
+  std::string m_text;
+};
+
+/**
+ * @brief Read-only card data in structure-of-arrays layout.
+ *
+ * Every attribute is a column indexed by CardIndex, cards are sorted by id.
+ * The indexes for queries by type, cost and keyword are prebuilt by the card compiler,
+ * so the binary format is used right where it lies (e.g. mapped from the asset pack) without any parsing.
+ */
+class CardDatabase final : private sf::NonCopyable
+{
+public:
+  static char const MAGIC[4];
+  static std::uint32_t const VERSION = 1;
+  static CardIndex const NONE; ///< Returned by find() for unknown ids.
+
+  /**
+   * @brief Serialize cards.
+   * @param out The binary output stream.
+   * @param cards The cards, ids must be unique.
+   * @throws std::invalid_argument If ids are not unique.
+   */
+  static void write(std::ostream & out, std::vector<CardDefinition> cards);
+
+  /**
+   * @brief Use serialized cards.
+   * @param asset The serialized cards, referenced rather than copied.
+   * @throws std::runtime_error If the asset is no valid card database.
+   */
+  explicit CardDatabase(Asset asset);
+
+  /**
+   * @return The number of cards.
+   */
+  std::size_t size() const;
+
+  /**
+   * @param id The id of the requested card.
+   * @return The index of the card or NONE.
+   */
+  CardIndex find(CardId id) const;
+
+  CardId id(CardIndex index) const;
+  CardType type(CardIndex index) const;
+  unsigned cost(CardIndex index) const;
+  unsigned attack(CardIndex index) const;
+  unsigned health(CardIndex index) const; ///< Durability of weapons.
+  std::uint32_t keywords(CardIndex index) const;
+  bool has(CardIndex index, Keyword keyword) const;
+  boost::string_ref name(CardIndex index) const;
+  boost::string_ref text(CardIndex index) const;
+
+  /**
+   * @return All cards of the type, ordered by cost and id.
+   */
+  gsl::span<CardIndex const> of_type(CardType type) const;
+
+  /**
+   * @return All cards with exactly this cost, ordered by id.
+   */
+  gsl::span<CardIndex const> costing(unsigned cost) const;
+
+  /**
+   * @return All cards costing between minimum and maximum (inclusive), ordered by cost and id.
+   */
+  gsl::span<CardIndex const> costing(unsigned minimum, unsigned maximum) const;
+
+  /**
+   * @return All cards with the keyword, ordered by id.
+   */
+  gsl::span<CardIndex const> with(Keyword keyword) const;
+
+private:
+  struct StringRef final
+  {
+    std::uint32_t m_offset; ///< Into the string column.
+    std::uint32_t m_length;
+  };
+
+  Asset m_asset;
+  std::size_t m_count;
+  CardId const * m_ids;
+  CardType const * m_types;
+  std::uint8_t const * m_costs;
+  std::uint8_t const * m_attacks;
+  std::uint8_t const * m_healths;
+  std::uint32_t const * m_keywords;
+  StringRef const * m_names;
+  StringRef const * m_texts;
+  std::uint32_t const * m_typeOffsets; ///< CARD_TYPE_COUNT + 1 entries into m_byType.
+  CardIndex const * m_byType;
+  std::uint32_t const * m_costOffsets; ///< MAX_CARD_COST + 2 entries into m_byCost.
+  CardIndex const * m_byCost;
+  std::uint32_t const * m_keywordOffsets; ///< KEYWORD_COUNT + 1 entries into m_byKeyword.
+  CardIndex const * m_byKeyword;
+  char const * m_strings;
+};
+
+#endif // OVENBRICK_CARD_DATABASE_HXX
@@ -16,20 +16,23 @@
 
 #include "dummy_game_state.hxx"
 #include "game_state_manager.hxx"
-#include "keyboard_layout.hxx"
+#include "input_actions.hxx"
 
 #include <SFML/System/Time.hpp>
 
-#include <SFML/Window/Keyboard.hpp>
-#include <SFML/Window/Event.hpp>
+char const DummyGameState::TYPE_KEY[] = "dummy";
 
 void DummyGameState::set_up()
 {
 }
 
-void DummyGameState::handle_event(sf::Event const & event)
+void DummyGameState::handle_event(sf::Event const & /* event */)
 {
-  if (event.type == sf::Event::KeyPressed && event.key.code == KeyboardLayout::current.m_keyMenu)
+}
+
+void DummyGameState::handle_actions(ActionFrame const & actions)
+{
+  if (actions.pressed(Action::Menu))
     m_gsm->pop_state();
 }
 
@@ -37,6 +40,25 @@ void DummyGameState::update(sf::Time const & /* elapsed */)
 {
 }
 
+void DummyGameState::render(float /* alpha */)
+{
+}
+
+sf::Time DummyGameState::next_wakeup() const
+{
+  return never();
+}
+
+bool DummyGameState::save(std::ostream & /* out */) const
+{
+  return true;
+}
+
+char const * DummyGameState::type_key() const
+{
+  return TYPE_KEY;
+}
+
 void DummyGameState::tear_down()
 {
 }
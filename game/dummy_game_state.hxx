@@ -25,6 +25,8 @@ struct DummyGameState final : public GameState
 {
   using autowire = ddic::inject<GameStateManager>;
 
+  static char const TYPE_KEY[]; ///< What the state is saved under in session snapshots.
+
   explicit inline DummyGameState(std::shared_ptr<GameStateManager> gsm)
       : GameState {gsm}
   {
@@ -36,8 +38,21 @@ struct DummyGameState final : public GameState
 
   void handle_event(sf::Event const & event) override;
 
+  void handle_actions(ActionFrame const & actions) override;
+
   void update(sf::Time const & elapsed) override;
 
+  void render(float alpha) override;
+
+  sf::Time next_wakeup() const override;
+
+  /**
+   * @brief Writes nothing, there is nothing to continue but being there.
+   */
+  bool save(std::ostream & out) const override;
+
+  char const * type_key() const override;
+
   void tear_down() override;
 };
 
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include "frame_scheduler.hxx"
+#include "game_state_manager.hxx"
+#include "game_state.hxx"
+
+namespace {
+  FrameScheduler::TimeSource make_clock()
+  {
+    auto const clock = std::make_shared<sf::Clock>();
+    return [clock] { return clock->getElapsedTime(); };
+  }
+}
+
+FrameScheduler::FrameScheduler(FrameRate const & rate)
+    : FrameScheduler {rate, make_clock(), &sf::sleep}
+{
+}
+
+FrameScheduler::FrameScheduler(FrameRate const & rate, TimeSource now, Sleeper sleep)
+    : m_rate {rate}
+    , m_now {std::move(now)}
+    , m_sleep {std::move(sleep)}
+{
+  assert(m_rate.m_tickRate > 0);
+  assert(m_rate.m_maxTicksPerFrame > 0);
+
+  m_tick = sf::microseconds(1000000 / m_rate.m_tickRate);
+  m_frameBudget = (m_rate.m_frameRate > 0) ? sf::microseconds(1000000 / m_rate.m_frameRate) : sf::Time::Zero;
+  m_frameStart = m_now();
+}
+
+FrameTiming const & FrameScheduler::run_frame(GameStateManager & gsm, Callback const & pumpEvents,
+                                              Callback const & present)
+{
+  return run_frame(gsm, pumpEvents, present, Waiter {});
+}
+
+FrameTiming const & FrameScheduler::run_frame(GameStateManager & gsm, Callback const & pumpEvents,
+                                              Callback const & present, Waiter const & waitEvents)
+{
+  FrameTiming timing {};
+
+  auto const start = m_now();
+  timing.m_elapsed = start - m_frameStart;
+  m_frameStart = start;
+
+  pumpEvents();
+  gsm.commit_loaded_states();
+  auto mark = m_now();
+  timing.m_event = mark - start;
+
+  // spiral of death: never try to catch up more than the cap allows
+  m_accumulator += timing.m_elapsed;
+  auto const maxBacklog = m_tick * static_cast<sf::Int64>(m_rate.m_maxTicksPerFrame);
+  if (m_accumulator > maxBacklog)
+  {
+    timing.m_dropped = m_accumulator - maxBacklog;
+    m_accumulator = maxBacklog;
+  }
+  m_accumulator += m_idleBacklog;
+  m_idleBacklog = sf::Time::Zero;
+
+  while (m_accumulator >= m_tick && !gsm.is_empty())
+  {
+    gsm.update(m_tick);
+    m_accumulator -= m_tick;
+    ++timing.m_ticks;
+  }
+  if (gsm.is_empty())
+    m_accumulator = sf::Time::Zero;
+
+  auto const afterUpdate = m_now();
+  timing.m_update = afterUpdate - mark;
+
+  timing.m_alpha = m_accumulator / m_tick;
+  gsm.render(timing.m_alpha);
+  mark = m_now();
+  timing.m_render = mark - afterUpdate;
+
+  present();
+  gsm.frame_presented();
+  auto const afterPresent = m_now();
+  timing.m_present = afterPresent - mark;
+
+  auto const wakeup = waitEvents ? gsm.next_wakeup() : sf::Time::Zero;
+  if (wakeup > sf::Time::Zero)
+  {
+    // the frame just presented stays valid until something happens
+    waitEvents(wakeup);
+    auto const woken = m_now();
+    timing.m_idle = woken - afterPresent;
+    auto const interval = (m_frameBudget > sf::Time::Zero) ? m_frameBudget : m_tick;
+    timing.m_skippedFrames = static_cast<unsigned>(timing.m_idle.asMicroseconds() / interval.asMicroseconds());
+
+    if (wakeup != GameState::never())
+      m_idleBacklog = timing.m_idle;
+    m_frameStart = woken;
+    ++m_statistics.m_idleFrames;
+  }
+  else if (m_frameBudget > sf::Time::Zero)
+  {
+    auto const remaining = m_frameBudget - (afterPresent - start);
+    if (remaining > sf::Time::Zero)
+    {
+      m_sleep(remaining);
+      timing.m_sleep = m_now() - afterPresent;
+    }
+  }
+
+  m_last = timing;
+
+  ++m_statistics.m_frames;
+  m_statistics.m_ticks += timing.m_ticks;
+  if (timing.m_dropped > sf::Time::Zero)
+    ++m_statistics.m_cappedFrames;
+  m_statistics.m_skippedFrames += timing.m_skippedFrames;
+  m_statistics.m_event += timing.m_event;
+  m_statistics.m_update += timing.m_update;
+  m_statistics.m_render += timing.m_render;
+  m_statistics.m_present += timing.m_present;
+  m_statistics.m_sleep += timing.m_sleep;
+  m_statistics.m_dropped += timing.m_dropped;
+  m_statistics.m_idle += timing.m_idle;
+  m_statistics.m_longestFrame = std::max(m_statistics.m_longestFrame, timing.m_elapsed);
+
+  return m_last;
+}
+
+void FrameScheduler::reset()
+{
+  m_accumulator = sf::Time::Zero;
+  m_idleBacklog = sf::Time::Zero;
+  m_frameStart = m_now();
+}
+
+sf::Time FrameScheduler::tick_duration() const
+{
+  return m_tick;
+}
+
+FrameTiming const & FrameScheduler::last_frame() const
+{
+  return m_last;
+}
+
+FrameStatistics const & FrameScheduler::statistics() const
+{
+  return m_statistics;
+}
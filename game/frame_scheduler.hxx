@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_FRAME_SCHEDULER_HXX
+#define OVENBRICK_FRAME_SCHEDULER_HXX
+
+#include <cstdint>
+#include <functional>
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+
+class GameStateManager;
+
+/**
+ * @brief Pacing parameters of the main loop.
+ */
+struct FrameRate final
+{
+  unsigned m_tickRate = 60; ///< Fixed simulation ticks per second.
+  unsigned m_frameRate = 0; ///< Presented frames per second, 0 leaves pacing to vsync.
+  unsigned m_maxTicksPerFrame = 5; ///< Ticks simulated per frame at most, excess time is dropped.
+};
+
+/**
+ * @brief Timing breakdown of a single frame.
+ */
+struct FrameTiming final
+{
+  sf::Time m_elapsed; ///< Wall time between the start of the previous frame and this one.
+  sf::Time m_event; ///< Time spent polling and dispatching events.
+  sf::Time m_update; ///< Time spent in fixed simulation ticks.
+  sf::Time m_render; ///< Time spent in the interpolated render pass.
+  sf::Time m_present; ///< Time spent presenting the frame.
+  sf::Time m_sleep; ///< Time spent sleeping to hit the target frame rate.
+  sf::Time m_dropped; ///< Simulation time discarded because of the tick cap.
+  sf::Time m_idle; ///< Time spent blocked until the next event or wakeup.
+  unsigned m_ticks = 0; ///< Number of simulation ticks run.
+  unsigned m_skippedFrames = 0; ///< Frames which would have been presented while idle.
+  float m_alpha = 0.f; ///< Interpolation factor handed to the render pass.
+};
+
+/**
+ * @brief Accumulated timings over all frames run by a FrameScheduler.
+ */
+struct FrameStatistics final
+{
+  std::uint64_t m_frames = 0;
+  std::uint64_t m_ticks = 0;
+  std::uint64_t m_cappedFrames = 0; ///< Frames which hit the tick cap.
+  std::uint64_t m_idleFrames = 0; ///< Frames after which the loop blocked.
+  std::uint64_t m_skippedFrames = 0; ///< Frames not run because nothing was going on.
+  sf::Time m_event;
+  sf::Time m_update;
+  sf::Time m_render;
+  sf::Time m_present;
+  sf::Time m_sleep;
+  sf::Time m_dropped;
+  sf::Time m_idle;
+  sf::Time m_longestFrame;
+};
+
+/**
+ * @brief Drives the GameStateManager with fixed simulation ticks and interpolated rendering.
+ *
+ * Every frame the wall time since the previous frame is added to an accumulator,
+ * which is then consumed in steps of exactly one tick. Whatever is left over
+ * becomes the interpolation factor of the render pass.
+ *
+ * When the current state has nothing to animate, the scheduler blocks until the next
+ * event or wakeup instead of presenting identical frames.
+ */
+class FrameScheduler final : private sf::NonCopyable
+{
+public:
+  using TimeSource = std::function<sf::Time()>;
+  using Sleeper = std::function<void(sf::Time)>;
+  using Callback = std::function<void()>;
+  using Waiter = std::function<void(sf::Time)>;
+
+  /**
+   * @brief Create a scheduler measuring with sf::Clock and pacing with sf::sleep.
+   * @param rate The pacing parameters.
+   */
+  explicit FrameScheduler(FrameRate const & rate);
+
+  /**
+   * @brief Create a scheduler with custom time keeping, e.g. for headless tests.
+   * @param rate The pacing parameters.
+   * @param now Returns the current (monotonic) time.
+   * @param sleep Blocks for (about) the given time.
+   */
+  FrameScheduler(FrameRate const & rate, TimeSource now, Sleeper sleep);
+
+  /**
+   * @brief Run a single frame.
+   * @param gsm The game states to simulate and render, preloaded states are committed after the events.
+   * @param pumpEvents Polls pending events and forwards them to the game states.
+   * @param present Presents the rendered frame.
+   * @return The timing breakdown of the frame.
+   */
+  FrameTiming const & run_frame(GameStateManager & gsm, Callback const & pumpEvents, Callback const & present);
+
+  /**
+   * @brief Run a single frame and block afterwards as long as the game states are idle.
+   * @param gsm The game states to simulate and render, preloaded states are committed after the events.
+   * @param pumpEvents Polls pending events and forwards them to the game states.
+   * @param present Presents the rendered frame.
+   * @param waitEvents Blocks until an event is pending or (about) the given time passed,
+   *                   GameState::never() waits for events only.
+   * @return The timing breakdown of the frame.
+   * @remarks Idle time before a timed wakeup is simulated by the next frame, regardless of the tick cap.
+   *          Idle time before an event is dropped, nothing happens in it by definition.
+   */
+  FrameTiming const & run_frame(GameStateManager & gsm, Callback const & pumpEvents, Callback const & present,
+                                Waiter const & waitEvents);
+
+  /**
+   * @brief Forget about the time accumulated so far.
+   * @remarks Use after intentional stalls (e.g. loading) to avoid a burst of catch-up ticks.
+   */
+  void reset();
+
+  /**
+   * @return The simulated time per tick.
+   */
+  sf::Time tick_duration() const;
+
+  /**
+   * @return The timing breakdown of the most recent frame.
+   */
+  FrameTiming const & last_frame() const;
+
+  /**
+   * @return The timings accumulated over all frames.
+   */
+  FrameStatistics const & statistics() const;
+
+private:
+  FrameRate m_rate;
+  TimeSource m_now;
+  Sleeper m_sleep;
+
+  sf::Time m_tick;
+  sf::Time m_frameBudget;
+  sf::Time m_accumulator;
+  sf::Time m_frameStart;
+  sf::Time m_idleBacklog; ///< Idle time the next frame still has to simulate.
+
+  FrameTiming m_last;
+  FrameStatistics m_statistics;
+};
+
+#endif // OVENBRICK_FRAME_SCHEDULER_HXX
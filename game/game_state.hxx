@@ -17,25 +17,84 @@
 #ifndef OVENBRICK_GAME_STATE_HXX
 #define OVENBRICK_GAME_STATE_HXX
 
+#include <iosfwd>
+#include <limits>
 #include <memory>
 
+#include <SFML/System/Time.hpp>
+
+#include "state_arena.hxx"
+
 namespace sf {
   class Event;
-
-  class Time;
 }
 
+struct ActionFrame;
+class Asset;
 class GameStateManager;
+class LoadProgress;
 
 struct GameState
 {
+  /**
+   * @brief How a state is updated while other states lie on top of it.
+   */
+  enum class WhenCovered
+  {
+    Suspend, ///< Not at all, time stands still for it.
+    Throttle, ///< At most every covered_update_interval(), with the time elapsed since its last update.
+    Run, ///< Like the current state.
+  };
+
   explicit inline GameState(std::shared_ptr<GameStateManager> gsm)
-      : m_gsm {gsm}
+      : m_gsm {gsm}, m_arena {}
   {
   }
 
   virtual ~GameState() = default;
 
+  /**
+   * @brief Lifecycle function called on a background thread when the state is preloaded.
+   * @param progress Where to report progress to and to check for cancellation.
+   * @remarks Heavy work (assets, boards) belongs here, set_up() follows on the main thread.
+   *          Must not touch the window or other states. Does nothing by default.
+   */
+  virtual void load(LoadProgress & /* progress */)
+  {
+  }
+
+  /**
+   * @brief Lifecycle function called instead of load() when the state continues a previous session.
+   * @param data What save() wrote in the previous session, valid until the function returns.
+   * @param progress Where to report progress to and to check for cancellation.
+   * @throws std::runtime_error If the data cannot be used, the state is discarded then.
+   * @remarks Runs on a background thread like load(), which it calls by default.
+   */
+  virtual void resume(Asset const & /* data */, LoadProgress & progress)
+  {
+    load(progress);
+  }
+
+  /**
+   * @brief Write what resume() needs to continue the state in the next session.
+   * @param out Where to write to.
+   * @return false, if the state cannot be continued and is left out of the snapshot, which is the default.
+   * @remarks Called on the main thread between frames.
+   */
+  virtual bool save(std::ostream & /* out */) const
+  {
+    return false;
+  }
+
+  /**
+   * @return The name the state is saved under, which has to stay the same across builds and versions.
+   * @remarks Only states which can be saved need one, the default is nullptr.
+   */
+  virtual char const * type_key() const
+  {
+    return nullptr;
+  }
+
   /**
    * @brief Lifecycle function called by the GameStateManager when the state is added.
    */
@@ -47,19 +106,94 @@ struct GameState
    */
   virtual void handle_event(sf::Event const & event) = 0;
 
+  /**
+   * @brief Lifecycle function called once per frame in which actions were pressed or released.
+   * @param actions The actions since the previous call, in terms of the handheld's buttons.
+   * @remarks Called right before the next update() or render(). Does nothing by default.
+   */
+  virtual void handle_actions(ActionFrame const & /* actions */)
+  {
+  }
+
   /**
    * @brief Lifecycle function called whenever the world should be updated.
    * @param elapsed Time elapsed since the last call to update.
    */
   virtual void update(sf::Time const & elapsed) = 0;
 
+  /**
+   * @brief Lifecycle function called once per presented frame.
+   * @param alpha How far (0..1) the frame lies between the last and the next update.
+   */
+  virtual void render(float alpha) = 0;
+
+  /**
+   * @brief Tell the main loop how long the state can do without updates and frames.
+   * @return sf::Time::Zero while animating, otherwise the time until the next timer is due
+   *         or never() if only events can change the state.
+   * @remarks Asked after every frame. Events always wake the loop, whatever was returned.
+   *          States animate on every frame by default.
+   */
+  virtual sf::Time next_wakeup() const
+  {
+    return sf::Time::Zero;
+  }
+
+  /**
+   * @brief Tell whether the states beneath show through this one, e.g. for pause menus and popups.
+   * @return false by default, the state covers the whole screen.
+   * @remarks The states beneath are drawn once into a backdrop, and again only when it is invalidated.
+   */
+  virtual bool is_overlay() const
+  {
+    return false;
+  }
+
+  /**
+   * @return How the state is updated while other states lie on top of it, suspended by default.
+   * @remarks Whenever a throttled state is updated, the backdrop showing it is drawn again.
+   *          Running states are drawn every frame on top of the backdrop instead, with those above them.
+   */
+  virtual WhenCovered when_covered() const
+  {
+    return WhenCovered::Suspend;
+  }
+
+  /**
+   * @return The least time between the updates of the state while it is covered and throttled.
+   */
+  virtual sf::Time covered_update_interval() const
+  {
+    return sf::milliseconds(250);
+  }
+
+  /**
+   * @return The wakeup of a state which waits for nothing but events.
+   */
+  static sf::Time never()
+  {
+    return sf::microseconds(std::numeric_limits<sf::Int64>::max());
+  }
+
   /**
    * @brief Lifecycle function called when the state is removed.
+   * @remarks Must let go of everything allocated from arena(), which is released right afterwards.
    */
   virtual void tear_down() = 0;
 
+  /**
+   * @return Where the containers and objects of the state should allocate from, e.g. by ArenaAllocator.
+   */
+  StateArena & arena()
+  {
+    return m_arena;
+  }
+
 protected:
   std::shared_ptr<GameStateManager> const m_gsm;
+
+private:
+  StateArena m_arena;
 };
 
 #endif // OVENBRICK_GAME_STATE_HXX
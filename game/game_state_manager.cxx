@@ -14,22 +14,276 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
 
+#include <boost/log/trivial.hpp>
+
+#include "asset_pack.hxx"
 #include "game_state_manager.hxx"
 #include "game_state.hxx"
+#include "input_trace.hxx"
+#include "keyboard_layout.hxx"
+#include "load_progress.hxx"
+#include "profiler.hxx"
+#include "renderer.hxx"
+#include "session_snapshot.hxx"
+
+namespace {
+  void load(GameState & state, LoadProgress & progress)
+  {
+#ifdef OVENBRICK_PROFILING
+    auto const & loaded = state;
+    OVENBRICK_PROFILE(Profiler::instance().profile(typeid(loaded)).m_load);
+#endif
+    state.load(progress);
+  }
+
+  void load_saved(GameState & state, Asset const & data, LoadProgress & progress)
+  {
+#ifdef OVENBRICK_PROFILING
+    auto const & loaded = state;
+    OVENBRICK_PROFILE(Profiler::instance().profile(typeid(loaded)).m_load);
+#endif
+    state.resume(data, progress);
+  }
+}
+
+GameStateManager::GameStateManager()
+    : m_backdropValid {false}
+    , m_replay {Replay::Off}
+    , m_input {KeyboardLayout::current}
+{
+}
+
+GameStateManager::~GameStateManager()
+{
+  // the futures wait for their loaders when destroyed, loading jobs own what they need and finish on their own
+  for (auto & pending : m_pending)
+    pending.m_progress->cancel();
+}
 
 void GameStateManager::push_state(std::shared_ptr<GameState> state)
 {
   assert(state != nullptr);
-  m_states.push(state);
+
+  LoadProgress progress {};
+  load(*state, progress);
+  add_state(std::move(state));
+}
+
+std::shared_ptr<LoadProgress> GameStateManager::preload_state(std::shared_ptr<GameState> state,
+                                                              Transition const transition)
+{
+  return preload(std::move(state), transition, Asset {});
+}
+
+std::shared_ptr<LoadProgress> GameStateManager::preload(std::shared_ptr<GameState> state, Transition const transition,
+                                                        Asset resumeData)
+{
+  assert(state != nullptr);
+
+  auto progress = std::make_shared<LoadProgress>();
+  auto const loader = [state, progress, resumeData] {
+    try
+    {
+      if (resumeData)
+        load_saved(*state, resumeData, *progress);
+      else
+        load(*state, *progress);
+    }
+    catch (...)
+    {
+      progress->fail(std::current_exception());
+    }
+  };
+
+  PendingState pending {std::move(state), progress, transition, {}, {}};
+  if (m_jobs)
+    pending.m_job = m_jobs->schedule(loader);
+  else
+    pending.m_loader = std::async(std::launch::async, loader);
+  m_pending.push_back(std::move(pending));
+  return progress;
+}
+
+void GameStateManager::commit_loaded_states()
+{
+  auto const loaded = [](PendingState const & pending) {
+    if (pending.m_job)
+      return pending.m_job.is_done();
+    return pending.m_loader.wait_for(std::chrono::seconds::zero()) == std::future_status::ready;
+  };
+
+  // later states wait for earlier ones, so transitions happen in the requested order
+  auto const end = std::find_if_not(m_pending.begin(), m_pending.end(), loaded);
+  if (end == m_pending.begin())
+    return;
+
+  // set_up() may preload further states, so take the finished ones out first
+  std::vector<PendingState> finished {std::make_move_iterator(m_pending.begin()), std::make_move_iterator(end)};
+  m_pending.erase(m_pending.begin(), end);
+
+  for (auto & pending : finished)
+  {
+    auto & progress = *pending.m_progress;
+    if (progress.status() == LoadProgress::Status::Failed)
+    {
+      auto const & state = *pending.m_state;
+      BOOST_LOG_TRIVIAL(error) << "Preloading " << typeid(state).name() << " failed";
+      continue;
+    }
+
+    progress.finish();
+    if (progress.status() != LoadProgress::Status::Ready)
+      continue;
+
+    if (m_recorder)
+      m_recorder->commit(pending.m_transition);
+    if (pending.m_transition == Transition::Replace && !is_empty())
+      pop_state();
+    add_state(std::move(pending.m_state));
+  }
+}
+
+std::size_t GameStateManager::save(std::ostream & out) const
+{
+  std::vector<SnapshotSource> sources {};
+  sources.reserve(m_states.size());
+  auto topSaved = false;
+  for (auto const & layer : m_states)
+  {
+    std::ostringstream data {};
+    topSaved = layer.m_state->save(data);
+    if (!topSaved)
+      continue;
+
+    auto const type = layer.m_state->type_key();
+    if (!type)
+      throw std::logic_error {"A saved game state has no type key"}; // NOLINT(cert-err60-cpp)
+    auto const bytes = data.str();
+    sources.push_back(SnapshotSource {type, std::vector<char> {bytes.begin(), bytes.end()}});
+  }
+
+  // resuming below the state the session was left in would show another screen, e.g. after a finished match
+  if (!topSaved)
+    return 0;
+
+  write_session_snapshot(out, sources);
+  return sources.size();
+}
+
+std::vector<std::shared_ptr<LoadProgress>> GameStateManager::resume(SessionSnapshot const & snapshot,
+                                                                    StateFactory const & create)
+{
+  // create all states first, so an unknown one leaves the stack as it is
+  std::vector<std::shared_ptr<GameState>> states {};
+  states.reserve(snapshot.size());
+  for (std::size_t n = 0; n < snapshot.size(); ++n)
+  {
+    auto const type = snapshot.type(n);
+    states.push_back(create(type));
+    if (!states.back())
+      throw std::runtime_error {"Cannot resume unknown game state " + type}; // NOLINT(cert-err60-cpp)
+  }
+
+  std::vector<std::shared_ptr<LoadProgress>> progress {};
+  progress.reserve(states.size());
+  for (std::size_t n = 0; n < states.size(); ++n)
+    progress.push_back(preload(std::move(states[n]), Transition::Push, snapshot.data(n)));
+  return progress;
+}
+
+bool GameStateManager::collect(bool const done)
+{
+  switch (m_replay)
+  {
+    case Replay::Off:
+      break;
+    case Replay::Wait:
+      return false;
+    case Replay::Collect:
+      m_replay = Replay::Wait;
+      return true;
+  }
+
+  if (done && m_recorder)
+    m_recorder->collect();
+  return done;
+}
+
+void GameStateManager::set_replay(Replay const replay)
+{
+  m_replay = replay;
+}
+
+void GameStateManager::set_recorder(std::shared_ptr<InputRecorder> recorder)
+{
+  m_recorder = std::move(recorder);
+}
+
+void GameStateManager::set_job_system(std::shared_ptr<JobSystem> jobs)
+{
+  m_jobs = std::move(jobs);
+}
+
+void GameStateManager::set_renderer(std::shared_ptr<Renderer> renderer)
+{
+  m_renderer = std::move(renderer);
+  m_backdropValid = false;
+}
+
+void GameStateManager::invalidate_covered()
+{
+  m_backdropValid = false;
+}
+
+bool GameStateManager::is_loading() const
+{
+  return !m_pending.empty();
+}
+
+void GameStateManager::add_state(std::shared_ptr<GameState> state)
+{
+  if (!is_empty())
+    m_states.back().m_sinceUpdate = sf::Time::Zero;
+  m_states.push_back(Layer {std::move(state), sf::Time::Zero});
+  m_backdropValid = false;
+#ifdef OVENBRICK_PROFILING
+  auto const & added = current();
+  m_profiles.push_back(&Profiler::instance().profile(typeid(added)));
+#endif
+
+  OVENBRICK_PROFILE(m_profiles.back()->m_setUp);
   current().set_up();
 }
 
 void GameStateManager::pop_state()
 {
-  current().tear_down();
-  m_states.pop();
+  {
+    OVENBRICK_PROFILE(m_profiles.back()->m_tearDown);
+    current().tear_down();
+  }
+
+  auto & popped = current();
+  auto & arena = popped.arena();
+  if (arena.high_water_mark() != 0)
+  {
+    BOOST_LOG_TRIVIAL(info) << typeid(popped).name() << " used at most " << arena.high_water_mark()
+                            << " bytes of its arena, " << arena.reserved() << " bytes in " << arena.blocks()
+                            << " blocks at the end";
+  }
+  arena.release();
+
+#ifdef OVENBRICK_PROFILING
+  m_profiles.pop_back();
+#endif
+  m_states.pop_back();
+  m_backdropValid = false;
 }
 
 bool GameStateManager::is_empty() const
@@ -39,17 +293,184 @@ bool GameStateManager::is_empty() const
 
 GameState & GameStateManager::current() const
 {
-  return *m_states.top();
+  return *m_states.back().m_state;
 }
 
-void GameStateManager::handle_event(sf::Event const & event) const
+void GameStateManager::handle_event(sf::Event const & event)
 {
-  if (!is_empty())
-    current().handle_event(event);
+  if (is_empty())
+    return;
+  if (m_recorder)
+    m_recorder->event(event);
+  m_input.translate(event);
+
+  OVENBRICK_PROFILE(m_profiles.back()->m_event);
+  current().handle_event(event);
 }
 
-void GameStateManager::update(sf::Time const & elapsed) const
+void GameStateManager::update(sf::Time const & elapsed)
 {
-  if (!is_empty())
-    current().update(elapsed);
+  if (m_jobs)
+    m_jobs->run_main_thread_jobs();
+  if (is_empty())
+    return;
+  if (m_recorder)
+    m_recorder->update(elapsed);
+  dispatch_actions();
+  update_covered(elapsed);
+  if (is_empty())
+    return;
+
+  OVENBRICK_PROFILE(m_profiles.back()->m_update);
+  current().update(elapsed);
+}
+
+void GameStateManager::render(float alpha)
+{
+  if (is_empty())
+    return;
+  if (m_recorder)
+    m_recorder->render(alpha);
+  dispatch_actions();
+  if (is_empty())
+    return;
+  render_covered(alpha);
+
+  OVENBRICK_PROFILE(m_profiles.back()->m_render);
+  current().render(alpha);
+}
+
+sf::Time GameStateManager::next_wakeup() const
+{
+  // loading finishes without an event, so keep polling for it
+  if (is_empty() || is_loading() || m_input.has_pending() || (m_jobs && m_jobs->has_main_thread_jobs()))
+    return sf::Time::Zero;
+
+  auto wakeup = current().next_wakeup();
+  for (std::size_t n = 0; n + 1 < m_states.size(); ++n)
+  {
+    auto const & layer = m_states[n];
+    auto const & state = *layer.m_state;
+    switch (state.when_covered())
+    {
+      case GameState::WhenCovered::Suspend:
+        break;
+      case GameState::WhenCovered::Throttle:
+        wakeup = std::min(wakeup, std::max(state.next_wakeup(), state.covered_update_interval() - layer.m_sinceUpdate));
+        break;
+      case GameState::WhenCovered::Run:
+        wakeup = std::min(wakeup, state.next_wakeup());
+        break;
+    }
+  }
+  return std::max(wakeup, sf::Time::Zero);
+}
+
+void GameStateManager::frame_presented()
+{
+  m_input.presented();
+}
+
+void GameStateManager::set_keyboard_layout(KeyboardLayout const & layout)
+{
+  m_input.set_layout(layout);
+}
+
+InputActions const & GameStateManager::input() const
+{
+  return m_input;
+}
+
+void GameStateManager::dispatch_actions()
+{
+  if (!m_input.has_pending())
+    return;
+
+  auto const actions = m_input.collect();
+  if (actions.is_empty())
+    return;
+
+  OVENBRICK_PROFILE(m_profiles.back()->m_event);
+  current().handle_actions(actions);
+}
+
+void GameStateManager::update_covered(sf::Time const & elapsed)
+{
+  for (std::size_t n = 0; n + 1 < m_states.size(); ++n)
+  {
+    auto & layer = m_states[n];
+    switch (layer.m_state->when_covered())
+    {
+      case GameState::WhenCovered::Suspend:
+        continue;
+      case GameState::WhenCovered::Throttle:
+        layer.m_sinceUpdate += elapsed;
+        if (layer.m_sinceUpdate < layer.m_state->covered_update_interval())
+          continue;
+        break;
+      case GameState::WhenCovered::Run:
+        layer.m_sinceUpdate = elapsed;
+        break;
+    }
+
+    // the update may change the stack, and what the backdrop shows unless the state is drawn every frame anyway
+    auto const state = layer.m_state;
+    auto const sinceUpdate = layer.m_sinceUpdate;
+    layer.m_sinceUpdate = sf::Time::Zero;
+    if (n >= first_shown() && n < first_running())
+      m_backdropValid = false;
+
+    OVENBRICK_PROFILE(m_profiles[n]->m_update);
+    state->update(sinceUpdate);
+  }
+}
+
+std::size_t GameStateManager::first_shown() const
+{
+  auto const top = m_states.size() - 1;
+  auto first = top;
+  while (first > 0 && m_states[first].m_state->is_overlay())
+    --first;
+  return first;
+}
+
+std::size_t GameStateManager::first_running() const
+{
+  auto const top = m_states.size() - 1;
+  auto first = first_shown();
+  while (first < top && m_states[first].m_state->when_covered() != GameState::WhenCovered::Run)
+    ++first;
+  return first;
+}
+
+void GameStateManager::render_covered(float const alpha)
+{
+  auto const top = m_states.size() - 1;
+  auto const first = first_shown();
+  auto const running = first_running();
+
+  if (first < running && m_renderer && m_backdropValid)
+    m_renderer->draw_backdrop();
+  else if (first < running)
+  {
+    for (auto n = first; n < running; ++n)
+    {
+      OVENBRICK_PROFILE(m_profiles[n]->m_render);
+      m_states[n].m_state->render(alpha);
+    }
+
+    if (m_renderer)
+    {
+      m_renderer->capture_backdrop();
+      m_renderer->draw_backdrop();
+      m_backdropValid = true;
+    }
+  }
+
+  // running states change every tick, capturing them would only add a copy of the whole screen
+  for (auto n = running; n < top; ++n)
+  {
+    OVENBRICK_PROFILE(m_profiles[n]->m_render);
+    m_states[n].m_state->render(alpha);
+  }
 }
@@ -17,35 +17,230 @@
 #ifndef OVENBRICK_GAME_STATE_MANAGER_HXX
 #define OVENBRICK_GAME_STATE_MANAGER_HXX
 
+#include <functional>
+#include <future>
+#include <iosfwd>
 #include <memory>
-#include <stack>
+#include <string>
+#include <vector>
 
 #include <gsl/pointers>
 
 #include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+
+#include "input_actions.hxx"
+#include "job_system.hxx"
 
 struct GameState;
+struct StateProfile;
+class Asset;
+class InputRecorder;
+class LoadProgress;
+class Renderer;
+class SessionSnapshot;
 
 namespace sf {
   class Event;
-
-  class Time;
 }
 
 class GameStateManager final : private sf::NonCopyable
 {
-  std::stack<std::shared_ptr<GameState>> m_states;
+  struct Layer final
+  {
+    std::shared_ptr<GameState> m_state;
+    sf::Time m_sinceUpdate; ///< While covered and throttled.
+  };
+
+  // vectors keep their capacity, so screen transitions do not allocate once the stack was this deep,
+  // plain ones since covered states are updated and rendered as well
+  std::vector<Layer> m_states;
+#ifdef OVENBRICK_PROFILING
+  std::vector<StateProfile *> m_profiles;
+#endif
+
+public:
+  /**
+   * @brief How a preloaded state enters the stack.
+   */
+  enum class Transition
+  {
+    Push, ///< On top of the current state.
+    Replace, ///< Instead of the current state.
+  };
+
+  /**
+   * @brief Who decides when states collect the results of their background work.
+   */
+  enum class Replay
+  {
+    Off, ///< The states decide by whether the work is done, the ticks they collect on are recorded.
+    Wait, ///< A replay decides, nothing is collected on this tick.
+    Collect, ///< A replay decides, the result is collected on this tick, waiting for it if necessary.
+  };
+
+private:
+  struct PendingState final
+  {
+    std::shared_ptr<GameState> m_state;
+    std::shared_ptr<LoadProgress> m_progress;
+    Transition m_transition;
+    std::future<void> m_loader; ///< Without a job system.
+    JobHandle m_job; ///< With a job system.
+  };
+
+  /**
+   * @brief Load a state in the background, by GameState::resume() if there is data of a previous session.
+   */
+  std::shared_ptr<LoadProgress> preload(std::shared_ptr<GameState> state, Transition transition,
+                                        Asset resumeData);
+
+  std::vector<PendingState> m_pending;
+  std::shared_ptr<InputRecorder> m_recorder;
+  std::shared_ptr<JobSystem> m_jobs;
+  std::shared_ptr<Renderer> m_renderer;
+  bool m_backdropValid; ///< The renderer's backdrop shows the states beneath the overlays as they are.
+  Replay m_replay;
+  InputActions m_input;
+
+  /**
+   * @brief Put an already loaded state on top of the stack and set it up.
+   */
+  void add_state(std::shared_ptr<GameState> state);
+
+  /**
+   * @brief Hand the actions translated since the last call to the current state.
+   */
+  void dispatch_actions();
+
+  /**
+   * @brief Update the states beneath the current one by their WhenCovered policy.
+   */
+  void update_covered(sf::Time const & elapsed);
+
+  /**
+   * @return The index of the lowest state showing through the overlays on top, that of the current state if none.
+   */
+  std::size_t first_shown() const;
+
+  /**
+   * @return The index of the lowest state showing through which runs while covered, that of the current state if none.
+   * @remarks The states from there on are drawn every frame, only those beneath are cached in the backdrop.
+   */
+  std::size_t first_running() const;
+
+  /**
+   * @brief Render the states showing through the overlays on top, those beneath running ones from the backdrop.
+   */
+  void render_covered(float alpha);
 
 public:
+  /**
+   * @brief Translates keys by KeyboardLayout::current.
+   */
+  GameStateManager();
+
+  /**
+   * @brief Cancels all states still being preloaded, waits for those loading on a thread of their own.
+   */
+  ~GameStateManager();
+
   /**
    * @brief Push the new state on top of the game state stack.
    * @param state The new state.
+   * @remarks Loads the state synchronously, use preload_state() for states with heavy loading.
    */
   void push_state(std::shared_ptr<GameState> state);
 
+  /**
+   * @brief Load a state in the background while the current state keeps running.
+   * @param state The new state.
+   * @param transition How the state enters the stack once it is loaded.
+   * @return The progress of loading, which also allows cancelling it.
+   * @remarks The state is added by the first call to commit_loaded_states() after loading finished.
+   *          Loading runs as a job if there is a job system, on a thread of its own otherwise.
+   */
+  std::shared_ptr<LoadProgress> preload_state(std::shared_ptr<GameState> state,
+                                              Transition transition = Transition::Push);
+
+  /**
+   * @brief Add all states which finished preloading, in the order they were requested.
+   * @remarks Called at frame boundaries, so transitions never happen in the middle of a frame.
+   */
+  void commit_loaded_states();
+
+  /**
+   * @brief Creates the game state of a GameState::type_key() written into a session snapshot.
+   * @remarks Returns nullptr for unknown types.
+   */
+  using StateFactory = std::function<std::shared_ptr<GameState>(std::string const & type)>;
+
+  /**
+   * @brief Write the stack of states into a session snapshot, states which cannot be saved are left out.
+   * @param out The binary output stream.
+   * @return The number of states written, 0 if the top state cannot be saved, nothing is written then.
+   * @throws std::logic_error If a state is saved without a type key.
+   * @remarks States still being preloaded are not part of the snapshot.
+   */
+  std::size_t save(std::ostream & out) const;
+
+  /**
+   * @brief Preload the states of a snapshot, which enter the stack in their previous order by GameState::resume().
+   * @param snapshot A snapshot written by save().
+   * @param create Creates the states by their type key.
+   * @return The progress of loading the states, from the bottom of the stack to the top.
+   * @throws std::runtime_error If create() does not know a type, nothing is preloaded then.
+   */
+  std::vector<std::shared_ptr<LoadProgress>> resume(SessionSnapshot const & snapshot, StateFactory const & create);
+
+  /**
+   * @brief Record everything the states are fed with from now on.
+   * @param recorder Where to record to, nullptr stops recording.
+   */
+  void set_recorder(std::shared_ptr<InputRecorder> recorder);
+
+  /**
+   * @brief Decide whether a state takes the result of its background work on this tick.
+   * @param done Whether the work is done, so taking its result does not block.
+   * @return done, unless a replay decides.
+   * @remarks Ticks returning true are recorded, so work finishing at some wall time is collected on the same tick
+   *          in a replay. At most one state collects per tick.
+   */
+  bool collect(bool done);
+
+  /**
+   * @brief Let a replay decide what collect() returns, Replay::Collect applies to a single call.
+   */
+  void set_replay(Replay replay);
+
+  /**
+   * @brief Preload states on the job system and run its main thread jobs during update().
+   * @param jobs The job system, nullptr goes back to a thread per preloaded state.
+   */
+  void set_job_system(std::shared_ptr<JobSystem> jobs);
+
+  /**
+   * @brief Cache the states showing through overlays in the backdrop of the renderer.
+   * @param renderer The renderer the states draw with, nullptr renders them every frame.
+   */
+  void set_renderer(std::shared_ptr<Renderer> renderer);
+
+  /**
+   * @brief Render the states showing through overlays again in the next frame.
+   * @remarks For overlays changing what the states beneath show, covered updates and stack changes invalidate anyway.
+   */
+  void invalidate_covered();
+
+  /**
+   * @brief Check whether there are states being preloaded.
+   * @return true, if there are states which were not committed or discarded yet.
+   */
+  bool is_loading() const;
+
   /**
    * @brief Pop the current state from the game state stack.
-   * @remarks This deletes the state.
+   * @remarks Releases the arena of the state after tear_down() and logs how much of it was used.
+   *          This deletes the state.
    */
   void pop_state();
 
@@ -62,16 +257,48 @@ public:
   GameState & current() const;
 
   /**
-   * @brief Forward the event to the currently active state.
+   * @brief Forward the event to the currently active state, key events are translated into actions as well.
    * @param event The event which occurred.
    */
-  void handle_event(sf::Event const & event) const;
+  void handle_event(sf::Event const & event);
 
   /**
-   * @brief Update the currently active state.
+   * @brief Update the currently active state, after running main thread jobs and handing it pending actions.
+   * @remarks The states beneath are updated before, as far as their GameState::WhenCovered policy allows.
    * @param elapsed The elapsed time since the last call to update.
    */
-  void update(sf::Time const & elapsed) const;
+  void update(sf::Time const & elapsed);
+
+  /**
+   * @brief Render the currently active state, after handing it pending actions.
+   * @remarks The states showing through overlays are drawn before, from the backdrop while it is valid.
+   * @param alpha How far (0..1) the frame lies between the last and the next update.
+   */
+  void render(float alpha);
+
+  /**
+   * @brief Tell the manager that the last rendered frame was presented, measures the input latency.
+   */
+  void frame_presented();
+
+  /**
+   * @brief Translate keys by a different layout from now on.
+   */
+  void set_keyboard_layout(KeyboardLayout const & layout);
+
+  /**
+   * @return The translation of keys into actions and its latency.
+   */
+  InputActions const & input() const;
+
+  /**
+   * @brief Ask the currently active state when it needs the next frame.
+   * @return sf::Time::Zero while states are being preloaded, actions or main thread jobs are pending
+   *         or there is no state at all,
+   *         GameState::next_wakeup() of the current state otherwise,
+   *         or earlier if a covered state which is not suspended needs an update before.
+   */
+  sf::Time next_wakeup() const;
 };
 
 #endif // OVENBRICK_GAME_STATE_MANAGER_HXX
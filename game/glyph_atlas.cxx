@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "glyph_atlas.hxx"
+
+namespace {
+  struct Header final
+  {
+    char m_magic[4];
+    std::uint32_t m_version;
+    std::uint32_t m_width;
+    std::uint32_t m_height;
+    std::uint32_t m_faceCount;
+    std::uint32_t m_glyphCount;
+  };
+
+  static_assert(std::is_standard_layout<Header>::value && sizeof(Header) == 24, "unexpected header layout");
+  static_assert(std::is_standard_layout<GlyphAtlas::Face>::value && sizeof(GlyphAtlas::Face) == 24,
+                "unexpected face layout");
+  static_assert(std::is_standard_layout<GlyphAtlas::Glyph>::value && sizeof(GlyphAtlas::Glyph) == 20,
+                "unexpected glyph layout");
+
+  [[noreturn]] void malformed(std::string const & what)
+  {
+    throw std::runtime_error {"Malformed glyph atlas: " + what}; // NOLINT(cert-err60-cpp)
+  }
+
+  template <typename T>
+  void write_all(std::ostream & out, std::vector<T> const & values)
+  {
+    out.write(reinterpret_cast<char const *>(values.data()), static_cast<std::streamsize>(sizeof(T) * values.size()));
+  }
+}
+
+char const GlyphAtlas::MAGIC[4] = {'O', 'B', 'G', 'A'};
+std::uint32_t const GlyphAtlas::VERSION;
+
+void GlyphAtlas::write(std::ostream & out, Data const & data)
+{
+  Header header {};
+  std::copy(std::begin(MAGIC), std::end(MAGIC), header.m_magic);
+  header.m_version = VERSION;
+  header.m_width = data.m_width;
+  header.m_height = data.m_height;
+  header.m_faceCount = static_cast<std::uint32_t>(data.m_faces.size());
+  header.m_glyphCount = static_cast<std::uint32_t>(data.m_glyphs.size());
+
+  out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+  write_all(out, data.m_faces);
+  write_all(out, data.m_glyphs);
+  write_all(out, data.m_coverage);
+}
+
+GlyphAtlas::GlyphAtlas(Asset asset)
+    : m_asset {std::move(asset)}, m_faces {nullptr}, m_faceCount {0}, m_glyphs {nullptr}
+{
+  Header header {};
+  if (m_asset.size() < sizeof(header))
+    malformed("truncated header");
+  std::memcpy(&header, m_asset.data(), sizeof(header));
+  if (!std::equal(std::begin(MAGIC), std::end(MAGIC), header.m_magic))
+    malformed("bad magic");
+  if (header.m_version != VERSION)
+    malformed("unsupported version " + std::to_string(header.m_version));
+
+  auto const tables = sizeof(Header) + std::uint64_t {sizeof(Face)} * header.m_faceCount
+                      + std::uint64_t {sizeof(Glyph)} * header.m_glyphCount;
+  auto const pixels = std::uint64_t {header.m_width} * header.m_height;
+  if (m_asset.size() != tables + pixels)
+    malformed("size mismatch");
+  if (reinterpret_cast<std::uintptr_t>(m_asset.data()) % alignof(Face) != 0)
+    malformed("misaligned");
+
+  m_faces = reinterpret_cast<Face const *>(m_asset.data() + sizeof(Header));
+  m_faceCount = header.m_faceCount;
+  m_glyphs = reinterpret_cast<Glyph const *>(m_faces + m_faceCount);
+  for (std::size_t n = 0; n < m_faceCount; ++n)
+  {
+    auto const & face = m_faces[n];
+    if (face.m_firstGlyph > header.m_glyphCount || face.m_glyphCount > header.m_glyphCount - face.m_firstGlyph)
+      malformed("face " + std::to_string(face.m_pixelSize) + " out of bounds");
+  }
+  for (std::size_t n = 0; n < header.m_glyphCount; ++n)
+  {
+    auto const & glyph = m_glyphs[n];
+    if (glyph.m_x + glyph.m_width > header.m_width || glyph.m_y + glyph.m_height > header.m_height)
+      malformed("glyph " + std::to_string(glyph.m_codepoint) + " out of bounds");
+  }
+
+  // white pixels, so vertex colors tint the text
+  auto const coverage = reinterpret_cast<std::uint8_t const *>(m_asset.data() + tables);
+  std::vector<sf::Uint8> rgba(pixels * 4, 255);
+  for (std::size_t n = 0; n < pixels; ++n)
+    rgba[n * 4 + 3] = coverage[n];
+
+  if (!m_texture.create(header.m_width, header.m_height))
+    throw std::runtime_error {"Cannot create glyph atlas texture"}; // NOLINT(cert-err60-cpp)
+  m_texture.update(rgba.data());
+}
+
+GlyphAtlas::Face const * GlyphAtlas::face(unsigned const pixelSize) const
+{
+  auto const end = m_faces + m_faceCount;
+  auto const it = std::find_if(m_faces, end, [pixelSize](Face const & face) {
+    return face.m_pixelSize == pixelSize;
+  });
+  return (it != end) ? it : nullptr;
+}
+
+GlyphAtlas::Glyph const * GlyphAtlas::glyph(Face const & face, std::uint32_t const codepoint) const
+{
+  auto const begin = m_glyphs + face.m_firstGlyph;
+  auto const end = begin + face.m_glyphCount;
+  auto const it = std::lower_bound(begin, end, codepoint, [](Glyph const & glyph, std::uint32_t value) {
+    return glyph.m_codepoint < value;
+  });
+  return (it != end && it->m_codepoint == codepoint) ? it : nullptr;
+}
+
+sf::Texture const & GlyphAtlas::texture() const
+{
+  return m_texture;
+}
@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_GLYPH_ATLAS_HXX
+#define OVENBRICK_GLYPH_ATLAS_HXX
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/System/NonCopyable.hpp>
+
+#include "asset_pack.hxx"
+
+/**
+ * @brief Glyphs rasterized at build time, ready to be drawn without FreeType.
+ *
+ * Layout (little endian): a header, the faces (one per pixel size), the glyphs of all faces
+ * sorted by codepoint within each face, then one coverage byte per atlas pixel.
+ */
+class GlyphAtlas final : private sf::NonCopyable
+{
+public:
+  static char const MAGIC[4];
+  static std::uint32_t const VERSION = 1;
+
+  /**
+   * @brief Metrics of one pixel size.
+   */
+  struct Face final
+  {
+    std::uint32_t m_pixelSize;
+    std::int32_t m_lineSpacing; ///< Distance between two baselines.
+    std::int32_t m_ascent; ///< Distance from the top of a line to its baseline.
+    std::uint32_t m_firstGlyph; ///< Index of the first glyph of this face.
+    std::uint32_t m_glyphCount;
+    std::uint32_t m_reserved;
+  };
+
+  /**
+   * @brief Placement of one glyph in the atlas.
+   */
+  struct Glyph final
+  {
+    std::uint32_t m_codepoint;
+    std::uint16_t m_x; ///< Left edge in the atlas.
+    std::uint16_t m_y; ///< Top edge in the atlas.
+    std::uint16_t m_width;
+    std::uint16_t m_height;
+    std::int16_t m_left; ///< Horizontal offset from the pen position.
+    std::int16_t m_top; ///< Distance from the baseline up to the top edge.
+    std::int16_t m_advance; ///< How far the pen moves.
+    std::int16_t m_reserved;
+  };
+
+  /**
+   * @brief Everything stored in an atlas.
+   */
+  struct Data final
+  {
+    std::uint32_t m_width;
+    std::uint32_t m_height;
+    std::vector<Face> m_faces;
+    std::vector<Glyph> m_glyphs;
+    std::vector<std::uint8_t> m_coverage; ///< m_width * m_height bytes, row by row.
+  };
+
+  /**
+   * @brief Serialize an atlas.
+   * @param out The binary output stream.
+   * @param data The atlas, glyphs must be sorted as described above.
+   */
+  static void write(std::ostream & out, Data const & data);
+
+  /**
+   * @brief Use a serialized atlas and upload it into a texture.
+   * @param asset The serialized atlas, referenced rather than copied.
+   * @throws std::runtime_error If the asset is no valid atlas.
+   */
+  explicit GlyphAtlas(Asset asset);
+
+  /**
+   * @param pixelSize The requested size.
+   * @return The face of that size or nullptr, if the size was not baked.
+   */
+  Face const * face(unsigned pixelSize) const;
+
+  /**
+   * @param face A face of this atlas.
+   * @param codepoint The requested character.
+   * @return The glyph or nullptr, if the character was not baked.
+   */
+  Glyph const * glyph(Face const & face, std::uint32_t codepoint) const;
+
+  /**
+   * @return The texture holding all glyphs in white, with the coverage as alpha.
+   */
+  sf::Texture const & texture() const;
+
+private:
+  Asset m_asset;
+  Face const * m_faces;
+  std::size_t m_faceCount;
+  Glyph const * m_glyphs;
+  sf::Texture m_texture;
+};
+
+#endif // OVENBRICK_GLYPH_ATLAS_HXX
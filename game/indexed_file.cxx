@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "indexed_file.hxx"
+
+namespace {
+  struct Header final
+  {
+    char m_magic[4];
+    std::uint32_t m_version;
+    std::uint32_t m_count;
+    std::uint32_t m_reserved;
+  };
+
+  static_assert(std::is_standard_layout<Header>::value && sizeof(Header) == IndexedFile::HEADER_SIZE,
+                "unexpected header layout");
+}
+
+std::size_t const IndexedFile::HEADER_SIZE;
+std::size_t const IndexedFile::DATA_ALIGNMENT;
+
+void write_indexed_file_contents(std::ostream & out, char const (&magic)[4], std::uint32_t const version,
+                                 char const * const index, std::size_t const indexSize,
+                                 std::vector<IndexedFileItem> const & items)
+{
+  Header header {};
+  std::copy(std::begin(magic), std::end(magic), header.m_magic);
+  header.m_version = version;
+  header.m_count = static_cast<std::uint32_t>(items.size());
+
+  out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+  out.write(index, static_cast<std::streamsize>(indexSize));
+  std::size_t written = sizeof(header) + indexSize;
+  for (auto const & item : items)
+  {
+    out.write(item.m_name->data(), static_cast<std::streamsize>(item.m_name->size()));
+    written += item.m_name->size();
+  }
+
+  char const padding[IndexedFile::DATA_ALIGNMENT] = {};
+  for (auto const & item : items)
+  {
+    auto const offset = IndexedFile::align(written);
+    out.write(padding, static_cast<std::streamsize>(offset - written));
+    out.write(item.m_data->data(), static_cast<std::streamsize>(item.m_data->size()));
+    written = offset + item.m_data->size();
+  }
+}
+
+std::size_t IndexedFile::align(std::size_t const offset)
+{
+  return (offset + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+}
+
+IndexedFile::IndexedFile(std::string const & filename, std::string kind, char const (&magic)[4],
+                         std::uint32_t const version, std::size_t const entrySize)
+    : m_file {std::make_shared<boost::iostreams::mapped_file_source>()}
+    , m_kind {std::move(kind)}
+    , m_data {nullptr}
+    , m_fileSize {0}
+    , m_count {0}
+{
+  try
+  {
+    m_file->open(filename);
+  }
+  catch (std::exception const & error)
+  {
+    throw std::runtime_error {"Cannot map " + m_kind + " " + filename + ": " + error.what()}; // NOLINT(cert-err60-cpp)
+  }
+
+  m_data = m_file->data();
+  m_fileSize = m_file->size();
+
+  Header header {};
+  if (m_fileSize < sizeof(header))
+    malformed("truncated header");
+  std::memcpy(&header, m_data, sizeof(header));
+  if (!std::equal(std::begin(magic), std::end(magic), header.m_magic))
+    malformed("bad magic");
+  if (header.m_version != version)
+    malformed("unsupported version " + std::to_string(header.m_version));
+
+  m_count = header.m_count;
+  if ((m_fileSize - sizeof(header)) / entrySize < m_count)
+    malformed("truncated index");
+}
+
+IndexedFile::~IndexedFile() = default;
+
+std::size_t IndexedFile::size() const
+{
+  return m_count;
+}
+
+char const * IndexedFile::data() const
+{
+  return m_data;
+}
+
+std::shared_ptr<void const> IndexedFile::owner() const
+{
+  return m_file;
+}
+
+void IndexedFile::malformed(std::string const & what) const
+{
+  throw std::runtime_error {"Malformed " + m_kind + ": " + what}; // NOLINT(cert-err60-cpp)
+}
+
+void IndexedFile::check_bounds(std::size_t const index, std::uint64_t const nameOffset, std::uint64_t const nameLength,
+                               std::uint64_t const offset, std::uint64_t const size) const
+{
+  if (nameOffset > m_fileSize || nameLength > m_fileSize - nameOffset || offset > m_fileSize
+      || size > m_fileSize - offset)
+    malformed("entry " + std::to_string(index) + " out of bounds");
+}
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_INDEXED_FILE_HXX
+#define OVENBRICK_INDEXED_FILE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+namespace boost {
+  namespace iostreams {
+    class mapped_file_source;
+  }
+}
+
+/**
+ * @brief What an entry of an indexed file is written from.
+ */
+struct IndexedFileItem final
+{
+  std::string const * m_name;
+  std::vector<char> const * m_data; ///< As it is stored in the file.
+};
+
+/**
+ * @brief Write the header, the index, the names and the aligned data of an indexed file.
+ * @param index The entries exactly as stored, the offsets of all items included.
+ * @param indexSize The bytes of the index.
+ * @remarks Called by write_indexed_file(), which lays out the entries.
+ */
+void write_indexed_file_contents(std::ostream & out, char const (&magic)[4], std::uint32_t version,
+                                 char const * index, std::size_t indexSize, std::vector<IndexedFileItem> const & items);
+
+/**
+ * @brief Lay out the entries and write an indexed file.
+ * @param out The binary output stream.
+ * @param magic Tells the kind of file.
+ * @param version The version of the format.
+ * @param[in,out] entries One per item, m_nameOffset, m_nameLength and m_offset are filled in.
+ * @param items The names and data of the entries.
+ */
+template <typename Entry>
+void write_indexed_file(std::ostream & out, char const (&magic)[4], std::uint32_t const version,
+                        std::vector<Entry> & entries, std::vector<IndexedFileItem> const & items);
+
+/**
+ * @brief Memory-mapped file made of an entry index, the names of the entries and their data.
+ *
+ * Layout (little endian): a 16 byte header with magic, version and the number of entries,
+ * the index, the names, then the data of every entry aligned to 16 bytes.
+ * Asset packs and session snapshots are indexed files, each with entries of their own,
+ * which have an m_nameOffset, m_nameLength and m_offset and tell their stored_size().
+ */
+class IndexedFile final : private sf::NonCopyable
+{
+public:
+  static constexpr std::size_t HEADER_SIZE = 16;
+  static constexpr std::size_t DATA_ALIGNMENT = 16;
+
+  /**
+   * @return The offset rounded up to the DATA_ALIGNMENT.
+   */
+  static std::size_t align(std::size_t offset);
+
+  /**
+   * @brief Map a file and check its header and that the index fits.
+   * @param filename The path of the file.
+   * @param kind What the file is, for error messages, e.g. "asset pack".
+   * @param magic Tells the kind of file.
+   * @param version The only version of the format which is accepted.
+   * @param entrySize The bytes of an entry of the index.
+   * @throws std::runtime_error If the file cannot be mapped or is malformed.
+   */
+  IndexedFile(std::string const & filename, std::string kind, char const (&magic)[4], std::uint32_t version,
+              std::size_t entrySize);
+
+  ~IndexedFile();
+
+  /**
+   * @return The number of entries.
+   */
+  std::size_t size() const;
+
+  /**
+   * @return The entries after checking that their names and data lie within the file.
+   * @throws std::runtime_error If an entry is out of bounds.
+   */
+  template <typename Entry>
+  Entry const * checked_index() const;
+
+  /**
+   * @return The first byte of the mapping, which the offsets of the entries count from.
+   */
+  char const * data() const;
+
+  /**
+   * @return Keeps the mapping alive, e.g. for Asset.
+   */
+  std::shared_ptr<void const> owner() const;
+
+  /**
+   * @throws std::runtime_error Always, telling what is malformed about the file.
+   */
+  [[noreturn]] void malformed(std::string const & what) const;
+
+private:
+  std::shared_ptr<boost::iostreams::mapped_file_source> m_file;
+  std::string m_kind;
+  char const * m_data;
+  std::size_t m_fileSize;
+  std::size_t m_count;
+
+  void check_bounds(std::size_t index, std::uint64_t nameOffset, std::uint64_t nameLength, std::uint64_t offset,
+                    std::uint64_t size) const;
+};
+
+template <typename Entry>
+void write_indexed_file(std::ostream & out, char const (&magic)[4], std::uint32_t const version,
+                        std::vector<Entry> & entries, std::vector<IndexedFileItem> const & items)
+{
+  auto offset = IndexedFile::HEADER_SIZE + sizeof(Entry) * entries.size();
+  for (std::size_t n = 0; n < items.size(); ++n)
+  {
+    entries[n].m_nameOffset = static_cast<std::uint32_t>(offset);
+    entries[n].m_nameLength = static_cast<std::uint32_t>(items[n].m_name->size());
+    offset += items[n].m_name->size();
+  }
+  for (std::size_t n = 0; n < items.size(); ++n)
+  {
+    offset = IndexedFile::align(offset);
+    entries[n].m_offset = offset;
+    offset += items[n].m_data->size();
+  }
+
+  write_indexed_file_contents(out, magic, version, reinterpret_cast<char const *>(entries.data()),
+                              sizeof(Entry) * entries.size(), items);
+}
+
+template <typename Entry>
+Entry const * IndexedFile::checked_index() const
+{
+  // mappings are page aligned and the header is a multiple of the entry alignment
+  auto const entries = reinterpret_cast<Entry const *>(m_data + HEADER_SIZE);
+  for (std::size_t n = 0; n < m_count; ++n)
+  {
+    auto const & entry = entries[n];
+    check_bounds(n, entry.m_nameOffset, entry.m_nameLength, entry.m_offset, entry.stored_size());
+  }
+  return entries;
+}
+
+#endif // OVENBRICK_INDEXED_FILE_HXX
@@ -0,0 +1,288 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <SFML/Window/Event.hpp>
+
+#include "input_actions.hxx"
+
+namespace {
+  using sfk = sf::Keyboard;
+
+  struct Binding final
+  {
+    Action m_action;
+    char const * m_name;
+    KeyboardLayout::key_type KeyboardLayout::* m_key;
+  };
+
+  // in the order of Action
+  std::array<Binding, ACTION_COUNT> const BINDINGS {{
+      {Action::Up, "up", &KeyboardLayout::m_keyUp},
+      {Action::Down, "down", &KeyboardLayout::m_keyDown},
+      {Action::Left, "left", &KeyboardLayout::m_keyLeft},
+      {Action::Right, "right", &KeyboardLayout::m_keyRight},
+      {Action::A, "a", &KeyboardLayout::m_keyA},
+      {Action::B, "b", &KeyboardLayout::m_keyB},
+      {Action::X, "x", &KeyboardLayout::m_keyX},
+      {Action::Y, "y", &KeyboardLayout::m_keyY},
+      {Action::Menu, "menu", &KeyboardLayout::m_keyMenu},
+      {Action::Start, "start", &KeyboardLayout::m_keyStart},
+      {Action::Select, "select", &KeyboardLayout::m_keySelect},
+  }};
+
+  using KeyNames = std::vector<std::pair<std::string, sfk::Key>>;
+
+  KeyNames make_key_names()
+  {
+    KeyNames names {
+        {"Escape", sfk::Escape}, {"LControl", sfk::LControl}, {"LShift", sfk::LShift}, {"LAlt", sfk::LAlt},
+        {"LSystem", sfk::LSystem}, {"RControl", sfk::RControl}, {"RShift", sfk::RShift}, {"RAlt", sfk::RAlt},
+        {"RSystem", sfk::RSystem}, {"Menu", sfk::Menu}, {"LBracket", sfk::LBracket}, {"RBracket", sfk::RBracket},
+        {"Semicolon", sfk::Semicolon}, {"Comma", sfk::Comma}, {"Period", sfk::Period}, {"Quote", sfk::Quote},
+        {"Slash", sfk::Slash}, {"Backslash", sfk::Backslash}, {"Tilde", sfk::Tilde}, {"Equal", sfk::Equal},
+        {"Hyphen", sfk::Hyphen}, {"Space", sfk::Space}, {"Enter", sfk::Enter}, {"Backspace", sfk::Backspace},
+        {"Tab", sfk::Tab}, {"PageUp", sfk::PageUp}, {"PageDown", sfk::PageDown}, {"End", sfk::End},
+        {"Home", sfk::Home}, {"Insert", sfk::Insert}, {"Delete", sfk::Delete}, {"Add", sfk::Add},
+        {"Subtract", sfk::Subtract}, {"Multiply", sfk::Multiply}, {"Divide", sfk::Divide}, {"Left", sfk::Left},
+        {"Right", sfk::Right}, {"Up", sfk::Up}, {"Down", sfk::Down}, {"Pause", sfk::Pause},
+    };
+
+    auto const range = [&names](std::string const & prefix, char first, sfk::Key from, int count) {
+      for (int n = 0; n < count; ++n)
+        names.emplace_back(prefix + static_cast<char>(first + n), static_cast<sfk::Key>(from + n));
+    };
+    range("", 'A', sfk::A, 26);
+    range("Num", '0', sfk::Num0, 10);
+    range("Numpad", '0', sfk::Numpad0, 10);
+    for (int n = 0; n < 15; ++n)
+      names.emplace_back("F" + std::to_string(n + 1), static_cast<sfk::Key>(sfk::F1 + n));
+
+    return names;
+  }
+
+  std::int64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+char const * to_string(Action const action)
+{
+  auto const index = static_cast<std::size_t>(action);
+  return (index < BINDINGS.size()) ? BINDINGS[index].m_name : "none";
+}
+
+bool from_string(std::string const & name, Action & action)
+{
+  auto const it = std::find_if(BINDINGS.begin(), BINDINGS.end(), [&name](Binding const & binding) {
+    return name == binding.m_name;
+  });
+  if (it == BINDINGS.end())
+    return false;
+
+  action = it->m_action;
+  return true;
+}
+
+bool from_string(std::string const & name, sf::Keyboard::Key & key)
+{
+  static KeyNames const names = make_key_names();
+  auto const it = std::find_if(names.begin(), names.end(), [&name](KeyNames::value_type const & entry) {
+    return entry.first == name;
+  });
+  if (it == names.end())
+    return false;
+
+  key = it->second;
+  return true;
+}
+
+bool parse_layout(std::string const & spec, KeyboardLayout & layout)
+{
+  std::istringstream in {spec};
+  std::string part {};
+  if (!std::getline(in, part, ','))
+    return false;
+
+  KeyboardLayout parsed {};
+  if (part == KeyboardLayout::XBOX.m_name)
+    parsed = KeyboardLayout::XBOX;
+  else if (part == KeyboardLayout::SNES.m_name)
+    parsed = KeyboardLayout::SNES;
+  else
+    return false;
+
+  while (std::getline(in, part, ','))
+  {
+    auto const separator = part.find('=');
+    if (separator == std::string::npos)
+      return false;
+
+    Action action {};
+    sf::Keyboard::Key key {};
+    if (!from_string(part.substr(0, separator), action) || !from_string(part.substr(separator + 1), key))
+      return false;
+    parsed.*BINDINGS[static_cast<std::size_t>(action)].m_key = key;
+  }
+
+  layout = parsed;
+  return true;
+}
+
+ActionMap::ActionMap(KeyboardLayout const & layout)
+    : m_actions {}
+{
+  m_actions.fill(Action::None);
+  for (auto const & binding : BINDINGS)
+  {
+    auto const index = static_cast<std::size_t>(layout.*binding.m_key);
+    if (index < m_actions.size())
+      m_actions[index] = binding.m_action;
+  }
+}
+
+std::size_t const ActionQueue::CAPACITY;
+
+ActionQueue::ActionQueue()
+    : m_events {}
+    , m_head {0}
+    , m_headPadding {}
+    , m_tail {0}
+    , m_tailPadding {}
+    , m_dropped {0}
+{
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "the capacity has to be a power of two");
+}
+
+bool ActionQueue::push(ActionEvent const & event)
+{
+  auto const tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+  {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  m_events[tail % CAPACITY] = event;
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+bool ActionQueue::pop(ActionEvent & event)
+{
+  auto const head = m_head.load(std::memory_order_relaxed);
+  if (head == m_tail.load(std::memory_order_acquire))
+    return false;
+
+  event = m_events[head % CAPACITY];
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+bool ActionQueue::is_empty() const
+{
+  return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+}
+
+std::uint64_t ActionQueue::dropped() const
+{
+  return m_dropped.load(std::memory_order_relaxed);
+}
+
+InputActions::InputActions(KeyboardLayout const & layout)
+    : m_map {layout}
+    , m_queue {}
+    , m_held {0}
+    , m_oldest {0}
+    , m_latency {}
+{
+}
+
+void InputActions::set_layout(KeyboardLayout const & layout)
+{
+  m_map = ActionMap {layout};
+}
+
+bool InputActions::translate(sf::Event const & event)
+{
+  if (event.type != sf::Event::KeyPressed && event.type != sf::Event::KeyReleased)
+    return false;
+
+  auto const action = m_map[event.key.code];
+  if (action == Action::None)
+    return false;
+
+  return m_queue.push(ActionEvent {now(), action, event.type == sf::Event::KeyPressed});
+}
+
+bool InputActions::has_pending() const
+{
+  return !m_queue.is_empty();
+}
+
+ActionFrame InputActions::collect()
+{
+  ActionFrame frame {};
+  ActionEvent event {};
+  while (m_queue.pop(event))
+  {
+    auto const bit = action_bit(event.m_action);
+    if (event.m_pressed)
+    {
+      frame.m_pressed |= bit;
+      m_held |= bit;
+    }
+    else
+    {
+      frame.m_released |= bit;
+      m_held &= static_cast<ActionMask>(~bit);
+    }
+
+    // the queue is in order, so the first action is the oldest
+    if (m_oldest == 0)
+      m_oldest = event.m_timestamp;
+  }
+
+  frame.m_held = m_held;
+  return frame;
+}
+
+void InputActions::presented()
+{
+  if (m_oldest == 0)
+    return;
+
+  m_latency.record(static_cast<std::uint64_t>(now() - m_oldest));
+  m_oldest = 0;
+}
+
+LatencyHistogram const & InputActions::latency() const
+{
+  return m_latency;
+}
+
+std::uint64_t InputActions::dropped() const
+{
+  return m_queue.dropped();
+}
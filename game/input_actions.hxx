@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_INPUT_ACTIONS_HXX
+#define OVENBRICK_INPUT_ACTIONS_HXX
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include <SFML/Window/Keyboard.hpp>
+
+#include "keyboard_layout.hxx"
+#include "profiler.hxx"
+
+namespace sf {
+  class Event;
+}
+
+/**
+ * @brief What the buttons of the handheld mean to the game, independent of the keyboard layout.
+ */
+enum class Action : std::uint8_t
+{
+  Up,
+  Down,
+  Left,
+  Right,
+  A,
+  B,
+  X,
+  Y,
+  Menu,
+  Start,
+  Select,
+  None, ///< Keys without an action.
+};
+
+constexpr unsigned ACTION_COUNT = 11;
+
+using ActionMask = std::uint16_t;
+
+/**
+ * @return The bit of the action in an action mask.
+ */
+constexpr ActionMask action_bit(Action action)
+{
+  return static_cast<ActionMask>(1u << static_cast<unsigned>(action));
+}
+
+/**
+ * @return The name of the action as used in layout specifications.
+ */
+char const * to_string(Action action);
+
+/**
+ * @brief Look up an action by its name.
+ * @return false, if there is no action of that name.
+ */
+bool from_string(std::string const & name, Action & action);
+
+/**
+ * @brief Look up a key by its SFML name (e.g. "Enter", "Num1", "F5").
+ * @return false, if there is no key of that name.
+ */
+bool from_string(std::string const & name, sf::Keyboard::Key & key);
+
+/**
+ * @brief Build a keyboard layout from a specification.
+ * @param spec The name of a predefined layout, optionally followed by overrides,
+ *             e.g. "snes,a=Space,menu=Backspace".
+ * @param layout Receives the layout, left alone if the specification is invalid.
+ * @return false, if the specification is invalid.
+ */
+bool parse_layout(std::string const & spec, KeyboardLayout & layout);
+
+/**
+ * @brief A keyboard layout compiled into a flat key-to-action table.
+ */
+class ActionMap final
+{
+public:
+  explicit ActionMap(KeyboardLayout const & layout);
+
+  /**
+   * @return The action of the key, Action::None if it has none.
+   */
+  inline Action operator[](sf::Keyboard::Key const key) const
+  {
+    auto const index = static_cast<std::size_t>(key);
+    return (index < m_actions.size()) ? m_actions[index] : Action::None;
+  }
+
+private:
+  std::array<Action, sf::Keyboard::KeyCount> m_actions;
+};
+
+/**
+ * @brief A key press or release turned into an action.
+ */
+struct ActionEvent final
+{
+  std::int64_t m_timestamp; ///< Nanoseconds on the steady clock, when the event was translated.
+  Action m_action;
+  bool m_pressed;
+};
+
+/**
+ * @brief Fixed-size lock-free ring buffer of actions, for a single producer and a single consumer.
+ */
+class ActionQueue final : private sf::NonCopyable
+{
+public:
+  static constexpr std::size_t CAPACITY = 256;
+
+  ActionQueue();
+
+  /**
+   * @brief Add an action, only ever called by the producer.
+   * @return false, if the queue was full and the action was dropped.
+   */
+  bool push(ActionEvent const & event);
+
+  /**
+   * @brief Take the oldest action, only ever called by the consumer.
+   * @return false, if the queue was empty.
+   */
+  bool pop(ActionEvent & event);
+
+  /**
+   * @return Whether there are actions to pop, exact for the consumer.
+   */
+  bool is_empty() const;
+
+  /**
+   * @return The number of actions dropped because the queue was full.
+   */
+  std::uint64_t dropped() const;
+
+private:
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  std::array<ActionEvent, CAPACITY> m_events;
+  std::atomic<std::size_t> m_head; ///< Next to pop, written by the consumer.
+  char m_headPadding[CACHE_LINE - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> m_tail; ///< Next to push, written by the producer.
+  char m_tailPadding[CACHE_LINE - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::uint64_t> m_dropped;
+};
+
+/**
+ * @brief The actions of one frame, handed to the current game state at once.
+ * @remarks Presses of the same action within one frame (e.g. key repeats) collapse into one bit.
+ */
+struct ActionFrame final
+{
+  ActionMask m_pressed = 0; ///< Triggered since the previous frame.
+  ActionMask m_released = 0; ///< Let go since the previous frame.
+  ActionMask m_held = 0; ///< Down at the end of the frame.
+
+  inline bool pressed(Action const action) const
+  {
+    return (m_pressed & action_bit(action)) != 0;
+  }
+
+  inline bool released(Action const action) const
+  {
+    return (m_released & action_bit(action)) != 0;
+  }
+
+  inline bool held(Action const action) const
+  {
+    return (m_held & action_bit(action)) != 0;
+  }
+
+  inline bool is_empty() const
+  {
+    return (m_pressed | m_released) == 0;
+  }
+};
+
+/**
+ * @brief Turns key events into actions and batches them per frame.
+ *
+ * Every action is timestamped when its event is translated, so the time until the frame
+ * showing its effect was presented can be measured.
+ */
+class InputActions final : private sf::NonCopyable
+{
+public:
+  explicit InputActions(KeyboardLayout const & layout);
+
+  /**
+   * @brief Compile a different layout, actions already queued are kept.
+   */
+  void set_layout(KeyboardLayout const & layout);
+
+  /**
+   * @brief Translate an event.
+   * @return false, if the event is not a key event or the key has no action.
+   */
+  bool translate(sf::Event const & event);
+
+  /**
+   * @return Whether there are translated actions which were not collected yet.
+   */
+  bool has_pending() const;
+
+  /**
+   * @brief Take all translated actions.
+   * @return The actions since the previous call.
+   */
+  ActionFrame collect();
+
+  /**
+   * @brief Measure the latency of the collected actions, call when their frame was presented.
+   */
+  void presented();
+
+  /**
+   * @return Nanoseconds from translating the oldest action of a frame until the frame was presented.
+   */
+  LatencyHistogram const & latency() const;
+
+  /**
+   * @return The number of actions dropped because more than ActionQueue::CAPACITY piled up.
+   */
+  std::uint64_t dropped() const;
+
+private:
+  ActionMap m_map;
+  ActionQueue m_queue;
+  ActionMask m_held;
+  std::int64_t m_oldest; ///< Timestamp of the oldest action collected since the last present, 0 if none.
+  LatencyHistogram m_latency;
+};
+
+#endif // OVENBRICK_INPUT_ACTIONS_HXX
@@ -0,0 +1,567 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "game_state.hxx"
+#include "input_trace.hxx"
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  constexpr unsigned MAX_VARINT_BYTES = 10;
+  constexpr std::uint64_t MAX_LAYOUT_LENGTH = 1024;
+
+  enum Modifier : std::uint8_t
+  {
+    ALT = 1u << 0u,
+    CONTROL = 1u << 1u,
+    SHIFT = 1u << 2u,
+    SYSTEM = 1u << 3u,
+  };
+
+  [[noreturn]] void malformed(std::string const & what)
+  {
+    throw std::runtime_error {"Malformed input trace: " + what}; // NOLINT(cert-err60-cpp)
+  }
+
+  /**
+   * @brief Thrown when the trace ends in the middle of a record.
+   */
+  struct Truncated final
+  {
+  };
+
+  class Writer final
+  {
+    std::ostream & m_out;
+
+  public:
+    explicit Writer(std::ostream & out)
+        : m_out {out}
+    {
+    }
+
+    void byte(std::uint8_t const value)
+    {
+      m_out.put(static_cast<char>(value));
+    }
+
+    void unsigned_varint(std::uint64_t value)
+    {
+      while (value >= 0x80u)
+      {
+        byte(static_cast<std::uint8_t>(value | 0x80u));
+        value >>= 7u;
+      }
+      byte(static_cast<std::uint8_t>(value));
+    }
+
+    void signed_varint(std::int64_t const value)
+    {
+      // zigzag, small negative numbers stay short
+      unsigned_varint((static_cast<std::uint64_t>(value) << 1u) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    void real(float const value)
+    {
+      std::uint32_t bits {};
+      std::memcpy(&bits, &value, sizeof(bits));
+      for (unsigned n = 0; n < 4; ++n)
+        byte(static_cast<std::uint8_t>(bits >> (8u * n)));
+    }
+  };
+
+  class Reader final
+  {
+    std::istream & m_in;
+
+  public:
+    explicit Reader(std::istream & in)
+        : m_in {in}
+    {
+    }
+
+    std::uint8_t byte()
+    {
+      auto const value = m_in.get();
+      if (value == std::istream::traits_type::eof())
+        throw Truncated {};
+      return static_cast<std::uint8_t>(value);
+    }
+
+    std::uint64_t unsigned_varint()
+    {
+      std::uint64_t value = 0;
+      for (unsigned n = 0; n < MAX_VARINT_BYTES; ++n)
+      {
+        auto const next = byte();
+        value |= std::uint64_t {next & 0x7fu} << (7u * n);
+        if (!(next & 0x80u))
+          return value;
+      }
+      malformed("overlong number");
+    }
+
+    std::int64_t signed_varint()
+    {
+      auto const value = unsigned_varint();
+      return static_cast<std::int64_t>(value >> 1u) ^ -static_cast<std::int64_t>(value & 1u);
+    }
+
+    float real()
+    {
+      std::uint32_t bits = 0;
+      for (unsigned n = 0; n < 4; ++n)
+        bits |= std::uint32_t {byte()} << (8u * n);
+      float value {};
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+  };
+
+  void write_event(Writer & out, sf::Event const & event)
+  {
+    out.unsigned_varint(event.type);
+    switch (event.type)
+    {
+      case sf::Event::Resized:
+        out.unsigned_varint(event.size.width);
+        out.unsigned_varint(event.size.height);
+        break;
+      case sf::Event::TextEntered:
+        out.unsigned_varint(event.text.unicode);
+        break;
+      case sf::Event::KeyPressed:
+      case sf::Event::KeyReleased:
+        out.signed_varint(event.key.code);
+        out.byte(static_cast<std::uint8_t>((event.key.alt ? ALT : 0u) | (event.key.control ? CONTROL : 0u)
+                                           | (event.key.shift ? SHIFT : 0u) | (event.key.system ? SYSTEM : 0u)));
+        break;
+      case sf::Event::MouseWheelMoved:
+        out.signed_varint(event.mouseWheel.delta);
+        out.signed_varint(event.mouseWheel.x);
+        out.signed_varint(event.mouseWheel.y);
+        break;
+      case sf::Event::MouseWheelScrolled:
+        out.unsigned_varint(event.mouseWheelScroll.wheel);
+        out.real(event.mouseWheelScroll.delta);
+        out.signed_varint(event.mouseWheelScroll.x);
+        out.signed_varint(event.mouseWheelScroll.y);
+        break;
+      case sf::Event::MouseButtonPressed:
+      case sf::Event::MouseButtonReleased:
+        out.unsigned_varint(event.mouseButton.button);
+        out.signed_varint(event.mouseButton.x);
+        out.signed_varint(event.mouseButton.y);
+        break;
+      case sf::Event::MouseMoved:
+        out.signed_varint(event.mouseMove.x);
+        out.signed_varint(event.mouseMove.y);
+        break;
+      case sf::Event::JoystickButtonPressed:
+      case sf::Event::JoystickButtonReleased:
+        out.unsigned_varint(event.joystickButton.joystickId);
+        out.unsigned_varint(event.joystickButton.button);
+        break;
+      case sf::Event::JoystickMoved:
+        out.unsigned_varint(event.joystickMove.joystickId);
+        out.unsigned_varint(event.joystickMove.axis);
+        out.real(event.joystickMove.position);
+        break;
+      case sf::Event::JoystickConnected:
+      case sf::Event::JoystickDisconnected:
+        out.unsigned_varint(event.joystickConnect.joystickId);
+        break;
+      case sf::Event::TouchBegan:
+      case sf::Event::TouchMoved:
+      case sf::Event::TouchEnded:
+        out.unsigned_varint(event.touch.finger);
+        out.signed_varint(event.touch.x);
+        out.signed_varint(event.touch.y);
+        break;
+      case sf::Event::SensorChanged:
+        out.unsigned_varint(event.sensor.type);
+        out.real(event.sensor.x);
+        out.real(event.sensor.y);
+        out.real(event.sensor.z);
+        break;
+      default:
+        // no parameters
+        break;
+    }
+  }
+
+  sf::Event read_event(Reader & in)
+  {
+    auto const type = in.unsigned_varint();
+    if (type >= sf::Event::Count)
+      malformed("unknown event type " + std::to_string(type));
+
+    sf::Event event {};
+    event.type = static_cast<sf::Event::EventType>(type);
+    switch (event.type)
+    {
+      case sf::Event::Resized:
+        event.size.width = static_cast<unsigned>(in.unsigned_varint());
+        event.size.height = static_cast<unsigned>(in.unsigned_varint());
+        break;
+      case sf::Event::TextEntered:
+        event.text.unicode = static_cast<sf::Uint32>(in.unsigned_varint());
+        break;
+      case sf::Event::KeyPressed:
+      case sf::Event::KeyReleased:
+      {
+        event.key.code = static_cast<sf::Keyboard::Key>(in.signed_varint());
+        auto const modifiers = in.byte();
+        event.key.alt = (modifiers & ALT) != 0;
+        event.key.control = (modifiers & CONTROL) != 0;
+        event.key.shift = (modifiers & SHIFT) != 0;
+        event.key.system = (modifiers & SYSTEM) != 0;
+        break;
+      }
+      case sf::Event::MouseWheelMoved:
+        event.mouseWheel.delta = static_cast<int>(in.signed_varint());
+        event.mouseWheel.x = static_cast<int>(in.signed_varint());
+        event.mouseWheel.y = static_cast<int>(in.signed_varint());
+        break;
+      case sf::Event::MouseWheelScrolled:
+        event.mouseWheelScroll.wheel = static_cast<sf::Mouse::Wheel>(in.unsigned_varint());
+        event.mouseWheelScroll.delta = in.real();
+        event.mouseWheelScroll.x = static_cast<int>(in.signed_varint());
+        event.mouseWheelScroll.y = static_cast<int>(in.signed_varint());
+        break;
+      case sf::Event::MouseButtonPressed:
+      case sf::Event::MouseButtonReleased:
+        event.mouseButton.button = static_cast<sf::Mouse::Button>(in.unsigned_varint());
+        event.mouseButton.x = static_cast<int>(in.signed_varint());
+        event.mouseButton.y = static_cast<int>(in.signed_varint());
+        break;
+      case sf::Event::MouseMoved:
+        event.mouseMove.x = static_cast<int>(in.signed_varint());
+        event.mouseMove.y = static_cast<int>(in.signed_varint());
+        break;
+      case sf::Event::JoystickButtonPressed:
+      case sf::Event::JoystickButtonReleased:
+        event.joystickButton.joystickId = static_cast<unsigned>(in.unsigned_varint());
+        event.joystickButton.button = static_cast<unsigned>(in.unsigned_varint());
+        break;
+      case sf::Event::JoystickMoved:
+        event.joystickMove.joystickId = static_cast<unsigned>(in.unsigned_varint());
+        event.joystickMove.axis = static_cast<sf::Joystick::Axis>(in.unsigned_varint());
+        event.joystickMove.position = in.real();
+        break;
+      case sf::Event::JoystickConnected:
+      case sf::Event::JoystickDisconnected:
+        event.joystickConnect.joystickId = static_cast<unsigned>(in.unsigned_varint());
+        break;
+      case sf::Event::TouchBegan:
+      case sf::Event::TouchMoved:
+      case sf::Event::TouchEnded:
+        event.touch.finger = static_cast<unsigned>(in.unsigned_varint());
+        event.touch.x = static_cast<int>(in.signed_varint());
+        event.touch.y = static_cast<int>(in.signed_varint());
+        break;
+      case sf::Event::SensorChanged:
+        event.sensor.type = static_cast<sf::Sensor::Type>(in.unsigned_varint());
+        event.sensor.x = in.real();
+        event.sensor.y = in.real();
+        event.sensor.z = in.real();
+        break;
+      default:
+        break;
+    }
+    return event;
+  }
+}
+
+char const InputRecorder::MAGIC[4] = {'O', 'B', 'I', 'T'};
+std::uint32_t const InputRecorder::VERSION;
+
+InputRecorder::InputRecorder(std::ostream & out, TraceSession const & session)
+    : m_out {out}
+    , m_pendingElapsed {}
+    , m_pendingCount {0}
+{
+  m_out.write(MAGIC, sizeof(MAGIC));
+  Writer writer {m_out};
+  writer.unsigned_varint(VERSION);
+  writer.unsigned_varint(session.m_seed);
+  writer.unsigned_varint(session.m_computerThreads);
+  writer.unsigned_varint(session.m_computerPlayouts);
+  writer.unsigned_varint(static_cast<std::uint64_t>(session.m_computerBudget.count()));
+  writer.unsigned_varint(session.m_keyLayout.size());
+  m_out.write(session.m_keyLayout.data(), static_cast<std::streamsize>(session.m_keyLayout.size()));
+}
+
+InputRecorder::~InputRecorder()
+{
+  flush();
+}
+
+void InputRecorder::event(sf::Event const & event)
+{
+  flush_updates();
+  Writer writer {m_out};
+  writer.byte(static_cast<std::uint8_t>(TraceRecord::Kind::Event));
+  write_event(writer, event);
+}
+
+void InputRecorder::update(sf::Time const & elapsed)
+{
+  if (m_pendingCount > 0 && elapsed == m_pendingElapsed)
+  {
+    ++m_pendingCount;
+    return;
+  }
+
+  flush_updates();
+  m_pendingElapsed = elapsed;
+  m_pendingCount = 1;
+}
+
+void InputRecorder::render(float const alpha)
+{
+  flush_updates();
+  Writer writer {m_out};
+  writer.byte(static_cast<std::uint8_t>(TraceRecord::Kind::Render));
+  writer.real(alpha);
+}
+
+void InputRecorder::commit(GameStateManager::Transition const transition)
+{
+  flush_updates();
+  Writer writer {m_out};
+  writer.byte(static_cast<std::uint8_t>(TraceRecord::Kind::Commit));
+  writer.byte(static_cast<std::uint8_t>(transition));
+}
+
+void InputRecorder::collect()
+{
+  flush_updates();
+  Writer writer {m_out};
+  writer.byte(static_cast<std::uint8_t>(TraceRecord::Kind::Collect));
+}
+
+void InputRecorder::checksum(std::uint64_t const checksum)
+{
+  flush_updates();
+  Writer writer {m_out};
+  writer.byte(static_cast<std::uint8_t>(TraceRecord::Kind::Checksum));
+  writer.unsigned_varint(checksum);
+}
+
+void InputRecorder::flush()
+{
+  flush_updates();
+  m_out.flush();
+}
+
+void InputRecorder::flush_updates()
+{
+  if (m_pendingCount == 0)
+    return;
+
+  Writer writer {m_out};
+  writer.byte(static_cast<std::uint8_t>(TraceRecord::Kind::Update));
+  writer.unsigned_varint(m_pendingCount);
+  writer.signed_varint(m_pendingElapsed.asMicroseconds());
+  m_pendingCount = 0;
+}
+
+InputTrace::InputTrace(std::istream & in)
+    : m_in {in}
+    , m_session {}
+    , m_truncated {false}
+{
+  char magic[sizeof(InputRecorder::MAGIC)] = {};
+  if (!m_in.read(magic, sizeof(magic)) || !std::equal(std::begin(magic), std::end(magic), InputRecorder::MAGIC))
+    malformed("bad magic");
+
+  Reader reader {m_in};
+  try
+  {
+    auto const version = reader.unsigned_varint();
+    if (version != InputRecorder::VERSION)
+      malformed("unsupported version " + std::to_string(version));
+
+    m_session.m_seed = reader.unsigned_varint();
+    m_session.m_computerThreads = static_cast<unsigned>(reader.unsigned_varint());
+    m_session.m_computerPlayouts = reader.unsigned_varint();
+    m_session.m_computerBudget = std::chrono::milliseconds {reader.unsigned_varint()};
+    auto const layoutLength = reader.unsigned_varint();
+    if (layoutLength > MAX_LAYOUT_LENGTH)
+      malformed("overlong key layout");
+    m_session.m_keyLayout.resize(static_cast<std::size_t>(layoutLength));
+    for (auto & c : m_session.m_keyLayout)
+      c = static_cast<char>(reader.byte());
+  }
+  catch (Truncated const &)
+  {
+    malformed("truncated header");
+  }
+}
+
+TraceSession const & InputTrace::session() const
+{
+  return m_session;
+}
+
+bool InputTrace::next(TraceRecord & record)
+{
+  if (m_truncated || m_in.peek() == std::istream::traits_type::eof())
+    return false;
+
+  Reader reader {m_in};
+  try
+  {
+    record.m_kind = static_cast<TraceRecord::Kind>(reader.byte());
+    switch (record.m_kind)
+    {
+      case TraceRecord::Kind::Event:
+        record.m_event = read_event(reader);
+        return true;
+      case TraceRecord::Kind::Update:
+        record.m_count = static_cast<std::uint32_t>(reader.unsigned_varint());
+        record.m_elapsed = sf::microseconds(reader.signed_varint());
+        return true;
+      case TraceRecord::Kind::Render:
+        record.m_alpha = reader.real();
+        return true;
+      case TraceRecord::Kind::Commit:
+      {
+        auto const transition = reader.byte();
+        if (transition > static_cast<std::uint8_t>(GameStateManager::Transition::Replace))
+          malformed("unknown transition " + std::to_string(transition));
+        record.m_transition = static_cast<GameStateManager::Transition>(transition);
+        return true;
+      }
+      case TraceRecord::Kind::Checksum:
+        record.m_checksum = reader.unsigned_varint();
+        return true;
+      case TraceRecord::Kind::Collect:
+        return true;
+    }
+  }
+  catch (Truncated const &)
+  {
+    m_truncated = true;
+    return false;
+  }
+
+  malformed("unknown record " + std::to_string(static_cast<unsigned>(record.m_kind)));
+}
+
+bool InputTrace::is_truncated() const
+{
+  return m_truncated;
+}
+
+InputReplay::InputReplay(InputTrace & trace, GameStateManager & gsm)
+    : m_trace {trace}
+    , m_gsm {gsm}
+    , m_statistics {}
+    , m_frameTimes {}
+{
+}
+
+void InputReplay::run(StateFactory const & nextState, Callback const & present)
+{
+  auto const start = clock::now();
+  auto frameStart = start;
+
+  // a collect record belongs to the last update before it, so the trace is read one record ahead
+  TraceRecord record {};
+  TraceRecord next {};
+  auto hasNext = m_trace.next(next);
+  m_gsm.set_replay(GameStateManager::Replay::Wait);
+  while (hasNext)
+  {
+    record = next;
+    hasNext = m_trace.next(next);
+    switch (record.m_kind)
+    {
+      case TraceRecord::Kind::Event:
+        m_gsm.handle_event(record.m_event);
+        ++m_statistics.m_events;
+        break;
+
+      case TraceRecord::Kind::Update:
+        for (std::uint32_t n = 0; n < record.m_count; ++n)
+        {
+          if (n + 1 == record.m_count && hasNext && next.m_kind == TraceRecord::Kind::Collect)
+            m_gsm.set_replay(GameStateManager::Replay::Collect);
+          m_gsm.update(record.m_elapsed);
+          m_gsm.set_replay(GameStateManager::Replay::Wait);
+        }
+        m_statistics.m_ticks += record.m_count;
+        m_statistics.m_simulated += record.m_elapsed * static_cast<sf::Int64>(record.m_count);
+        break;
+
+      case TraceRecord::Kind::Render:
+      {
+        m_gsm.render(record.m_alpha);
+        present();
+        auto const now = clock::now();
+        m_frameTimes.record(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - frameStart).count()));
+        frameStart = now;
+        ++m_statistics.m_frames;
+        break;
+      }
+
+      case TraceRecord::Kind::Commit:
+      {
+        auto state = nextState();
+        if (!state)
+          throw std::runtime_error {"The trace commits more states than there are"}; // NOLINT(cert-err60-cpp)
+        if (record.m_transition == GameStateManager::Transition::Replace && !m_gsm.is_empty())
+          m_gsm.pop_state();
+        m_gsm.push_state(std::move(state));
+        ++m_statistics.m_commits;
+        break;
+      }
+
+      case TraceRecord::Kind::Checksum:
+        m_statistics.m_hasChecksum = true;
+        m_statistics.m_checksum = record.m_checksum;
+        break;
+
+      case TraceRecord::Kind::Collect:
+        ++m_statistics.m_collects;
+        break;
+    }
+  }
+  m_gsm.set_replay(GameStateManager::Replay::Off);
+
+  m_statistics.m_elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+}
+
+ReplayStatistics const & InputReplay::statistics() const
+{
+  return m_statistics;
+}
+
+LatencyHistogram const & InputReplay::frame_times() const
+{
+  return m_frameTimes;
+}
@@ -0,0 +1,215 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_INPUT_TRACE_HXX
+#define OVENBRICK_INPUT_TRACE_HXX
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+
+#include <SFML/Window/Event.hpp>
+
+#include "game_state_manager.hxx"
+#include "profiler.hxx"
+
+struct GameState;
+
+/**
+ * @brief How the recorded session was started, a replay has to start the same way to reproduce it.
+ */
+struct TraceSession final
+{
+  std::uint64_t m_seed = 0; ///< Seed of the decks and the computer.
+  unsigned m_computerThreads = 0;
+  std::uint64_t m_computerPlayouts = 0; ///< Per thread and move, 0 means the moves depend on timing.
+  std::chrono::milliseconds m_computerBudget {0};
+  std::string m_keyLayout; ///< The keyboard layout as understood by parse_layout(), events are raw keys.
+};
+
+/**
+ * @brief A single entry of a trace.
+ */
+struct TraceRecord final
+{
+  enum class Kind : std::uint8_t
+  {
+    Event = 1, ///< m_event was handled.
+    Update, ///< m_count updates of m_elapsed each were run.
+    Render, ///< A frame was rendered with m_alpha and presented.
+    Commit, ///< A preloaded state was added with m_transition.
+    Checksum, ///< The session ended with m_checksum.
+    Collect, ///< A state collected the result of background work during the last update.
+  };
+
+  Kind m_kind;
+  sf::Event m_event;
+  sf::Time m_elapsed;
+  std::uint32_t m_count;
+  float m_alpha;
+  GameStateManager::Transition m_transition;
+  std::uint64_t m_checksum;
+};
+
+/**
+ * @brief Writes everything fed into a GameStateManager into a compact binary trace.
+ *
+ * Records are a tag byte followed by varints, runs of equal updates are stored once with a count,
+ * so a session at a steady frame rate costs about ten bytes per frame.
+ */
+class InputRecorder final : private sf::NonCopyable
+{
+public:
+  static char const MAGIC[4];
+  static constexpr std::uint32_t VERSION = 3; ///< 2: the key layout may carry overrides, 3: collect records.
+
+  /**
+   * @brief Start a trace by writing its header.
+   * @param out Where to write to, has to outlive the recorder.
+   * @param session How the session was started.
+   */
+  InputRecorder(std::ostream & out, TraceSession const & session);
+
+  /**
+   * @brief Writes pending updates.
+   */
+  ~InputRecorder();
+
+  void event(sf::Event const & event);
+
+  void update(sf::Time const & elapsed);
+
+  void render(float alpha);
+
+  void commit(GameStateManager::Transition transition);
+
+  /**
+   * @brief A state collects the result of background work during the update recorded last.
+   */
+  void collect();
+
+  /**
+   * @brief Finish the trace with a digest of the final game state, a replay has to end with the same.
+   */
+  void checksum(std::uint64_t checksum);
+
+  /**
+   * @brief Write pending updates and flush the stream.
+   */
+  void flush();
+
+private:
+  void flush_updates();
+
+  std::ostream & m_out;
+  sf::Time m_pendingElapsed;
+  std::uint32_t m_pendingCount;
+};
+
+/**
+ * @brief Reads a trace written by an InputRecorder.
+ */
+class InputTrace final : private sf::NonCopyable
+{
+public:
+  /**
+   * @brief Read the header.
+   * @param in Where to read from, has to outlive the trace.
+   * @throws std::runtime_error If the header is malformed.
+   */
+  explicit InputTrace(std::istream & in);
+
+  TraceSession const & session() const;
+
+  /**
+   * @brief Read the next record.
+   * @param record Receives the record.
+   * @return false at the end of the trace.
+   * @throws std::runtime_error If the record is malformed.
+   * @remarks A record cut off (e.g. by a crash while recording) ends the trace, see is_truncated().
+   */
+  bool next(TraceRecord & record);
+
+  /**
+   * @return true, if the trace ended in the middle of a record.
+   */
+  bool is_truncated() const;
+
+private:
+  std::istream & m_in;
+  TraceSession m_session;
+  bool m_truncated;
+};
+
+/**
+ * @brief Counters of a replay.
+ */
+struct ReplayStatistics final
+{
+  std::uint64_t m_frames = 0;
+  std::uint64_t m_events = 0;
+  std::uint64_t m_ticks = 0;
+  std::uint64_t m_commits = 0;
+  std::uint64_t m_collects = 0;
+  sf::Time m_simulated; ///< Game time covered by the trace.
+  std::chrono::nanoseconds m_elapsed {0}; ///< Wall time of the replay.
+  bool m_hasChecksum = false;
+  std::uint64_t m_checksum = 0; ///< Recorded at the end of the session.
+};
+
+/**
+ * @brief Feeds a trace into game states as fast as possible and measures every frame.
+ *
+ * States collect background work on the recorded ticks only, see GameStateManager::collect().
+ */
+class InputReplay final : private sf::NonCopyable
+{
+public:
+  using StateFactory = std::function<std::shared_ptr<GameState>()>;
+  using Callback = std::function<void()>;
+
+  InputReplay(InputTrace & trace, GameStateManager & gsm);
+
+  /**
+   * @brief Replay the whole trace.
+   * @param nextState Creates the next state the recorded session preloaded, it is loaded synchronously.
+   * @param present Presents a rendered frame.
+   * @throws std::runtime_error If the trace is malformed or commits more states than nextState creates.
+   */
+  void run(StateFactory const & nextState, Callback const & present);
+
+  ReplayStatistics const & statistics() const;
+
+  /**
+   * @return The wall time from the end of a frame to the end of the next, in nanoseconds.
+   */
+  LatencyHistogram const & frame_times() const;
+
+private:
+  InputTrace & m_trace;
+  GameStateManager & m_gsm;
+  ReplayStatistics m_statistics;
+  LatencyHistogram m_frameTimes;
+};
+
+#endif // OVENBRICK_INPUT_TRACE_HXX
@@ -0,0 +1,382 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <limits>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "job_system.hxx"
+
+namespace detail {
+  struct Job final
+  {
+    Job(JobSystem::Function function, JobSystem::Affinity const affinity)
+        : m_function {std::move(function)}
+        , m_affinity {affinity}
+        , m_blockers {1}
+        , m_done {false}
+        , m_error {}
+        , m_mutex {}
+        , m_finished {}
+        , m_dependents {}
+    {
+    }
+
+    JobSystem::Function m_function;
+    JobSystem::Affinity const m_affinity;
+    std::atomic<unsigned> m_blockers; ///< Jobs to wait for, plus one while the job is being scheduled.
+    std::atomic<bool> m_done;
+    std::exception_ptr m_error; ///< Written before m_done.
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+    std::vector<std::shared_ptr<Job>> m_dependents; ///< Guarded by m_mutex, until m_done.
+  };
+}
+
+namespace {
+  constexpr auto NO_WORKER = std::numeric_limits<std::size_t>::max();
+
+  /**
+   * @brief Threads waiting for a job check for other work this often.
+   */
+  constexpr std::chrono::microseconds WAIT_SLICE {500};
+
+  thread_local JobSystem const * tSystem = nullptr; ///< The pool the current thread works for, if any.
+  thread_local std::size_t tWorker = NO_WORKER;
+
+  std::shared_ptr<detail::Job> pop_front(std::mutex & mutex, std::deque<std::shared_ptr<detail::Job>> & jobs)
+  {
+    std::lock_guard<std::mutex> const lock {mutex};
+    if (jobs.empty())
+      return nullptr;
+    auto job = std::move(jobs.front());
+    jobs.pop_front();
+    return job;
+  }
+}
+
+JobHandle::JobHandle(std::shared_ptr<detail::Job> job)
+    : m_job {std::move(job)}
+{
+}
+
+bool JobHandle::is_done() const
+{
+  return m_job && m_job->m_done.load(std::memory_order_acquire);
+}
+
+JobHandle::operator bool() const
+{
+  return m_job != nullptr;
+}
+
+JobSystem::JobSystem(Settings const & settings)
+    : m_mainThread {std::this_thread::get_id()}
+    , m_workers {}
+    , m_sharedMutex {}
+    , m_shared {}
+    , m_mainMutex {}
+    , m_main {}
+    , m_mainPending {0}
+    , m_queued {0}
+    , m_sleeping {0}
+    , m_sleepMutex {}
+    , m_wakeup {}
+    , m_stop {false}
+    , m_pinned {settings.m_pinned}
+    , m_executed {0}
+    , m_stolen {0}
+    , m_helped {0}
+{
+  auto const threads = settings.m_threads
+      ? settings.m_threads
+      : std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+  // all deques exist before the first worker looks for something to steal
+  m_workers.reserve(threads);
+  for (unsigned n = 0; n < threads; ++n)
+    m_workers.emplace_back(new Worker {});
+  for (std::size_t n = 0; n < m_workers.size(); ++n)
+  {
+    auto & worker = *m_workers[n];
+    worker.m_thread = std::thread {&JobSystem::work, this, n};
+    if (m_pinned)
+      m_pinned = pin(worker, n);
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    std::lock_guard<std::mutex> const lock {m_sleepMutex};
+    m_stop = true;
+  }
+  m_wakeup.notify_all();
+  for (auto & worker : m_workers)
+    worker->m_thread.join();
+}
+
+JobHandle JobSystem::schedule(Function function, std::vector<JobHandle> const & after, Affinity const affinity)
+{
+  auto job = std::make_shared<detail::Job>(std::move(function), affinity);
+  if (affinity == Affinity::MainThread)
+    m_mainPending.fetch_add(1, std::memory_order_relaxed);
+
+  for (auto const & handle : after)
+  {
+    if (!handle)
+      continue;
+
+    auto & before = *handle.m_job;
+    std::lock_guard<std::mutex> const lock {before.m_mutex};
+    if (before.m_done.load(std::memory_order_relaxed))
+      continue;
+    job->m_blockers.fetch_add(1, std::memory_order_relaxed);
+    before.m_dependents.push_back(job);
+  }
+
+  if (job->m_blockers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    enqueue(job);
+  return JobHandle {std::move(job)};
+}
+
+void JobSystem::wait(JobHandle const & handle)
+{
+  if (!handle)
+    return;
+
+  auto & job = *handle.m_job;
+  while (!job.m_done.load(std::memory_order_acquire))
+  {
+    if (run_one())
+      continue;
+
+    std::unique_lock<std::mutex> lock {job.m_mutex};
+    job.m_finished.wait_for(lock, WAIT_SLICE, [&job] { return job.m_done.load(std::memory_order_relaxed); });
+  }
+
+  if (job.m_error)
+    std::rethrow_exception(job.m_error);
+}
+
+std::size_t JobSystem::run_main_thread_jobs()
+{
+  assert(std::this_thread::get_id() == m_mainThread);
+  if (m_mainPending.load(std::memory_order_relaxed) == 0)
+    return 0;
+
+  std::vector<std::shared_ptr<detail::Job>> ready {};
+  {
+    std::lock_guard<std::mutex> const lock {m_mainMutex};
+    ready.swap(m_main);
+  }
+  for (auto const & job : ready)
+    run(*job);
+  return ready.size();
+}
+
+bool JobSystem::has_main_thread_jobs() const
+{
+  return m_mainPending.load(std::memory_order_relaxed) != 0;
+}
+
+unsigned JobSystem::thread_count() const
+{
+  return static_cast<unsigned>(m_workers.size());
+}
+
+bool JobSystem::is_pinned() const
+{
+  return m_pinned;
+}
+
+JobSystem::Statistics JobSystem::statistics() const
+{
+  return Statistics {
+      m_executed.load(std::memory_order_relaxed),
+      m_stolen.load(std::memory_order_relaxed),
+      m_helped.load(std::memory_order_relaxed)
+  };
+}
+
+void JobSystem::work(std::size_t const index)
+{
+  tSystem = this;
+  tWorker = index;
+
+  for (;;)
+  {
+    auto stolen = false;
+    auto const job = take(index, stolen);
+    if (job)
+    {
+      run(*job);
+      m_executed.fetch_add(1, std::memory_order_relaxed);
+      if (stolen)
+        m_stolen.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock {m_sleepMutex};
+    if (m_stop && m_queued.load() == 0)
+      break;
+    m_sleeping.fetch_add(1);
+    m_wakeup.wait(lock, [this] { return m_stop || m_queued.load() != 0; });
+    m_sleeping.fetch_sub(1);
+  }
+
+  tSystem = nullptr;
+  tWorker = NO_WORKER;
+}
+
+void JobSystem::enqueue(std::shared_ptr<detail::Job> job)
+{
+  if (job->m_affinity == Affinity::MainThread)
+  {
+    std::lock_guard<std::mutex> const lock {m_mainMutex};
+    m_main.push_back(std::move(job));
+    return;
+  }
+
+  // counted first, so m_queued never drops below the jobs actually queued
+  m_queued.fetch_add(1);
+  if (tSystem == this)
+  {
+    auto & worker = *m_workers[tWorker];
+    std::lock_guard<std::mutex> const lock {worker.m_mutex};
+    worker.m_jobs.push_back(std::move(job));
+  }
+  else
+  {
+    std::lock_guard<std::mutex> const lock {m_sharedMutex};
+    m_shared.push_back(std::move(job));
+  }
+
+  if (m_sleeping.load() != 0)
+  {
+    std::lock_guard<std::mutex> const lock {m_sleepMutex};
+    m_wakeup.notify_one();
+  }
+}
+
+std::shared_ptr<detail::Job> JobSystem::take(std::size_t const index, bool & stolen)
+{
+  std::shared_ptr<detail::Job> job {};
+  if (index != NO_WORKER)
+  {
+    // newest first, its data is most likely still cached
+    auto & own = *m_workers[index];
+    std::lock_guard<std::mutex> const lock {own.m_mutex};
+    if (!own.m_jobs.empty())
+    {
+      job = std::move(own.m_jobs.back());
+      own.m_jobs.pop_back();
+    }
+  }
+
+  if (!job)
+    job = pop_front(m_sharedMutex, m_shared);
+
+  // oldest first, which tend to be the larger pieces of work
+  auto const count = m_workers.size();
+  auto const start = (index == NO_WORKER) ? 0 : index + 1;
+  for (std::size_t n = 0; !job && n < count; ++n)
+  {
+    auto const victim = (start + n) % count;
+    if (victim == index)
+      continue;
+    job = pop_front(m_workers[victim]->m_mutex, m_workers[victim]->m_jobs);
+    stolen = (job != nullptr);
+  }
+
+  if (job)
+    m_queued.fetch_sub(1);
+  return job;
+}
+
+bool JobSystem::run_one()
+{
+  std::shared_ptr<detail::Job> job {};
+  if (std::this_thread::get_id() == m_mainThread && m_mainPending.load(std::memory_order_relaxed) != 0)
+  {
+    std::lock_guard<std::mutex> const lock {m_mainMutex};
+    if (!m_main.empty())
+    {
+      job = std::move(m_main.front());
+      m_main.erase(m_main.begin());
+    }
+  }
+
+  auto stolen = false;
+  if (!job)
+    job = take((tSystem == this) ? tWorker : NO_WORKER, stolen);
+  if (!job)
+    return false;
+
+  run(*job);
+  m_helped.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void JobSystem::run(detail::Job & job)
+{
+  try
+  {
+    job.m_function();
+  }
+  catch (...)
+  {
+    job.m_error = std::current_exception();
+  }
+  job.m_function = nullptr; // release what the job captured right away
+
+  std::vector<std::shared_ptr<detail::Job>> dependents {};
+  {
+    std::lock_guard<std::mutex> const lock {job.m_mutex};
+    job.m_done.store(true, std::memory_order_release);
+    dependents.swap(job.m_dependents);
+  }
+  job.m_finished.notify_all();
+  if (job.m_affinity == Affinity::MainThread)
+    m_mainPending.fetch_sub(1, std::memory_order_relaxed);
+
+  for (auto & dependent : dependents)
+  {
+    if (dependent->m_blockers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      enqueue(std::move(dependent));
+  }
+}
+
+bool JobSystem::pin(Worker & worker, std::size_t const index)
+{
+#if defined(__linux__)
+  cpu_set_t cores;
+  CPU_ZERO(&cores);
+  CPU_SET((index + 1) % std::max(std::thread::hardware_concurrency(), 1u), &cores);
+  return pthread_setaffinity_np(worker.m_thread.native_handle(), sizeof(cores), &cores) == 0;
+#else
+  static_cast<void>(worker);
+  static_cast<void>(index);
+  return false;
+#endif
+}
@@ -0,0 +1,330 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_JOB_SYSTEM_HXX
+#define OVENBRICK_JOB_SYSTEM_HXX
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+class JobSystem;
+
+namespace detail {
+  struct Job;
+
+  /**
+   * @brief Where the result of an async() job is kept until JobFuture::get() takes it.
+   */
+  template <typename T>
+  struct JobResult final
+  {
+    std::unique_ptr<T> m_value;
+
+    template <typename Fn>
+    inline void run(Fn & fn)
+    {
+      m_value.reset(new T(fn()));
+    }
+
+    inline T take()
+    {
+      return std::move(*m_value);
+    }
+  };
+
+  template <>
+  struct JobResult<void> final
+  {
+    template <typename Fn>
+    inline void run(Fn & fn)
+    {
+      fn();
+    }
+
+    inline void take()
+    {
+    }
+  };
+}
+
+/**
+ * @brief Refers to a scheduled job, e.g. to let other jobs run after it.
+ */
+class JobHandle final
+{
+public:
+  JobHandle() = default;
+
+  /**
+   * @return true, if the job ran (or failed).
+   */
+  bool is_done() const;
+
+  /**
+   * @return false for default constructed handles.
+   */
+  explicit operator bool() const;
+
+private:
+  friend class JobSystem;
+
+  explicit JobHandle(std::shared_ptr<detail::Job> job);
+
+  std::shared_ptr<detail::Job> m_job;
+};
+
+/**
+ * @brief The result of a job, which get() waits for.
+ */
+template <typename T>
+class JobFuture final
+{
+public:
+  JobFuture() = default;
+
+  /**
+   * @return true, if get() would not wait.
+   */
+  inline bool is_ready() const
+  {
+    return m_handle.is_done();
+  }
+
+  /**
+   * @return The job, e.g. to let other jobs run after it.
+   */
+  inline JobHandle const & handle() const
+  {
+    return m_handle;
+  }
+
+  /**
+   * @brief Wait for the job (running other jobs meanwhile) and take its result.
+   * @return The result, get() must only be called once.
+   * @throws Whatever the job threw.
+   */
+  T get();
+
+private:
+  friend class JobSystem;
+
+  inline JobFuture(JobSystem & system, JobHandle handle, std::shared_ptr<detail::JobResult<T>> result)
+      : m_system {&system}, m_handle {std::move(handle)}, m_result {std::move(result)}
+  {
+  }
+
+  JobSystem * m_system = nullptr;
+  JobHandle m_handle;
+  std::shared_ptr<detail::JobResult<T>> m_result;
+};
+
+/**
+ * @brief Pool of worker threads which steal jobs from each other.
+ *
+ * Every worker has a deque of its own: jobs scheduled by a worker go to the back of its deque and are taken
+ * from there again (the data is still in its cache), idle workers steal from the front of other deques.
+ * Jobs scheduled by other threads go to a shared queue. Jobs may run after other jobs, which makes up
+ * a task graph, and may be bound to the main thread, where they run during run_main_thread_jobs().
+ * Waiting for a job runs other jobs meanwhile, so jobs may wait for jobs they scheduled themselves.
+ * Jobs still queued when the pool is destroyed run before the workers stop, jobs for the main thread are dropped.
+ */
+class JobSystem final : private sf::NonCopyable
+{
+public:
+  using Function = std::function<void()>;
+
+  enum class Affinity
+  {
+    Workers, ///< Any worker thread.
+    MainThread, ///< The thread which created the pool, during run_main_thread_jobs().
+  };
+
+  struct Settings final
+  {
+    unsigned m_threads = 0; ///< 0 uses one worker per core but the main thread's.
+    bool m_pinned = false; ///< Bind every worker to a core of its own, the first core is left to the main thread.
+  };
+
+  struct Statistics final
+  {
+    std::uint64_t m_executed; ///< Jobs run by the workers.
+    std::uint64_t m_stolen; ///< Of those, jobs taken from another worker's deque.
+    std::uint64_t m_helped; ///< Jobs run by threads waiting for another job.
+  };
+
+  /**
+   * @brief Start the workers, the calling thread becomes the main thread.
+   */
+  explicit JobSystem(Settings const & settings);
+
+  /**
+   * @brief Runs the jobs still queued and stops the workers.
+   */
+  ~JobSystem();
+
+  /**
+   * @brief Schedule a job.
+   * @param function What to run.
+   * @param after Jobs which have to be done before, invalid handles are ignored.
+   * @param affinity Where to run.
+   * @return The job.
+   */
+  JobHandle schedule(Function function, std::vector<JobHandle> const & after = {},
+                     Affinity affinity = Affinity::Workers);
+
+  /**
+   * @brief Schedule a job which returns a result.
+   * @param fn What to run, must be copyable.
+   * @param after Jobs which have to be done before.
+   * @param affinity Where to run.
+   * @return The result to be.
+   */
+  template <typename Fn>
+  auto async(Fn fn, std::vector<JobHandle> const & after = {}, Affinity const affinity = Affinity::Workers)
+      -> JobFuture<decltype(fn())>
+  {
+    using Result = decltype(fn());
+    auto result = std::make_shared<detail::JobResult<Result>>();
+    auto handle = schedule([result, fn]() mutable { result->run(fn); }, after, affinity);
+    return JobFuture<Result> {*this, std::move(handle), std::move(result)};
+  }
+
+  /**
+   * @brief Run fn(n) for all n in [0, count) in chunks across the workers and wait for all of them.
+   * @param count The number of indices.
+   * @param grain The number of indices per job, at least 1.
+   * @param fn What to run for every index, from several threads at once.
+   * @throws The first exception thrown by fn.
+   */
+  template <typename Fn>
+  void parallel_for(std::size_t const count, std::size_t const grain, Fn const & fn)
+  {
+    auto const chunk = (grain == 0) ? 1 : grain;
+    std::vector<JobHandle> jobs {};
+    jobs.reserve(count / chunk + 1);
+    for (std::size_t begin = 0; begin < count; begin += chunk)
+    {
+      auto const end = (count - begin < chunk) ? count : begin + chunk;
+      jobs.push_back(schedule([&fn, begin, end] {
+        for (auto n = begin; n < end; ++n)
+          fn(n);
+      }));
+    }
+
+    // fn has to outlive every chunk, so wait for all of them before throwing
+    std::exception_ptr error {};
+    for (auto const & job : jobs)
+    {
+      try
+      {
+        wait(job);
+      }
+      catch (...)
+      {
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  /**
+   * @brief Wait for a job, running other jobs meanwhile (including main thread jobs on the main thread).
+   * @throws Whatever the job threw.
+   */
+  void wait(JobHandle const & job);
+
+  /**
+   * @brief Run the main thread jobs which are ready, called once per frame.
+   * @return The number of jobs run.
+   * @remarks Jobs becoming ready meanwhile wait for the next call, so a chain of them cannot stall the frame.
+   */
+  std::size_t run_main_thread_jobs();
+
+  /**
+   * @return Whether main thread jobs were scheduled which did not run yet, the main loop should not idle then.
+   */
+  bool has_main_thread_jobs() const;
+
+  /**
+   * @return The number of worker threads.
+   */
+  unsigned thread_count() const;
+
+  /**
+   * @return Whether the workers were bound to cores.
+   */
+  bool is_pinned() const;
+
+  Statistics statistics() const;
+
+private:
+  struct Worker final
+  {
+    std::mutex m_mutex;
+    std::deque<std::shared_ptr<detail::Job>> m_jobs;
+    std::thread m_thread;
+  };
+
+  void work(std::size_t index);
+  void enqueue(std::shared_ptr<detail::Job> job);
+  std::shared_ptr<detail::Job> take(std::size_t index, bool & stolen);
+  bool run_one();
+  void run(detail::Job & job);
+  bool pin(Worker & worker, std::size_t index);
+
+  std::thread::id const m_mainThread;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::mutex m_sharedMutex;
+  std::deque<std::shared_ptr<detail::Job>> m_shared; ///< Jobs scheduled by threads other than the workers.
+  std::mutex m_mainMutex;
+  std::vector<std::shared_ptr<detail::Job>> m_main; ///< Main thread jobs which are ready.
+  std::atomic<std::size_t> m_mainPending; ///< Main thread jobs scheduled but not run yet.
+
+  std::atomic<std::size_t> m_queued; ///< Jobs in the worker deques and the shared queue.
+  std::atomic<unsigned> m_sleeping;
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeup;
+  bool m_stop; ///< Guarded by m_sleepMutex.
+  bool m_pinned;
+
+  std::atomic<std::uint64_t> m_executed;
+  std::atomic<std::uint64_t> m_stolen;
+  std::atomic<std::uint64_t> m_helped;
+};
+
+template <typename T>
+T JobFuture<T>::get()
+{
+  m_system->wait(m_handle);
+  return m_result->take();
+}
+
+#endif // OVENBRICK_JOB_SYSTEM_HXX
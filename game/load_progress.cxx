@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+
+#include "load_progress.hxx"
+
+LoadProgress::LoadProgress()
+    : m_progress {0.f}, m_cancelled {false}, m_status {Status::Loading}
+{
+}
+
+void LoadProgress::report(float const fraction)
+{
+  m_progress.store(std::min(std::max(fraction, 0.f), 1.f), std::memory_order_relaxed);
+}
+
+float LoadProgress::progress() const
+{
+  return m_progress.load(std::memory_order_relaxed);
+}
+
+void LoadProgress::cancel()
+{
+  m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool LoadProgress::is_cancelled() const
+{
+  return m_cancelled.load(std::memory_order_relaxed);
+}
+
+LoadProgress::Status LoadProgress::status() const
+{
+  return m_status.load(std::memory_order_acquire);
+}
+
+std::exception_ptr LoadProgress::error() const
+{
+  return (status() == Status::Failed) ? m_error : nullptr;
+}
+
+void LoadProgress::finish()
+{
+  if (is_cancelled())
+  {
+    m_status.store(Status::Cancelled, std::memory_order_release);
+    return;
+  }
+
+  report(1.f);
+  m_status.store(Status::Ready, std::memory_order_release);
+}
+
+void LoadProgress::fail(std::exception_ptr error)
+{
+  m_error = std::move(error);
+  m_status.store(Status::Failed, std::memory_order_release);
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_LOAD_PROGRESS_HXX
+#define OVENBRICK_LOAD_PROGRESS_HXX
+
+#include <atomic>
+#include <exception>
+
+#include <SFML/System/NonCopyable.hpp>
+
+/**
+ * @brief Shared between a state being preloaded in the background and whoever waits for it.
+ *
+ * The loading side reports progress and polls for cancellation,
+ * the main thread (e.g. a loading screen) reads the progress and may cancel.
+ */
+class LoadProgress final : private sf::NonCopyable
+{
+public:
+  enum class Status
+  {
+    Loading, ///< Still loading or waiting for the next frame boundary.
+    Ready, ///< The state was added to the GameStateManager.
+    Cancelled, ///< The state was discarded.
+    Failed, ///< load() threw, the state was discarded.
+  };
+
+  LoadProgress();
+
+  /**
+   * @brief Report how far loading got.
+   * @param fraction The finished part (0..1), values outside are clamped.
+   */
+  void report(float fraction);
+
+  /**
+   * @return The last reported progress (0..1).
+   */
+  float progress() const;
+
+  /**
+   * @brief Ask the loading side to stop, the state will not be added.
+   * @remarks Has no effect once the status is Ready.
+   */
+  void cancel();
+
+  /**
+   * @return Whether cancel() was called, loading code should check this regularly and bail out.
+   */
+  bool is_cancelled() const;
+
+  /**
+   * @return The current status.
+   */
+  Status status() const;
+
+  /**
+   * @return The exception which made loading fail, if the status is Failed.
+   * @remarks Only valid once the status is not Loading anymore.
+   */
+  std::exception_ptr error() const;
+
+  /**
+   * @brief Called by the GameStateManager at the frame boundary after load() returned.
+   * @remarks Sets the status to Ready, or Cancelled if cancel() was called meanwhile.
+   */
+  void finish();
+
+  /**
+   * @brief Called by the GameStateManager if load() threw.
+   * @param error The thrown exception.
+   */
+  void fail(std::exception_ptr error);
+
+private:
+  std::atomic<float> m_progress;
+  std::atomic<bool> m_cancelled;
+  std::atomic<Status> m_status;
+  std::exception_ptr m_error; ///< Written before m_status is published.
+};
+
+#endif // OVENBRICK_LOAD_PROGRESS_HXX
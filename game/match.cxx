@@ -0,0 +1,671 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+#include "match.hxx"
+
+namespace {
+  enum class Feature : unsigned
+  {
+    Health,
+    Mana,
+    MaxMana,
+    Fatigue,
+    DeckTop,
+    Hand,
+    Board,
+    Active,
+    Turn,
+    Result,
+  };
+
+  constexpr unsigned GLOBAL = 2; ///< Player of the features not belonging to a side.
+
+  std::uint64_t mix(std::uint64_t x)
+  {
+    // splitmix64 finalizer, spreads every input bit over the whole key
+    x += 0x9e3779b97f4a7c15u;
+    x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9u;
+    x = (x ^ (x >> 27u)) * 0x94d049bb133111ebu;
+    return x ^ (x >> 31u);
+  }
+
+  /**
+   * @brief The Zobrist key of a feature, computed instead of looked up to keep the tables out of the cache.
+   */
+  std::uint64_t key(Feature const feature, unsigned const player, unsigned const slot, std::uint64_t const value)
+  {
+    return mix(mix(value) ^ (std::uint64_t {static_cast<unsigned>(feature)} << 56u
+                             | std::uint64_t {player} << 48u | std::uint64_t {slot} << 40u));
+  }
+
+  /**
+   * @brief Change a single valued feature and its part of the hash.
+   */
+  template <typename T>
+  void assign(std::uint64_t & hash, unsigned const player, Feature const feature, T & field, T const value)
+  {
+    hash ^= key(feature, player, 0, static_cast<std::uint64_t>(field)) ^ key(feature, player, 0, static_cast<std::uint64_t>(value));
+    field = value;
+  }
+
+  std::uint64_t pack(Minion const & minion)
+  {
+    return std::uint64_t {minion.m_card}
+        | std::uint64_t {static_cast<std::uint8_t>(minion.m_attack)} << 32u
+        | std::uint64_t {static_cast<std::uint8_t>(minion.m_health)} << 40u
+        | std::uint64_t {minion.m_flags} << 48u
+        | std::uint64_t {minion.m_attacksLeft} << 56u;
+  }
+
+  std::int8_t clamp_stat(unsigned const value)
+  {
+    return static_cast<std::int8_t>(std::min(value, 127u));
+  }
+
+  std::uint8_t flags_of(CardDatabase const & cards, CardIndex const card)
+  {
+    std::uint8_t flags = 0;
+    if (cards.has(card, Keyword::Taunt))
+      flags |= Minion::Taunt;
+    if (cards.has(card, Keyword::DivineShield))
+      flags |= Minion::DivineShield;
+    if (cards.has(card, Keyword::Stealth))
+      flags |= Minion::Stealth;
+    if (cards.has(card, Keyword::Lifesteal))
+      flags |= Minion::Lifesteal;
+    if (cards.has(card, Keyword::Poisonous))
+      flags |= Minion::Poisonous;
+    if (cards.has(card, Keyword::Windfury))
+      flags |= Minion::Windfury;
+    return flags;
+  }
+
+  std::uint8_t attacks_per_turn(Minion const & minion)
+  {
+    return (minion.m_flags & Minion::Windfury) ? 2 : 1;
+  }
+
+  bool is_targetable(Minion const & minion)
+  {
+    return !(minion.m_flags & Minion::Stealth);
+  }
+
+  bool is_guarding(Minion const & minion)
+  {
+    return (minion.m_flags & Minion::Taunt) && is_targetable(minion);
+  }
+
+  constexpr std::uint8_t FORMAT = 1; ///< Version of what Match::write() writes, read() rejects others.
+
+  /**
+   * @brief Writes every field on its own in little endian, so neither padding nor the byte order end up in a save.
+   */
+  class ImageWriter final
+  {
+    std::ostream & m_out;
+
+  public:
+    explicit ImageWriter(std::ostream & out)
+        : m_out {out}
+    {
+    }
+
+    template <typename T>
+    void put(T const value)
+    {
+      auto const bits = static_cast<typename std::make_unsigned<T>::type>(value);
+      for (unsigned n = 0; n < sizeof(T); ++n)
+        m_out.put(static_cast<char>(static_cast<std::uint8_t>(bits >> (8u * n))));
+    }
+  };
+
+  [[noreturn]] void malformed(std::string const & what)
+  {
+    throw std::runtime_error {"Malformed match: " + what}; // NOLINT(cert-err60-cpp)
+  }
+
+  class ImageReader final
+  {
+    unsigned char const * m_data;
+    unsigned char const * m_end;
+
+  public:
+    ImageReader(char const * const data, std::size_t const size)
+        : m_data {reinterpret_cast<unsigned char const *>(data)}, m_end {m_data + size}
+    {
+    }
+
+    template <typename T>
+    T get()
+    {
+      if (static_cast<std::size_t>(m_end - m_data) < sizeof(T))
+        malformed("truncated");
+      typename std::make_unsigned<T>::type bits = 0;
+      for (unsigned n = 0; n < sizeof(T); ++n)
+        bits |= static_cast<decltype(bits)>(static_cast<decltype(bits)>(*m_data++) << (8u * n));
+      return static_cast<T>(bits);
+    }
+
+    bool at_end() const
+    {
+      return m_data == m_end;
+    }
+  };
+}
+
+std::int8_t const Match::STARTING_HEALTH;
+std::uint8_t const Match::MAX_MANA;
+std::uint16_t const Match::MAX_TURNS;
+
+Match::Match(CardDatabase const & cards, Deck first, Deck second, std::uint64_t const seed)
+    : m_cards {&cards}
+    , m_decks {{first, second}}
+    , m_state {}
+{
+  std::mt19937_64 random {seed};
+  for (auto & deck : m_decks)
+    std::shuffle(deck.begin(), deck.end(), random);
+
+  for (auto & side : m_state.m_sides)
+    side.m_health = STARTING_HEALTH;
+  m_state.m_turn = 1;
+  m_state.m_active = 0;
+  m_state.m_result = Result::Running;
+  m_state.m_hash = compute_hash();
+
+  for (unsigned n = 0; n < 3; ++n)
+    draw(0);
+  for (unsigned n = 0; n < 4; ++n)
+    draw(1);
+  start_turn();
+}
+
+Match::Match(CardDatabase const & cards)
+    : m_cards {&cards}
+    , m_decks {}
+    , m_state {}
+{
+}
+
+void Match::write(std::ostream & out) const
+{
+  ImageWriter writer {out};
+  writer.put(FORMAT);
+  for (auto const & deck : m_decks)
+    for (auto const card : deck)
+      writer.put(m_cards->id(card));
+  for (auto const & side : m_state.m_sides)
+  {
+    writer.put(side.m_handSize);
+    writer.put(side.m_boardSize);
+    writer.put(side.m_deckTop);
+    writer.put(side.m_health);
+    writer.put(side.m_mana);
+    writer.put(side.m_maxMana);
+    writer.put(side.m_fatigue);
+    for (unsigned slot = 0; slot < side.m_handSize; ++slot)
+      writer.put(m_cards->id(side.m_hand[slot]));
+    for (unsigned slot = 0; slot < side.m_boardSize; ++slot)
+    {
+      auto const & minion = side.m_board[slot];
+      writer.put(m_cards->id(minion.m_card));
+      writer.put(minion.m_attack);
+      writer.put(minion.m_health);
+      writer.put(minion.m_flags);
+      writer.put(minion.m_attacksLeft);
+    }
+  }
+  writer.put(m_state.m_turn);
+  writer.put(m_state.m_active);
+  writer.put(static_cast<std::uint8_t>(m_state.m_result));
+}
+
+Match Match::read(CardDatabase const & cards, char const * const data, std::size_t const size)
+{
+  ImageReader reader {data, size};
+  auto const format = reader.get<std::uint8_t>();
+  if (format != FORMAT)
+    malformed("unsupported format " + std::to_string(format));
+
+  auto const card = [&cards, &reader] {
+    auto const id = reader.get<CardId>();
+    auto const index = cards.find(id);
+    if (index == CardDatabase::NONE)
+      malformed("unknown card " + std::to_string(id));
+    return index;
+  };
+
+  Match match {cards};
+  for (auto & deck : match.m_decks)
+    for (auto & slot : deck)
+      slot = card();
+
+  auto & state = match.m_state;
+  for (auto & side : state.m_sides)
+  {
+    side.m_handSize = reader.get<std::uint8_t>();
+    side.m_boardSize = reader.get<std::uint8_t>();
+    side.m_deckTop = reader.get<std::uint8_t>();
+    side.m_health = reader.get<std::int8_t>();
+    side.m_mana = reader.get<std::uint8_t>();
+    side.m_maxMana = reader.get<std::uint8_t>();
+    side.m_fatigue = reader.get<std::uint8_t>();
+    if (side.m_handSize > MAX_HAND || side.m_boardSize > MAX_BOARD || side.m_deckTop > DECK_SIZE)
+      malformed("bad side");
+
+    for (unsigned slot = 0; slot < side.m_handSize; ++slot)
+      side.m_hand[slot] = card();
+    for (unsigned slot = 0; slot < side.m_boardSize; ++slot)
+    {
+      auto & minion = side.m_board[slot];
+      minion.m_card = card();
+      minion.m_attack = reader.get<std::int8_t>();
+      minion.m_health = reader.get<std::int8_t>();
+      minion.m_flags = reader.get<std::uint8_t>();
+      minion.m_attacksLeft = reader.get<std::uint8_t>();
+    }
+  }
+
+  state.m_turn = reader.get<std::uint16_t>();
+  state.m_active = reader.get<std::uint8_t>();
+  auto const result = reader.get<std::uint8_t>();
+  if (state.m_active > 1 || result > static_cast<std::uint8_t>(Result::Draw))
+    malformed("bad turn");
+  state.m_result = static_cast<Result>(result);
+  if (!reader.at_end())
+    malformed("trailing data");
+
+  state.m_hash = match.compute_hash();
+  return match;
+}
+
+Deck Match::random_deck(CardDatabase const & cards, std::uint64_t const seed)
+{
+  std::vector<CardIndex> playable {};
+  for (auto const type : {CardType::Minion, CardType::Spell})
+  {
+    auto const ofType = cards.of_type(type);
+    playable.insert(playable.end(), ofType.begin(), ofType.end());
+  }
+  if (playable.empty())
+    throw std::invalid_argument {"No playable cards"}; // NOLINT(cert-err60-cpp)
+
+  std::mt19937_64 random {seed};
+  std::shuffle(playable.begin(), playable.end(), random);
+
+  Deck deck {};
+  for (std::size_t n = 0; n < DECK_SIZE; ++n)
+    deck[n] = playable[(n / 2) % playable.size()];
+  return deck;
+}
+
+void Match::legal_moves(MoveList & moves) const
+{
+  moves.clear();
+  if (is_over())
+    return;
+
+  auto const & own = m_state.m_sides[m_state.m_active];
+  auto const & enemy = m_state.m_sides[m_state.m_active ^ 1u];
+
+  moves.push_back(Move {Move::Kind::EndTurn, 0, 0});
+
+  for (std::uint8_t slot = 0; slot < own.m_handSize; ++slot)
+  {
+    auto const card = own.m_hand[slot];
+    if (m_cards->cost(card) > own.m_mana)
+      continue;
+
+    switch (m_cards->type(card))
+    {
+      case CardType::Minion:
+        if (own.m_boardSize < MAX_BOARD)
+          moves.push_back(Move {Move::Kind::Play, slot, 0});
+        break;
+
+      case CardType::Spell:
+        for (std::uint8_t target = 0; target < enemy.m_boardSize; ++target)
+        {
+          if (is_targetable(enemy.m_board[target]))
+            moves.push_back(Move {Move::Kind::Play, slot, target});
+        }
+        moves.push_back(Move {Move::Kind::Play, slot, HERO_TARGET});
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  auto const guarded = std::any_of(enemy.m_board.begin(), enemy.m_board.begin() + enemy.m_boardSize, is_guarding);
+  for (std::uint8_t slot = 0; slot < own.m_boardSize; ++slot)
+  {
+    auto const & attacker = own.m_board[slot];
+    if (attacker.m_attacksLeft == 0 || attacker.m_attack <= 0)
+      continue;
+
+    for (std::uint8_t target = 0; target < enemy.m_boardSize; ++target)
+    {
+      auto const & defender = enemy.m_board[target];
+      if (guarded ? is_guarding(defender) : is_targetable(defender))
+        moves.push_back(Move {Move::Kind::Attack, slot, target});
+    }
+    if (!guarded && !(attacker.m_flags & Minion::RushOnly))
+      moves.push_back(Move {Move::Kind::Attack, slot, HERO_TARGET});
+  }
+}
+
+Match::Undo Match::apply(Move const & move)
+{
+  auto undo = m_state;
+  switch (move.m_kind)
+  {
+    case Move::Kind::EndTurn:
+      assign<std::uint8_t>(m_state.m_hash, GLOBAL, Feature::Active, m_state.m_active, m_state.m_active ^ 1u);
+      assign<std::uint16_t>(m_state.m_hash, GLOBAL, Feature::Turn, m_state.m_turn, m_state.m_turn + 1u);
+      if (m_state.m_turn > MAX_TURNS)
+        set_result(Result::Draw);
+      else
+        start_turn();
+      break;
+
+    case Move::Kind::Play:
+      play(move.m_source, move.m_target);
+      break;
+
+    case Move::Kind::Attack:
+      attack(move.m_source, move.m_target);
+      break;
+  }
+  return undo;
+}
+
+void Match::undo(Undo const & undo)
+{
+  m_state = undo;
+}
+
+Match::Result Match::result() const
+{
+  return m_state.m_result;
+}
+
+bool Match::is_over() const
+{
+  return m_state.m_result != Result::Running;
+}
+
+unsigned Match::active() const
+{
+  return m_state.m_active;
+}
+
+unsigned Match::turn() const
+{
+  return m_state.m_turn;
+}
+
+Side const & Match::side(unsigned const player) const
+{
+  return m_state.m_sides[player];
+}
+
+CardDatabase const & Match::cards() const
+{
+  return *m_cards;
+}
+
+std::uint64_t Match::hash() const
+{
+  return m_state.m_hash;
+}
+
+std::uint64_t Match::compute_hash() const
+{
+  std::uint64_t hash = key(Feature::Active, GLOBAL, 0, m_state.m_active)
+      ^ key(Feature::Turn, GLOBAL, 0, m_state.m_turn)
+      ^ key(Feature::Result, GLOBAL, 0, static_cast<std::uint64_t>(m_state.m_result));
+  for (unsigned player = 0; player < 2; ++player)
+  {
+    auto const & side = m_state.m_sides[player];
+    hash ^= key(Feature::Health, player, 0, static_cast<std::uint64_t>(side.m_health))
+        ^ key(Feature::Mana, player, 0, side.m_mana)
+        ^ key(Feature::MaxMana, player, 0, side.m_maxMana)
+        ^ key(Feature::Fatigue, player, 0, side.m_fatigue)
+        ^ key(Feature::DeckTop, player, 0, side.m_deckTop)
+        ^ hand_hash(player)
+        ^ board_hash(player);
+  }
+  return hash;
+}
+
+std::string Match::describe(Move const & move) const
+{
+  auto const & own = m_state.m_sides[m_state.m_active];
+  auto const & enemy = m_state.m_sides[m_state.m_active ^ 1u];
+  auto const target = [&](std::uint8_t const slot) {
+    return (slot == HERO_TARGET) ? std::string {"the enemy hero"} : m_cards->name(enemy.m_board[slot].m_card).to_string();
+  };
+
+  switch (move.m_kind)
+  {
+    case Move::Kind::EndTurn:
+      return "End turn";
+
+    case Move::Kind::Play:
+    {
+      auto const card = own.m_hand[move.m_source];
+      auto description = "Play " + m_cards->name(card).to_string();
+      if (m_cards->type(card) == CardType::Spell)
+        description += " on " + target(move.m_target);
+      return description;
+    }
+
+    case Move::Kind::Attack:
+      return m_cards->name(own.m_board[move.m_source].m_card).to_string() + " attacks " + target(move.m_target);
+  }
+  return "Unknown move";
+}
+
+void Match::start_turn()
+{
+  auto const player = m_state.m_active;
+  auto & side = m_state.m_sides[player];
+  assign<std::uint8_t>(m_state.m_hash, player, Feature::MaxMana, side.m_maxMana, std::min<std::uint8_t>(side.m_maxMana + 1u, MAX_MANA));
+  assign<std::uint8_t>(m_state.m_hash, player, Feature::Mana, side.m_mana, side.m_maxMana);
+
+  m_state.m_hash ^= board_hash(player);
+  for (std::size_t slot = 0; slot < side.m_boardSize; ++slot)
+  {
+    auto & minion = side.m_board[slot];
+    minion.m_flags &= static_cast<std::uint8_t>(~Minion::RushOnly);
+    minion.m_attacksLeft = attacks_per_turn(minion);
+  }
+  m_state.m_hash ^= board_hash(player);
+
+  draw(player);
+}
+
+void Match::draw(unsigned const player)
+{
+  auto & side = m_state.m_sides[player];
+  if (side.m_deckTop == DECK_SIZE)
+  {
+    assign<std::uint8_t>(m_state.m_hash, player, Feature::Fatigue, side.m_fatigue, side.m_fatigue + 1u);
+    damage_hero(player, side.m_fatigue);
+    return;
+  }
+
+  auto const card = m_decks[player][side.m_deckTop];
+  assign<std::uint8_t>(m_state.m_hash, player, Feature::DeckTop, side.m_deckTop, side.m_deckTop + 1u);
+  if (side.m_handSize == MAX_HAND)
+    return; // burnt
+
+  m_state.m_hash ^= key(Feature::Hand, player, side.m_handSize, card);
+  side.m_hand[side.m_handSize++] = card;
+}
+
+void Match::damage_hero(unsigned const player, int const amount)
+{
+  auto & side = m_state.m_sides[player];
+  assign<std::int8_t>(m_state.m_hash, player, Feature::Health, side.m_health, static_cast<std::int8_t>(std::max(side.m_health - amount, 0)));
+  if (side.m_health == 0)
+    set_result(player == 0 ? Result::SecondWins : Result::FirstWins);
+}
+
+void Match::heal_hero(unsigned const player, int const amount)
+{
+  auto & side = m_state.m_sides[player];
+  if (amount > 0 && side.m_health > 0)
+  {
+    auto const health = std::min(side.m_health + amount, int {STARTING_HEALTH});
+    assign<std::int8_t>(m_state.m_hash, player, Feature::Health, side.m_health, static_cast<std::int8_t>(health));
+  }
+}
+
+void Match::play(std::uint8_t const handSlot, std::uint8_t const target)
+{
+  auto const player = m_state.m_active;
+  auto const enemy = player ^ 1u;
+  auto & side = m_state.m_sides[player];
+  auto const card = side.m_hand[handSlot];
+
+  assign<std::uint8_t>(m_state.m_hash, player, Feature::Mana, side.m_mana, static_cast<std::uint8_t>(side.m_mana - m_cards->cost(card)));
+
+  m_state.m_hash ^= hand_hash(player);
+  std::copy(side.m_hand.begin() + handSlot + 1, side.m_hand.begin() + side.m_handSize, side.m_hand.begin() + handSlot);
+  --side.m_handSize;
+  m_state.m_hash ^= hand_hash(player);
+
+  if (m_cards->type(card) == CardType::Minion)
+  {
+    Minion minion {card, clamp_stat(m_cards->attack(card)), clamp_stat(m_cards->health(card)), flags_of(*m_cards, card), 0};
+    if (m_cards->has(card, Keyword::Charge))
+      minion.m_attacksLeft = attacks_per_turn(minion);
+    else if (m_cards->has(card, Keyword::Rush))
+    {
+      minion.m_attacksLeft = attacks_per_turn(minion);
+      minion.m_flags |= Minion::RushOnly;
+    }
+
+    m_state.m_hash ^= key(Feature::Board, player, side.m_boardSize, pack(minion));
+    side.m_board[side.m_boardSize++] = minion;
+    return;
+  }
+
+  auto const damage = static_cast<int>(m_cards->attack(card));
+  if (target == HERO_TARGET)
+  {
+    damage_hero(enemy, damage);
+    return;
+  }
+
+  m_state.m_hash ^= board_hash(enemy);
+  strike(m_state.m_sides[enemy].m_board[target], damage, false);
+  remove_dead(enemy);
+  m_state.m_hash ^= board_hash(enemy);
+}
+
+void Match::attack(std::uint8_t const attacker, std::uint8_t const target)
+{
+  auto const player = m_state.m_active;
+  auto const enemy = player ^ 1u;
+  auto & own = m_state.m_sides[player];
+  auto & other = m_state.m_sides[enemy];
+
+  m_state.m_hash ^= board_hash(player) ^ board_hash(enemy);
+
+  auto & minion = own.m_board[attacker];
+  --minion.m_attacksLeft;
+  minion.m_flags &= static_cast<std::uint8_t>(~Minion::Stealth);
+
+  if (target == HERO_TARGET)
+  {
+    damage_hero(enemy, minion.m_attack);
+    if (minion.m_flags & Minion::Lifesteal)
+      heal_hero(player, minion.m_attack);
+  }
+  else
+  {
+    auto & defender = other.m_board[target];
+    auto const dealt = strike(defender, minion.m_attack, (minion.m_flags & Minion::Poisonous) != 0);
+    auto const taken = strike(minion, defender.m_attack, (defender.m_flags & Minion::Poisonous) != 0);
+    if (minion.m_flags & Minion::Lifesteal)
+      heal_hero(player, dealt);
+    if (defender.m_flags & Minion::Lifesteal)
+      heal_hero(enemy, taken);
+    remove_dead(player);
+    remove_dead(enemy);
+  }
+
+  m_state.m_hash ^= board_hash(player) ^ board_hash(enemy);
+}
+
+int Match::strike(Minion & target, int const damage, bool const poisonous)
+{
+  if (damage <= 0)
+    return 0;
+
+  if (target.m_flags & Minion::DivineShield)
+  {
+    target.m_flags &= static_cast<std::uint8_t>(~Minion::DivineShield);
+    return 0;
+  }
+
+  target.m_health = static_cast<std::int8_t>(poisonous ? 0 : std::max(target.m_health - damage, 0));
+  return damage;
+}
+
+void Match::remove_dead(unsigned const player)
+{
+  auto & side = m_state.m_sides[player];
+  auto const begin = side.m_board.begin();
+  auto const end = std::remove_if(begin, begin + side.m_boardSize, [](Minion const & minion) {
+    return minion.m_health <= 0;
+  });
+  side.m_boardSize = static_cast<std::uint8_t>(end - begin);
+}
+
+void Match::set_result(Result const result)
+{
+  if (m_state.m_result == Result::Running)
+    assign<Result>(m_state.m_hash, GLOBAL, Feature::Result, m_state.m_result, result);
+}
+
+std::uint64_t Match::hand_hash(unsigned const player) const
+{
+  auto const & side = m_state.m_sides[player];
+  std::uint64_t hash = 0;
+  for (unsigned slot = 0; slot < side.m_handSize; ++slot)
+    hash ^= key(Feature::Hand, player, slot, side.m_hand[slot]);
+  return hash;
+}
+
+std::uint64_t Match::board_hash(unsigned const player) const
+{
+  auto const & side = m_state.m_sides[player];
+  std::uint64_t hash = 0;
+  for (unsigned slot = 0; slot < side.m_boardSize; ++slot)
+    hash ^= key(Feature::Board, player, slot, pack(side.m_board[slot]));
+  return hash;
+}
@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_MATCH_HXX
+#define OVENBRICK_MATCH_HXX
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "card_database.hxx"
+
+constexpr std::size_t DECK_SIZE = 30;
+constexpr std::size_t MAX_HAND = 10;
+constexpr std::size_t MAX_BOARD = 7;
+constexpr std::size_t MAX_MOVES = 1 + MAX_HAND * (MAX_BOARD + 1) + MAX_BOARD * (MAX_BOARD + 1);
+constexpr std::uint8_t HERO_TARGET = MAX_BOARD; ///< Target index of the enemy hero.
+
+using Deck = std::array<CardIndex, DECK_SIZE>;
+
+/**
+ * @brief A single action of the active player.
+ */
+struct Move final
+{
+  enum class Kind : std::uint8_t
+  {
+    EndTurn,
+    Play, ///< Play the card in hand slot m_source, spells hit m_target.
+    Attack, ///< Let the minion in board slot m_source attack m_target.
+  };
+
+  Kind m_kind;
+  std::uint8_t m_source;
+  std::uint8_t m_target; ///< Enemy board slot or HERO_TARGET.
+};
+
+inline bool operator==(Move const & lhs, Move const & rhs)
+{
+  return lhs.m_kind == rhs.m_kind && lhs.m_source == rhs.m_source && lhs.m_target == rhs.m_target;
+}
+
+inline bool operator!=(Move const & lhs, Move const & rhs)
+{
+  return !(lhs == rhs);
+}
+
+/**
+ * @brief Fixed capacity list of moves, so move generation never allocates.
+ */
+class MoveList final
+{
+  std::array<Move, MAX_MOVES> m_moves;
+  std::size_t m_size = 0;
+
+public:
+  inline void clear()
+  {
+    m_size = 0;
+  }
+
+  inline void push_back(Move const & move)
+  {
+    m_moves[m_size++] = move;
+  }
+
+  inline std::size_t size() const
+  {
+    return m_size;
+  }
+
+  inline bool empty() const
+  {
+    return m_size == 0;
+  }
+
+  inline Move const & operator[](std::size_t index) const
+  {
+    return m_moves[index];
+  }
+
+  inline Move const * begin() const
+  {
+    return m_moves.data();
+  }
+
+  inline Move const * end() const
+  {
+    return m_moves.data() + m_size;
+  }
+};
+
+/**
+ * @brief A minion on the board.
+ */
+struct Minion final
+{
+  enum Flag : std::uint8_t
+  {
+    Taunt = 1u << 0u,
+    DivineShield = 1u << 1u,
+    Stealth = 1u << 2u,
+    Lifesteal = 1u << 3u,
+    Poisonous = 1u << 4u,
+    Windfury = 1u << 5u,
+    RushOnly = 1u << 6u, ///< Played with Rush this turn, may only attack minions.
+  };
+
+  CardIndex m_card;
+  std::int8_t m_attack;
+  std::int8_t m_health;
+  std::uint8_t m_flags;
+  std::uint8_t m_attacksLeft;
+};
+
+/**
+ * @brief Everything one player owns, except for the deck order.
+ */
+struct Side final
+{
+  std::array<CardIndex, MAX_HAND> m_hand;
+  std::array<Minion, MAX_BOARD> m_board;
+  std::uint8_t m_handSize;
+  std::uint8_t m_boardSize;
+  std::uint8_t m_deckTop; ///< Number of cards drawn so far.
+  std::int8_t m_health;
+  std::uint8_t m_mana;
+  std::uint8_t m_maxMana;
+  std::uint8_t m_fatigue;
+};
+
+/**
+ * @brief The rules of a match between two players.
+ *
+ * Supported are minions with their keywords (Taunt, Charge, Rush, Divine Shield, Windfury, Stealth,
+ * Lifesteal, Poisonous) and spells dealing their attack value as damage to an enemy.
+ * Battlecries and deathrattles have no effect yet, weapons and heroes are not playable.
+ *
+ * The state is a few hundred bytes without any pointers into itself, so copying is cheap.
+ * A Zobrist-style hash is updated incrementally with every change,
+ * and apply() returns what undo() needs to revert the move.
+ */
+class Match final
+{
+public:
+  static constexpr std::int8_t STARTING_HEALTH = 30;
+  static constexpr std::uint8_t MAX_MANA = 10;
+  static constexpr std::uint16_t MAX_TURNS = 80; ///< The match is a draw afterwards.
+
+  enum class Result : std::uint8_t
+  {
+    Running,
+    FirstWins,
+    SecondWins,
+    Draw,
+  };
+
+  /**
+   * @brief Everything a move may change.
+   */
+  struct State final
+  {
+    std::array<Side, 2> m_sides;
+    std::uint64_t m_hash;
+    std::uint16_t m_turn;
+    std::uint8_t m_active;
+    Result m_result;
+  };
+
+  using Undo = State;
+
+  /**
+   * @brief Shuffle the decks, draw the starting hands and begin the first turn.
+   * @param cards The cards referred to by the decks, which must outlive the match.
+   * @param first The deck of the player going first.
+   * @param second The deck of the player going second.
+   * @param seed Determines the order of the decks.
+   */
+  Match(CardDatabase const & cards, Deck first, Deck second, std::uint64_t seed);
+
+  /**
+   * @brief Build a deck of the cards a match can play.
+   * @param cards The card database.
+   * @param seed Determines which cards are used.
+   * @return A deck with at most two copies of each minion and spell, if there are enough of them.
+   */
+  static Deck random_deck(CardDatabase const & cards, std::uint64_t seed);
+
+  /**
+   * @brief Write the match into a save game, cards are stored by id so the database may change meanwhile.
+   * @param out Where to write to.
+   */
+  void write(std::ostream & out) const;
+
+  /**
+   * @brief Continue a match written by write().
+   * @param cards The cards to play with, which must outlive the match.
+   * @param data What write() wrote.
+   * @param size The number of bytes.
+   * @return The match, with its hash computed for these cards.
+   * @throws std::runtime_error If the data is malformed or refers to cards which do not exist anymore.
+   */
+  static Match read(CardDatabase const & cards, char const * data, std::size_t size);
+
+  /**
+   * @param[out] moves All moves the active player may make, none once the match is over.
+   */
+  void legal_moves(MoveList & moves) const;
+
+  /**
+   * @brief Make a move of the active player.
+   * @param move One of the legal moves.
+   * @return The information to revert the move.
+   */
+  Undo apply(Move const & move);
+
+  /**
+   * @brief Revert a move.
+   * @param undo What apply() returned, undos must be applied in reverse order.
+   */
+  void undo(Undo const & undo);
+
+  Result result() const;
+
+  bool is_over() const;
+
+  /**
+   * @return The player to move (0 or 1).
+   */
+  unsigned active() const;
+
+  unsigned turn() const;
+
+  Side const & side(unsigned player) const;
+
+  CardDatabase const & cards() const;
+
+  /**
+   * @return The incrementally maintained hash.
+   */
+  std::uint64_t hash() const;
+
+  /**
+   * @return The hash computed from scratch, which always equals hash().
+   */
+  std::uint64_t compute_hash() const;
+
+  /**
+   * @return A human readable description of a legal move, e.g. for the log.
+   */
+  std::string describe(Move const & move) const;
+
+private:
+  explicit Match(CardDatabase const & cards);
+
+  void start_turn();
+  void draw(unsigned player);
+  void damage_hero(unsigned player, int amount);
+  void heal_hero(unsigned player, int amount);
+  void play(std::uint8_t handSlot, std::uint8_t target);
+  void attack(std::uint8_t attacker, std::uint8_t target);
+  int strike(Minion & target, int damage, bool poisonous);
+  void remove_dead(unsigned player);
+  void set_result(Result result);
+
+  std::uint64_t hand_hash(unsigned player) const;
+  std::uint64_t board_hash(unsigned player) const;
+
+  CardDatabase const * m_cards;
+  std::array<Deck, 2> m_decks;
+  State m_state;
+};
+
+#endif // OVENBRICK_MATCH_HXX
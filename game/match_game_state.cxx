@@ -0,0 +1,416 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include <SFML/System/Time.hpp>
+
+#include <SFML/Window/Event.hpp>
+
+#include <boost/log/trivial.hpp>
+
+#include "game_state_manager.hxx"
+#include "input_actions.hxx"
+#include "load_progress.hxx"
+#include "match_game_state.hxx"
+#include "resources.hxx"
+
+namespace {
+  // layout of the 320x240 screen
+  constexpr float MARGIN = 4.f;
+  constexpr float SLOT_WIDTH = 42.f;
+  constexpr float SLOT_STRIDE = 45.f;
+  constexpr float BOARD_HEIGHT = 50.f;
+  constexpr float HAND_WIDTH = 29.f;
+  constexpr float HAND_STRIDE = 31.f;
+  constexpr float HAND_HEIGHT = 44.f;
+  constexpr float INFO_HEIGHT = 13.f;
+  constexpr float ENEMY_INFO_TOP = 1.f;
+  constexpr float ENEMY_BOARD_TOP = 16.f;
+  constexpr float OWN_BOARD_TOP = 72.f;
+  constexpr float OWN_INFO_TOP = 126.f;
+  constexpr float HAND_TOP = 142.f;
+  constexpr float MESSAGE_TOP = 196.f;
+  constexpr float INFO_WIDTH = 312.f;
+
+  constexpr unsigned SMALL = 10;
+  constexpr unsigned LARGE = 12;
+
+  // one text and one sprite per spot, so the renderer sees changes spot by spot
+  constexpr std::size_t ENEMY_INFO = 0;
+  constexpr std::size_t OWN_INFO = 1;
+  constexpr std::size_t ENEMY_BOARD = 2;
+  constexpr std::size_t OWN_BOARD = ENEMY_BOARD + MAX_BOARD;
+  constexpr std::size_t HAND = OWN_BOARD + MAX_BOARD;
+  constexpr std::size_t SPOTS = HAND + MAX_HAND;
+  constexpr std::size_t MESSAGE = SPOTS; ///< Only a text.
+
+  // how often the threads are polled once the thinking time passed
+  sf::Time const POLL_INTERVAL = sf::milliseconds(10);
+
+  sf::Color const TABLE {24, 48, 32};
+  sf::Color const EMPTY_SLOT {36, 66, 46};
+  sf::Color const CARD {214, 192, 150};
+  sf::Color const UNPLAYABLE {128, 118, 100};
+  sf::Color const SELECTED {255, 236, 120};
+  sf::Color const TARGETED {224, 96, 72};
+  sf::Color const INK {48, 32, 24};
+
+  std::string abbreviate(boost::string_ref const name, std::size_t const length)
+  {
+    return name.substr(0, length).to_string();
+  }
+
+  std::string describe(Side const & side)
+  {
+    return "HP " + std::to_string(side.m_health) + "  Mana " + std::to_string(side.m_mana) + "/"
+        + std::to_string(side.m_maxMana) + "  Hand " + std::to_string(side.m_handSize)
+        + "  Deck " + std::to_string(DECK_SIZE - side.m_deckTop);
+  }
+}
+
+unsigned const MatchGameState::PLAYER;
+unsigned const MatchGameState::COMPUTER;
+char const MatchGameState::TYPE_KEY[] = "match";
+
+MatchGameState::MatchGameState(std::shared_ptr<GameStateManager> gsm, std::shared_ptr<Resources> resources,
+                               std::shared_ptr<MctsSearch::Settings> settings, std::shared_ptr<Renderer> renderer)
+    : GameState {gsm}
+    , m_resources {std::move(resources)}
+    , m_renderer {std::move(renderer)}
+    , m_cards {}
+    , m_match {}
+    , m_search {*settings}
+    , m_thinking {}
+    , m_cutShort {0}
+    , m_moves {}
+    , m_selected {0}
+    , m_atlas {}
+    , m_texts {ArenaAllocator<TextBatch> {arena()}}
+    , m_sprites {ArenaAllocator<Sprite> {arena()}}
+    , m_changed {true}
+{
+}
+
+MatchGameState::~MatchGameState()
+{
+  m_search.cancel();
+  if (m_search.is_running())
+    static_cast<void>(m_search.result());
+}
+
+void MatchGameState::load(LoadProgress & progress)
+{
+  m_cards.reset(new CardDatabase {m_resources->get("cards/cards.db")});
+  progress.report(.5f);
+
+  auto seed = m_search.settings().m_seed;
+  if (seed == 0)
+  {
+    std::random_device device {};
+    seed = (std::uint64_t {device()} << 32u) | device();
+  }
+  m_match.reset(new Match {*m_cards, Match::random_deck(*m_cards, seed), Match::random_deck(*m_cards, ~seed), seed});
+  progress.report(1.f);
+}
+
+void MatchGameState::resume(Asset const & data, LoadProgress & progress)
+{
+  m_cards.reset(new CardDatabase {m_resources->get("cards/cards.db")});
+  progress.report(.5f);
+  m_match.reset(new Match {Match::read(*m_cards, data.data(), data.size())});
+  progress.report(1.f);
+}
+
+bool MatchGameState::save(std::ostream & out) const
+{
+  if (!m_match || m_match->is_over())
+    return false;
+  m_match->write(out);
+  return true;
+}
+
+char const * MatchGameState::type_key() const
+{
+  return TYPE_KEY;
+}
+
+void MatchGameState::set_up()
+{
+  if (!m_match)
+    return;
+
+  // the texture is created on the main thread
+  m_atlas.reset(new GlyphAtlas {m_resources->get("fonts/FiraCode-Regular.atlas")});
+  m_texts.clear();
+  m_texts.reserve(MESSAGE + 1);
+  for (std::size_t n = 0; n <= MESSAGE; ++n)
+    m_texts.emplace_back(*m_atlas);
+  m_sprites.resize(SPOTS);
+  m_changed = true;
+
+  BOOST_LOG_TRIVIAL(info)
+    << "Match against the computer (" << m_search.settings().m_budget.count() << "ms per move)";
+  select(0);
+}
+
+void MatchGameState::handle_event(sf::Event const & /* event */)
+{
+}
+
+void MatchGameState::handle_actions(ActionFrame const & actions)
+{
+  if (actions.pressed(Action::Menu))
+  {
+    m_gsm->pop_state();
+    return;
+  }
+
+  if (!m_match || m_match->active() != PLAYER || m_moves.empty())
+    return;
+
+  if (actions.pressed(Action::Left))
+    select((m_selected + m_moves.size() - 1) % m_moves.size());
+  if (actions.pressed(Action::Right))
+    select((m_selected + 1) % m_moves.size());
+
+  // playing changes the moves, so a frame plays at most one
+  if (actions.pressed(Action::A))
+    play(m_moves[m_selected]);
+  else if (actions.pressed(Action::Start))
+    play(Move {Move::Kind::EndTurn, 0, 0});
+}
+
+void MatchGameState::update(sf::Time const & elapsed)
+{
+  if (!m_match || m_match->is_over() || m_match->active() != COMPUTER)
+    return;
+
+  if (!m_search.is_running())
+  {
+    m_search.start(*m_match);
+    m_thinking = sf::Time::Zero;
+    m_changed = true;
+    return;
+  }
+
+  // the move is due once the thinking time passed in simulated time, but only taken once the threads are done,
+  // so update never waits for them; a replay takes it on the tick recorded
+  m_thinking += elapsed;
+  auto const due = m_search.is_forced()
+      || m_thinking.asMicroseconds() >= std::chrono::microseconds {m_search.settings().m_budget}.count();
+  if (due && m_gsm->collect(m_search.is_done()))
+  {
+    auto const move = m_search.result();
+    auto const & statistics = m_search.statistics();
+    BOOST_LOG_TRIVIAL(debug)
+      << "Computer searched " << statistics.m_playouts << " playouts ("
+      << statistics.m_nodes << " nodes) on " << statistics.m_threads << " threads in "
+      << std::chrono::duration_cast<std::chrono::milliseconds>(statistics.m_elapsed).count() << "ms";
+    if (statistics.m_cutShort)
+      ++m_cutShort;
+    play(move);
+  }
+}
+
+void MatchGameState::render(float /* alpha */)
+{
+  if (!m_match)
+    return;
+
+  if (m_changed)
+  {
+    lay_out();
+    m_changed = false;
+  }
+
+  for (auto const & sprite : m_sprites)
+    m_renderer->draw(sprite);
+  for (auto const & text : m_texts)
+    m_renderer->draw(text, 1);
+}
+
+sf::Time MatchGameState::next_wakeup() const
+{
+  if (m_changed)
+    return sf::Time::Zero;
+  if (!m_match || m_match->is_over() || m_match->active() != COMPUTER)
+    return never();
+
+  // update() starts the search, takes forced moves right away and otherwise waits out the thinking time,
+  // the frame scheduler simulates the time slept
+  if (!m_search.is_running() || m_search.is_forced())
+    return sf::Time::Zero;
+  auto const remaining = sf::microseconds(std::chrono::microseconds {m_search.settings().m_budget}.count()) - m_thinking;
+  return (remaining > sf::Time::Zero) ? remaining : POLL_INTERVAL;
+}
+
+void MatchGameState::tear_down()
+{
+  m_search.cancel();
+  // the arena is released right after, clear() would keep the capacity
+  ArenaVector<TextBatch> {m_texts.get_allocator()}.swap(m_texts);
+  ArenaVector<Sprite> {m_sprites.get_allocator()}.swap(m_sprites);
+}
+
+Match const * MatchGameState::match() const
+{
+  return m_match.get();
+}
+
+bool MatchGameState::is_thinking() const
+{
+  return m_search.is_running();
+}
+
+MctsSearch const & MatchGameState::search() const
+{
+  return m_search;
+}
+
+std::uint64_t MatchGameState::searches_cut_short() const
+{
+  return m_cutShort;
+}
+
+void MatchGameState::play(Move const & move)
+{
+  BOOST_LOG_TRIVIAL(info) << (m_match->active() == PLAYER ? "Player: " : "Computer: ") << m_match->describe(move);
+  m_match->apply(move);
+  m_changed = true;
+
+  switch (m_match->result())
+  {
+    case Match::Result::Running:
+      select(0);
+      return;
+    case Match::Result::FirstWins:
+      BOOST_LOG_TRIVIAL(info) << "The player wins";
+      break;
+    case Match::Result::SecondWins:
+      BOOST_LOG_TRIVIAL(info) << "The computer wins";
+      break;
+    case Match::Result::Draw:
+      BOOST_LOG_TRIVIAL(info) << "The match is a draw";
+      break;
+  }
+  m_moves.clear();
+}
+
+void MatchGameState::select(std::size_t const index)
+{
+  if (m_match->active() != PLAYER)
+    return;
+
+  m_match->legal_moves(m_moves);
+  m_selected = index % m_moves.size();
+  m_changed = true;
+  BOOST_LOG_TRIVIAL(debug) << "Selected move " << (m_selected + 1) << "/" << m_moves.size() << ": "
+                           << m_match->describe(m_moves[m_selected]);
+}
+
+void MatchGameState::lay_out()
+{
+  auto const & cards = m_match->cards();
+  auto const & own = m_match->side(PLAYER);
+  auto const & enemy = m_match->side(COMPUTER);
+  for (auto & text : m_texts)
+    text.clear();
+
+  auto const spot = [this](std::size_t const index, sf::FloatRect const & bounds, sf::Color const & color) {
+    m_sprites[index] = Sprite {bounds, sf::FloatRect {}, nullptr, color, 0};
+  };
+
+  spot(ENEMY_INFO, sf::FloatRect {MARGIN, ENEMY_INFO_TOP, INFO_WIDTH, INFO_HEIGHT}, TABLE);
+  m_texts[ENEMY_INFO].add("Computer  " + describe(enemy), {MARGIN + 2.f, ENEMY_INFO_TOP}, SMALL);
+  spot(OWN_INFO, sf::FloatRect {MARGIN, OWN_INFO_TOP, INFO_WIDTH, INFO_HEIGHT}, TABLE);
+  m_texts[OWN_INFO].add("You  " + describe(own), {MARGIN + 2.f, OWN_INFO_TOP}, SMALL);
+
+  for (std::size_t slot = 0; slot < MAX_BOARD; ++slot)
+  {
+    auto const x = MARGIN + SLOT_STRIDE * static_cast<float>(slot);
+    for (auto const player : {COMPUTER, PLAYER})
+    {
+      auto const & side = m_match->side(player);
+      auto const index = (player == COMPUTER ? ENEMY_BOARD : OWN_BOARD) + slot;
+      auto const top = (player == COMPUTER) ? ENEMY_BOARD_TOP : OWN_BOARD_TOP;
+      if (slot >= side.m_boardSize)
+      {
+        spot(index, sf::FloatRect {x, top, SLOT_WIDTH, BOARD_HEIGHT}, EMPTY_SLOT);
+        continue;
+      }
+
+      auto const & minion = side.m_board[slot];
+      spot(index, sf::FloatRect {x, top, SLOT_WIDTH, BOARD_HEIGHT}, CARD);
+      m_texts[index].add(abbreviate(cards.name(minion.m_card), 6), {x + 2.f, top + 2.f}, SMALL, INK);
+      m_texts[index].add(std::to_string(minion.m_attack) + "/" + std::to_string(minion.m_health),
+                         {x + 2.f, top + BOARD_HEIGHT - 16.f}, LARGE, INK);
+    }
+  }
+
+  for (std::size_t slot = 0; slot < MAX_HAND; ++slot)
+  {
+    auto const x = MARGIN + HAND_STRIDE * static_cast<float>(slot);
+    sf::FloatRect const bounds {x, HAND_TOP, HAND_WIDTH, HAND_HEIGHT};
+    if (slot >= own.m_handSize)
+    {
+      spot(HAND + slot, bounds, EMPTY_SLOT);
+      continue;
+    }
+
+    auto const card = own.m_hand[slot];
+    spot(HAND + slot, bounds, cards.cost(card) <= own.m_mana ? CARD : UNPLAYABLE);
+    m_texts[HAND + slot].add(std::to_string(cards.cost(card)), {x + 2.f, HAND_TOP + 2.f}, LARGE, INK);
+    m_texts[HAND + slot].add(abbreviate(cards.name(card), 4), {x + 2.f, HAND_TOP + 20.f}, SMALL, INK);
+  }
+
+  auto & message = m_texts[MESSAGE];
+  sf::Vector2f const messagePosition {MARGIN + 2.f, MESSAGE_TOP};
+  switch (m_match->result())
+  {
+    case Match::Result::FirstWins:
+      message.add("You win!", messagePosition, LARGE);
+      return;
+    case Match::Result::SecondWins:
+      message.add("The computer wins.", messagePosition, LARGE);
+      return;
+    case Match::Result::Draw:
+      message.add("Draw.", messagePosition, LARGE);
+      return;
+    case Match::Result::Running:
+      break;
+  }
+
+  if (m_match->active() == COMPUTER || m_moves.empty())
+  {
+    message.add(m_search.is_running() ? "The computer is thinking..." : "The computer's turn", messagePosition, LARGE);
+    return;
+  }
+
+  // highlight what the selected move is about
+  auto const & move = m_moves[m_selected];
+  message.add(m_match->describe(move), messagePosition, LARGE);
+  message.add("left/right: choose  A: play  start: end turn", {MARGIN + 2.f, MESSAGE_TOP + 18.f}, SMALL);
+  if (move.m_kind == Move::Kind::EndTurn)
+    return;
+
+  m_sprites[(move.m_kind == Move::Kind::Play ? HAND : OWN_BOARD) + move.m_source].m_color = SELECTED;
+  if (move.m_kind == Move::Kind::Attack || cards.type(own.m_hand[move.m_source]) == CardType::Spell)
+    m_sprites[move.m_target == HERO_TARGET ? ENEMY_INFO : ENEMY_BOARD + move.m_target].m_color = TARGETED;
+}
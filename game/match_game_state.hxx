@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_MATCH_GAME_STATE_HXX
+#define OVENBRICK_MATCH_GAME_STATE_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ddic.hxx>
+
+#include "card_database.hxx"
+#include "game_state.hxx"
+#include "glyph_atlas.hxx"
+#include "match.hxx"
+#include "mcts.hxx"
+#include "renderer.hxx"
+#include "text_batch.hxx"
+
+class Resources;
+
+/**
+ * @brief A match of the player against the computer.
+ *
+ * The computer thinks on background threads while update() only polls for its move,
+ * so frames keep their pace no matter how long the search takes.
+ * Its move is taken on the first tick after the thinking time passed in simulated time on which the search is done.
+ * That tick is recorded, see GameStateManager::collect(), so replays take the move on the same tick.
+ * The player picks moves with the left/right actions and A, start ends the turn.
+ * The table is only laid out again when something changed, so the renderer redraws just that.
+ */
+class MatchGameState final : public GameState
+{
+public:
+  using autowire = ddic::inject<GameStateManager, Resources, MctsSearch::Settings, Renderer>;
+
+  static constexpr unsigned PLAYER = 0;
+  static constexpr unsigned COMPUTER = 1;
+  static char const TYPE_KEY[]; ///< What the state is saved under in session snapshots.
+
+  MatchGameState(std::shared_ptr<GameStateManager> gsm, std::shared_ptr<Resources> resources,
+                 std::shared_ptr<MctsSearch::Settings> settings, std::shared_ptr<Renderer> renderer);
+
+  /**
+   * @brief Stops the search before the cards and the match it reads go away.
+   */
+  ~MatchGameState() override;
+
+  /**
+   * @brief Reads the cards and deals the decks.
+   */
+  void load(LoadProgress & progress) override;
+
+  /**
+   * @brief Reads the cards and continues the match of the previous session.
+   */
+  void resume(Asset const & data, LoadProgress & progress) override;
+
+  /**
+   * @brief Writes the match, the computer starts thinking anew when it is resumed.
+   */
+  bool save(std::ostream & out) const override;
+
+  char const * type_key() const override;
+
+  void set_up() override;
+
+  void handle_event(sf::Event const & event) override;
+
+  void handle_actions(ActionFrame const & actions) override;
+
+  void update(sf::Time const & elapsed) override;
+
+  void render(float alpha) override;
+
+  /**
+   * @brief Idle while the player ponders, wake up when the computer's thinking time passed or the table changed.
+   * @remarks Once the thinking time passed, the search is polled every few milliseconds until its threads are done.
+   */
+  sf::Time next_wakeup() const override;
+
+  void tear_down() override;
+
+  /**
+   * @return The match, nullptr before it was loaded.
+   */
+  Match const * match() const;
+
+  /**
+   * @return true, while the computer is thinking.
+   */
+  bool is_thinking() const;
+
+  /**
+   * @return The search of the computer.
+   */
+  MctsSearch const & search() const;
+
+  /**
+   * @return How many searches of the computer ran out of thinking time before their playout limit.
+   */
+  std::uint64_t searches_cut_short() const;
+
+private:
+  void play(Move const & move);
+  void select(std::size_t index);
+  void lay_out();
+
+  std::shared_ptr<Resources> const m_resources;
+  std::shared_ptr<Renderer> const m_renderer;
+  std::unique_ptr<CardDatabase> m_cards;
+  std::unique_ptr<Match> m_match;
+  MctsSearch m_search; ///< Declared after the cards, its threads must stop before they go away.
+  sf::Time m_thinking; ///< Simulated time the computer has been thinking.
+  std::uint64_t m_cutShort;
+  MoveList m_moves;
+  std::size_t m_selected;
+  std::unique_ptr<GlyphAtlas> m_atlas;
+  ArenaVector<TextBatch> m_texts; ///< In the arena of the state, like the sprites.
+  ArenaVector<Sprite> m_sprites;
+  bool m_changed; ///< The table has to be laid out again.
+};
+
+#endif // OVENBRICK_MATCH_GAME_STATE_HXX
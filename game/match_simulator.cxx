@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "job_system.hxx"
+#include "match_simulator.hxx"
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  constexpr std::uint64_t MERGE_INTERVAL = 16; ///< Matches a thread plays between merging its counters.
+  constexpr unsigned END_TURN_CHANCE = 10; ///< Percent, like the playouts of the search.
+
+  /**
+   * @brief splitmix64, turns consecutive indices into unrelated seeds.
+   */
+  std::uint64_t mix(std::uint64_t value)
+  {
+    value += 0x9e3779b97f4a7c15u;
+    value = (value ^ (value >> 30u)) * 0xbf58476d1ce4e5b9u;
+    value = (value ^ (value >> 27u)) * 0x94d049bb133111ebu;
+    return value ^ (value >> 31u);
+  }
+
+  MatchSimulator::Statistics empty_statistics(std::vector<Deck> const & decks)
+  {
+    MatchSimulator::Statistics statistics {0, 0, 0, 0, 0, 0, {}, 0, std::chrono::nanoseconds::zero()};
+    statistics.m_decks.reserve(decks.size());
+    for (auto const & deck : decks)
+      statistics.m_decks.push_back(MatchSimulator::DeckRecord {deck, 0, 0, 0, 0});
+    return statistics;
+  }
+
+  /**
+   * @brief Add the counters of part to total and clear them in part.
+   */
+  void merge_into(MatchSimulator::Statistics & total, MatchSimulator::Statistics & part)
+  {
+    total.m_matches += part.m_matches;
+    total.m_firstWins += part.m_firstWins;
+    total.m_secondWins += part.m_secondWins;
+    total.m_draws += part.m_draws;
+    total.m_moves += part.m_moves;
+    total.m_turns += part.m_turns;
+    part.m_matches = part.m_firstWins = part.m_secondWins = part.m_draws = part.m_moves = part.m_turns = 0;
+
+    for (std::size_t n = 0; n < total.m_decks.size(); ++n)
+    {
+      auto & to = total.m_decks[n];
+      auto & from = part.m_decks[n];
+      to.m_matches += from.m_matches;
+      to.m_wins += from.m_wins;
+      to.m_losses += from.m_losses;
+      to.m_draws += from.m_draws;
+      from.m_matches = from.m_wins = from.m_losses = from.m_draws = 0;
+    }
+  }
+
+  double win_rate(double const wins, double const draws, double const matches)
+  {
+    return matches > 0.0 ? (wins + draws / 2.0) / matches : 0.0;
+  }
+
+  void write_json_string(std::ostream & out, std::string const & text)
+  {
+    out << '"';
+    for (auto const c : text)
+    {
+      if (c == '"' || c == '\\')
+        out << '\\';
+      out << c;
+    }
+    out << '"';
+  }
+}
+
+struct MatchSimulator::Lane final
+{
+  MctsWorkspace m_workspace;
+  MoveList m_moves;
+  Statistics m_counts;
+};
+
+double MatchSimulator::Statistics::matches_per_second_per_core() const
+{
+  auto const seconds = std::chrono::duration<double> {m_elapsed}.count();
+  return (seconds > 0.0 && m_threads > 0) ? static_cast<double>(m_matches) / seconds / m_threads : 0.0;
+}
+
+MatchSimulator::MatchSimulator(CardDatabase const & cards, Settings const & settings)
+    : m_cards {cards}
+    , m_settings {settings}
+    , m_decks {}
+{
+  if (m_settings.m_decks == 0)
+    throw std::invalid_argument {"The simulation needs at least one deck"}; // NOLINT(cert-err60-cpp)
+
+  m_decks.reserve(m_settings.m_decks);
+  for (std::size_t n = 0; n < m_settings.m_decks; ++n)
+    m_decks.push_back(Match::random_deck(m_cards, mix(m_settings.m_seed ^ ~std::uint64_t {n})));
+}
+
+MatchSimulator::Statistics MatchSimulator::run(JobSystem & jobs, Report const & report) const
+{
+  auto const start = clock::now();
+  auto const elapsed = [start] {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+  };
+
+  auto total = empty_statistics(m_decks);
+  total.m_threads = jobs.thread_count() + 1; // the calling thread helps while waiting
+
+  std::mutex mutex {};
+  auto nextReport = m_settings.m_reportInterval;
+  auto const merge = [this, &mutex, &total, &nextReport, &report, &elapsed](Lane & lane) {
+    std::lock_guard<std::mutex> const lock {mutex};
+    merge_into(total, lane.m_counts);
+    if (!report || m_settings.m_reportInterval == 0 || total.m_matches < nextReport
+        || total.m_matches >= m_settings.m_matches)
+      return;
+
+    total.m_elapsed = elapsed();
+    report(total);
+    while (nextReport <= total.m_matches)
+      nextReport += m_settings.m_reportInterval;
+  };
+
+  std::atomic<std::uint64_t> next {0};
+  jobs.parallel_for(total.m_threads, 1, [this, &next, &merge](std::size_t) {
+    // lives as long as the thread plays, so matches after the first hardly allocate
+    Lane lane {};
+    lane.m_counts = empty_statistics(m_decks);
+
+    for (std::uint64_t played = 1;; ++played)
+    {
+      auto const index = next.fetch_add(1, std::memory_order_relaxed);
+      if (index >= m_settings.m_matches)
+        break;
+      play(index, lane);
+      if (played % MERGE_INTERVAL == 0)
+        merge(lane);
+    }
+    merge(lane);
+  });
+
+  total.m_elapsed = elapsed();
+  return total;
+}
+
+std::vector<Deck> const & MatchSimulator::decks() const
+{
+  return m_decks;
+}
+
+void MatchSimulator::play(std::uint64_t const index, Lane & lane) const
+{
+  auto const seed = mix(m_settings.m_seed ^ mix(index));
+  auto const first = static_cast<std::size_t>(seed % m_decks.size());
+  auto const second = static_cast<std::size_t>((seed >> 32u) % m_decks.size());
+  Match match {m_cards, m_decks[first], m_decks[second], seed};
+
+  auto computer = m_settings.m_computer;
+  computer.m_seed = seed;
+  auto random = seed;
+  auto & counts = lane.m_counts;
+  while (!match.is_over())
+  {
+    if (computer.m_maxPlayouts != 0)
+    {
+      match.apply(MctsSearch::run(match, computer, lane.m_workspace));
+    }
+    else
+    {
+      auto & moves = lane.m_moves;
+      match.legal_moves(moves);
+      // ending the turn always is the first move
+      random = mix(random);
+      std::size_t move = 0;
+      if (moves.size() > 1 && random % 100 >= END_TURN_CHANCE)
+        move = 1 + static_cast<std::size_t>((random >> 8u) % (moves.size() - 1));
+      match.apply(moves[move]);
+    }
+    ++counts.m_moves;
+  }
+
+  ++counts.m_matches;
+  counts.m_turns += match.turn();
+  auto & firstDeck = counts.m_decks[first];
+  auto & secondDeck = counts.m_decks[second];
+  ++firstDeck.m_matches;
+  ++secondDeck.m_matches;
+  switch (match.result())
+  {
+    case Match::Result::FirstWins:
+      ++counts.m_firstWins;
+      ++firstDeck.m_wins;
+      ++secondDeck.m_losses;
+      break;
+    case Match::Result::SecondWins:
+      ++counts.m_secondWins;
+      ++secondDeck.m_wins;
+      ++firstDeck.m_losses;
+      break;
+    case Match::Result::Draw:
+    case Match::Result::Running:
+      ++counts.m_draws;
+      ++firstDeck.m_draws;
+      ++secondDeck.m_draws;
+      break;
+  }
+}
+
+void write_json(std::ostream & out, MatchSimulator::Statistics const & statistics, CardDatabase const & cards)
+{
+  auto const matches = static_cast<double>(statistics.m_matches);
+  auto const seconds = std::chrono::duration<double> {statistics.m_elapsed}.count();
+  out << "{\"matches\": " << statistics.m_matches
+      << ", \"first_wins\": " << statistics.m_firstWins
+      << ", \"second_wins\": " << statistics.m_secondWins
+      << ", \"draws\": " << statistics.m_draws
+      << ", \"moves_per_match\": " << (matches > 0.0 ? statistics.m_moves / matches : 0.0)
+      << ", \"turns_per_match\": " << (matches > 0.0 ? statistics.m_turns / matches : 0.0)
+      << ", \"threads\": " << statistics.m_threads
+      << ", \"seconds\": " << seconds
+      << ", \"matches_per_second\": " << (seconds > 0.0 ? matches / seconds : 0.0)
+      << ", \"matches_per_second_per_core\": " << statistics.matches_per_second_per_core()
+      << ", \"decks\": [";
+
+  struct CardRecord final
+  {
+    double m_matches;
+    double m_wins;
+    double m_draws;
+  };
+  std::map<CardIndex, CardRecord> perCard {};
+
+  for (std::size_t n = 0; n < statistics.m_decks.size(); ++n)
+  {
+    auto const & deck = statistics.m_decks[n];
+    out << (n ? ", " : "") << "{\"deck\": " << n
+        << ", \"matches\": " << deck.m_matches
+        << ", \"wins\": " << deck.m_wins
+        << ", \"losses\": " << deck.m_losses
+        << ", \"draws\": " << deck.m_draws
+        << ", \"win_rate\": " << win_rate(deck.m_wins, deck.m_draws, deck.m_matches)
+        << ", \"cards\": [";
+    for (std::size_t c = 0; c < deck.m_deck.size(); ++c)
+    {
+      auto const card = deck.m_deck[c];
+      out << (c ? ", " : "") << cards.id(card);
+
+      // every copy counts, a card played twice as often weighs twice as much
+      auto & record = perCard[card];
+      record.m_matches += deck.m_matches;
+      record.m_wins += deck.m_wins;
+      record.m_draws += deck.m_draws;
+    }
+    out << "]}";
+  }
+
+  out << "], \"cards\": [";
+  auto first = true;
+  for (auto const & entry : perCard)
+  {
+    auto const name = cards.name(entry.first);
+    out << (first ? "" : ", ") << "{\"id\": " << cards.id(entry.first) << ", \"name\": ";
+    write_json_string(out, std::string {name.data(), name.size()});
+    out << ", \"matches\": " << entry.second.m_matches
+        << ", \"win_rate\": " << win_rate(entry.second.m_wins, entry.second.m_draws, entry.second.m_matches)
+        << "}";
+    first = false;
+  }
+  out << "]}\n";
+}
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_MATCH_SIMULATOR_HXX
+#define OVENBRICK_MATCH_SIMULATOR_HXX
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "card_database.hxx"
+#include "match.hxx"
+#include "mcts.hxx"
+
+class JobSystem;
+
+/**
+ * @brief Plays the computer against itself headless, many matches at once, to balance decks.
+ *
+ * A pool of random decks plays in random pairings, every match is determined by its index and the seed alone,
+ * so the statistics do not depend on the number of threads. Every thread keeps its search tree and counters
+ * between matches and merges the counters into the totals now and then.
+ */
+class MatchSimulator final : private sf::NonCopyable
+{
+public:
+  struct Settings final
+  {
+    std::uint64_t m_matches = 1000;
+    std::size_t m_decks = 8; ///< Random decks in the pool.
+    std::uint64_t m_seed = 1; ///< Determines the decks, the pairings and the course of every match.
+    /// A playout limit of 0 plays random moves instead of searching.
+    /// The results only repeat as long as no move runs out of m_budget, so keep it generous.
+    MctsSearch::Settings m_computer;
+    std::uint64_t m_reportInterval = 1000; ///< Matches between progress reports.
+  };
+
+  struct DeckRecord final
+  {
+    Deck m_deck;
+    std::uint64_t m_matches;
+    std::uint64_t m_wins;
+    std::uint64_t m_losses;
+    std::uint64_t m_draws;
+  };
+
+  struct Statistics final
+  {
+    std::uint64_t m_matches;
+    std::uint64_t m_firstWins; ///< By the player going first.
+    std::uint64_t m_secondWins;
+    std::uint64_t m_draws;
+    std::uint64_t m_moves;
+    std::uint64_t m_turns;
+    std::vector<DeckRecord> m_decks;
+    unsigned m_threads;
+    std::chrono::nanoseconds m_elapsed;
+
+    /**
+     * @return The figure of merit of the simulator.
+     */
+    double matches_per_second_per_core() const;
+  };
+
+  using Report = std::function<void(Statistics const &)>;
+
+  /**
+   * @brief Build the deck pool.
+   * @param cards The cards, which must outlive the simulator.
+   * @param settings What to simulate.
+   * @throws std::invalid_argument If the deck pool is empty.
+   */
+  MatchSimulator(CardDatabase const & cards, Settings const & settings);
+
+  /**
+   * @brief Play all matches, on all workers of the job system and the calling thread.
+   * @param jobs The job system.
+   * @param report Called with the totals so far about every m_reportInterval matches,
+   *               from whichever thread got there first, but never concurrently.
+   * @return The totals.
+   */
+  Statistics run(JobSystem & jobs, Report const & report = {}) const;
+
+  /**
+   * @return The deck pool.
+   */
+  std::vector<Deck> const & decks() const;
+
+private:
+  struct Lane;
+
+  void play(std::uint64_t index, Lane & lane) const;
+
+  CardDatabase const & m_cards;
+  Settings const m_settings;
+  std::vector<Deck> m_decks;
+};
+
+/**
+ * @brief Write statistics as a single line of JSON, the decks with their cards and the win rate of every card.
+ * @param out Where to write to.
+ * @param statistics What to write.
+ * @param cards The cards of the decks.
+ */
+void write_json(std::ostream & out, MatchSimulator::Statistics const & statistics, CardDatabase const & cards);
+
+#endif // OVENBRICK_MATCH_SIMULATOR_HXX
@@ -0,0 +1,466 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "mcts.hxx"
+
+namespace {
+  using clock = std::chrono::steady_clock;
+
+  constexpr std::uint32_t NO_NODE = std::numeric_limits<std::uint32_t>::max();
+  constexpr unsigned MAX_PLAYOUT_MOVES = 500; ///< Safety net, matches end after Match::MAX_TURNS anyway.
+  constexpr unsigned END_TURN_CHANCE = 10; ///< Percent, random playouts rather play cards than pass.
+  constexpr std::uint64_t CLOCK_INTERVAL = 16; ///< Playouts between looking at the clock.
+
+  /**
+   * @brief xorshift64*, small enough to live on the stack of every worker.
+   */
+  class Random final
+  {
+    std::uint64_t m_state;
+
+  public:
+    explicit Random(std::uint64_t const seed)
+        : m_state {seed ? seed : 0x2545f4914f6cdd1du}
+    {
+    }
+
+    std::uint64_t next()
+    {
+      m_state ^= m_state >> 12u;
+      m_state ^= m_state << 25u;
+      m_state ^= m_state >> 27u;
+      return m_state * 0x2545f4914f6cdd1du;
+    }
+
+    std::size_t below(std::size_t const bound)
+    {
+      return static_cast<std::size_t>((next() >> 32u) * bound >> 32u);
+    }
+  };
+
+  struct Edge final
+  {
+    Move m_move;
+    std::uint8_t m_player; ///< Who makes the move.
+    std::uint32_t m_child;
+    std::uint32_t m_visits;
+    float m_value; ///< Sum of the rewards for m_player.
+  };
+
+  struct Node final
+  {
+    std::uint32_t m_firstEdge;
+    std::uint32_t m_edgeCount;
+    std::uint32_t m_visits;
+    bool m_expanded;
+  };
+
+  /**
+   * @brief The tree of a single worker, nodes and edges live in arrays and refer to each other by index.
+   */
+  class Tree final
+  {
+  public:
+    Tree()
+        : m_maxNodes {0}, m_exploration {0.f}
+    {
+    }
+
+    /**
+     * @brief Forget all nodes, the memory is kept for the next search.
+     */
+    void reset(std::size_t const maxNodes, float const exploration)
+    {
+      m_maxNodes = maxNodes;
+      m_exploration = exploration;
+      m_nodes.clear();
+      m_edges.clear();
+      m_transpositions.clear();
+      m_nodes.reserve(maxNodes);
+      m_edges.reserve(maxNodes * 4);
+      m_transpositions.reserve(maxNodes);
+    }
+
+    /**
+     * @return The node of the position, a new one or NO_NODE if the tree is full.
+     */
+    std::uint32_t node_of(std::uint64_t const hash)
+    {
+      auto const it = m_transpositions.find(hash);
+      if (it != m_transpositions.end())
+        return it->second;
+
+      if (m_nodes.size() >= m_maxNodes)
+        return NO_NODE;
+
+      auto const index = static_cast<std::uint32_t>(m_nodes.size());
+      m_nodes.push_back(Node {0, 0, 0, false});
+      m_transpositions.emplace(hash, index);
+      return index;
+    }
+
+    void expand(std::uint32_t const node, Match const & match, MoveList & moves)
+    {
+      match.legal_moves(moves);
+      auto & n = m_nodes[node];
+      n.m_firstEdge = static_cast<std::uint32_t>(m_edges.size());
+      n.m_edgeCount = static_cast<std::uint32_t>(moves.size());
+      n.m_expanded = true;
+      auto const player = static_cast<std::uint8_t>(match.active());
+      for (auto const & move : moves)
+        m_edges.push_back(Edge {move, player, NO_NODE, 0, 0.f});
+    }
+
+    /**
+     * @return The edge to follow by UCT, untried moves first.
+     */
+    std::uint32_t select(std::uint32_t const node) const
+    {
+      auto const & n = m_nodes[node];
+      auto const logVisits = std::log(static_cast<float>(n.m_visits));
+      auto best = n.m_firstEdge;
+      auto bestScore = -std::numeric_limits<float>::infinity();
+      for (auto e = n.m_firstEdge; e < n.m_firstEdge + n.m_edgeCount; ++e)
+      {
+        auto const & edge = m_edges[e];
+        if (edge.m_visits == 0)
+          return e;
+
+        auto const visits = static_cast<float>(edge.m_visits);
+        auto const score = edge.m_value / visits + m_exploration * std::sqrt(logVisits / visits);
+        if (score > bestScore)
+        {
+          best = e;
+          bestScore = score;
+        }
+      }
+      return best;
+    }
+
+    Node & node(std::uint32_t const index)
+    {
+      return m_nodes[index];
+    }
+
+    Node const & node(std::uint32_t const index) const
+    {
+      return m_nodes[index];
+    }
+
+    Edge & edge(std::uint32_t const index)
+    {
+      return m_edges[index];
+    }
+
+    Edge const & edge(std::uint32_t const index) const
+    {
+      return m_edges[index];
+    }
+
+    std::size_t size() const
+    {
+      return m_nodes.size();
+    }
+
+  private:
+    std::size_t m_maxNodes;
+    float m_exploration;
+    std::vector<Node> m_nodes;
+    std::vector<Edge> m_edges;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_transpositions;
+  };
+
+  /**
+   * @return The reward of the first player for a finished or cut off match.
+   */
+  float reward(Match const & match)
+  {
+    switch (match.result())
+    {
+      case Match::Result::FirstWins:
+        return 1.f;
+      case Match::Result::SecondWins:
+        return 0.f;
+      case Match::Result::Draw:
+        return .5f;
+      case Match::Result::Running:
+        break;
+    }
+
+    auto const lead = match.side(0).m_health - match.side(1).m_health;
+    return std::min(std::max(.5f + .5f * static_cast<float>(lead) / Match::STARTING_HEALTH, 0.f), 1.f);
+  }
+
+  float playout(Match & match, MoveList & moves, Random & random)
+  {
+    for (unsigned n = 0; n < MAX_PLAYOUT_MOVES && !match.is_over(); ++n)
+    {
+      match.legal_moves(moves);
+      // ending the turn always is the first move
+      std::size_t index = 0;
+      if (moves.size() > 1 && random.below(100) >= END_TURN_CHANCE)
+        index = 1 + random.below(moves.size() - 1);
+      match.apply(moves[index]);
+    }
+    return reward(match);
+  }
+}
+
+struct MctsWorkspace::Impl final
+{
+  Tree m_tree;
+  MoveList m_moves;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> m_path; ///< (node, edge)
+};
+
+namespace {
+  constexpr std::uint32_t ROOT_NODE = 0;
+
+  /**
+   * @brief Grow a fresh tree below the root until the playout limit, the deadline or stop.
+   * @return The number of playouts.
+   */
+  std::uint64_t grow(Match const & root, MctsSearch::Settings const & settings, MctsWorkspace::Impl & workspace,
+                     Random & random, std::atomic<bool> const * stop, clock::time_point const deadline)
+  {
+    auto & tree = workspace.m_tree;
+    auto & moves = workspace.m_moves;
+    auto & path = workspace.m_path;
+    tree.reset(std::max<std::size_t>(settings.m_maxNodes, 1), settings.m_exploration);
+    path.reserve(64);
+
+    auto const rootNode = tree.node_of(root.hash());
+    tree.expand(rootNode, root, moves);
+
+    std::uint64_t playouts = 0;
+    while (!settings.m_maxPlayouts || playouts < settings.m_maxPlayouts)
+    {
+      if (playouts % CLOCK_INTERVAL == 0
+          && ((stop && stop->load(std::memory_order_relaxed)) || clock::now() >= deadline))
+        break;
+
+      auto match = root;
+      path.clear();
+
+      // descend through known positions until a new one is reached
+      auto node = rootNode;
+      while (!match.is_over())
+      {
+        if (!tree.node(node).m_expanded)
+          tree.expand(node, match, moves);
+
+        auto const e = tree.select(node);
+        path.emplace_back(node, e);
+        match.apply(tree.edge(e).m_move);
+
+        auto & edge = tree.edge(e);
+        if (edge.m_child == NO_NODE)
+        {
+          auto const size = tree.size();
+          edge.m_child = tree.node_of(match.hash());
+          if (edge.m_child == NO_NODE || tree.size() != size)
+            break; // a new position (or no room left), evaluated by the playout
+        }
+        node = edge.m_child;
+      }
+
+      auto const firstReward = playout(match, moves, random);
+      for (auto const & step : path)
+      {
+        auto & edge = tree.edge(step.second);
+        ++tree.node(step.first).m_visits;
+        ++edge.m_visits;
+        edge.m_value += (edge.m_player == 0) ? firstReward : 1.f - firstReward;
+      }
+      ++playouts;
+    }
+    return playouts;
+  }
+
+  std::uint64_t thread_seed(std::uint64_t const seed, Match const & match, unsigned const thread)
+  {
+    return seed ^ match.hash() ^ ((thread + 1u) * 0x9e3779b97f4a7c15u);
+  }
+}
+
+MctsWorkspace::MctsWorkspace()
+    : m_impl {new Impl {}}
+{
+}
+
+MctsWorkspace::~MctsWorkspace() = default;
+
+MctsSearch::MctsSearch(Settings const & settings)
+    : m_settings {settings}
+    , m_threads {}
+    , m_workers {}
+    , m_rootMoves {}
+    , m_start {}
+    , m_deadline {}
+    , m_stop {false}
+    , m_finished {0}
+    , m_running {false}
+    , m_statistics {}
+{
+}
+
+MctsSearch::~MctsSearch()
+{
+  cancel();
+  join();
+}
+
+void MctsSearch::start(Match const & match)
+{
+  if (m_running)
+    throw std::logic_error {"The search is already running"}; // NOLINT(cert-err60-cpp)
+  if (match.is_over())
+    throw std::logic_error {"The match is over"}; // NOLINT(cert-err60-cpp)
+
+  match.legal_moves(m_rootMoves);
+  auto const threads = (m_rootMoves.size() == 1)
+      ? 0u // nothing to think about
+      : thread_count(m_settings);
+
+  m_workers.assign(threads, Worker {std::vector<std::uint32_t>(m_rootMoves.size(), 0), 0, 0});
+  m_stop = false;
+  m_finished = 0;
+  m_running = true;
+  m_start = clock::now();
+  m_deadline = m_start + m_settings.m_budget;
+
+  m_threads.reserve(threads);
+  for (unsigned n = 0; n < threads; ++n)
+  {
+    m_threads.emplace_back(&MctsSearch::search, this, match, std::ref(m_workers[n]), thread_seed(m_settings.m_seed, match, n));
+  }
+}
+
+bool MctsSearch::is_running() const
+{
+  return m_running;
+}
+
+bool MctsSearch::is_done() const
+{
+  return m_running && m_finished.load(std::memory_order_acquire) == m_threads.size();
+}
+
+bool MctsSearch::is_forced() const
+{
+  return m_running && m_rootMoves.size() == 1;
+}
+
+void MctsSearch::cancel()
+{
+  m_stop.store(true, std::memory_order_relaxed);
+}
+
+Move MctsSearch::result()
+{
+  if (!m_running)
+    throw std::logic_error {"No search is running"}; // NOLINT(cert-err60-cpp)
+  join();
+  m_running = false;
+
+  m_statistics = Statistics {static_cast<unsigned>(m_workers.size()), 0, 0,
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start), false};
+  std::vector<std::uint64_t> visits(m_rootMoves.size(), 0);
+  auto const cancelled = m_stop.load(std::memory_order_relaxed);
+  for (auto const & worker : m_workers)
+  {
+    for (std::size_t n = 0; n < visits.size(); ++n)
+      visits[n] += worker.m_visits[n];
+    m_statistics.m_playouts += worker.m_playouts;
+    m_statistics.m_nodes += worker.m_nodes;
+    if (m_settings.m_maxPlayouts > 0 && worker.m_playouts < m_settings.m_maxPlayouts && !cancelled)
+      m_statistics.m_cutShort = true;
+  }
+
+  // the most visited move is more robust than the best average, ties keep the earlier move
+  auto const best = std::max_element(visits.begin(), visits.end()) - visits.begin();
+  return m_rootMoves[static_cast<std::size_t>(best)];
+}
+
+MctsSearch::Statistics const & MctsSearch::statistics() const
+{
+  return m_statistics;
+}
+
+MctsSearch::Settings const & MctsSearch::settings() const
+{
+  return m_settings;
+}
+
+unsigned MctsSearch::thread_count(Settings const & settings)
+{
+  return settings.m_threads ? settings.m_threads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+Move MctsSearch::run(Match const & match, Settings const & settings, MctsWorkspace & workspace)
+{
+  if (match.is_over())
+    throw std::logic_error {"The match is over"}; // NOLINT(cert-err60-cpp)
+
+  auto & impl = *workspace.m_impl;
+  match.legal_moves(impl.m_moves);
+  if (impl.m_moves.size() == 1)
+    return impl.m_moves[0]; // nothing to think about
+
+  // like the first thread of a search started at the same time
+  Random random {thread_seed(settings.m_seed, match, 0)};
+  grow(match, settings, impl, random, nullptr, clock::now() + settings.m_budget);
+
+  auto const & tree = impl.m_tree;
+  auto const & top = tree.node(ROOT_NODE);
+  auto best = top.m_firstEdge;
+  for (auto e = top.m_firstEdge + 1; e < top.m_firstEdge + top.m_edgeCount; ++e)
+  {
+    if (tree.edge(e).m_visits > tree.edge(best).m_visits)
+      best = e;
+  }
+  return tree.edge(best).m_move;
+}
+
+void MctsSearch::search(Match const & root, Worker & worker, std::uint64_t const seed)
+{
+  MctsWorkspace workspace {};
+  Random random {seed};
+  worker.m_playouts = grow(root, m_settings, *workspace.m_impl, random, &m_stop, m_deadline);
+
+  auto const & tree = workspace.m_impl->m_tree;
+  auto const & top = tree.node(ROOT_NODE);
+  for (std::uint32_t n = 0; n < top.m_edgeCount; ++n)
+    worker.m_visits[n] = tree.edge(top.m_firstEdge + n).m_visits;
+  worker.m_nodes = tree.size();
+
+  m_finished.fetch_add(1, std::memory_order_release);
+}
+
+void MctsSearch::join()
+{
+  for (auto & thread : m_threads)
+    thread.join();
+  m_threads.clear();
+}
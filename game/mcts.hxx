@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_MCTS_HXX
+#define OVENBRICK_MCTS_HXX
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "match.hxx"
+
+/**
+ * @brief The memory of a search tree, kept between searches run one after another on the same thread.
+ */
+class MctsWorkspace final : private sf::NonCopyable
+{
+public:
+  struct Impl; ///< Only known to the search.
+
+  MctsWorkspace();
+
+  ~MctsWorkspace();
+
+private:
+  friend class MctsSearch;
+
+  std::unique_ptr<Impl> m_impl;
+};
+
+/**
+ * @brief Parallel Monte-Carlo tree search for the best move of the active player.
+ *
+ * Every thread grows a tree of its own (root parallelization), so the threads never synchronize
+ * until the visits of the root moves are summed up. Positions reached by different move orders
+ * share their node through the match hash, which matters as a turn consists of many moves.
+ * The search runs on its own threads, the caller polls is_done() and collects the move with result().
+ */
+class MctsSearch final : private sf::NonCopyable
+{
+public:
+  struct Settings final
+  {
+    unsigned m_threads = 0; ///< 0 uses one thread per core.
+    std::chrono::milliseconds m_budget {1000}; ///< Thinking time per move.
+    std::uint64_t m_maxPlayouts = 0; ///< Per thread, 0 only stops at the budget.
+    std::size_t m_maxNodes = 1u << 15u; ///< Per thread, the tree stops growing afterwards.
+    float m_exploration = 0.7f; ///< UCT exploration constant.
+    std::uint64_t m_seed = 0; ///< With a playout limit, the same seed and thread count give the same moves.
+  };
+
+  struct Statistics final
+  {
+    unsigned m_threads;
+    std::uint64_t m_playouts; ///< Of all threads.
+    std::size_t m_nodes; ///< Of all threads.
+    std::chrono::nanoseconds m_elapsed;
+    bool m_cutShort; ///< The thinking time ran out before every thread reached the playout limit.
+  };
+
+  explicit MctsSearch(Settings const & settings);
+
+  /**
+   * @brief Cancels a running search and waits for its threads.
+   */
+  ~MctsSearch();
+
+  /**
+   * @brief Start searching in the background.
+   * @param match The position, which is copied, so it may change meanwhile.
+   * @throws std::logic_error If a search is still running or the match is over.
+   */
+  void start(Match const & match);
+
+  /**
+   * @return true, if a search was started and its result was not collected yet.
+   */
+  bool is_running() const;
+
+  /**
+   * @return true, if all threads finished, result() does not block then.
+   */
+  bool is_done() const;
+
+  /**
+   * @return true, if the running search has just one move to choose from and thus no threads.
+   */
+  bool is_forced() const;
+
+  /**
+   * @brief Ask the threads to stop early, result() still returns the best move found so far.
+   */
+  void cancel();
+
+  /**
+   * @brief Collect the result, waiting for the threads if necessary.
+   * @return The root move visited most often by all threads together.
+   * @throws std::logic_error If no search is running.
+   */
+  Move result();
+
+  /**
+   * @return Statistics of the last collected search.
+   */
+  Statistics const & statistics() const;
+
+  Settings const & settings() const;
+
+  /**
+   * @return The number of threads searches with the settings use, m_threads = 0 resolved to the cores of this machine.
+   */
+  static unsigned thread_count(Settings const & settings);
+
+  /**
+   * @brief Search on the calling thread alone, e.g. to play many matches side by side.
+   * @param match The position.
+   * @param settings How to search, m_threads is ignored.
+   * @param workspace Where the tree grows, reused between searches.
+   * @return The root move visited most often, the same move as a search on a single thread would pick.
+   * @throws std::logic_error If the match is over.
+   */
+  static Move run(Match const & match, Settings const & settings, MctsWorkspace & workspace);
+
+private:
+  struct Worker final
+  {
+    std::vector<std::uint32_t> m_visits; ///< Per root move.
+    std::uint64_t m_playouts;
+    std::size_t m_nodes;
+  };
+
+  void search(Match const & root, Worker & worker, std::uint64_t seed);
+  void join();
+
+  Settings const m_settings;
+  std::vector<std::thread> m_threads;
+  std::vector<Worker> m_workers;
+  MoveList m_rootMoves;
+  std::chrono::steady_clock::time_point m_start;
+  std::chrono::steady_clock::time_point m_deadline;
+  std::atomic<bool> m_stop;
+  std::atomic<unsigned> m_finished;
+  bool m_running;
+  Statistics m_statistics;
+};
+
+#endif // OVENBRICK_MCTS_HXX
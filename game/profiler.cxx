@@ -0,0 +1,235 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <limits>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <boost/core/demangle.hpp>
+#include <boost/log/trivial.hpp>
+
+#include "profiler.hxx"
+
+namespace {
+  unsigned highest_bit(std::uint64_t value)
+  {
+    unsigned bit = 0;
+    while (value >>= 1)
+      ++bit;
+    return bit;
+  }
+
+  struct NamedHistogram
+  {
+    char const * m_name;
+    LatencyHistogram const & m_histogram;
+  };
+
+  std::array<NamedHistogram, 6> histograms_of(StateProfile const & profile)
+  {
+    return {{
+        {"load", profile.m_load},
+        {"set_up", profile.m_setUp},
+        {"handle_event", profile.m_event},
+        {"update", profile.m_update},
+        {"render", profile.m_render},
+        {"tear_down", profile.m_tearDown},
+    }};
+  }
+
+  void write_json_string(std::ostream & out, std::string const & text)
+  {
+    out << '"';
+    for (auto const c : text)
+    {
+      if (c == '"' || c == '\\')
+        out << '\\';
+      out << c;
+    }
+    out << '"';
+  }
+}
+
+constexpr unsigned LatencyHistogram::SUB_BUCKET_BITS;
+constexpr unsigned LatencyHistogram::SUB_BUCKETS;
+constexpr unsigned LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram()
+    : m_count {0}, m_total {0}, m_max {0}
+{
+  for (auto & bucket : m_buckets)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::record(std::uint64_t const nanoseconds)
+{
+  m_buckets[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_total.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+  auto max = m_max.load(std::memory_order_relaxed);
+  while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed));
+}
+
+std::uint64_t LatencyHistogram::count() const
+{
+  return m_count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::total() const
+{
+  return m_total.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::max() const
+{
+  return m_max.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::percentile(double const fraction) const
+{
+  // the buckets are summed up instead of trusting count(), as recording might happen concurrently
+  std::uint64_t samples = 0;
+  for (auto const & bucket : m_buckets)
+    samples += bucket.load(std::memory_order_relaxed);
+  if (samples == 0)
+    return 0;
+
+  auto const clamped = std::min(std::max(fraction, 0.0), 1.0);
+  auto const rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(clamped * static_cast<double>(samples) + 0.5));
+
+  std::uint64_t seen = 0;
+  for (unsigned bucket = 0; bucket < BUCKETS; ++bucket)
+  {
+    seen += m_buckets[bucket].load(std::memory_order_relaxed);
+    if (seen >= rank)
+      return std::min(bucket_limit(bucket) - 1, max());
+  }
+  return max();
+}
+
+std::uint64_t LatencyHistogram::bucket_count(unsigned const bucket) const
+{
+  return m_buckets[bucket].load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::bucket_limit(unsigned const bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket + 1;
+
+  auto const shift = bucket / SUB_BUCKETS - 1;
+  auto const mantissa = std::uint64_t {SUB_BUCKETS + bucket % SUB_BUCKETS + 1};
+  if (highest_bit(mantissa) + shift >= 64)
+    return std::numeric_limits<std::uint64_t>::max();
+  return mantissa << shift;
+}
+
+unsigned LatencyHistogram::bucket_of(std::uint64_t const value)
+{
+  if (value < SUB_BUCKETS)
+    return static_cast<unsigned>(value);
+
+  auto const shift = highest_bit(value) - SUB_BUCKET_BITS;
+  auto const subBucket = static_cast<unsigned>((value >> shift) & (SUB_BUCKETS - 1));
+  return (shift + 1) * SUB_BUCKETS + subBucket;
+}
+
+StateProfile::StateProfile(std::string name)
+    : m_name {std::move(name)}
+{
+}
+
+Profiler & Profiler::instance()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+StateProfile & Profiler::profile(std::type_info const & type)
+{
+  std::lock_guard<std::mutex> lock {m_mutex};
+
+  auto & profile = m_profiles[std::type_index {type}];
+  if (!profile)
+    profile = std::make_unique<StateProfile>(boost::core::demangle(type.name()));
+  return *profile;
+}
+
+void Profiler::log() const
+{
+  std::lock_guard<std::mutex> lock {m_mutex};
+
+  for (auto const & entry : m_profiles)
+  {
+    for (auto const & named : histograms_of(*entry.second))
+    {
+      auto const & histogram = named.m_histogram;
+      if (histogram.count() == 0)
+        continue;
+
+      BOOST_LOG_TRIVIAL(info)
+        << "Profile " << entry.second->m_name << "::" << named.m_name
+        << ": calls " << histogram.count()
+        << ", p50 " << histogram.percentile(0.5) / 1000.0 << "us"
+        << ", p99 " << histogram.percentile(0.99) / 1000.0 << "us"
+        << ", max " << histogram.max() / 1000.0 << "us"
+        << ", total " << histogram.total() / 1000000.0 << "ms";
+    }
+  }
+}
+
+void Profiler::write_json(std::ostream & out) const
+{
+  std::lock_guard<std::mutex> lock {m_mutex};
+
+  out << "[";
+  auto firstState = true;
+  for (auto const & entry : m_profiles)
+  {
+    out << (firstState ? "\n" : ",\n") << "  {\"state\": ";
+    firstState = false;
+    write_json_string(out, entry.second->m_name);
+
+    for (auto const & named : histograms_of(*entry.second))
+    {
+      auto const & histogram = named.m_histogram;
+      out << ",\n   \"" << named.m_name << "\": {"
+          << "\"count\": " << histogram.count()
+          << ", \"total_ns\": " << histogram.total()
+          << ", \"p50_ns\": " << histogram.percentile(0.5)
+          << ", \"p99_ns\": " << histogram.percentile(0.99)
+          << ", \"max_ns\": " << histogram.max()
+          << ", \"buckets\": [";
+
+      auto firstBucket = true;
+      for (unsigned bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket)
+      {
+        auto const count = histogram.bucket_count(bucket);
+        if (count == 0)
+          continue;
+        out << (firstBucket ? "" : ", ") << "[" << LatencyHistogram::bucket_limit(bucket) << ", " << count << "]";
+        firstBucket = false;
+      }
+      out << "]}";
+    }
+    out << "}";
+  }
+  out << "\n]\n";
+}
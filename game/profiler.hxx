@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_PROFILER_HXX
+#define OVENBRICK_PROFILER_HXX
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+
+#include <SFML/System/NonCopyable.hpp>
+
+/**
+ * @brief Lock-free latency histogram with logarithmic buckets.
+ *
+ * Every power of two is split into SUB_BUCKETS linear buckets,
+ * so the relative error of a reported percentile is below 1 / SUB_BUCKETS.
+ * Recording is wait-free and may happen from any thread.
+ */
+class LatencyHistogram final : private sf::NonCopyable
+{
+public:
+  static constexpr unsigned SUB_BUCKET_BITS = 3;
+  static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+  static constexpr unsigned BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  LatencyHistogram();
+
+  /**
+   * @brief Add a sample.
+   * @param nanoseconds The measured latency.
+   */
+  void record(std::uint64_t nanoseconds);
+
+  /**
+   * @return The number of recorded samples.
+   */
+  std::uint64_t count() const;
+
+  /**
+   * @return The sum of all recorded samples in nanoseconds.
+   */
+  std::uint64_t total() const;
+
+  /**
+   * @return The largest recorded sample in nanoseconds.
+   */
+  std::uint64_t max() const;
+
+  /**
+   * @brief Estimate a percentile.
+   * @param fraction The percentile as a fraction (e.g. 0.99 for p99).
+   * @return The upper bound of the bucket containing the percentile, clamped to max().
+   */
+  std::uint64_t percentile(double fraction) const;
+
+  /**
+   * @return The number of samples in the given bucket.
+   */
+  std::uint64_t bucket_count(unsigned bucket) const;
+
+  /**
+   * @return The smallest value which is not part of the given bucket anymore.
+   */
+  static std::uint64_t bucket_limit(unsigned bucket);
+
+  /**
+   * @return The bucket the given value is sorted into.
+   */
+  static unsigned bucket_of(std::uint64_t value);
+
+private:
+  std::array<std::atomic<std::uint32_t>, BUCKETS> m_buckets;
+  std::atomic<std::uint64_t> m_count;
+  std::atomic<std::uint64_t> m_total;
+  std::atomic<std::uint64_t> m_max;
+};
+
+/**
+ * @brief Latencies of all lifecycle functions of one GameState type.
+ */
+struct StateProfile final
+{
+  explicit StateProfile(std::string name);
+
+  std::string const m_name;
+
+  LatencyHistogram m_load; ///< Recorded on the loading thread.
+  LatencyHistogram m_setUp;
+  LatencyHistogram m_event;
+  LatencyHistogram m_update;
+  LatencyHistogram m_render;
+  LatencyHistogram m_tearDown;
+};
+
+/**
+ * @brief Registry of per-state profiles.
+ *
+ * Looking up a profile takes a lock, so it should be done once (e.g. when a state is pushed),
+ * recording into the returned profile does not.
+ */
+class Profiler final : private sf::NonCopyable
+{
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::type_index, std::unique_ptr<StateProfile>> m_profiles;
+
+public:
+  /**
+   * @return The process wide profiler.
+   */
+  static Profiler & instance();
+
+  /**
+   * @brief Acquire the profile of a type, creating it if necessary.
+   * @param type The dynamic type of the profiled state.
+   * @return The profile, which stays valid as long as the profiler exists.
+   */
+  StateProfile & profile(std::type_info const & type);
+
+  /**
+   * @brief Write a summary line per state and lifecycle function to the log.
+   */
+  void log() const;
+
+  /**
+   * @brief Write all profiles including their non-empty buckets as JSON.
+   * @param out The output stream.
+   */
+  void write_json(std::ostream & out) const;
+};
+
+/**
+ * @brief Records the lifetime of the object into a histogram.
+ */
+class ScopedSample final : private sf::NonCopyable
+{
+  using clock = std::chrono::steady_clock;
+
+  LatencyHistogram & m_histogram;
+  clock::time_point const m_start;
+
+public:
+  explicit inline ScopedSample(LatencyHistogram & histogram)
+      : m_histogram {histogram}, m_start {clock::now()}
+  {
+  }
+
+  inline ~ScopedSample()
+  {
+    auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start);
+    m_histogram.record(static_cast<std::uint64_t>(elapsed.count()));
+  }
+};
+
+#define OVENBRICK_CONCAT_IMPL(a, b) a##b
+#define OVENBRICK_CONCAT(a, b) OVENBRICK_CONCAT_IMPL(a, b)
+
+#ifdef OVENBRICK_PROFILING
+/**
+ * @brief Measure the rest of the enclosing scope into the given histogram.
+ * @remarks Expands to nothing (not even evaluating its argument) unless OVENBRICK_PROFILING is defined.
+ */
+#define OVENBRICK_PROFILE(histogram) ScopedSample const OVENBRICK_CONCAT(ovenbrickSample, __LINE__) {histogram}
+#else
+#define OVENBRICK_PROFILE(histogram) static_cast<void>(0)
+#endif
+
+#endif // OVENBRICK_PROFILER_HXX
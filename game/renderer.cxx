@@ -0,0 +1,395 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+#include <SFML/Graphics/BlendMode.hpp>
+#include <SFML/Graphics/PrimitiveType.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/View.hpp>
+
+#include "renderer.hxx"
+#include "text_batch.hxx"
+
+namespace {
+  constexpr std::size_t VERTICES_PER_QUAD = 6;
+
+  bool same(sf::Vertex const & lhs, sf::Vertex const & rhs)
+  {
+    return lhs.position == rhs.position && lhs.color == rhs.color && lhs.texCoords == rhs.texCoords;
+  }
+
+  float area(sf::FloatRect const & rect)
+  {
+    return rect.width * rect.height;
+  }
+
+  sf::FloatRect unite(sf::FloatRect const & lhs, sf::FloatRect const & rhs)
+  {
+    auto const left = std::min(lhs.left, rhs.left);
+    auto const top = std::min(lhs.top, rhs.top);
+    auto const right = std::max(lhs.left + lhs.width, rhs.left + rhs.width);
+    auto const bottom = std::max(lhs.top + lhs.height, rhs.top + rhs.height);
+    return sf::FloatRect {left, top, right - left, bottom - top};
+  }
+
+  bool touches(sf::FloatRect const & lhs, sf::FloatRect const & rhs)
+  {
+    return lhs.left <= rhs.left + rhs.width && rhs.left <= lhs.left + lhs.width
+        && lhs.top <= rhs.top + rhs.height && rhs.top <= lhs.top + lhs.height;
+  }
+
+  /**
+   * @brief Two triangles covering a rectangle.
+   */
+  void quad(sf::Vertex * out, sf::FloatRect const & bounds, sf::FloatRect const & texture, sf::Color const & color)
+  {
+    auto const right = bounds.left + bounds.width;
+    auto const bottom = bounds.top + bounds.height;
+    auto const u1 = texture.left + texture.width;
+    auto const v1 = texture.top + texture.height;
+
+    out[0] = sf::Vertex {{bounds.left, bounds.top}, color, {texture.left, texture.top}};
+    out[1] = sf::Vertex {{right, bounds.top}, color, {u1, texture.top}};
+    out[2] = sf::Vertex {{bounds.left, bottom}, color, {texture.left, v1}};
+    out[3] = out[2];
+    out[4] = out[1];
+    out[5] = sf::Vertex {{right, bottom}, color, {u1, v1}};
+  }
+}
+
+std::size_t const Renderer::MAX_DIRTY_REGIONS;
+
+Renderer::Renderer(sf::Vector2u const size, sf::Color const background)
+    : m_size {size}
+    , m_background {background}
+    , m_canvas {}
+    , m_backdrop {}
+    , m_hasBackdrop {false}
+    , m_backdropItems {0}
+    , m_items {}
+    , m_previousItems {}
+    , m_vertices {}
+    , m_previousVertices {}
+    , m_dirty {}
+    , m_order {}
+    , m_batchVertices {}
+    , m_batches {}
+    , m_invalidated {true}
+    , m_statistics {}
+{
+  if (!m_canvas.create(size.x, size.y))
+    throw std::runtime_error {"Cannot create the canvas"}; // NOLINT(cert-err60-cpp)
+}
+
+void Renderer::draw(Sprite const & sprite)
+{
+  sf::Vertex vertices[VERTICES_PER_QUAD];
+  quad(vertices, sprite.m_bounds, sprite.m_textureRect, sprite.m_color);
+  add(vertices, VERTICES_PER_QUAD, sprite.m_texture, sprite.m_layer);
+}
+
+void Renderer::draw(TextBatch const & text, int const layer)
+{
+  // empty texts are submitted as well, so the items of the following spots keep their positions
+  auto const & vertices = text.vertices();
+  auto const count = vertices.getVertexCount();
+  add(count ? &vertices[0] : nullptr, count, &text.atlas().texture(), layer);
+}
+
+void Renderer::invalidate()
+{
+  m_invalidated = true;
+}
+
+void Renderer::capture_backdrop()
+{
+  if (!m_hasBackdrop)
+  {
+    if (!m_backdrop.create(m_size.x, m_size.y))
+      throw std::runtime_error {"Cannot create the backdrop"}; // NOLINT(cert-err60-cpp)
+    m_hasBackdrop = true;
+  }
+
+  m_order.clear();
+  for (std::uint32_t n = 0; n < m_items.size(); ++n)
+  {
+    if (m_items[n].m_count > 0)
+      m_order.push_back(n);
+  }
+  batch_ordered_items();
+
+  m_backdrop.setView(m_backdrop.getDefaultView());
+  m_backdrop.clear(m_background);
+  for (auto const & batch : m_batches)
+    m_backdrop.draw(&m_batchVertices[batch.m_first], batch.m_count, sf::Triangles, sf::RenderStates {batch.m_texture});
+  m_backdrop.display();
+
+  m_backdropItems += m_order.size();
+  m_items.clear();
+  m_vertices.clear();
+  // the backdrop sprite looks the same as before, but not what it shows
+  m_invalidated = true;
+}
+
+void Renderer::draw_backdrop()
+{
+  if (!m_hasBackdrop)
+    return;
+
+  auto const width = static_cast<float>(m_size.x);
+  auto const height = static_cast<float>(m_size.y);
+  sf::Vertex vertices[VERTICES_PER_QUAD];
+  quad(vertices, sf::FloatRect {0.f, 0.f, width, height}, sf::FloatRect {0.f, 0.f, width, height}, sf::Color::White);
+  add(vertices, VERTICES_PER_QUAD, &m_backdrop.getTexture(), std::numeric_limits<int>::min());
+}
+
+void Renderer::present(sf::RenderTarget & target)
+{
+  m_statistics = RenderStatistics {};
+  m_statistics.m_items = m_items.size();
+  m_statistics.m_backdropItems = m_backdropItems;
+  m_backdropItems = 0;
+
+  collect_dirty_regions();
+  if (!m_dirty.empty())
+    redraw();
+
+  // the canvas replaces the whole window, so blending is not needed
+  auto const width = static_cast<float>(m_size.x);
+  auto const height = static_cast<float>(m_size.y);
+  sf::Vertex screen[VERTICES_PER_QUAD];
+  quad(screen, sf::FloatRect {0.f, 0.f, width, height}, sf::FloatRect {0.f, 0.f, width, height}, sf::Color::White);
+  sf::RenderStates states {&m_canvas.getTexture()};
+  states.blendMode = sf::BlendNone;
+  target.setView(target.getDefaultView());
+  target.draw(screen, VERTICES_PER_QUAD, sf::Triangles, states);
+  ++m_statistics.m_drawCalls;
+
+  std::swap(m_items, m_previousItems);
+  std::swap(m_vertices, m_previousVertices);
+  m_items.clear();
+  m_vertices.clear();
+  m_invalidated = false;
+}
+
+RenderStatistics const & Renderer::statistics() const
+{
+  return m_statistics;
+}
+
+sf::Texture const & Renderer::canvas() const
+{
+  return m_canvas.getTexture();
+}
+
+void Renderer::add(sf::Vertex const * const vertices, std::size_t const count, sf::Texture const * const texture,
+                   int const layer)
+{
+  auto left = std::numeric_limits<float>::max();
+  auto top = std::numeric_limits<float>::max();
+  auto right = std::numeric_limits<float>::lowest();
+  auto bottom = std::numeric_limits<float>::lowest();
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    auto const & position = vertices[n].position;
+    left = std::min(left, position.x);
+    top = std::min(top, position.y);
+    right = std::max(right, position.x);
+    bottom = std::max(bottom, position.y);
+  }
+
+  auto const bounds = count ? sf::FloatRect {left, top, right - left, bottom - top} : sf::FloatRect {};
+  m_items.push_back(Item {bounds, texture, layer,
+                          static_cast<std::uint32_t>(m_vertices.size()), static_cast<std::uint32_t>(count)});
+  m_vertices.insert(m_vertices.end(), vertices, vertices + count);
+}
+
+bool Renderer::is_unchanged(std::size_t const index) const
+{
+  auto const & current = m_items[index];
+  auto const & previous = m_previousItems[index];
+  if (current.m_layer != previous.m_layer || current.m_texture != previous.m_texture
+      || current.m_count != previous.m_count)
+    return false;
+
+  auto const begin = m_vertices.begin() + current.m_first;
+  return std::equal(begin, begin + current.m_count, m_previousVertices.begin() + previous.m_first, same);
+}
+
+void Renderer::mark_dirty(sf::FloatRect const & region)
+{
+  // whole pixels, so neighbouring regions never leave gaps
+  auto const left = std::max(std::floor(region.left), 0.f);
+  auto const top = std::max(std::floor(region.top), 0.f);
+  auto const right = std::min(std::ceil(region.left + region.width), static_cast<float>(m_size.x));
+  auto const bottom = std::min(std::ceil(region.top + region.height), static_cast<float>(m_size.y));
+  if (right <= left || bottom <= top)
+    return;
+
+  sf::FloatRect dirty {left, top, right - left, bottom - top};
+  for (auto it = m_dirty.begin(); it != m_dirty.end();)
+  {
+    if (touches(*it, dirty))
+    {
+      dirty = unite(*it, dirty);
+      m_dirty.erase(it);
+      it = m_dirty.begin(); // the grown region may touch regions checked before
+    }
+    else
+      ++it;
+  }
+  m_dirty.push_back(dirty);
+
+  while (m_dirty.size() > MAX_DIRTY_REGIONS)
+  {
+    // merge the pair wasting the fewest pixels
+    std::size_t first = 0;
+    std::size_t second = 1;
+    auto leastWaste = std::numeric_limits<float>::max();
+    for (std::size_t i = 0; i < m_dirty.size(); ++i)
+    {
+      for (std::size_t j = i + 1; j < m_dirty.size(); ++j)
+      {
+        auto const waste = area(unite(m_dirty[i], m_dirty[j])) - area(m_dirty[i]) - area(m_dirty[j]);
+        if (waste < leastWaste)
+        {
+          first = i;
+          second = j;
+          leastWaste = waste;
+        }
+      }
+    }
+
+    auto const merged = unite(m_dirty[first], m_dirty[second]);
+    m_dirty.erase(m_dirty.begin() + static_cast<std::ptrdiff_t>(second));
+    m_dirty.erase(m_dirty.begin() + static_cast<std::ptrdiff_t>(first));
+    mark_dirty(merged);
+  }
+}
+
+void Renderer::collect_dirty_regions()
+{
+  m_dirty.clear();
+  sf::FloatRect const screen {0.f, 0.f, static_cast<float>(m_size.x), static_cast<float>(m_size.y)};
+  if (m_invalidated)
+  {
+    m_dirty.push_back(screen);
+    return;
+  }
+
+  auto const common = std::min(m_items.size(), m_previousItems.size());
+  for (std::size_t n = 0; n < common; ++n)
+  {
+    if (!is_unchanged(n))
+    {
+      mark_dirty(m_previousItems[n].m_bounds);
+      mark_dirty(m_items[n].m_bounds);
+    }
+  }
+  for (auto n = common; n < m_items.size(); ++n)
+    mark_dirty(m_items[n].m_bounds);
+  for (auto n = common; n < m_previousItems.size(); ++n)
+    mark_dirty(m_previousItems[n].m_bounds);
+
+  // beyond half the screen, a single region is cheaper than drawing the overlapping batches repeatedly
+  float dirtyArea = 0.f;
+  for (auto const & region : m_dirty)
+    dirtyArea += area(region);
+  if (m_dirty.size() > 1 && dirtyArea * 2.f > area(screen))
+  {
+    m_dirty.clear();
+    m_dirty.push_back(screen);
+  }
+}
+
+void Renderer::batch_ordered_items()
+{
+  // the submission order breaks ties, std::stable_sort would allocate every frame
+  std::sort(m_order.begin(), m_order.end(), [this](std::uint32_t const lhs, std::uint32_t const rhs) {
+    auto const & l = m_items[lhs];
+    auto const & r = m_items[rhs];
+    if (l.m_layer != r.m_layer)
+      return l.m_layer < r.m_layer;
+    if (l.m_texture != r.m_texture)
+      return std::less<sf::Texture const *> {}(l.m_texture, r.m_texture);
+    return lhs < rhs;
+  });
+
+  m_batchVertices.clear();
+  m_batches.clear();
+  for (auto const index : m_order)
+  {
+    auto const & item = m_items[index];
+    if (m_batches.empty() || m_batches.back().m_texture != item.m_texture)
+      m_batches.push_back(Batch {item.m_texture, static_cast<std::uint32_t>(m_batchVertices.size()), 0});
+    m_batchVertices.insert(m_batchVertices.end(), m_vertices.begin() + item.m_first,
+                           m_vertices.begin() + item.m_first + item.m_count);
+    m_batches.back().m_count += item.m_count;
+  }
+}
+
+void Renderer::redraw()
+{
+  m_order.clear();
+  for (std::uint32_t n = 0; n < m_items.size(); ++n)
+  {
+    auto const & bounds = m_items[n].m_bounds;
+    if (m_items[n].m_count > 0 && std::any_of(m_dirty.begin(), m_dirty.end(), [&bounds](sf::FloatRect const & region) {
+      return touches(region, bounds);
+    }))
+      m_order.push_back(n);
+  }
+  batch_ordered_items();
+
+  auto const width = static_cast<float>(m_size.x);
+  auto const height = static_cast<float>(m_size.y);
+  for (auto const & region : m_dirty)
+  {
+    // the viewport clips everything to the region
+    sf::View view {region};
+    view.setViewport(sf::FloatRect {region.left / width, region.top / height, region.width / width,
+                                    region.height / height});
+    m_canvas.setView(view);
+
+    sf::Vertex background[VERTICES_PER_QUAD];
+    quad(background, region, sf::FloatRect {}, m_background);
+    sf::RenderStates clear {};
+    clear.blendMode = sf::BlendNone;
+    m_canvas.draw(background, VERTICES_PER_QUAD, sf::Triangles, clear);
+    ++m_statistics.m_drawCalls;
+
+    for (auto const & batch : m_batches)
+    {
+      m_canvas.draw(&m_batchVertices[batch.m_first], batch.m_count, sf::Triangles, sf::RenderStates {batch.m_texture});
+      ++m_statistics.m_drawCalls;
+    }
+
+    m_statistics.m_redrawnPixels += static_cast<std::uint64_t>(area(region));
+  }
+  m_canvas.display();
+
+  m_statistics.m_redrawnItems = m_order.size();
+  m_statistics.m_batches = m_batches.size();
+  m_statistics.m_dirtyRegions = m_dirty.size();
+}
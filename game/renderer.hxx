@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_RENDERER_HXX
+#define OVENBRICK_RENDERER_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Vector2.hpp>
+
+namespace sf {
+  class RenderTarget;
+
+  class Texture;
+}
+
+class TextBatch;
+
+/**
+ * @brief A rectangle on screen, showing a part of a texture or just a color.
+ */
+struct Sprite final
+{
+  sf::FloatRect m_bounds; ///< On screen.
+  sf::FloatRect m_textureRect; ///< In texture pixels, ignored without a texture.
+  sf::Texture const * m_texture = nullptr;
+  sf::Color m_color = sf::Color::White; ///< Multiplied with the texture.
+  int m_layer = 0; ///< Higher layers are drawn on top.
+};
+
+/**
+ * @brief What the last presented frame cost.
+ */
+struct RenderStatistics final
+{
+  std::size_t m_items = 0; ///< Sprites and texts submitted.
+  std::size_t m_redrawnItems = 0;
+  std::size_t m_batches = 0;
+  std::size_t m_drawCalls = 0; ///< Including clearing the dirty regions and presenting the canvas.
+  std::size_t m_dirtyRegions = 0;
+  std::uint64_t m_redrawnPixels = 0;
+  std::size_t m_backdropItems = 0; ///< Drawn into the backdrop since the previous frame.
+};
+
+/**
+ * @brief Collects the draw commands of the game states and draws them in batches.
+ *
+ * Game states submit everything they show every frame.
+ * Submissions are compared with those of the previous frame, only the regions which changed are drawn again
+ * into an offscreen canvas, which is then presented as a single quad.
+ * A mostly static card table thus costs little more than presenting the canvas.
+ *
+ * Within the dirty regions, items are sorted by layer and texture and drawn with one call per texture run.
+ * The order of items on the same layer is only kept for items sharing a texture,
+ * overlapping items with different textures belong on different layers.
+ *
+ * What lies beneath an overlay can be drawn once into a backdrop, which is then submitted as a single sprite
+ * behind everything else, until it is captured again.
+ */
+class Renderer final : private sf::NonCopyable
+{
+public:
+  static constexpr std::size_t MAX_DIRTY_REGIONS = 4; ///< More are merged, which may redraw a bit more.
+
+  /**
+   * @param size The size of the screen in pixels.
+   * @param background The color behind everything.
+   * @throws std::runtime_error If the canvas cannot be created.
+   */
+  explicit Renderer(sf::Vector2u size, sf::Color background = sf::Color::Black);
+
+  /**
+   * @brief Submit a sprite for the current frame.
+   */
+  void draw(Sprite const & sprite);
+
+  /**
+   * @brief Submit a text for the current frame, drawn with the texture of its atlas.
+   * @param text The text.
+   * @param layer Higher layers are drawn on top.
+   */
+  void draw(TextBatch const & text, int layer = 0);
+
+  /**
+   * @brief Redraw everything in the next frame, e.g. after the window lost its contents.
+   */
+  void invalidate();
+
+  /**
+   * @brief Draw everything submitted so far in this frame into the backdrop, instead of the frame itself.
+   * @throws std::runtime_error If the backdrop cannot be created.
+   * @remarks The whole screen is drawn again in the next frame, since the backdrop changed.
+   */
+  void capture_backdrop();
+
+  /**
+   * @brief Submit the last captured backdrop for the current frame, behind everything else.
+   */
+  void draw_backdrop();
+
+  /**
+   * @brief Bring the submitted frame to the screen and start the next one.
+   * @param target Usually the window.
+   */
+  void present(sf::RenderTarget & target);
+
+  /**
+   * @return The statistics of the last presented frame.
+   */
+  RenderStatistics const & statistics() const;
+
+  /**
+   * @return The canvas holding the last presented frame.
+   */
+  sf::Texture const & canvas() const;
+
+private:
+  struct Item final
+  {
+    sf::FloatRect m_bounds;
+    sf::Texture const * m_texture;
+    int m_layer;
+    std::uint32_t m_first; ///< Of the vertices.
+    std::uint32_t m_count;
+  };
+
+  struct Batch final
+  {
+    sf::Texture const * m_texture;
+    std::uint32_t m_first;
+    std::uint32_t m_count;
+  };
+
+  void add(sf::Vertex const * vertices, std::size_t count, sf::Texture const * texture, int layer);
+  bool is_unchanged(std::size_t index) const;
+  void mark_dirty(sf::FloatRect const & region);
+  void collect_dirty_regions();
+  void batch_ordered_items();
+  void redraw();
+
+  sf::Vector2u const m_size;
+  sf::Color const m_background;
+  sf::RenderTexture m_canvas;
+  sf::RenderTexture m_backdrop; ///< Created by the first capture.
+  bool m_hasBackdrop;
+  std::size_t m_backdropItems;
+  std::vector<Item> m_items;
+  std::vector<Item> m_previousItems;
+  std::vector<sf::Vertex> m_vertices;
+  std::vector<sf::Vertex> m_previousVertices;
+  std::vector<sf::FloatRect> m_dirty;
+  std::vector<std::uint32_t> m_order;
+  std::vector<sf::Vertex> m_batchVertices;
+  std::vector<Batch> m_batches;
+  bool m_invalidated;
+  RenderStatistics m_statistics;
+};
+
+#endif // OVENBRICK_RENDERER_HXX
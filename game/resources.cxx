@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdexcept>
+
+#include "resources.hxx"
+
+Resources::Resources(std::string const & filename, std::size_t const budget)
+    : m_pack {filename}, m_budget {budget}, m_cachedBytes {0}
+{
+}
+
+Asset Resources::get(std::string const & name)
+{
+  auto const entry = m_pack.find(name);
+  if (entry == nullptr)
+    throw std::out_of_range {"Unknown asset: " + name}; // NOLINT(cert-err60-cpp)
+
+  if (entry->m_compression == AssetPack::Compression::Stored)
+    return m_pack.read(*entry);
+
+  {
+    std::lock_guard<std::mutex> lock {m_mutex};
+    auto const it = m_cache.find(entry);
+    if (it != m_cache.end())
+    {
+      m_recency.splice(m_recency.begin(), m_recency, it->second.m_position);
+      return it->second.m_asset;
+    }
+  }
+
+  // inflate without holding the lock, so other threads are not stalled by it
+  auto asset = m_pack.read(*entry);
+
+  std::lock_guard<std::mutex> lock {m_mutex};
+  auto const it = m_cache.find(entry);
+  if (it != m_cache.end())
+  {
+    // someone else was faster
+    m_recency.splice(m_recency.begin(), m_recency, it->second.m_position);
+    return it->second.m_asset;
+  }
+
+  insert(entry, asset);
+  return asset;
+}
+
+std::size_t Resources::cached_bytes() const
+{
+  std::lock_guard<std::mutex> lock {m_mutex};
+  return m_cachedBytes;
+}
+
+std::size_t Resources::budget() const
+{
+  return m_budget;
+}
+
+AssetPack const & Resources::pack() const
+{
+  return m_pack;
+}
+
+void Resources::insert(AssetPack::Entry const * entry, Asset const & asset)
+{
+  if (asset.size() > m_budget)
+    return;
+
+  while (m_cachedBytes + asset.size() > m_budget)
+  {
+    auto const evicted = m_cache.find(m_recency.back());
+    m_cachedBytes -= evicted->second.m_asset.size();
+    m_cache.erase(evicted);
+    m_recency.pop_back();
+  }
+
+  m_recency.push_front(entry);
+  m_cache.emplace(entry, Cached {asset, m_recency.begin()});
+  m_cachedBytes += asset.size();
+}
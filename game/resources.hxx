@@ -14,11 +14,81 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+
 #ifndef OVENBRICK_RESOURCES_HXX
 #define OVENBRICK_RESOURCES_HXX
 
-#include <incbin.h>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "asset_pack.hxx"
+
+/**
+ * @brief Lazily decoded assets of an asset pack.
+ *
+ * Decoded (inflated) entries are kept in a least recently used cache, which is trimmed to the memory budget.
+ * Stored entries point into the mapping and never count against the budget.
+ * Assets handed out stay valid after eviction for as long as they are referenced.
+ * May be used from any thread, e.g. while preloading game states.
+ */
+class Resources final : private sf::NonCopyable
+{
+public:
+  /**
+   * @brief Map an asset pack.
+   * @param filename The path of the pack.
+   * @param budget The maximum number of bytes kept in the cache.
+   * @throws std::runtime_error If the pack cannot be opened.
+   */
+  Resources(std::string const & filename, std::size_t budget);
+
+  /**
+   * @brief Acquire an asset, decoding it on a cache miss.
+   * @param name The name of the asset in the pack.
+   * @return The asset.
+   * @throws std::out_of_range If there is no such asset.
+   * @throws std::runtime_error If the asset cannot be decoded.
+   */
+  Asset get(std::string const & name);
+
+  /**
+   * @return The number of decoded bytes currently held by the cache.
+   */
+  std::size_t cached_bytes() const;
+
+  /**
+   * @return The maximum number of bytes kept in the cache.
+   */
+  std::size_t budget() const;
+
+  /**
+   * @return The underlying pack.
+   */
+  AssetPack const & pack() const;
+
+private:
+  using Recency = std::list<AssetPack::Entry const *>;
+
+  struct Cached final
+  {
+    Asset m_asset;
+    Recency::iterator m_position;
+  };
+
+  void insert(AssetPack::Entry const * entry, Asset const & asset); ///< Requires the lock to be held.
+
+  AssetPack const m_pack;
+  std::size_t const m_budget;
 
-INCBIN_EXTERN(FiraCode);
+  mutable std::mutex m_mutex;
+  std::unordered_map<AssetPack::Entry const *, Cached> m_cache;
+  Recency m_recency; ///< Most recently used first.
+  std::size_t m_cachedBytes;
+};
 
 #endif // OVENBRICK_RESOURCES_HXX
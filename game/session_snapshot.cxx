@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <type_traits>
+
+#include <boost/log/trivial.hpp>
+
+#include "game_state_manager.hxx"
+#include "session_snapshot.hxx"
+
+namespace {
+  static_assert(std::is_standard_layout<SessionSnapshot::Entry>::value && sizeof(SessionSnapshot::Entry) == 24,
+                "unexpected entry layout");
+}
+
+char const SessionSnapshot::MAGIC[4] = {'O', 'B', 'S', 'S'};
+std::uint32_t const SessionSnapshot::VERSION;
+
+void write_session_snapshot(std::ostream & out, std::vector<SnapshotSource> const & states)
+{
+  std::vector<SessionSnapshot::Entry> entries(states.size());
+  std::vector<IndexedFileItem> items(states.size());
+  for (std::size_t n = 0; n < states.size(); ++n)
+  {
+    entries[n].m_size = states[n].m_data.size();
+    items[n] = IndexedFileItem {&states[n].m_type, &states[n].m_data};
+  }
+
+  write_indexed_file(out, SessionSnapshot::MAGIC, SessionSnapshot::VERSION, entries, items);
+}
+
+void save_session(GameStateManager const & gsm, std::string const & filename)
+{
+  // the states still loading would be missing, or the snapshot removed while it is being resumed
+  if (filename.empty() || gsm.is_loading())
+    return;
+
+  auto const start = std::chrono::steady_clock::now();
+  auto const temporary = filename + ".tmp";
+  std::size_t states = 0;
+  {
+    std::ofstream out {temporary, std::ios::binary | std::ios::trunc};
+    states = gsm.save(out);
+    if (!out.flush())
+    {
+      BOOST_LOG_TRIVIAL(error) << "Cannot save the session to " << temporary;
+      states = 0;
+    }
+  }
+
+  if (states == 0)
+  {
+    std::remove(temporary.c_str());
+    std::remove(filename.c_str());
+    return;
+  }
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+  {
+    BOOST_LOG_TRIVIAL(error) << "Cannot replace " << filename;
+    return;
+  }
+
+  BOOST_LOG_TRIVIAL(info)
+    << "Saved " << states << " states to " << filename << " in "
+    << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+    << "us";
+}
+
+SessionSnapshot::SessionSnapshot(std::string const & filename)
+    : m_file {filename, "session snapshot", MAGIC, VERSION, sizeof(Entry)}, m_entries {m_file.checked_index<Entry>()}
+{
+}
+
+SessionSnapshot::~SessionSnapshot() = default;
+
+std::size_t SessionSnapshot::size() const
+{
+  return m_file.size();
+}
+
+std::string SessionSnapshot::type(std::size_t const index) const
+{
+  auto const & entry = m_entries[index];
+  return std::string {m_file.data() + entry.m_nameOffset, entry.m_nameLength};
+}
+
+Asset SessionSnapshot::data(std::size_t const index) const
+{
+  auto const & entry = m_entries[index];
+  return Asset {m_file.owner(), m_file.data() + entry.m_offset, static_cast<std::size_t>(entry.m_size)};
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_SESSION_SNAPSHOT_HXX
+#define OVENBRICK_SESSION_SNAPSHOT_HXX
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+#include "asset_pack.hxx"
+#include "indexed_file.hxx"
+
+class GameStateManager;
+
+/**
+ * @brief A game state to be written into a snapshot.
+ */
+struct SnapshotSource final
+{
+  std::string m_type; ///< Tells the next session which state to create.
+  std::vector<char> m_data; ///< What GameState::save() wrote.
+};
+
+/**
+ * @brief Write a session snapshot.
+ * @param out The binary output stream.
+ * @param states The game states from the bottom of the stack to the top.
+ */
+void write_session_snapshot(std::ostream & out, std::vector<SnapshotSource> const & states);
+
+/**
+ * @brief Write the states into the snapshot, or remove the snapshot if the top state cannot be resumed.
+ * @param gsm The states to save.
+ * @param filename The path of the snapshot, empty neither saves nor removes anything.
+ * @remarks The snapshot is replaced in one go, a crash while saving keeps the previous one.
+ *          While states are still being preloaded, e.g. those of a resumed session, the snapshot is left as it is.
+ */
+void save_session(GameStateManager const & gsm, std::string const & filename);
+
+/**
+ * @brief Memory-mapped snapshot of the game state stack, to resume a session where it was left.
+ *
+ * An IndexedFile with one entry per state from the bottom of the stack to the top, named by the type.
+ * The states read their data right from the mapping.
+ */
+class SessionSnapshot final : private sf::NonCopyable
+{
+public:
+  static char const MAGIC[4];
+  static std::uint32_t const VERSION = 2; ///< 2: matches written field by field, states saved by type key.
+
+  /**
+   * @brief An entry of the index, exactly as stored in the snapshot.
+   */
+  struct Entry final
+  {
+    std::uint64_t m_offset; ///< Of the data, from the start of the snapshot.
+    std::uint64_t m_size;
+    std::uint32_t m_nameOffset; ///< Of the type name, from the start of the snapshot.
+    std::uint32_t m_nameLength;
+
+    inline std::uint64_t stored_size() const
+    {
+      return m_size;
+    }
+  };
+
+  /**
+   * @brief Map a snapshot.
+   * @param filename The path of the snapshot.
+   * @throws std::runtime_error If the file cannot be mapped or is no valid snapshot of this version.
+   */
+  explicit SessionSnapshot(std::string const & filename);
+
+  ~SessionSnapshot();
+
+  /**
+   * @return The number of states.
+   */
+  std::size_t size() const;
+
+  /**
+   * @param index The position of the state on the stack, 0 is the bottom.
+   * @return The type name of the state.
+   */
+  std::string type(std::size_t index) const;
+
+  /**
+   * @param index The position of the state on the stack, 0 is the bottom.
+   * @return The data of the state, pointing right into the mapping.
+   */
+  Asset data(std::size_t index) const;
+
+private:
+  IndexedFile m_file;
+  Entry const * m_entries;
+};
+
+#endif // OVENBRICK_SESSION_SNAPSHOT_HXX
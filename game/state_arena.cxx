@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "state_arena.hxx"
+
+constexpr std::size_t StateArena::FIRST_BLOCK;
+constexpr std::size_t StateArena::MAX_BLOCK;
+
+StateArena::StateArena()
+    : m_blocks {}
+    , m_top {nullptr}
+    , m_end {nullptr}
+    , m_last {nullptr}
+    , m_used {0}
+    , m_highWaterMark {0}
+    , m_reserved {0}
+{
+}
+
+StateArena::~StateArena()
+{
+  release();
+}
+
+void * StateArena::allocate(std::size_t const bytes, std::size_t const alignment)
+{
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+  auto const padding = [alignment](char const * top) {
+    return static_cast<std::size_t>(-reinterpret_cast<std::uintptr_t>(top) & (alignment - 1));
+  };
+
+  if (!m_top || padding(m_top) > static_cast<std::size_t>(m_end - m_top)
+      || bytes > static_cast<std::size_t>(m_end - m_top) - padding(m_top))
+  {
+    auto size = m_blocks.empty() ? FIRST_BLOCK : std::min(m_blocks.back().m_size * 2, MAX_BLOCK);
+    if (bytes > std::numeric_limits<std::size_t>::max() - alignment)
+      throw std::bad_alloc {}; // NOLINT(cert-err60-cpp)
+    size = std::max(size, bytes + alignment);
+
+    if (m_blocks.size() == m_blocks.capacity())
+      m_blocks.reserve(std::max<std::size_t>(m_blocks.size() * 2, 8));
+    auto const data = static_cast<char *>(::operator new(size));
+    m_blocks.push_back(Block {data, size});
+    m_reserved += size;
+    // whatever was left in the previous block counts as used
+    m_used += static_cast<std::size_t>(m_end - m_top);
+    m_top = data;
+    m_end = data + size;
+  }
+
+  auto const skip = padding(m_top);
+  m_last = m_top + skip;
+  m_top = m_last + bytes;
+  m_used += skip + bytes;
+  m_highWaterMark = std::max(m_highWaterMark, m_used);
+  return m_last;
+}
+
+void StateArena::deallocate(void * const pointer, std::size_t const bytes) noexcept
+{
+  if (pointer && pointer == m_last && m_last + bytes == m_top)
+  {
+    m_top = m_last;
+    m_used -= bytes;
+    m_last = nullptr;
+  }
+}
+
+void StateArena::release() noexcept
+{
+  for (auto const & block : m_blocks)
+    ::operator delete(block.m_data);
+  m_blocks.clear();
+  m_top = m_end = m_last = nullptr;
+  m_used = 0;
+  m_highWaterMark = 0;
+  m_reserved = 0;
+}
+
+std::size_t StateArena::used() const
+{
+  return m_used;
+}
+
+std::size_t StateArena::high_water_mark() const
+{
+  return m_highWaterMark;
+}
+
+std::size_t StateArena::reserved() const
+{
+  return m_reserved;
+}
+
+std::size_t StateArena::blocks() const
+{
+  return m_blocks.size();
+}
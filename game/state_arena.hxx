@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_STATE_ARENA_HXX
+#define OVENBRICK_STATE_ARENA_HXX
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include <SFML/System/NonCopyable.hpp>
+
+/**
+ * @brief Monotonic memory of a single game state, released all at once when the state is popped.
+ *
+ * Memory comes in blocks of growing size from the global heap, allocations only move a pointer
+ * and deallocations are ignored, except for the most recent one.
+ * A growing vector allocates its new buffer before it frees the old one, so the old buffers stay used
+ * until release(); containers should reserve() what they need up front.
+ * Keeping what a state allocates in a few large blocks, instead of scattered over the heap,
+ * keeps long sessions from fragmenting the memory.
+ * Not thread safe, load() and the main thread never use it at the same time.
+ */
+class StateArena final : private sf::NonCopyable
+{
+public:
+  static constexpr std::size_t FIRST_BLOCK = 4 * 1024; ///< Bytes, every further block is twice as large.
+  static constexpr std::size_t MAX_BLOCK = 1024 * 1024; ///< Bytes, larger allocations get a block of their own.
+
+  StateArena();
+
+  ~StateArena();
+
+  /**
+   * @param bytes The size of the allocation.
+   * @param alignment A power of two.
+   * @return Memory valid until release().
+   * @throws std::bad_alloc If the heap is exhausted.
+   */
+  void * allocate(std::size_t bytes, std::size_t alignment);
+
+  /**
+   * @brief Give memory back, which only takes effect for the most recent allocation.
+   * @param pointer What allocate() returned.
+   * @param bytes The size passed to allocate().
+   */
+  void deallocate(void * pointer, std::size_t bytes) noexcept;
+
+  /**
+   * @brief Return all blocks to the heap.
+   * @remarks Everything allocated from the arena must be gone by then, the high-water mark starts over.
+   */
+  void release() noexcept;
+
+  /**
+   * @return The bytes allocated since the last release(), including alignment padding.
+   */
+  std::size_t used() const;
+
+  /**
+   * @return The most bytes in use at the same time since the last release().
+   */
+  std::size_t high_water_mark() const;
+
+  /**
+   * @return The bytes taken from the heap.
+   */
+  std::size_t reserved() const;
+
+  /**
+   * @return The number of blocks taken from the heap.
+   */
+  std::size_t blocks() const;
+
+private:
+  struct Block final
+  {
+    char * m_data;
+    std::size_t m_size;
+  };
+
+  std::vector<Block> m_blocks;
+  char * m_top; ///< Next free byte in the last block.
+  char * m_end; ///< End of the last block.
+  char * m_last; ///< The most recent allocation.
+  std::size_t m_used;
+  std::size_t m_highWaterMark;
+  std::size_t m_reserved;
+};
+
+/**
+ * @brief Lets standard containers allocate from a StateArena.
+ * @remarks Not final, the containers derive from their allocators.
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(StateArena & arena) noexcept
+      : m_arena {&arena}
+  {
+  }
+
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const & other) noexcept // NOLINT(google-explicit-constructor)
+      : m_arena {other.m_arena}
+  {
+  }
+
+  T * allocate(std::size_t const count)
+  {
+    if (count > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_alloc {}; // NOLINT(cert-err60-cpp)
+    return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T * const pointer, std::size_t const count) noexcept
+  {
+    m_arena->deallocate(pointer, count * sizeof(T));
+  }
+
+  StateArena & arena() const
+  {
+    return *m_arena;
+  }
+
+private:
+  template <typename U>
+  friend class ArenaAllocator;
+
+  StateArena * m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(ArenaAllocator<T> const & lhs, ArenaAllocator<U> const & rhs)
+{
+  return &lhs.arena() == &rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(ArenaAllocator<T> const & lhs, ArenaAllocator<U> const & rhs)
+{
+  return !(lhs == rhs);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // OVENBRICK_STATE_ARENA_HXX
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdexcept>
+#include <string>
+
+#include <SFML/Graphics/RenderTarget.hpp>
+
+#include "text_batch.hxx"
+
+namespace {
+  constexpr std::size_t VERTICES_PER_GLYPH = 6;
+}
+
+TextBatch::TextBatch(GlyphAtlas const & atlas)
+    : m_atlas {atlas}, m_vertices {sf::Triangles}
+{
+}
+
+sf::Vector2f TextBatch::add(sf::String const & text, sf::Vector2f const position, unsigned const pixelSize,
+                            sf::Color const & color)
+{
+  auto const face = m_atlas.face(pixelSize);
+  if (face == nullptr)
+    throw std::out_of_range {"No glyphs baked at " + std::to_string(pixelSize) + "px"}; // NOLINT(cert-err60-cpp)
+
+  auto const fallback = m_atlas.glyph(*face, '?');
+  auto pen = position;
+  for (auto const codepoint : text)
+  {
+    if (codepoint == '\n')
+    {
+      pen.x = position.x;
+      pen.y += static_cast<float>(face->m_lineSpacing);
+      continue;
+    }
+
+    auto glyph = m_atlas.glyph(*face, codepoint);
+    if (glyph == nullptr)
+      glyph = fallback;
+    if (glyph == nullptr)
+      continue;
+
+    if (glyph->m_width > 0 && glyph->m_height > 0)
+    {
+      auto const left = pen.x + static_cast<float>(glyph->m_left);
+      auto const top = pen.y + static_cast<float>(face->m_ascent - glyph->m_top);
+      auto const right = left + static_cast<float>(glyph->m_width);
+      auto const bottom = top + static_cast<float>(glyph->m_height);
+
+      auto const u0 = static_cast<float>(glyph->m_x);
+      auto const v0 = static_cast<float>(glyph->m_y);
+      auto const u1 = u0 + static_cast<float>(glyph->m_width);
+      auto const v1 = v0 + static_cast<float>(glyph->m_height);
+
+      sf::Vertex const topLeft {{left, top}, color, {u0, v0}};
+      sf::Vertex const topRight {{right, top}, color, {u1, v0}};
+      sf::Vertex const bottomLeft {{left, bottom}, color, {u0, v1}};
+      sf::Vertex const bottomRight {{right, bottom}, color, {u1, v1}};
+
+      m_vertices.append(topLeft);
+      m_vertices.append(topRight);
+      m_vertices.append(bottomLeft);
+      m_vertices.append(bottomLeft);
+      m_vertices.append(topRight);
+      m_vertices.append(bottomRight);
+    }
+
+    pen.x += static_cast<float>(glyph->m_advance);
+  }
+
+  return pen;
+}
+
+void TextBatch::clear()
+{
+  // sf::VertexArray::clear keeps the capacity of its vector
+  m_vertices.clear();
+}
+
+std::size_t TextBatch::glyph_count() const
+{
+  return m_vertices.getVertexCount() / VERTICES_PER_GLYPH;
+}
+
+sf::VertexArray const & TextBatch::vertices() const
+{
+  return m_vertices;
+}
+
+GlyphAtlas const & TextBatch::atlas() const
+{
+  return m_atlas;
+}
+
+void TextBatch::draw(sf::RenderTarget & target, sf::RenderStates states) const
+{
+  states.texture = &m_atlas.texture();
+  target.draw(m_vertices, states);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef OVENBRICK_TEXT_BATCH_HXX
+#define OVENBRICK_TEXT_BATCH_HXX
+
+#include <cstddef>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
+#include <SFML/System/String.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "glyph_atlas.hxx"
+
+/**
+ * @brief Collects text drawn from a GlyphAtlas, so all of it is drawn in a single call.
+ *
+ * Characters missing from the atlas are drawn as '?' (or skipped, if that is missing as well).
+ */
+class TextBatch final : public sf::Drawable
+{
+  GlyphAtlas const & m_atlas;
+  sf::VertexArray m_vertices;
+
+public:
+  explicit TextBatch(GlyphAtlas const & atlas);
+
+  /**
+   * @brief Add a (possibly multi-line) text.
+   * @param text The text.
+   * @param position The top left corner of the first line.
+   * @param pixelSize One of the sizes baked into the atlas.
+   * @param color The color of the text.
+   * @return The pen position after the last character, i.e. where the next text on that line would go.
+   * @throws std::out_of_range If the size was not baked into the atlas.
+   */
+  sf::Vector2f add(sf::String const & text, sf::Vector2f position, unsigned pixelSize,
+                   sf::Color const & color = sf::Color::White);
+
+  /**
+   * @brief Remove all texts, keeping the memory for the next frame.
+   */
+  void clear();
+
+  /**
+   * @return The number of glyphs which will be drawn.
+   */
+  std::size_t glyph_count() const;
+
+  /**
+   * @return The triangles of all glyphs, with texture coordinates in atlas pixels.
+   */
+  sf::VertexArray const & vertices() const;
+
+  /**
+   * @return The atlas the glyphs are taken from.
+   */
+  GlyphAtlas const & atlas() const;
+
+private:
+  void draw(sf::RenderTarget & target, sf::RenderStates states) const override;
+};
+
+#endif // OVENBRICK_TEXT_BATCH_HXX
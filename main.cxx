@@ -14,64 +14,117 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <SFML/Graphics/RenderWindow.hpp>
+
 #include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+#include <SFML/System/Time.hpp>
 
 #include <SFML/Window/Event.hpp>
-#include <SFML/Window/Window.hpp>
 #include <SFML/Window/WindowStyle.hpp>
 #include <SFML/Window/VideoMode.hpp>
 
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/log/utility/setup/file.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <iostream>
-#include <unordered_map>
+#include <memory>
+#include <random>
+#include <string>
 
 #include <ddic.hxx>
 
+#include "game/async_log.hxx"
 #include "game/game_state_manager.hxx"
 #include "game/game_state.hxx"
 #include "game/dummy_game_state.hxx"
+#include "game/frame_scheduler.hxx"
+#include "game/input_actions.hxx"
+#include "game/input_trace.hxx"
+#include "game/job_system.hxx"
 #include "game/keyboard_layout.hxx"
+#include "game/match_game_state.hxx"
+#include "game/profiler.hxx"
+#include "game/renderer.hxx"
+#include "game/resources.hxx"
+#include "game/session_snapshot.hxx"
 
 namespace logging = boost::log;
 namespace po = boost::program_options;
 
-void init_logging(logging::trivial::severity_level minimum_level, std::string const & filename)
+/**
+ * @brief How often pending events are checked while waiting for a timed wakeup.
+ * @remarks SFML cannot wait for events with a timeout, this bounds the added input latency.
+ */
+sf::Time const IDLE_POLL_INTERVAL = sf::milliseconds(4);
+
+void init_logging(
+    logging::trivial::severity_level minimum_level, std::string const & filename,
+    bool asynchronous, AsyncLog::Settings const & async
+)
 {
-  logging::add_file_log(filename);
+  if (asynchronous)
+  {
+    std::unique_ptr<std::ostream> file {new std::ofstream {filename, std::ios::trunc}};
+    auto const backend = boost::make_shared<AsyncLogBackend>(std::make_shared<AsyncLog>(std::move(file), async));
+    logging::core::get()->add_sink(boost::make_shared<logging::sinks::unlocked_sink<AsyncLogBackend>>(backend));
+  }
+  else
+    logging::add_file_log(filename);
 
   logging::core::get()->set_filter(logging::trivial::severity >= minimum_level);
 }
 
-void validate(boost::any & value, std::vector<std::string> const & values, KeyboardLayout *, int)
+/**
+ * @brief Detach the sinks, which writes whatever the asynchronous log still has queued.
+ */
+void shutdown_logging()
 {
-  static std::unordered_map<std::string, KeyboardLayout> const supportedLayouts {
-      {"xbox", KeyboardLayout::XBOX},
-      {"snes", KeyboardLayout::SNES},
-  };
-
-  po::validators::check_first_occurrence(value);
-  auto const & single = po::validators::get_single_string(values);
-
-  auto const it = supportedLayouts.find(single);
-  if (it != std::cend(supportedLayouts))
-    value = it->second;
-  else
-    throw po::validation_error {po::validation_error::invalid_option_value}; // NOLINT(cert-err60-cpp)
+  logging::core::get()->flush();
+  logging::core::get()->remove_all_sinks();
 }
 
-bool handle_command_line(int argc, char ** argv)
+/**
+ * @brief Settings which are not applied directly while parsing the command line.
+ */
+struct Settings final
+{
+  FrameRate m_frameRate;
+  std::string m_profileOut;
+  std::string m_record;
+  std::string m_keyLayout {"snes"}; ///< As understood by parse_layout().
+  std::string m_assets {"ovenbrick.pack"};
+  std::string m_snapshot {"ovenbrick.snapshot"}; ///< Empty neither resumes nor saves sessions.
+  bool m_coldStart = false;
+  std::size_t m_assetBudget = 16; ///< MiB
+  MctsSearch::Settings m_computer;
+  JobSystem::Settings m_jobs;
+  sf::VideoMode m_screen {320, 240, 24};
+};
+
+bool handle_command_line(int argc, char ** argv, Settings & settings)
 {
+  auto & rate = settings.m_frameRate;
+  unsigned thinkingTime = static_cast<unsigned>(settings.m_computer.m_budget.count());
+  std::string logMode {"sync"};
+  AsyncLog::Settings asyncLog {};
+
   po::options_description desc {"Allowed options"};
   desc.add_options()
       ("help,h", "show this help")
       (
           "key-layout,k",
-          po::value<KeyboardLayout>(&KeyboardLayout::current)->default_value(KeyboardLayout::SNES, "snes"),
-          "set the keyboard layout to use (xbox,snes)"
+          po::value<std::string>(&settings.m_keyLayout)->default_value(settings.m_keyLayout),
+          "set the keyboard layout to use (xbox,snes), optionally followed by keys of your own (e.g. snes,a=Space)"
       )
       (
           "log-level,l",
@@ -82,7 +135,96 @@ bool handle_command_line(int argc, char ** argv)
           "log-file,f",
           po::value<std::string>()->default_value("ovenbrick.log"),
           "set the path of the log file"
+      )
+      (
+          "log-mode",
+          po::value<std::string>(&logMode)->default_value(logMode),
+          "set how the log file is written (sync, or in the background dropping (drop) or waiting (block) when behind)"
+      )
+      (
+          "log-queue",
+          po::value<std::size_t>(&asyncLog.m_capacity)->default_value(asyncLog.m_capacity),
+          "set the number of log records queued for the background writer"
+      )
+      (
+          "tick-rate,t",
+          po::value<unsigned>(&rate.m_tickRate)->default_value(rate.m_tickRate),
+          "set the number of simulation ticks per second"
+      )
+      (
+          "frame-rate,r",
+          po::value<unsigned>(&rate.m_frameRate)->default_value(rate.m_frameRate),
+          "limit the number of presented frames per second (0 paces by vsync)"
+      )
+      (
+          "max-ticks",
+          po::value<unsigned>(&rate.m_maxTicksPerFrame)->default_value(rate.m_maxTicksPerFrame),
+          "set the maximum number of simulation ticks per frame before time is dropped"
+      )
+      (
+          "assets,a",
+          po::value<std::string>(&settings.m_assets)->default_value(settings.m_assets),
+          "set the path of the asset pack"
+      )
+      (
+          "asset-budget",
+          po::value<std::size_t>(&settings.m_assetBudget)->default_value(settings.m_assetBudget),
+          "set the memory budget for decoded assets (MiB)"
+      )
+      (
+          "ai-time",
+          po::value<unsigned>(&thinkingTime)->default_value(thinkingTime),
+          "set the time the computer thinks about each move (ms)"
+      )
+      (
+          "ai-threads",
+          po::value<unsigned>(&settings.m_computer.m_threads)->default_value(settings.m_computer.m_threads),
+          "set the number of threads the computer thinks with (0 uses all cores)"
+      )
+      (
+          "ai-playouts",
+          po::value<std::uint64_t>(&settings.m_computer.m_maxPlayouts)
+              ->default_value(settings.m_computer.m_maxPlayouts),
+          "limit the playouts per thread and move, which makes the computer's moves reproducible (0 for no limit)"
+      )
+      (
+          "job-threads",
+          po::value<unsigned>(&settings.m_jobs.m_threads)->default_value(settings.m_jobs.m_threads),
+          "set the number of worker threads for background jobs (0 uses all cores but one)"
+      )
+      (
+          "pin-threads",
+          po::bool_switch(&settings.m_jobs.m_pinned),
+          "bind every worker thread to a core of its own"
+      )
+      (
+          "seed",
+          po::value<std::uint64_t>(&settings.m_computer.m_seed)->default_value(settings.m_computer.m_seed),
+          "seed the decks and the computer (0 picks a random seed)"
+      )
+      (
+          "snapshot",
+          po::value<std::string>(&settings.m_snapshot)->default_value(settings.m_snapshot),
+          "set where the session is saved on exit and resumed from on launch (empty to disable)"
+      )
+      (
+          "cold-start",
+          po::bool_switch(&settings.m_coldStart),
+          "start a new session instead of resuming the previous one"
+      )
+      (
+          "record",
+          po::value<std::string>(&settings.m_record),
+          "record the input of the session into this file, for ovenbrick_replay"
+      );
+#ifdef OVENBRICK_PROFILING
+  desc.add_options()
+      (
+          "profile-out,p",
+          po::value<std::string>(&settings.m_profileOut),
+          "write the game state latency histograms to this file on exit (JSON)"
       );
+#endif
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
   po::notify(vm);
@@ -93,18 +235,141 @@ bool handle_command_line(int argc, char ** argv)
     return false;
   }
 
+  if (!parse_layout(settings.m_keyLayout, KeyboardLayout::current))
+    throw po::validation_error {po::validation_error::invalid_option_value, "key-layout"}; // NOLINT(cert-err60-cpp)
+  if (rate.m_tickRate == 0)
+    throw po::validation_error {po::validation_error::invalid_option_value, "tick-rate"}; // NOLINT(cert-err60-cpp)
+  if (rate.m_maxTicksPerFrame == 0)
+    throw po::validation_error {po::validation_error::invalid_option_value, "max-ticks"}; // NOLINT(cert-err60-cpp)
+  if (logMode != "sync" && !from_string(logMode, asyncLog.m_overflow))
+    throw po::validation_error {po::validation_error::invalid_option_value, "log-mode"}; // NOLINT(cert-err60-cpp)
+  if (asyncLog.m_capacity == 0)
+    throw po::validation_error {po::validation_error::invalid_option_value, "log-queue"}; // NOLINT(cert-err60-cpp)
+  settings.m_computer.m_budget = std::chrono::milliseconds {thinkingTime};
+  if (!settings.m_record.empty())
+  {
+    // the replay needs to know the seed and the number of threads, which would be those of its own machine otherwise
+    if (settings.m_computer.m_seed == 0)
+    {
+      std::random_device device {};
+      settings.m_computer.m_seed = (std::uint64_t {device()} << 32u) | device();
+    }
+    settings.m_computer.m_threads = MctsSearch::thread_count(settings.m_computer);
+  }
+
   init_logging(
       vm["log-level"].as<logging::trivial::severity_level>(),
-      vm["log-file"].as<std::string>()
+      vm["log-file"].as<std::string>(),
+      logMode != "sync",
+      asyncLog
   );
 
   return true;
 }
 
-void configure_dependencies(ddic::container & c)
+void log_frame_statistics(FrameStatistics const & statistics)
+{
+  if (statistics.m_frames == 0)
+    return;
+
+  auto const perFrame = [&statistics](sf::Time const & total) {
+    return total.asSeconds() * 1000.f / static_cast<float>(statistics.m_frames);
+  };
+
+  BOOST_LOG_TRIVIAL(info)
+    << "Frames: " << statistics.m_frames
+    << ", ticks: " << statistics.m_ticks
+    << ", capped frames: " << statistics.m_cappedFrames
+    << " (" << statistics.m_dropped.asMilliseconds() << "ms dropped)"
+    << ", idle frames: " << statistics.m_idleFrames
+    << " (" << statistics.m_skippedFrames << " frames skipped in " << statistics.m_idle.asMilliseconds() << "ms)";
+  BOOST_LOG_TRIVIAL(info)
+    << "Average frame (ms): event " << perFrame(statistics.m_event)
+    << ", update " << perFrame(statistics.m_update)
+    << ", render " << perFrame(statistics.m_render)
+    << ", present " << perFrame(statistics.m_present)
+    << ", sleep " << perFrame(statistics.m_sleep)
+    << "; longest frame: " << statistics.m_longestFrame.asMilliseconds() << "ms";
+}
+
+void log_input_latency(InputActions const & input)
+{
+  auto const & latency = input.latency();
+  if (latency.count() == 0)
+    return;
+
+  auto const milliseconds = [](std::uint64_t const nanoseconds) { return static_cast<double>(nanoseconds) / 1e6; };
+  BOOST_LOG_TRIVIAL(info)
+    << "Input to present (ms): p50 " << milliseconds(latency.percentile(0.5))
+    << ", p99 " << milliseconds(latency.percentile(0.99))
+    << ", max " << milliseconds(latency.max())
+    << " over " << latency.count() << " frames; dropped actions: " << input.dropped();
+}
+
+void write_profile(std::string const & filename)
+{
+#ifdef OVENBRICK_PROFILING
+  Profiler::instance().log();
+
+  if (filename.empty())
+    return;
+
+  std::ofstream out {filename};
+  Profiler::instance().write_json(out);
+  if (!out)
+    BOOST_LOG_TRIVIAL(error) << "Could not write profile to " << filename;
+#else
+  static_cast<void>(filename);
+#endif
+}
+
+/**
+ * @brief Preload the states of the previous session.
+ * @return false, if there is no snapshot or it cannot be resumed.
+ */
+bool resume_session(GameStateManager & gsm, ddic::container & c, std::string const & filename)
+{
+  if (filename.empty() || !std::ifstream {filename})
+    return false;
+
+  try
+  {
+    SessionSnapshot const snapshot {filename};
+    if (snapshot.size() == 0)
+      return false;
+
+    gsm.resume(snapshot, [&c](std::string const & type) -> std::shared_ptr<GameState> {
+      if (type == MatchGameState::TYPE_KEY)
+        return c.resolve<MatchGameState>();
+      if (type == DummyGameState::TYPE_KEY)
+        return c.resolve<DummyGameState>();
+      return nullptr;
+    });
+    BOOST_LOG_TRIVIAL(info) << "Resuming " << snapshot.size() << " states from " << filename;
+    return true;
+  }
+  catch (std::exception const & error)
+  {
+    BOOST_LOG_TRIVIAL(warning) << "Cannot resume the previous session: " << error.what();
+    return false;
+  }
+}
+
+void configure_dependencies(ddic::container & c, Settings const & settings)
 {
   c.register_type<GameStateManager, ddic::creation_policy::always_same>();
-  c.autowire_type<DummyGameState>();
+  c.register_type<Resources, ddic::creation_policy::always_same>([&settings](ddic::container &) {
+    return new Resources {settings.m_assets, settings.m_assetBudget * 1024 * 1024};
+  });
+  c.register_type<Renderer, ddic::creation_policy::always_same>([&settings](ddic::container &) {
+    return new Renderer {sf::Vector2u {settings.m_screen.width, settings.m_screen.height}};
+  });
+  c.register_type<MctsSearch::Settings>(settings.m_computer);
+  c.register_type<JobSystem, ddic::creation_policy::always_same>([&settings](ddic::container &) {
+    return new JobSystem {settings.m_jobs};
+  });
+  c.autowire_type<DummyGameState, ddic::creation_policy::pooled>().reserve(2);
+  c.autowire_type<MatchGameState>();
 }
 
 /**
@@ -115,14 +380,20 @@ void configure_dependencies(ddic::container & c)
  */
 int main(int argc, char ** argv)
 {
-  if (!handle_command_line(argc, argv))
+  auto const launched = std::chrono::steady_clock::now();
+  Settings settings {};
+  if (!handle_command_line(argc, argv, settings))
     return EXIT_SUCCESS;
+  auto const & rate = settings.m_frameRate;
 
   BOOST_LOG_TRIVIAL(info) << "Oven Brick";
-  BOOST_LOG_TRIVIAL(info) << "Using keyboard layout: " << KeyboardLayout::current.m_name;
+  BOOST_LOG_TRIVIAL(info) << "Using keyboard layout: " << settings.m_keyLayout;
+  BOOST_LOG_TRIVIAL(info)
+    << "Simulating at " << rate.m_tickRate << " ticks/s, presenting at "
+    << (rate.m_frameRate ? std::to_string(rate.m_frameRate) + " frames/s" : std::string {"vsync"});
 
   auto const desktopMode = sf::VideoMode::getDesktopMode();
-  auto const desiredMode = sf::VideoMode {320, 240, 24};
+  auto const & desiredMode = settings.m_screen;
   BOOST_LOG_TRIVIAL(info)
     << "Desktop-Resolution: "
     << desktopMode.width << "x" << desktopMode.height
@@ -131,33 +402,149 @@ int main(int argc, char ** argv)
       ? (sf::Style::Titlebar | sf::Style::Close)
       : sf::Style::Fullscreen;
 
-  sf::Window mainWindow {desiredMode, "Oven Brick", style};
-  mainWindow.setVerticalSyncEnabled(true);
+  sf::RenderWindow mainWindow {desiredMode, "Oven Brick", style};
+  mainWindow.setVerticalSyncEnabled(rate.m_frameRate == 0);
   mainWindow.setMouseCursorVisible(false);
 
-  ddic::container c;
-  configure_dependencies(c);
+  ddic::container c {ddic::threading_policy::multi_threaded};
+  configure_dependencies(c, settings);
+
+  std::shared_ptr<Renderer> renderer {};
+  try
+  {
+    auto const resources = c.resolve<Resources>();
+    BOOST_LOG_TRIVIAL(info) << "Mapped " << resources->pack().size() << " assets from " << settings.m_assets;
+    renderer = c.resolve<Renderer>();
+  }
+  catch (std::exception const & error)
+  {
+    BOOST_LOG_TRIVIAL(fatal) << error.what();
+    shutdown_logging();
+    return EXIT_FAILURE;
+  }
 
   auto gsm = c.resolve<GameStateManager>();
-  gsm->push_state(c.resolve<DummyGameState>());
+  auto const jobs = c.resolve<JobSystem>();
+  gsm->set_job_system(jobs);
+  gsm->set_renderer(renderer);
+  BOOST_LOG_TRIVIAL(info)
+    << "Running jobs on " << jobs->thread_count() << " worker threads" << (jobs->is_pinned() ? " (pinned)" : "");
 
-  sf::Clock clock {};
-  while (mainWindow.isOpen())
+  std::ofstream traceFile {};
+  std::shared_ptr<InputRecorder> recorder {};
+  if (!settings.m_record.empty())
   {
+    traceFile.open(settings.m_record, std::ios::binary | std::ios::trunc);
+    if (!traceFile)
+    {
+      BOOST_LOG_TRIVIAL(fatal) << "Cannot record to " << settings.m_record;
+      shutdown_logging();
+      return EXIT_FAILURE;
+    }
+
+    auto const & computer = settings.m_computer;
+    recorder = std::make_shared<InputRecorder>(
+        traceFile, TraceSession {computer.m_seed, computer.m_threads, computer.m_maxPlayouts, computer.m_budget,
+                                settings.m_keyLayout});
+    gsm->set_recorder(recorder);
+    BOOST_LOG_TRIVIAL(info) << "Recording to " << settings.m_record << " (seed " << computer.m_seed << ")";
+    if (computer.m_maxPlayouts == 0)
+      BOOST_LOG_TRIVIAL(warning) << "Without --ai-playouts the computer's moves cannot be replayed exactly";
+  }
+
+  // ovenbrick_replay commits the same states in the same order, so recorded sessions always start anew
+  std::shared_ptr<MatchGameState> match {};
+  auto const startCold = [&c, &gsm, &match] {
+    match = c.resolve<MatchGameState>();
+    gsm->preload_state(c.resolve<DummyGameState>());
+    gsm->preload_state(match);
+  };
+  auto resumed = !recorder && !settings.m_coldStart && resume_session(*gsm, c, settings.m_snapshot);
+  if (!resumed)
+    startCold();
+
+  auto const dispatch = [&mainWindow, &gsm, &settings](sf::Event const & event) {
+    if (event.type == sf::Event::Closed)
+      mainWindow.close();
+    // the launcher may suspend or kill the game once it is in the background
+    if (event.type == sf::Event::LostFocus)
+      save_session(*gsm, settings.m_snapshot);
+
+    gsm->handle_event(event);
+  };
+  auto const pumpEvents = [&mainWindow, &dispatch] {
     sf::Event event {};
     while (mainWindow.pollEvent(event))
+      dispatch(event);
+  };
+  auto const waitEvents = [&mainWindow, &dispatch](sf::Time const timeout) {
+    sf::Event event {};
+    if (timeout == GameState::never())
     {
-      if (event.type == sf::Event::Closed)
-        mainWindow.close();
-
-      gsm->handle_event(event);
+      if (mainWindow.waitEvent(event))
+        dispatch(event);
+      return;
     }
 
-    gsm->update(clock.restart());
+    sf::Clock const clock {};
+    while (clock.getElapsedTime() < timeout)
+    {
+      if (mainWindow.pollEvent(event))
+      {
+        dispatch(event);
+        return;
+      }
+      sf::sleep(std::min(IDLE_POLL_INTERVAL, timeout - clock.getElapsedTime()));
+    }
+  };
+  auto const present = [&mainWindow, &renderer] {
+    renderer->present(mainWindow);
     mainWindow.display();
+  };
+
+  FrameScheduler scheduler {rate};
+  auto interactive = false;
+  while (mainWindow.isOpen())
+  {
+    scheduler.run_frame(*gsm, pumpEvents, present, waitEvents);
 
-    if (gsm->is_empty())
+    if (!interactive && !gsm->is_empty() && !gsm->is_loading())
+    {
+      interactive = true;
+      BOOST_LOG_TRIVIAL(info)
+        << "First interactive frame after "
+        << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - launched).count()
+        << "ms (" << (resumed ? "resumed" : "cold start") << ")";
+    }
+
+    if (gsm->is_empty() && !gsm->is_loading())
+    {
+      if (resumed && !interactive)
+      {
+        BOOST_LOG_TRIVIAL(warning) << "None of the states of the previous session could be resumed";
+        resumed = false;
+        startCold();
+        continue;
+      }
       mainWindow.close();
+    }
   }
+
+  save_session(*gsm, settings.m_snapshot);
+  if (recorder)
+  {
+    gsm->set_recorder(nullptr);
+    recorder->checksum(match->match() ? match->match()->hash() : 0);
+    recorder->flush();
+    if (match->searches_cut_short() > 0)
+      BOOST_LOG_TRIVIAL(warning)
+        << match->searches_cut_short() << " of the computer's searches ran out of thinking time"
+        << " before the playout limit, replays of this session depend on timing";
+  }
+
+  log_frame_statistics(scheduler.statistics());
+  log_input_latency(gsm->input());
+  write_profile(settings.m_profileOut);
+  shutdown_logging();
   return EXIT_SUCCESS;
 }
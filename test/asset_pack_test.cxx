@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../game/asset_pack.hxx"
+
+namespace {
+  std::vector<char> compressible(std::size_t size)
+  {
+    std::vector<char> data(size);
+    for (std::size_t n = 0; n < size; ++n)
+      data[n] = static_cast<char>('a' + n % 7);
+    return data;
+  }
+
+  std::vector<char> noise(std::size_t size)
+  {
+    std::vector<char> data(size);
+    std::uint32_t state = 0x12345678u;
+    for (auto & c : data)
+    {
+      state = state * 1664525u + 1013904223u;
+      c = static_cast<char>(state >> 24);
+    }
+    return data;
+  }
+
+  void write_file(std::string const & filename, std::string const & content)
+  {
+    std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+    out << content;
+  }
+}
+
+TEST_CASE("Asset packs", "[core][resources]")
+{
+  std::string const filename {"asset_pack_test.pack"};
+
+  SECTION("Entries survive the round trip")
+  {
+    std::vector<AssetSource> const sources {
+        {"sounds/noise.ogg", noise(1000)},
+        {"cards/text.txt", compressible(4096)},
+        {"empty", {}},
+    };
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      write_asset_pack(out, sources);
+    }
+
+    AssetPack const pack {filename};
+    REQUIRE(pack.size() == sources.size());
+    REQUIRE(pack.find("missing") == nullptr);
+    REQUIRE(pack.find("cards") == nullptr);
+
+    for (auto const & source : sources)
+    {
+      auto const entry = pack.find(source.m_name);
+      REQUIRE(entry != nullptr);
+      REQUIRE(pack.name(*entry) == source.m_name);
+
+      auto const asset = pack.read(*entry);
+      REQUIRE(asset.size() == source.m_data.size());
+      REQUIRE(std::equal(source.m_data.begin(), source.m_data.end(), asset.data()));
+    }
+
+    REQUIRE(pack.find("cards/text.txt")->m_compression == AssetPack::Compression::Zlib);
+    REQUIRE(pack.find("sounds/noise.ogg")->m_compression == AssetPack::Compression::Stored);
+  }
+
+  SECTION("Assets outlive their pack")
+  {
+    auto const data = noise(100);
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      write_asset_pack(out, {{"a", data}, {"b", compressible(100)}});
+    }
+
+    Asset stored {};
+    Asset inflated {};
+    {
+      AssetPack const pack {filename};
+      stored = pack.read(*pack.find("a"));
+      inflated = pack.read(*pack.find("b"));
+    }
+
+    REQUIRE(std::equal(data.begin(), data.end(), stored.data()));
+    REQUIRE(inflated.size() == 100);
+  }
+
+  SECTION("Duplicate names are rejected")
+  {
+    std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+    REQUIRE_THROWS_AS(write_asset_pack(out, {{"a", {}}, {"a", {}}}), std::invalid_argument);
+  }
+
+  SECTION("Malformed packs are rejected")
+  {
+    REQUIRE_THROWS_AS(AssetPack {"does/not/exist.pack"}, std::runtime_error);
+
+    write_file(filename, "not an asset pack at all");
+    REQUIRE_THROWS_AS(AssetPack {filename}, std::runtime_error);
+
+    // a valid header announcing more entries than there are
+    std::string header {"OBPK"};
+    header += std::string {"\x01\0\0\0\xff\0\0\0\0\0\0\0", 12};
+    write_file(filename, header);
+    REQUIRE_THROWS_AS(AssetPack {filename}, std::runtime_error);
+  }
+
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/make_shared.hpp>
+
+#include "../game/async_log.hxx"
+
+namespace {
+  /**
+   * @brief Holds the writer thread on its first write while the gate is locked.
+   */
+  class GatedBuffer final : public std::stringbuf
+  {
+  public:
+    std::mutex m_gate;
+
+  protected:
+    std::streamsize xsputn(char const * text, std::streamsize const count) override
+    {
+      std::lock_guard<std::mutex> const lock {m_gate};
+      return std::stringbuf::xsputn(text, count);
+    }
+  };
+
+  /**
+   * @return A stream for the log to own, writing into a buffer the test keeps.
+   */
+  std::unique_ptr<std::ostream> stream_to(std::stringbuf & buffer)
+  {
+    return std::unique_ptr<std::ostream> {new std::ostream {&buffer}};
+  }
+
+  std::vector<std::string> lines_of(std::string const & text)
+  {
+    std::vector<std::string> lines {};
+    std::istringstream in {text};
+    for (std::string line {}; std::getline(in, line);)
+      lines.push_back(line);
+    return lines;
+  }
+
+  void push(AsyncLog & log, std::string const & text)
+  {
+    log.push(text.data(), text.size());
+  }
+
+  AsyncLog::Settings settings(std::size_t const capacity, AsyncLog::Overflow const overflow)
+  {
+    AsyncLog::Settings result {};
+    result.m_capacity = capacity;
+    result.m_overflow = overflow;
+    result.m_flushInterval = std::chrono::hours {1}; // only write when told or when filling up
+    return result;
+  }
+}
+
+TEST_CASE("Asynchronous log", "[core][log]")
+{
+  SECTION("records are written in order, one per line")
+  {
+    std::stringbuf buffer {};
+    AsyncLog log {stream_to(buffer), settings(64, AsyncLog::Overflow::Drop)};
+    for (auto n = 0; n < 20; ++n)
+      push(log, "record " + std::to_string(n));
+
+    log.flush();
+    auto const lines = lines_of(buffer.str());
+    REQUIRE(lines.size() == 20);
+    for (auto n = 0; n < 20; ++n)
+      REQUIRE(lines[static_cast<std::size_t>(n)] == "record " + std::to_string(n));
+    REQUIRE(log.written() == 20);
+    REQUIRE(log.dropped() == 0);
+  }
+
+  SECTION("the capacity is rounded up to a power of two")
+  {
+    std::stringbuf buffer {};
+    AsyncLog log {stream_to(buffer), settings(100, AsyncLog::Overflow::Drop)};
+    REQUIRE(log.settings().m_capacity == 128);
+  }
+
+  SECTION("long records are cut off")
+  {
+    std::stringbuf buffer {};
+    auto small = settings(4, AsyncLog::Overflow::Drop);
+    small.m_recordSize = 16;
+    AsyncLog log {stream_to(buffer), small};
+    push(log, "exactly sixteen!");
+    push(log, "this one does not fit into sixteen bytes");
+
+    log.flush();
+    auto const lines = lines_of(buffer.str());
+    REQUIRE(lines.size() == 2);
+    REQUIRE(lines[0] == "exactly sixteen!");
+    REQUIRE(lines[1] == "this one does...");
+  }
+
+  SECTION("a full queue drops records and says so")
+  {
+    GatedBuffer buffer {};
+    std::unique_lock<std::mutex> gate {buffer.m_gate};
+    AsyncLog log {stream_to(buffer), settings(4, AsyncLog::Overflow::Drop)};
+
+    // the writer gets stuck in its first batch, after that nothing fits any more
+    std::uint64_t pushed = 0;
+    for (; pushed < 100; ++pushed)
+      push(log, "record " + std::to_string(pushed));
+    REQUIRE(log.dropped() > 0);
+    REQUIRE(log.dropped() <= pushed - 4);
+
+    gate.unlock();
+    log.flush();
+    REQUIRE(log.written() + log.dropped() == pushed);
+
+    std::uint64_t noted = 0;
+    for (auto const & line : lines_of(buffer.str()))
+    {
+      unsigned count = 0;
+      if (std::sscanf(line.c_str(), "[%u log records dropped]", &count) == 1)
+        noted += count;
+    }
+    REQUIRE(noted == log.dropped());
+  }
+
+  SECTION("blocking loses nothing")
+  {
+    constexpr auto THREADS = 4;
+    constexpr auto RECORDS = 5000;
+
+    std::stringbuf buffer {};
+    AsyncLog log {stream_to(buffer), settings(8, AsyncLog::Overflow::Block)};
+
+    std::vector<std::thread> producers {};
+    for (auto t = 0; t < THREADS; ++t)
+      producers.emplace_back([&log, t] {
+        for (auto n = 0; n < RECORDS; ++n)
+          push(log, std::to_string(t) + " " + std::to_string(n));
+      });
+    for (auto & producer : producers)
+      producer.join();
+
+    log.flush();
+    REQUIRE(log.dropped() == 0);
+    REQUIRE(log.written() == THREADS * RECORDS);
+
+    // every producer's records keep their order
+    std::vector<int> next(THREADS, 0);
+    auto ordered = true;
+    for (auto const & line : lines_of(buffer.str()))
+    {
+      std::istringstream in {line};
+      int t = 0;
+      int n = 0;
+      in >> t >> n;
+      ordered = ordered && t >= 0 && t < THREADS && next[static_cast<std::size_t>(t)] == n;
+      if (t >= 0 && t < THREADS)
+        ++next[static_cast<std::size_t>(t)];
+    }
+    REQUIRE(ordered);
+    REQUIRE(next == std::vector<int>(THREADS, RECORDS));
+  }
+
+  SECTION("everything queued is written on destruction")
+  {
+    std::stringbuf buffer {};
+    {
+      AsyncLog log {stream_to(buffer), settings(16, AsyncLog::Overflow::Drop)};
+      push(log, "first");
+      push(log, "last");
+    }
+    REQUIRE(lines_of(buffer.str()) == (std::vector<std::string> {"first", "last"}));
+  }
+
+  SECTION("Boost.Log records end up in the file")
+  {
+    std::stringbuf buffer {};
+    auto const log = std::make_shared<AsyncLog>(stream_to(buffer), settings(16, AsyncLog::Overflow::Drop));
+    auto const sink = boost::make_shared<boost::log::sinks::unlocked_sink<AsyncLogBackend>>(
+        boost::make_shared<AsyncLogBackend>(log));
+    boost::log::core::get()->add_sink(sink);
+    BOOST_LOG_TRIVIAL(warning) << "answer " << 42;
+    boost::log::core::get()->flush();
+    boost::log::core::get()->remove_sink(sink);
+
+    REQUIRE(lines_of(buffer.str()) == (std::vector<std::string> {"answer 42"}));
+  }
+
+  SECTION("overflow policies by name")
+  {
+    AsyncLog::Overflow overflow {AsyncLog::Overflow::Drop};
+    REQUIRE(from_string("block", overflow));
+    REQUIRE(overflow == AsyncLog::Overflow::Block);
+    REQUIRE(from_string("drop", overflow));
+    REQUIRE(overflow == AsyncLog::Overflow::Drop);
+    REQUIRE_FALSE(from_string("sync", overflow));
+  }
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../game/card_database.hxx"
+#include "../game/resources.hxx"
+
+namespace {
+  Asset as_asset(std::string const & bytes)
+  {
+    auto const buffer = std::make_shared<std::vector<char>>(bytes.begin(), bytes.end());
+    return Asset {buffer, buffer->data(), buffer->size()};
+  }
+
+  std::string serialize(std::vector<CardDefinition> const & cards)
+  {
+    std::ostringstream out {};
+    CardDatabase::write(out, cards);
+    return out.str();
+  }
+
+  CardDefinition card(CardId id, CardType type, std::uint8_t cost, std::uint32_t keywords = 0)
+  {
+    return CardDefinition {id, "Card " + std::to_string(id), type, cost, 1, 2, keywords, "Text " + std::to_string(id)};
+  }
+
+  std::vector<CardId> ids(CardDatabase const & cards, gsl::span<CardIndex const> indexes)
+  {
+    std::vector<CardId> result {};
+    for (auto const index : indexes)
+      result.push_back(cards.id(index));
+    return result;
+  }
+}
+
+TEST_CASE("Card database", "[core][cards]")
+{
+  auto const taunt = keyword_bit(Keyword::Taunt);
+  auto const rush = keyword_bit(Keyword::Rush);
+
+  // deliberately not sorted by id
+  CardDatabase const cards {as_asset(serialize({
+      card(7, CardType::Spell, 2),
+      card(3, CardType::Minion, 4, taunt),
+      card(1, CardType::Minion, 2, taunt | rush),
+      card(9, CardType::Weapon, 2),
+      card(5, CardType::Minion, 1),
+  }))};
+
+  SECTION("Cards are found by id")
+  {
+    REQUIRE(cards.size() == 5);
+    REQUIRE(cards.find(2) == CardDatabase::NONE);
+
+    auto const index = cards.find(3);
+    REQUIRE(index != CardDatabase::NONE);
+    REQUIRE(cards.id(index) == 3);
+    REQUIRE(cards.type(index) == CardType::Minion);
+    REQUIRE(cards.cost(index) == 4);
+    REQUIRE(cards.attack(index) == 1);
+    REQUIRE(cards.health(index) == 2);
+    REQUIRE(cards.has(index, Keyword::Taunt));
+    REQUIRE(!cards.has(index, Keyword::Rush));
+    REQUIRE(cards.name(index) == "Card 3");
+    REQUIRE(cards.text(index) == "Text 3");
+  }
+
+  SECTION("Cards are queried by type, cost and keyword")
+  {
+    REQUIRE(ids(cards, cards.of_type(CardType::Minion)) == std::vector<CardId> {5, 1, 3});
+    REQUIRE(ids(cards, cards.of_type(CardType::Hero)).empty());
+    REQUIRE(ids(cards, cards.costing(2)) == std::vector<CardId> {1, 7, 9});
+    REQUIRE(ids(cards, cards.costing(0, 2)) == std::vector<CardId> {5, 1, 7, 9});
+    REQUIRE(ids(cards, cards.costing(3, 1000)) == std::vector<CardId> {3});
+    REQUIRE(cards.costing(4, 3).empty());
+    REQUIRE(ids(cards, cards.with(Keyword::Taunt)) == std::vector<CardId> {1, 3});
+    REQUIRE(ids(cards, cards.with(Keyword::Rush)) == std::vector<CardId> {1});
+    REQUIRE(cards.with(Keyword::Poisonous).empty());
+  }
+
+  SECTION("Names round-trip")
+  {
+    for (unsigned n = 0; n < CARD_TYPE_COUNT; ++n)
+    {
+      CardType type {};
+      REQUIRE(from_string(to_string(static_cast<CardType>(n)), type));
+      REQUIRE(type == static_cast<CardType>(n));
+    }
+    for (unsigned n = 0; n < KEYWORD_COUNT; ++n)
+    {
+      Keyword keyword {};
+      REQUIRE(from_string(to_string(static_cast<Keyword>(n)), keyword));
+      REQUIRE(keyword == static_cast<Keyword>(n));
+    }
+
+    Keyword keyword {};
+    REQUIRE(!from_string("flying", keyword));
+  }
+
+  SECTION("Invalid databases are rejected")
+  {
+    REQUIRE_THROWS_AS(serialize({card(1, CardType::Spell, 0), card(1, CardType::Hero, 0)}), std::invalid_argument);
+
+    auto bytes = serialize({card(1, CardType::Spell, 0)});
+    REQUIRE_THROWS_AS(CardDatabase {as_asset(bytes.substr(0, bytes.size() - 1))}, std::runtime_error);
+    bytes[0] = 'X';
+    REQUIRE_THROWS_AS(CardDatabase {as_asset(bytes)}, std::runtime_error);
+  }
+
+  SECTION("The compiled cards are mapped in place")
+  {
+    Resources resources {OVENBRICK_ASSET_PACK, 0};
+    auto const entry = resources.pack().find("cards/cards.db");
+    REQUIRE(entry != nullptr);
+    REQUIRE(entry->m_compression == AssetPack::Compression::Stored);
+
+    CardDatabase const compiled {resources.get("cards/cards.db")};
+    REQUIRE(compiled.size() > 0);
+    REQUIRE(resources.cached_bytes() == 0);
+
+    for (auto const index : compiled.of_type(CardType::Minion))
+      REQUIRE(compiled.health(index) > 0);
+  }
+}
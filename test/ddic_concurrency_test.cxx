@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <ddic.hxx>
+
+namespace {
+  constexpr auto const THREADS = 8;
+  constexpr auto const RESOLUTIONS = 2000;
+
+  std::atomic<int> gConstructions {0};
+
+  struct SlowSingleton final
+  {
+    SlowSingleton()
+    {
+      ++gConstructions;
+      // widen the window in which other threads see no instance yet
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  struct Dependency final
+  {
+  };
+
+  struct Dependent final
+  {
+    using autowire = ddic::inject<Dependency>;
+
+    std::shared_ptr<Dependency> m_dependency;
+
+    explicit Dependent(std::shared_ptr<Dependency> dependency)
+        : m_dependency {std::move(dependency)}
+    {
+      ++gConstructions;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  template <int N>
+  struct Registered final
+  {
+  };
+
+  /**
+   * @brief Run fn on THREADS threads which are released at the same time.
+   */
+  template <typename Fn>
+  void run_concurrently(Fn fn)
+  {
+    std::atomic<bool> go {false};
+    std::vector<std::thread> threads {};
+    for (auto t = 0; t < THREADS; ++t)
+      threads.emplace_back([&go, &fn, t] {
+        while (!go.load())
+          std::this_thread::yield();
+        fn(t);
+      });
+
+    go.store(true);
+    for (auto & thread : threads)
+      thread.join();
+  }
+
+  template <int... Ns>
+  struct RegisterAll;
+
+  template <>
+  struct RegisterAll<>
+  {
+    static void with(ddic::container &)
+    {
+    }
+  };
+
+  template <int N, int... Ns>
+  struct RegisterAll<N, Ns...>
+  {
+    static void with(ddic::container & c)
+    {
+      c.register_type<Registered<N>>().as("registered");
+      RegisterAll<Ns...>::with(c);
+    }
+  };
+}
+
+TEST_CASE("ddic singletons are created once under contention", "[ddic][concurrency]")
+{
+  gConstructions = 0;
+  auto const c = std::make_shared<ddic::container>(ddic::threading_policy::multi_threaded);
+  REQUIRE(c->threading() == ddic::threading_policy::multi_threaded);
+
+  SECTION("Default constructed singletons")
+  {
+    c->register_type<SlowSingleton, ddic::creation_policy::always_same>();
+
+    std::vector<std::shared_ptr<SlowSingleton>> resolved(THREADS);
+    run_concurrently([&c, &resolved](int t) { resolved[t] = c->resolve<SlowSingleton>(); });
+
+    REQUIRE(gConstructions == 1);
+    for (auto const & instance : resolved)
+      REQUIRE(instance == resolved.front());
+  }
+
+  SECTION("Autowired singletons")
+  {
+    c->register_type<Dependency, ddic::creation_policy::always_same>();
+    c->autowire_type<Dependent, ddic::creation_policy::always_same>();
+
+    std::vector<std::shared_ptr<Dependent>> resolved(THREADS);
+    run_concurrently([&c, &resolved](int t) { resolved[t] = c->resolve<Dependent>(); });
+
+    REQUIRE(gConstructions == 1);
+    for (auto const & instance : resolved)
+    {
+      REQUIRE(instance == resolved.front());
+      REQUIRE(instance->m_dependency == c->resolve<Dependency>());
+    }
+  }
+
+  SECTION("Singletons inherited from a parent")
+  {
+    c->register_type<SlowSingleton, ddic::creation_policy::always_same>();
+    auto const child = std::make_shared<ddic::container>(c, ddic::threading_policy::multi_threaded);
+
+    std::vector<std::shared_ptr<SlowSingleton>> resolved(THREADS);
+    run_concurrently([&c, &child, &resolved](int t) {
+      resolved[t] = (t % 2) ? child->resolve<SlowSingleton>() : c->resolve<SlowSingleton>();
+    });
+
+    REQUIRE(gConstructions == 1);
+    for (auto const & instance : resolved)
+      REQUIRE(instance == resolved.front());
+  }
+}
+
+TEST_CASE("ddic shared containers need shared parents", "[ddic][concurrency]")
+{
+  auto const single = std::make_shared<ddic::container>();
+  auto const multi = std::make_shared<ddic::container>(ddic::threading_policy::multi_threaded);
+
+  REQUIRE_THROWS_AS(ddic::container(single, ddic::threading_policy::multi_threaded), std::invalid_argument);
+  REQUIRE_NOTHROW(ddic::container(multi, ddic::threading_policy::multi_threaded));
+  REQUIRE_NOTHROW(ddic::container(multi));
+  REQUIRE_NOTHROW(ddic::container(single));
+}
+
+TEST_CASE("ddic registration does not disturb concurrent resolution", "[ddic][concurrency]")
+{
+  auto const c = std::make_shared<ddic::container>(ddic::threading_policy::multi_threaded);
+  c->register_type<Dependency, ddic::creation_policy::always_same>();
+  auto const expected = c->resolve<Dependency>();
+
+  std::atomic<int> failures {0};
+  run_concurrently([&c, &expected, &failures](int t) {
+    if (t == 0)
+    {
+      RegisterAll<0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15>::with(*c);
+      return;
+    }
+
+    for (auto n = 0; n < RESOLUTIONS; ++n)
+    {
+      if (c->resolve<Dependency>() != expected)
+        ++failures;
+    }
+  });
+
+  REQUIRE(failures == 0);
+  REQUIRE(c->resolve<Registered<0>>());
+  REQUIRE(c->resolve<Registered<15>>());
+  REQUIRE(c->resolve<Registered<15>>("registered"));
+}
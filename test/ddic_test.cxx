@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ddic.hxx>
+
+namespace {
+  struct Service
+  {
+    virtual ~Service() = default;
+
+    virtual int value() const = 0;
+  };
+
+  struct ServiceImpl final : public Service
+  {
+    int value() const override
+    {
+      return 42;
+    }
+  };
+
+  struct Client final
+  {
+    using autowire = ddic::inject<Service>;
+
+    std::shared_ptr<Service> m_service;
+
+    explicit Client(std::shared_ptr<Service> service)
+        : m_service {std::move(service)}
+    {
+    }
+  };
+
+  struct Counted final
+  {
+    static int s_alive;
+
+    Counted()
+    {
+      ++s_alive;
+    }
+
+    Counted(Counted const &)
+    {
+      ++s_alive;
+    }
+
+    ~Counted()
+    {
+      --s_alive;
+    }
+  };
+
+  int Counted::s_alive = 0;
+}
+
+TEST_CASE("ddic type identifiers", "[ddic]")
+{
+  REQUIRE(ddic::type_id_of<int>() == ddic::type_id_of<int>());
+  REQUIRE(ddic::type_id_of<int const>() == ddic::type_id_of<int>());
+  REQUIRE(ddic::type_id_of<int>() != ddic::type_id_of<long>());
+  REQUIRE(ddic::type_id_of<Service>() != ddic::type_id_of<ServiceImpl>());
+}
+
+TEST_CASE("ddic factory table", "[ddic]")
+{
+  ddic::factory_table table {};
+  auto const first = std::make_shared<ddic::default_factory<int, ddic::creation_policy::always_new>>();
+  auto const second = std::make_shared<ddic::default_factory<long, ddic::creation_policy::always_new>>();
+
+  REQUIRE(table.find(ddic::type_id_of<int>()) == nullptr);
+
+  table.insert(ddic::type_id_of<long>(), second);
+  table.insert(ddic::type_id_of<int>(), first);
+  REQUIRE(table.size() == 2);
+  REQUIRE(table.find(ddic::type_id_of<int>()) == first.get());
+  REQUIRE(table.find(ddic::type_id_of<long>()) == second.get());
+
+  table.insert(ddic::type_id_of<int>(), second);
+  REQUIRE(table.size() == 2);
+  REQUIRE(table.find(ddic::type_id_of<int>()) == second.get());
+}
+
+TEST_CASE("ddic container", "[ddic]")
+{
+  auto const c = std::make_shared<ddic::container>();
+
+  SECTION("Types are resolved by type and by their name")
+  {
+    c->register_type<ServiceImpl, ddic::creation_policy::always_same>();
+
+    auto const byType = c->resolve<ServiceImpl>();
+    REQUIRE(byType);
+    REQUIRE(byType == c->resolve<ServiceImpl>(typeid(ServiceImpl).name()));
+  }
+
+  SECTION("Unknown types resolve to nothing")
+  {
+    REQUIRE(!c->resolve<ServiceImpl>());
+    REQUIRE(!c->resolve<ServiceImpl>("unknown"));
+  }
+
+  SECTION("Unknown types are found once registered")
+  {
+    auto const child = std::make_shared<ddic::container>(c);
+    REQUIRE(!child->resolve<ServiceImpl>());
+    REQUIRE(!child->resolve<ServiceImpl>());
+    REQUIRE(!c->resolve<ServiceImpl>());
+
+    c->register_type<ServiceImpl>();
+    REQUIRE(child->resolve<ServiceImpl>());
+    REQUIRE(!child->resolve<Service>());
+
+    child->register_type<ServiceImpl>().as(typeid(Service).name());
+    REQUIRE(child->resolve<Service>());
+  }
+
+  SECTION("Type aliases are resolved by type")
+  {
+    c->register_type<ServiceImpl, ddic::creation_policy::always_same>().as<Service>();
+    c->autowire_type<Client>();
+
+    auto const service = c->resolve<Service>();
+    REQUIRE(service);
+    REQUIRE(service->value() == 42);
+    REQUIRE(c->resolve<Client>()->m_service == service);
+  }
+
+  SECTION("String aliases keep working")
+  {
+    c->register_type<ServiceImpl>().as("service");
+
+    auto const service = c->resolve<Service>("service");
+    REQUIRE(service);
+    REQUIRE(service->value() == 42);
+  }
+
+  SECTION("Aliases with the mangled name of a type are found by type")
+  {
+    c->register_type<ServiceImpl>().as(typeid(Service).name());
+
+    REQUIRE(c->resolve<Service>());
+  }
+
+  SECTION("Children resolve through their parents")
+  {
+    c->register_type<ServiceImpl, ddic::creation_policy::always_same>().as<Service>().as("service");
+
+    auto const child = std::make_shared<ddic::container>(c);
+    auto const grandChild = std::make_shared<ddic::container>(child);
+
+    auto const service = c->resolve<Service>();
+    REQUIRE(grandChild->resolve<Service>() == service);
+    REQUIRE(grandChild->resolve<Service>() == service);
+    REQUIRE(grandChild->resolve<Service>("service") == service);
+    REQUIRE(child->resolve<Service>() == service);
+  }
+
+  SECTION("Children can override their parents")
+  {
+    c->register_type<ServiceImpl, ddic::creation_policy::always_same>();
+    auto const child = std::make_shared<ddic::container>(c);
+    auto const inherited = child->resolve<ServiceImpl>();
+
+    child->register_type<ServiceImpl, ddic::creation_policy::always_same>();
+    auto const own = child->resolve<ServiceImpl>();
+
+    REQUIRE(inherited == c->resolve<ServiceImpl>());
+    REQUIRE(own != inherited);
+  }
+
+  SECTION("Factories inherited from a destroyed parent are not used anymore")
+  {
+    auto parent = std::make_shared<ddic::container>();
+    parent->register_type<ServiceImpl>().as<Service>();
+    parent->autowire_type<Client>();
+
+    auto const child = std::make_shared<ddic::container>(parent);
+    auto const grandChild = std::make_shared<ddic::container>(child);
+    REQUIRE(child->resolve<Client>());
+    REQUIRE(grandChild->resolve<Client>());
+
+    parent.reset();
+    REQUIRE(!child->resolve<Client>());
+    REQUIRE(!grandChild->resolve<Client>());
+    REQUIRE(!grandChild->resolve<Service>());
+  }
+}
+
+TEST_CASE("ddic object pool", "[ddic]")
+{
+  auto const handle = ddic::object_pool::make();
+  auto & pool = *handle;
+  pool.reserve(4);
+  REQUIRE(pool.capacity() == 0);
+
+  auto const first = pool.allocate(24);
+  REQUIRE(pool.capacity() == 4);
+  REQUIRE(pool.available() == 3);
+
+  pool.deallocate(first);
+  REQUIRE(pool.available() == 4);
+  REQUIRE(pool.allocate(24) == first);
+
+  std::vector<void *> slots {};
+  for (auto n = 0; n < 3; ++n)
+    slots.push_back(pool.allocate(24));
+  REQUIRE(pool.capacity() == 4);
+  REQUIRE(pool.available() == 0);
+
+  // exhausted pools grow by the reserved amount
+  slots.push_back(pool.allocate(24));
+  REQUIRE(pool.capacity() == 8);
+
+  for (auto const slot : slots)
+    pool.deallocate(slot);
+  pool.deallocate(first);
+  REQUIRE(pool.available() == 8);
+}
+
+TEST_CASE("ddic pooled creation policy", "[ddic]")
+{
+  auto const c = std::make_shared<ddic::container>();
+  Counted::s_alive = 0;
+
+  SECTION("Pooled instances are distinct and destroyed on release")
+  {
+    c->register_type<Counted, ddic::creation_policy::pooled>().reserve(2);
+
+    auto first = c->resolve<Counted>();
+    auto second = c->resolve<Counted>();
+    REQUIRE(first != second);
+    REQUIRE(Counted::s_alive == 2);
+
+    first.reset();
+    second.reset();
+    REQUIRE(Counted::s_alive == 0);
+  }
+
+  SECTION("Released storage is recycled")
+  {
+    c->register_type<Counted, ddic::creation_policy::pooled>();
+
+    auto instance = c->resolve<Counted>();
+    auto const address = instance.get();
+    instance.reset();
+
+    REQUIRE(c->resolve<Counted>().get() == address);
+  }
+
+  SECTION("Prototypes can be pooled")
+  {
+    c->register_type<Counted, ddic::creation_policy::pooled>(Counted {});
+    REQUIRE(Counted::s_alive == 1);
+
+    auto const instance = c->resolve<Counted>();
+    REQUIRE(instance);
+    REQUIRE(Counted::s_alive == 2);
+  }
+
+  SECTION("Autowired types can be pooled")
+  {
+    c->register_type<ServiceImpl, ddic::creation_policy::always_same>().as<Service>();
+    c->autowire_type<Client, ddic::creation_policy::pooled>();
+
+    auto client = c->resolve<Client>();
+    auto const address = client.get();
+    REQUIRE(client->m_service == c->resolve<Service>());
+    client.reset();
+
+    REQUIRE(c->resolve<Client>().get() == address);
+  }
+
+  SECTION("Pooled instances may outlive their container")
+  {
+    c->register_type<Counted, ddic::creation_policy::pooled>();
+    auto const instance = c->resolve<Counted>();
+
+    c->register_type<Counted>();
+    REQUIRE(Counted::s_alive == 1);
+  }
+}
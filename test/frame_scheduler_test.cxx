@@ -0,0 +1,304 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <vector>
+
+#include <catch.hpp>
+
+#include <SFML/System/Time.hpp>
+
+#include "../game/frame_scheduler.hxx"
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+
+namespace {
+  sf::Time const UPDATE_COST = sf::milliseconds(2);
+
+  struct FakeClock final
+  {
+    sf::Time m_now;
+
+    FrameScheduler::TimeSource source()
+    {
+      return [this] { return m_now; };
+    }
+
+    FrameScheduler::Sleeper sleeper()
+    {
+      return [this](sf::Time const & duration) { m_now += duration; };
+    }
+  };
+
+  struct TickingGameState final : public GameState
+  {
+    FakeClock & m_clock;
+    int m_updates = 0;
+    int m_renders = 0;
+    sf::Time m_simulated;
+    sf::Time m_wakeup;
+    float m_alpha = -1.f;
+
+    TickingGameState(std::shared_ptr<GameStateManager> gsm, FakeClock & clock)
+        : GameState {std::move(gsm)}, m_clock {clock}
+    {
+    }
+
+    void set_up() override
+    {
+    }
+
+    void handle_event(sf::Event const & /* event */) override
+    {
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+      ++m_updates;
+      m_simulated += elapsed;
+      m_clock.m_now += UPDATE_COST;
+    }
+
+    void render(float alpha) override
+    {
+      ++m_renders;
+      m_alpha = alpha;
+    }
+
+    sf::Time next_wakeup() const override
+    {
+      return m_wakeup;
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+}
+
+TEST_CASE("FrameScheduler", "[core][FrameScheduler]")
+{
+  FakeClock clock {};
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto const state = std::make_shared<TickingGameState>(gsm, clock);
+  gsm->push_state(state);
+
+  auto const pumpEvents = [&clock] { clock.m_now += sf::milliseconds(1); };
+  auto const present = [&clock] { clock.m_now += sf::milliseconds(3); };
+
+  FrameRate rate {};
+  rate.m_tickRate = 100;
+  rate.m_frameRate = 50;
+  rate.m_maxTicksPerFrame = 5;
+
+  SECTION("Simulation runs in fixed ticks and the remainder is interpolated")
+  {
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+    REQUIRE(scheduler.tick_duration() == sf::milliseconds(10));
+
+    clock.m_now += sf::milliseconds(25);
+    auto const & timing = scheduler.run_frame(*gsm, pumpEvents, present);
+
+    REQUIRE(timing.m_elapsed == sf::milliseconds(25));
+    REQUIRE(timing.m_ticks == 2);
+    REQUIRE(state->m_updates == 2);
+    REQUIRE(state->m_simulated == sf::milliseconds(20));
+    REQUIRE(state->m_renders == 1);
+    REQUIRE(state->m_alpha == Approx(0.5f));
+    REQUIRE(timing.m_alpha == Approx(0.5f));
+    REQUIRE(timing.m_dropped == sf::Time::Zero);
+  }
+
+  SECTION("Each phase of a frame is measured")
+  {
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+    clock.m_now += sf::milliseconds(25);
+    auto const & timing = scheduler.run_frame(*gsm, pumpEvents, present);
+
+    REQUIRE(timing.m_event == sf::milliseconds(1));
+    REQUIRE(timing.m_update == UPDATE_COST * sf::Int64 {2});
+    REQUIRE(timing.m_render == sf::Time::Zero);
+    REQUIRE(timing.m_present == sf::milliseconds(3));
+    // 20ms budget, 8ms spent
+    REQUIRE(timing.m_sleep == sf::milliseconds(12));
+
+    auto const & statistics = scheduler.statistics();
+    REQUIRE(statistics.m_frames == 1);
+    REQUIRE(statistics.m_ticks == 2);
+    REQUIRE(statistics.m_sleep == sf::milliseconds(12));
+  }
+
+  SECTION("Frames are paced to the target frame rate")
+  {
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+    for (auto n = 0; n < 10; ++n)
+      scheduler.run_frame(*gsm, pumpEvents, present);
+
+    // the first frame started immediately, all following ones are 20ms apart
+    REQUIRE(clock.m_now == sf::milliseconds(200));
+    REQUIRE(scheduler.last_frame().m_elapsed == sf::milliseconds(20));
+    REQUIRE(scheduler.statistics().m_ticks == 18);
+  }
+
+  SECTION("Without a target frame rate no time is spent sleeping")
+  {
+    rate.m_frameRate = 0;
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+    clock.m_now += sf::milliseconds(25);
+    REQUIRE(scheduler.run_frame(*gsm, pumpEvents, present).m_sleep == sf::Time::Zero);
+  }
+
+  SECTION("Long stalls are capped instead of spiralling")
+  {
+    rate.m_maxTicksPerFrame = 3;
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+    clock.m_now += sf::seconds(1.f);
+    auto const & timing = scheduler.run_frame(*gsm, pumpEvents, present);
+
+    REQUIRE(timing.m_ticks == 3);
+    REQUIRE(timing.m_dropped == sf::milliseconds(970));
+    REQUIRE(timing.m_alpha == Approx(0.f));
+    REQUIRE(scheduler.statistics().m_cappedFrames == 1);
+  }
+
+  SECTION("Resetting discards accumulated time")
+  {
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+    clock.m_now += sf::milliseconds(45);
+    scheduler.reset();
+    clock.m_now += sf::milliseconds(5);
+    auto const & timing = scheduler.run_frame(*gsm, pumpEvents, present);
+
+    REQUIRE(timing.m_elapsed == sf::milliseconds(5));
+    REQUIRE(timing.m_ticks == 0);
+  }
+
+  SECTION("Ticking stops once the last state is gone")
+  {
+    FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+    gsm->pop_state();
+    clock.m_now += sf::milliseconds(25);
+    REQUIRE(scheduler.run_frame(*gsm, pumpEvents, present).m_ticks == 0);
+    REQUIRE(state->m_updates == 0);
+  }
+
+  while (!gsm->is_empty())
+    gsm->pop_state();
+}
+
+TEST_CASE("FrameScheduler idling", "[core][FrameScheduler]")
+{
+  FakeClock clock {};
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto const state = std::make_shared<TickingGameState>(gsm, clock);
+  gsm->push_state(state);
+
+  auto const pumpEvents = [] {};
+  int presents = 0;
+  auto const present = [&presents] { ++presents; };
+
+  // the next event arrives after a second, unless the wakeup is due earlier
+  std::vector<sf::Time> waits {};
+  auto const waitEvents = [&clock, &waits](sf::Time const timeout) {
+    waits.push_back(timeout);
+    clock.m_now += std::min(timeout, sf::seconds(1.f));
+  };
+
+  FrameRate rate {};
+  rate.m_tickRate = 100;
+  rate.m_frameRate = 50;
+  rate.m_maxTicksPerFrame = 5;
+  FrameScheduler scheduler {rate, clock.source(), clock.sleeper()};
+
+  SECTION("Animating states never wait")
+  {
+    clock.m_now += sf::milliseconds(25);
+    auto const & timing = scheduler.run_frame(*gsm, pumpEvents, present, waitEvents);
+
+    REQUIRE(waits.empty());
+    REQUIRE(timing.m_idle == sf::Time::Zero);
+    REQUIRE(timing.m_sleep == sf::milliseconds(16));
+  }
+
+  SECTION("Idle states block until the next event instead of presenting frames")
+  {
+    state->m_wakeup = GameState::never();
+
+    for (auto n = 0; n < 3; ++n)
+      scheduler.run_frame(*gsm, pumpEvents, present, waitEvents);
+
+    REQUIRE(waits == std::vector<sf::Time>(3, GameState::never()));
+    REQUIRE(presents == 3);
+    REQUIRE(scheduler.last_frame().m_idle == sf::seconds(1.f));
+    REQUIRE(scheduler.last_frame().m_skippedFrames == 50);
+    REQUIRE(scheduler.last_frame().m_sleep == sf::Time::Zero);
+
+    // nothing happens while waiting for events, so there is nothing to catch up with
+    REQUIRE(state->m_updates == 0);
+    REQUIRE(scheduler.last_frame().m_elapsed == sf::Time::Zero);
+
+    auto const & statistics = scheduler.statistics();
+    REQUIRE(statistics.m_frames == 3);
+    REQUIRE(statistics.m_idleFrames == 3);
+    REQUIRE(statistics.m_skippedFrames == 150);
+    REQUIRE(statistics.m_idle == sf::seconds(3.f));
+    REQUIRE(statistics.m_cappedFrames == 0);
+  }
+
+  SECTION("Time until a wakeup is simulated regardless of the tick cap")
+  {
+    state->m_wakeup = sf::milliseconds(100);
+
+    scheduler.run_frame(*gsm, pumpEvents, present, waitEvents);
+    REQUIRE(waits == std::vector<sf::Time> {sf::milliseconds(100)});
+
+    state->m_wakeup = sf::Time::Zero;
+    auto const & timing = scheduler.run_frame(*gsm, pumpEvents, present, waitEvents);
+
+    REQUIRE(timing.m_ticks == 10);
+    REQUIRE(state->m_simulated == sf::milliseconds(100));
+    REQUIRE(timing.m_dropped == sf::Time::Zero);
+  }
+
+  SECTION("States do not idle while others are being preloaded")
+  {
+    state->m_wakeup = GameState::never();
+    REQUIRE(gsm->next_wakeup() == GameState::never());
+
+    // pending until committed by the next frame
+    gsm->preload_state(std::make_shared<TickingGameState>(gsm, clock));
+    REQUIRE(gsm->next_wakeup() == sf::Time::Zero);
+  }
+
+  SECTION("Without a way to wait for events frames keep running")
+  {
+    state->m_wakeup = GameState::never();
+
+    scheduler.run_frame(*gsm, pumpEvents, present);
+    REQUIRE(scheduler.last_frame().m_idle == sf::Time::Zero);
+    REQUIRE(scheduler.statistics().m_idleFrames == 0);
+  }
+
+  while (!gsm->is_empty())
+    gsm->pop_state();
+}
@@ -17,9 +17,16 @@
 #include <catch.hpp>
 
 #include <array>
+#include <future>
+#include <stdexcept>
+#include <thread>
 
 #include "../game/game_state_manager.hxx"
 #include "../game/game_state.hxx"
+#include "../game/load_progress.hxx"
+#include "../game/renderer.hxx"
+
+#include <SFML/Graphics/RenderTexture.hpp>
 
 namespace {
   struct MockGameState final : public GameState
@@ -30,6 +37,7 @@ namespace {
       int m_setup = 0;
       int m_update = 0;
       int m_event = 0;
+      int m_render = 0;
       int m_teardown = 0;
     };
 
@@ -62,6 +70,12 @@ namespace {
         ++m_info->m_update;
     }
 
+    void render(float alpha) override
+    {
+      if (m_info)
+        ++m_info->m_render;
+    }
+
     void handle_event(sf::Event const & event) override
     {
       if (m_info)
@@ -74,6 +88,122 @@ namespace {
         ++m_info->m_teardown;
     }
   };
+
+  struct LoadingGameState final : public GameState
+  {
+    std::shared_future<void> m_release;
+    bool m_throw = false;
+    bool m_loaded = false;
+    bool m_setUp = false;
+
+    LoadingGameState(std::shared_ptr<GameStateManager> gsm, std::shared_future<void> release)
+        : GameState {std::move(gsm)}, m_release {std::move(release)}
+    {
+    }
+
+    void load(LoadProgress & progress) override
+    {
+      progress.report(0.5f);
+      m_release.wait();
+      if (m_throw)
+        throw std::runtime_error {"broken asset"};
+      m_loaded = !progress.is_cancelled();
+    }
+
+    void set_up() override
+    {
+      m_setUp = m_loaded;
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+    }
+
+    void render(float alpha) override
+    {
+    }
+
+    void handle_event(sf::Event const & event) override
+    {
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+
+  /**
+   * @brief Draws a single sprite and counts what it is asked to do.
+   */
+  struct LayerGameState final : public GameState
+  {
+    std::shared_ptr<Renderer> m_renderer;
+    bool m_overlay = false;
+    WhenCovered m_whenCovered = WhenCovered::Suspend;
+    sf::Time m_wakeup = never();
+    int m_updates = 0;
+    int m_renders = 0;
+    sf::Time m_elapsed;
+
+    LayerGameState(std::shared_ptr<GameStateManager> gsm, std::shared_ptr<Renderer> renderer)
+        : GameState {std::move(gsm)}, m_renderer {std::move(renderer)}
+    {
+    }
+
+    void set_up() override
+    {
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+      ++m_updates;
+      m_elapsed += elapsed;
+    }
+
+    void render(float alpha) override
+    {
+      ++m_renders;
+      m_renderer->draw(Sprite {sf::FloatRect {10.f * m_renders, 10.f, 20.f, 20.f}, sf::FloatRect {}, nullptr,
+                               sf::Color::White, 0});
+    }
+
+    void handle_event(sf::Event const & event) override
+    {
+    }
+
+    sf::Time next_wakeup() const override
+    {
+      return m_wakeup;
+    }
+
+    bool is_overlay() const override
+    {
+      return m_overlay;
+    }
+
+    WhenCovered when_covered() const override
+    {
+      return m_whenCovered;
+    }
+
+    sf::Time covered_update_interval() const override
+    {
+      return sf::milliseconds(100);
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+
+  void wait_for_loaders(GameStateManager & gsm)
+  {
+    while (gsm.is_loading())
+    {
+      gsm.commit_loaded_states();
+      std::this_thread::yield();
+    }
+  }
 }
 
 TEST_CASE("GameStateManager", "[core][GameStateManager]")
@@ -132,4 +262,203 @@ TEST_CASE("GameStateManager", "[core][GameStateManager]")
 
     REQUIRE(gsm->is_empty());
   }
+
+  SECTION("Preloaded GameStates are added at the next commit")
+  {
+    MockGameState::Info currentInfo {};
+    gsm->push_state(std::make_shared<MockGameState>(gsm, &currentInfo));
+
+    std::promise<void> release {};
+    auto const state = std::make_shared<LoadingGameState>(gsm, release.get_future().share());
+    auto const progress = gsm->preload_state(state);
+
+    REQUIRE(gsm->is_loading());
+    gsm->commit_loaded_states();
+    REQUIRE(std::addressof(gsm->current()) != state.get());
+    REQUIRE(progress->status() == LoadProgress::Status::Loading);
+
+    release.set_value();
+    wait_for_loaders(*gsm);
+
+    REQUIRE(progress->status() == LoadProgress::Status::Ready);
+    REQUIRE(progress->progress() == 1.f);
+    REQUIRE(std::addressof(gsm->current()) == state.get());
+    REQUIRE(state->m_setUp);
+    REQUIRE(currentInfo.m_teardown == 0);
+
+    gsm->pop_state();
+    gsm->pop_state();
+    REQUIRE(gsm->is_empty());
+  }
+
+  SECTION("Preloaded GameStates may replace the current one")
+  {
+    MockGameState::Info currentInfo {};
+    gsm->push_state(std::make_shared<MockGameState>(gsm, &currentInfo));
+
+    std::promise<void> release {};
+    release.set_value();
+    auto const state = std::make_shared<LoadingGameState>(gsm, release.get_future().share());
+    gsm->preload_state(state, GameStateManager::Transition::Replace);
+    wait_for_loaders(*gsm);
+
+    REQUIRE(currentInfo.m_teardown == 1);
+    REQUIRE(currentInfo.m_destructor);
+    REQUIRE(std::addressof(gsm->current()) == state.get());
+    gsm->pop_state();
+    REQUIRE(gsm->is_empty());
+  }
+
+  SECTION("Cancelled and failed GameStates are discarded")
+  {
+    std::promise<void> release {};
+    auto const future = release.get_future().share();
+
+    auto const cancelled = std::make_shared<LoadingGameState>(gsm, future);
+    auto const cancelledProgress = gsm->preload_state(cancelled);
+    auto const failed = std::make_shared<LoadingGameState>(gsm, future);
+    failed->m_throw = true;
+    auto const failedProgress = gsm->preload_state(failed);
+
+    cancelledProgress->cancel();
+    release.set_value();
+    wait_for_loaders(*gsm);
+
+    REQUIRE(gsm->is_empty());
+    REQUIRE(cancelledProgress->status() == LoadProgress::Status::Cancelled);
+    REQUIRE(!cancelled->m_setUp);
+    REQUIRE(failedProgress->status() == LoadProgress::Status::Failed);
+    REQUIRE_THROWS_AS(std::rethrow_exception(failedProgress->error()), std::runtime_error);
+  }
+}
+
+TEST_CASE("Overlays", "[core][GameStateManager]")
+{
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto const renderer = std::make_shared<Renderer>(sf::Vector2u {320, 240});
+  sf::RenderTexture screen {};
+  REQUIRE(screen.create(320, 240));
+  gsm->set_renderer(renderer);
+
+  auto const board = std::make_shared<LayerGameState>(gsm, renderer);
+  auto const popup = std::make_shared<LayerGameState>(gsm, renderer);
+  popup->m_overlay = true;
+  gsm->push_state(board);
+  gsm->push_state(popup);
+
+  auto const frame = [&] {
+    gsm->update(sf::milliseconds(40));
+    gsm->render(0.f);
+    renderer->present(screen);
+  };
+
+  SECTION("the state beneath an overlay is drawn once into the backdrop")
+  {
+    frame();
+    REQUIRE(board->m_renders == 1);
+    REQUIRE(renderer->statistics().m_backdropItems == 1);
+    REQUIRE(renderer->statistics().m_items == 2); // the backdrop and the popup
+
+    for (int n = 0; n < 5; ++n)
+      frame();
+    REQUIRE(board->m_renders == 1);
+    REQUIRE(popup->m_renders == 6);
+    REQUIRE(renderer->statistics().m_backdropItems == 0);
+
+    gsm->invalidate_covered();
+    frame();
+    REQUIRE(board->m_renders == 2);
+
+    // without the overlay, the board is the current state and drawn every frame
+    gsm->pop_state();
+    frame();
+    frame();
+    REQUIRE(board->m_renders == 4);
+    REQUIRE(renderer->statistics().m_backdropItems == 0);
+  }
+
+  SECTION("states beneath opaque states are not drawn at all")
+  {
+    auto const menu = std::make_shared<LayerGameState>(gsm, renderer);
+    gsm->push_state(menu);
+    frame();
+    frame();
+    REQUIRE(board->m_renders == 0);
+    REQUIRE(popup->m_renders == 0);
+    REQUIRE(menu->m_renders == 2);
+    gsm->pop_state();
+  }
+
+  SECTION("covered states are suspended by default")
+  {
+    frame();
+    frame();
+    REQUIRE(board->m_updates == 0);
+    REQUIRE(popup->m_updates == 2);
+    REQUIRE(gsm->next_wakeup() == GameState::never());
+  }
+
+  SECTION("throttled states are updated with the time since their last update")
+  {
+    board->m_whenCovered = GameState::WhenCovered::Throttle;
+    board->m_wakeup = sf::Time::Zero;
+    REQUIRE(gsm->next_wakeup() == sf::milliseconds(100));
+
+    frame();
+    frame();
+    REQUIRE(board->m_updates == 0);
+    REQUIRE(gsm->next_wakeup() == sf::milliseconds(20));
+    frame();
+    REQUIRE(board->m_updates == 1);
+    REQUIRE(board->m_elapsed == sf::milliseconds(120));
+    // the update changed the board, so the backdrop is drawn again
+    REQUIRE(board->m_renders == 2);
+  }
+
+  SECTION("running states are updated every tick and drawn every frame without a backdrop")
+  {
+    board->m_whenCovered = GameState::WhenCovered::Run;
+    board->m_wakeup = sf::milliseconds(10);
+    REQUIRE(gsm->next_wakeup() == sf::milliseconds(10));
+
+    frame();
+    frame();
+    REQUIRE(board->m_updates == 2);
+    REQUIRE(board->m_elapsed == sf::milliseconds(80));
+    REQUIRE(board->m_renders == 2);
+    REQUIRE(renderer->statistics().m_backdropItems == 0);
+  }
+
+  SECTION("the states beneath a running state stay in the backdrop")
+  {
+    auto const clock = std::make_shared<LayerGameState>(gsm, renderer);
+    clock->m_overlay = true;
+    clock->m_whenCovered = GameState::WhenCovered::Run;
+    gsm->pop_state();
+    gsm->push_state(clock);
+    gsm->push_state(popup);
+
+    frame();
+    REQUIRE(renderer->statistics().m_backdropItems == 1);
+    for (int n = 0; n < 5; ++n)
+      frame();
+    REQUIRE(board->m_renders == 1);
+    REQUIRE(clock->m_updates == 6);
+    REQUIRE(clock->m_renders == 6);
+    REQUIRE(popup->m_renders == 6);
+    REQUIRE(renderer->statistics().m_backdropItems == 0);
+    REQUIRE(renderer->statistics().m_items == 3); // the backdrop, the clock and the popup
+  }
+
+  SECTION("without a renderer the states beneath are drawn every frame")
+  {
+    gsm->set_renderer(nullptr);
+    frame();
+    frame();
+    REQUIRE(board->m_renders == 2);
+    REQUIRE(renderer->statistics().m_backdropItems == 0);
+  }
+
+  while (!gsm->is_empty())
+    gsm->pop_state();
 }
@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../game/glyph_atlas.hxx"
+#include "../game/resources.hxx"
+#include "../game/text_batch.hxx"
+
+namespace {
+  Asset as_asset(std::string const & bytes)
+  {
+    auto const buffer = std::make_shared<std::string>(bytes);
+    return Asset {buffer, buffer->data(), buffer->size()};
+  }
+
+  GlyphAtlas::Glyph glyph(std::uint32_t codepoint, std::uint16_t x, std::uint16_t width, std::int16_t advance)
+  {
+    GlyphAtlas::Glyph glyph {};
+    glyph.m_codepoint = codepoint;
+    glyph.m_x = x;
+    glyph.m_width = width;
+    glyph.m_height = 4;
+    glyph.m_top = 3;
+    glyph.m_advance = advance;
+    return glyph;
+  }
+
+  std::string serialize(GlyphAtlas::Data const & data)
+  {
+    std::ostringstream out {};
+    GlyphAtlas::write(out, data);
+    return out.str();
+  }
+
+  GlyphAtlas::Data tiny_atlas()
+  {
+    GlyphAtlas::Data data {};
+    data.m_width = 16;
+    data.m_height = 4;
+    data.m_faces.push_back(GlyphAtlas::Face {8, 6, 3, 0, 4, 0});
+    data.m_glyphs.push_back(glyph(' ', 0, 0, 4));
+    data.m_glyphs.push_back(glyph('?', 0, 4, 4));
+    data.m_glyphs.push_back(glyph('A', 4, 4, 5));
+    data.m_glyphs.push_back(glyph('B', 8, 4, 5));
+    data.m_coverage.assign(16 * 4, 128);
+    return data;
+  }
+}
+
+TEST_CASE("Glyph atlas", "[core][text]")
+{
+  SECTION("FiraCode is baked into the asset pack")
+  {
+    Resources resources {OVENBRICK_ASSET_PACK, 1024 * 1024};
+    GlyphAtlas const atlas {resources.get("fonts/FiraCode-Regular.atlas")};
+
+    for (auto const size : {10u, 12u, 16u, 20u})
+    {
+      auto const face = atlas.face(size);
+      REQUIRE(face != nullptr);
+      REQUIRE(face->m_lineSpacing > 0);
+
+      auto const letter = atlas.glyph(*face, 'A');
+      REQUIRE(letter != nullptr);
+      REQUIRE(letter->m_width > 0);
+      REQUIRE(letter->m_x + letter->m_width <= atlas.texture().getSize().x);
+
+      auto const space = atlas.glyph(*face, ' ');
+      REQUIRE(space != nullptr);
+      REQUIRE(space->m_advance > 0);
+    }
+    REQUIRE(atlas.face(11) == nullptr);
+  }
+
+  SECTION("Glyphs are looked up per size")
+  {
+    GlyphAtlas const atlas {as_asset(serialize(tiny_atlas()))};
+    REQUIRE(atlas.texture().getSize() == sf::Vector2u {16, 4});
+    REQUIRE(atlas.face(9) == nullptr);
+
+    auto const face = atlas.face(8);
+    REQUIRE(face != nullptr);
+    REQUIRE(atlas.glyph(*face, 'B')->m_x == 8);
+    REQUIRE(atlas.glyph(*face, 'C') == nullptr);
+  }
+
+  SECTION("Malformed atlases are rejected")
+  {
+    REQUIRE_THROWS_AS(GlyphAtlas {as_asset("OBGA")}, std::runtime_error);
+
+    auto bytes = serialize(tiny_atlas());
+    bytes.pop_back();
+    REQUIRE_THROWS_AS(GlyphAtlas {as_asset(bytes)}, std::runtime_error);
+
+    auto data = tiny_atlas();
+    data.m_glyphs.back().m_x = 14;
+    REQUIRE_THROWS_AS(GlyphAtlas {as_asset(serialize(data))}, std::runtime_error);
+  }
+}
+
+TEST_CASE("Text batches", "[core][text]")
+{
+  GlyphAtlas const atlas {as_asset(serialize(tiny_atlas()))};
+  TextBatch batch {atlas};
+
+  SECTION("All glyphs end up in one vertex array")
+  {
+    auto const pen = batch.add("A B", {10.f, 20.f}, 8);
+    REQUIRE(pen.x == 24.f);
+    REQUIRE(pen.y == 20.f);
+    REQUIRE(batch.glyph_count() == 2);
+
+    batch.add("AB\nA", pen, 8);
+    REQUIRE(batch.glyph_count() == 5);
+
+    auto const & vertices = batch.vertices();
+    REQUIRE(vertices.getPrimitiveType() == sf::Triangles);
+    REQUIRE(vertices.getVertexCount() == 30);
+
+    // the second B: pen at 24 + 5, ascent 3 and glyph top 3 put it right on the line
+    auto const & topLeft = vertices[18];
+    REQUIRE(topLeft.position == sf::Vector2f {29.f, 20.f});
+    REQUIRE(topLeft.texCoords == sf::Vector2f {8.f, 0.f});
+
+    // the line break returns to the start of the text, one line further down
+    REQUIRE(vertices[24].position == sf::Vector2f {24.f, 26.f});
+
+    batch.clear();
+    REQUIRE(batch.glyph_count() == 0);
+  }
+
+  SECTION("Missing characters are replaced")
+  {
+    auto const pen = batch.add("C", {0.f, 0.f}, 8);
+    REQUIRE(pen.x == 4.f);
+    REQUIRE(batch.glyph_count() == 1);
+  }
+
+  SECTION("Missing sizes are reported")
+  {
+    REQUIRE_THROWS_AS(batch.add("A", {0.f, 0.f}, 12), std::out_of_range);
+  }
+}
@@ -0,0 +1,265 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/Time.hpp>
+
+#include <SFML/Window/Event.hpp>
+
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+#include "../game/input_actions.hxx"
+#include "../game/keyboard_layout.hxx"
+
+namespace {
+  sf::Event key(sf::Event::EventType type, sf::Keyboard::Key code)
+  {
+    sf::Event event {};
+    event.type = type;
+    event.key.code = code;
+    return event;
+  }
+
+  struct ActionGameState final : public GameState
+  {
+    std::vector<ActionFrame> m_frames;
+
+    explicit ActionGameState(std::shared_ptr<GameStateManager> gsm)
+        : GameState {std::move(gsm)}
+    {
+    }
+
+    void set_up() override
+    {
+    }
+
+    void handle_event(sf::Event const & /* event */) override
+    {
+    }
+
+    void handle_actions(ActionFrame const & actions) override
+    {
+      m_frames.push_back(actions);
+      if (actions.pressed(Action::Menu))
+        m_gsm->pop_state();
+    }
+
+    void update(sf::Time const & /* elapsed */) override
+    {
+    }
+
+    void render(float /* alpha */) override
+    {
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+}
+
+TEST_CASE("Keyboard layouts", "[core][input]")
+{
+  SECTION("layouts compile into a key-to-action table")
+  {
+    ActionMap const map {KeyboardLayout::SNES};
+    REQUIRE(map[KeyboardLayout::SNES.m_keyStart] == Action::Start);
+    REQUIRE(map[KeyboardLayout::SNES.m_keyMenu] == Action::Menu);
+    REQUIRE(map[KeyboardLayout::SNES.m_keyA] == Action::A);
+    REQUIRE(map[sf::Keyboard::F12] == Action::None);
+    REQUIRE(map[sf::Keyboard::Unknown] == Action::None);
+  }
+
+  SECTION("actions and keys are known by name")
+  {
+    for (unsigned n = 0; n < ACTION_COUNT; ++n)
+    {
+      auto const action = static_cast<Action>(n);
+      Action parsed {Action::None};
+      REQUIRE(from_string(to_string(action), parsed));
+      REQUIRE(parsed == action);
+    }
+
+    sf::Keyboard::Key code {};
+    REQUIRE(from_string("Q", code));
+    REQUIRE(code == sf::Keyboard::Q);
+    REQUIRE(from_string("Num5", code));
+    REQUIRE(code == sf::Keyboard::Num5);
+    REQUIRE(from_string("Numpad0", code));
+    REQUIRE(code == sf::Keyboard::Numpad0);
+    REQUIRE(from_string("F15", code));
+    REQUIRE(code == sf::Keyboard::F15);
+    REQUIRE(from_string("Backspace", code));
+    REQUIRE(code == sf::Keyboard::Backspace);
+    REQUIRE_FALSE(from_string("F16", code));
+    REQUIRE_FALSE(from_string("enter", code));
+  }
+
+  SECTION("user-defined layouts override single keys")
+  {
+    KeyboardLayout layout {};
+    REQUIRE(parse_layout("xbox", layout));
+    REQUIRE(layout.m_keyStart == KeyboardLayout::XBOX.m_keyStart);
+
+    REQUIRE(parse_layout("snes,a=Q,menu=Backspace", layout));
+    REQUIRE(layout.m_keyA == sf::Keyboard::Q);
+    REQUIRE(layout.m_keyMenu == sf::Keyboard::Backspace);
+    REQUIRE(layout.m_keyB == KeyboardLayout::SNES.m_keyB);
+
+    ActionMap const map {layout};
+    REQUIRE(map[sf::Keyboard::Q] == Action::A);
+    REQUIRE(map[sf::Keyboard::Backspace] == Action::Menu);
+
+    for (auto const invalid : {"", "nes", "snes,a", "snes,jump=Space", "snes,a=Spacebar"})
+    {
+      REQUIRE_FALSE(parse_layout(invalid, layout));
+      REQUIRE(layout.m_keyA == sf::Keyboard::Q);
+    }
+  }
+}
+
+TEST_CASE("Action queue", "[core][input]")
+{
+  ActionQueue queue {};
+  ActionEvent event {};
+
+  SECTION("actions come out in order and overflow is counted")
+  {
+    REQUIRE(queue.is_empty());
+    REQUIRE_FALSE(queue.pop(event));
+
+    for (std::size_t n = 0; n < ActionQueue::CAPACITY; ++n)
+      REQUIRE(queue.push(ActionEvent {static_cast<std::int64_t>(n), Action::A, true}));
+    REQUIRE_FALSE(queue.push(ActionEvent {-1, Action::B, true}));
+    REQUIRE(queue.dropped() == 1);
+
+    for (std::size_t n = 0; n < ActionQueue::CAPACITY; ++n)
+    {
+      REQUIRE(queue.pop(event));
+      REQUIRE(event.m_timestamp == static_cast<std::int64_t>(n));
+    }
+    REQUIRE(queue.is_empty());
+  }
+
+  SECTION("a producer and a consumer on different threads")
+  {
+    constexpr std::int64_t COUNT = 100000;
+    std::thread producer {[&queue] {
+      for (std::int64_t n = 0; n < COUNT;)
+      {
+        if (queue.push(ActionEvent {n, static_cast<Action>(n % ACTION_COUNT), (n % 2) == 0}))
+          ++n;
+        else
+          std::this_thread::yield();
+      }
+    }};
+
+    std::int64_t expected = 0;
+    auto ordered = true;
+    while (expected < COUNT)
+    {
+      if (!queue.pop(event))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      ordered = ordered && event.m_timestamp == expected
+          && event.m_action == static_cast<Action>(expected % ACTION_COUNT);
+      ++expected;
+    }
+    producer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(queue.is_empty());
+  }
+}
+
+TEST_CASE("Actions reach game states once per frame", "[core][input]")
+{
+  KeyboardLayout::current = KeyboardLayout::SNES;
+  auto const & layout = KeyboardLayout::current;
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto const state = std::make_shared<ActionGameState>(gsm);
+  gsm->push_state(state);
+
+  SECTION("events of a frame are batched")
+  {
+    gsm->handle_event(key(sf::Event::KeyPressed, layout.m_keyLeft));
+    gsm->handle_event(key(sf::Event::KeyPressed, layout.m_keyRight));
+    gsm->handle_event(key(sf::Event::KeyReleased, layout.m_keyLeft));
+    gsm->handle_event(key(sf::Event::KeyPressed, sf::Keyboard::F12));
+    REQUIRE(state->m_frames.empty());
+    REQUIRE(gsm->next_wakeup() == sf::Time::Zero);
+
+    gsm->render(0.f);
+    REQUIRE(state->m_frames.size() == 1);
+    auto const & frame = state->m_frames.front();
+    REQUIRE(frame.m_pressed == (action_bit(Action::Left) | action_bit(Action::Right)));
+    REQUIRE(frame.m_released == action_bit(Action::Left));
+    REQUIRE(frame.m_held == action_bit(Action::Right));
+
+    // nothing happened, nothing is handed over
+    gsm->update(sf::milliseconds(10));
+    REQUIRE(state->m_frames.size() == 1);
+
+    gsm->handle_event(key(sf::Event::KeyReleased, layout.m_keyRight));
+    gsm->update(sf::milliseconds(10));
+    REQUIRE(state->m_frames.size() == 2);
+    REQUIRE(state->m_frames.back().released(Action::Right));
+    REQUIRE(state->m_frames.back().m_held == 0);
+  }
+
+  SECTION("the latency is measured until the frame is presented")
+  {
+    gsm->frame_presented();
+    REQUIRE(gsm->input().latency().count() == 0);
+
+    gsm->handle_event(key(sf::Event::KeyPressed, layout.m_keyA));
+    gsm->render(0.f);
+    std::this_thread::sleep_for(std::chrono::milliseconds {2});
+    gsm->frame_presented();
+    REQUIRE(gsm->input().latency().count() == 1);
+    REQUIRE(gsm->input().latency().max() >= 2000000);
+  }
+
+  SECTION("a state may leave while handling actions")
+  {
+    gsm->handle_event(key(sf::Event::KeyPressed, layout.m_keyMenu));
+    gsm->update(sf::milliseconds(10));
+    REQUIRE(gsm->is_empty());
+  }
+
+  SECTION("layouts can be switched")
+  {
+    KeyboardLayout custom {};
+    REQUIRE(parse_layout("snes,a=Q", custom));
+    gsm->set_keyboard_layout(custom);
+    gsm->handle_event(key(sf::Event::KeyPressed, sf::Keyboard::Q));
+    gsm->render(0.f);
+    REQUIRE(state->m_frames.size() == 1);
+    REQUIRE(state->m_frames.front().pressed(Action::A));
+  }
+
+  while (!gsm->is_empty())
+    gsm->pop_state();
+}
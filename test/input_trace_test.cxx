@@ -0,0 +1,388 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <SFML/System/Time.hpp>
+
+#include <SFML/Window/Event.hpp>
+
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+#include "../game/input_trace.hxx"
+#include "../game/keyboard_layout.hxx"
+#include "../game/match_game_state.hxx"
+#include "../game/renderer.hxx"
+#include "../game/resources.hxx"
+#include "test_helpers.hxx"
+
+namespace {
+  sf::Event key_pressed(sf::Keyboard::Key code)
+  {
+    sf::Event event {};
+    event.type = sf::Event::KeyPressed;
+    event.key.code = code;
+    return event;
+  }
+
+  /**
+   * @brief Writes down everything it is fed with.
+   */
+  struct TranscriptGameState final : public GameState
+  {
+    std::string m_name;
+    std::shared_ptr<std::vector<std::string>> m_transcript;
+
+    TranscriptGameState(std::shared_ptr<GameStateManager> gsm, std::string name,
+                        std::shared_ptr<std::vector<std::string>> transcript)
+        : GameState {std::move(gsm)}, m_name {std::move(name)}, m_transcript {std::move(transcript)}
+    {
+    }
+
+    void set_up() override
+    {
+      m_transcript->push_back(m_name + " set up");
+    }
+
+    void handle_event(sf::Event const & event) override
+    {
+      m_transcript->push_back(m_name + " event " + std::to_string(event.type) + " " + std::to_string(event.key.code));
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+      m_transcript->push_back(m_name + " update " + std::to_string(elapsed.asMicroseconds()));
+    }
+
+    void render(float alpha) override
+    {
+      m_transcript->push_back(m_name + " render " + std::to_string(alpha));
+    }
+
+    void tear_down() override
+    {
+      m_transcript->push_back(m_name + " tear down");
+    }
+  };
+
+  /**
+   * @brief Record two turns of a match against the computer and replay them like ovenbrick_replay does.
+   * @param buffer Receives the trace.
+   * @param threads Of the computer, recorded as the game records them.
+   */
+  void replay_match(std::stringstream & buffer, unsigned const threads)
+  {
+    KeyboardLayout::current = KeyboardLayout::SNES;
+    auto const resources = std::make_shared<Resources>(OVENBRICK_ASSET_PACK, 1024 * 1024);
+    auto const renderer = std::make_shared<Renderer>(sf::Vector2u {320, 240});
+    sf::RenderTexture screen {};
+    REQUIRE(screen.create(320, 240));
+
+    // a generous thinking time, the playout limit is what stops the search
+    auto const settings = std::make_shared<MctsSearch::Settings>();
+    settings->m_threads = threads;
+    settings->m_budget = std::chrono::milliseconds {1000};
+    settings->m_maxPlayouts = 200;
+    settings->m_seed = 42;
+
+    std::uint64_t checksum = 0;
+    {
+      auto const gsm = std::make_shared<GameStateManager>();
+      auto const recorder = std::make_shared<InputRecorder>(
+          buffer, TraceSession {settings->m_seed, MctsSearch::thread_count(*settings), settings->m_maxPlayouts,
+                                settings->m_budget, KeyboardLayout::current.m_name});
+      gsm->set_recorder(recorder);
+
+      auto const state = std::make_shared<MatchGameState>(gsm, resources, settings, renderer);
+      gsm->preload_state(state);
+      commit_when_loaded(*gsm);
+
+      // two turns of the player (whatever is selected first, then passing) and two of the computer
+      auto const & layout = KeyboardLayout::current;
+      for (auto const key : {layout.m_keyA, layout.m_keyStart, layout.m_keyRight, layout.m_keyA, layout.m_keyStart})
+      {
+        gsm->handle_event(key_pressed(key));
+        // the first update hands over the action
+        auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds {20};
+        for (auto n = 0; n == 0 || state->match()->active() == MatchGameState::COMPUTER; ++n)
+        {
+          REQUIRE(std::chrono::steady_clock::now() < deadline);
+          gsm->update(sf::milliseconds(10));
+          if (n % 4 == 0)
+          {
+            gsm->render(0.f);
+            renderer->present(screen);
+          }
+        }
+        REQUIRE(state->match()->active() == MatchGameState::PLAYER);
+      }
+      REQUIRE(state->match()->turn() > 3);
+      REQUIRE(state->searches_cut_short() == 0);
+
+      checksum = state->match()->hash();
+      recorder->checksum(checksum);
+      gsm->set_recorder(nullptr);
+      gsm->pop_state();
+    }
+
+    InputTrace trace {buffer};
+    auto const & session = trace.session();
+    REQUIRE(session.m_computerThreads == MctsSearch::thread_count(*settings));
+    REQUIRE(session.m_computerThreads > 0);
+    auto const replayed = std::make_shared<MctsSearch::Settings>();
+    replayed->m_threads = session.m_computerThreads;
+    replayed->m_budget = session.m_computerBudget;
+    replayed->m_maxPlayouts = session.m_computerPlayouts;
+    replayed->m_seed = session.m_seed;
+
+    auto const gsm = std::make_shared<GameStateManager>();
+    auto const state = std::make_shared<MatchGameState>(gsm, resources, replayed, renderer);
+    auto committed = false;
+
+    InputReplay replay {trace, *gsm};
+    replay.run([&state, &committed]() -> std::shared_ptr<GameState> {
+      if (committed)
+        return nullptr;
+      committed = true;
+      return state;
+    }, [&renderer, &screen] { renderer->present(screen); });
+
+    REQUIRE(replay.statistics().m_hasChecksum);
+    REQUIRE(replay.statistics().m_checksum == checksum);
+    REQUIRE(replay.statistics().m_collects > 0);
+    REQUIRE(state->match()->hash() == checksum);
+    REQUIRE(state->searches_cut_short() == 0);
+    gsm->pop_state();
+  }
+}
+
+TEST_CASE("Input traces", "[core][trace]")
+{
+  std::stringstream buffer {};
+  TraceSession const session {0x1234567890abcdefu, 2, 500, std::chrono::milliseconds {750}, "snes"};
+
+  SECTION("records are read back as written")
+  {
+    sf::Event resized {};
+    resized.type = sf::Event::Resized;
+    resized.size.width = 320;
+    resized.size.height = 240;
+    sf::Event moved {};
+    moved.type = sf::Event::JoystickMoved;
+    moved.joystickMove.joystickId = 1;
+    moved.joystickMove.axis = sf::Joystick::Y;
+    moved.joystickMove.position = -42.5f;
+    auto shifted = key_pressed(sf::Keyboard::Left);
+    shifted.key.shift = true;
+
+    {
+      InputRecorder recorder {buffer, session};
+      recorder.event(shifted);
+      recorder.event(resized);
+      recorder.event(moved);
+      recorder.update(sf::milliseconds(10));
+      recorder.update(sf::milliseconds(10));
+      recorder.update(sf::milliseconds(10));
+      recorder.collect();
+      recorder.update(sf::microseconds(-5));
+      recorder.render(.25f);
+      recorder.commit(GameStateManager::Transition::Replace);
+      recorder.checksum(0xfeedfacecafebeefu);
+    }
+
+    InputTrace trace {buffer};
+    REQUIRE(trace.session().m_seed == session.m_seed);
+    REQUIRE(trace.session().m_computerThreads == 2);
+    REQUIRE(trace.session().m_computerPlayouts == 500);
+    REQUIRE(trace.session().m_computerBudget == std::chrono::milliseconds {750});
+    REQUIRE(trace.session().m_keyLayout == "snes");
+
+    TraceRecord record {};
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_kind == TraceRecord::Kind::Event);
+    REQUIRE(record.m_event.type == sf::Event::KeyPressed);
+    REQUIRE(record.m_event.key.code == sf::Keyboard::Left);
+    REQUIRE(record.m_event.key.shift);
+    REQUIRE_FALSE(record.m_event.key.alt);
+
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_event.type == sf::Event::Resized);
+    REQUIRE(record.m_event.size.width == 320);
+    REQUIRE(record.m_event.size.height == 240);
+
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_event.type == sf::Event::JoystickMoved);
+    REQUIRE(record.m_event.joystickMove.joystickId == 1);
+    REQUIRE(record.m_event.joystickMove.axis == sf::Joystick::Y);
+    REQUIRE(record.m_event.joystickMove.position == -42.5f);
+
+    // equal updates are stored as one run
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_kind == TraceRecord::Kind::Update);
+    REQUIRE(record.m_count == 3);
+    REQUIRE(record.m_elapsed == sf::milliseconds(10));
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_kind == TraceRecord::Kind::Collect);
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_count == 1);
+    REQUIRE(record.m_elapsed == sf::microseconds(-5));
+
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_kind == TraceRecord::Kind::Render);
+    REQUIRE(record.m_alpha == .25f);
+
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_kind == TraceRecord::Kind::Commit);
+    REQUIRE(record.m_transition == GameStateManager::Transition::Replace);
+
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_kind == TraceRecord::Kind::Checksum);
+    REQUIRE(record.m_checksum == 0xfeedfacecafebeefu);
+
+    REQUIRE_FALSE(trace.next(record));
+    REQUIRE_FALSE(trace.is_truncated());
+  }
+
+  SECTION("a steady session costs a few bytes per frame")
+  {
+    std::size_t header = 0;
+    {
+      InputRecorder recorder {buffer, session};
+      recorder.flush();
+      header = buffer.str().size();
+      for (auto n = 0; n < 600; ++n)
+      {
+        recorder.update(sf::microseconds(16666));
+        recorder.render(.5f);
+      }
+    }
+    REQUIRE(buffer.str().size() - header <= 600 * 10);
+  }
+
+  SECTION("a cut off trace ends early")
+  {
+    {
+      InputRecorder recorder {buffer, session};
+      recorder.event(key_pressed(sf::Keyboard::Enter));
+      recorder.checksum(0xfeedfacecafebeefu);
+    }
+    auto const data = buffer.str();
+    std::istringstream in {data.substr(0, data.size() - 2)};
+
+    InputTrace trace {in};
+    TraceRecord record {};
+    REQUIRE(trace.next(record));
+    REQUIRE(record.m_event.key.code == sf::Keyboard::Enter);
+    REQUIRE_FALSE(trace.next(record));
+    REQUIRE(trace.is_truncated());
+  }
+
+  SECTION("garbage is rejected")
+  {
+    std::istringstream notATrace {"OBPK garbage"};
+    REQUIRE_THROWS_AS(InputTrace {notATrace}, std::runtime_error);
+
+    // older traces name the layout only
+    std::istringstream outdated {std::string {"OBIT"} + static_cast<char>(InputRecorder::VERSION - 1)};
+    REQUIRE_THROWS_AS(InputTrace {outdated}, std::runtime_error);
+
+    {
+      InputRecorder recorder {buffer, session};
+    }
+    buffer << '\x7f';
+    InputTrace trace {buffer};
+    TraceRecord record {};
+    REQUIRE_THROWS_AS(trace.next(record), std::runtime_error);
+  }
+}
+
+TEST_CASE("Input replay", "[core][trace]")
+{
+  std::stringstream buffer {};
+
+  SECTION("game states are fed exactly like in the recorded session")
+  {
+    auto const recorded = std::make_shared<std::vector<std::string>>();
+    {
+      auto const gsm = std::make_shared<GameStateManager>();
+      gsm->set_recorder(std::make_shared<InputRecorder>(buffer, TraceSession {}));
+
+      // nothing is there to be fed yet
+      gsm->handle_event(key_pressed(sf::Keyboard::A));
+      gsm->preload_state(std::make_shared<TranscriptGameState>(gsm, "first", recorded));
+      commit_when_loaded(*gsm);
+      gsm->handle_event(key_pressed(sf::Keyboard::B));
+      gsm->update(sf::milliseconds(10));
+      gsm->update(sf::milliseconds(10));
+      gsm->render(.5f);
+      gsm->preload_state(std::make_shared<TranscriptGameState>(gsm, "second", recorded),
+                         GameStateManager::Transition::Replace);
+      commit_when_loaded(*gsm);
+      gsm->update(sf::milliseconds(7));
+      gsm->render(.7f);
+      gsm->set_recorder(nullptr);
+      gsm->pop_state();
+    }
+
+    auto const replayed = std::make_shared<std::vector<std::string>>();
+    auto const gsm = std::make_shared<GameStateManager>();
+    std::vector<std::shared_ptr<GameState>> states {
+        std::make_shared<TranscriptGameState>(gsm, "first", replayed),
+        std::make_shared<TranscriptGameState>(gsm, "second", replayed),
+    };
+    std::size_t committed = 0;
+    int presented = 0;
+
+    InputTrace trace {buffer};
+    InputReplay replay {trace, *gsm};
+    replay.run([&states, &committed]() -> std::shared_ptr<GameState> {
+      return committed < states.size() ? states[committed++] : nullptr;
+    }, [&presented] { ++presented; });
+    gsm->pop_state();
+
+    REQUIRE(*replayed == *recorded);
+    REQUIRE(presented == 2);
+
+    auto const & statistics = replay.statistics();
+    REQUIRE(statistics.m_frames == 2);
+    REQUIRE(statistics.m_events == 1);
+    REQUIRE(statistics.m_ticks == 3);
+    REQUIRE(statistics.m_commits == 2);
+    REQUIRE(statistics.m_simulated == sf::milliseconds(27));
+    REQUIRE_FALSE(statistics.m_hasChecksum);
+    REQUIRE(replay.frame_times().count() == 2);
+  }
+
+  SECTION("a match against the computer ends the same way")
+  {
+    replay_match(buffer, 2);
+  }
+
+  SECTION("the computer's thread count is recorded as it was resolved")
+  {
+    replay_match(buffer, 0);
+  }
+}
@@ -0,0 +1,272 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/Time.hpp>
+
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+#include "../game/job_system.hxx"
+#include "../game/load_progress.hxx"
+
+namespace {
+  JobSystem::Settings threads(unsigned const count)
+  {
+    JobSystem::Settings settings {};
+    settings.m_threads = count;
+    return settings;
+  }
+
+  struct SlowGameState final : public GameState
+  {
+    std::thread::id m_loadedOn;
+
+    explicit SlowGameState(std::shared_ptr<GameStateManager> gsm)
+        : GameState {std::move(gsm)}
+    {
+    }
+
+    void load(LoadProgress & /* progress */) override
+    {
+      m_loadedOn = std::this_thread::get_id();
+    }
+
+    void set_up() override
+    {
+    }
+
+    void update(sf::Time const & /* elapsed */) override
+    {
+    }
+
+    void render(float /* alpha */) override
+    {
+    }
+
+    void handle_event(sf::Event const & /* event */) override
+    {
+    }
+
+    sf::Time next_wakeup() const override
+    {
+      return never();
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+
+  /**
+   * @brief Naive recursion, every call below the cutoff is a job of its own.
+   */
+  std::uint64_t fibonacci(JobSystem & jobs, unsigned const n)
+  {
+    if (n < 2)
+      return n;
+    if (n < 12)
+      return fibonacci(jobs, n - 1) + fibonacci(jobs, n - 2);
+
+    auto left = jobs.async([&jobs, n] { return fibonacci(jobs, n - 1); });
+    auto const right = fibonacci(jobs, n - 2);
+    return left.get() + right;
+  }
+}
+
+TEST_CASE("Job system", "[core][jobs]")
+{
+  SECTION("the default leaves a core to the main thread")
+  {
+    JobSystem jobs {JobSystem::Settings {}};
+    auto const cores = std::max(std::thread::hardware_concurrency(), 2u);
+    REQUIRE(jobs.thread_count() == cores - 1);
+    REQUIRE_FALSE(jobs.is_pinned());
+  }
+
+  SECTION("futures deliver results and exceptions")
+  {
+    JobSystem jobs {threads(2)};
+    auto answer = jobs.async([] { return 42; });
+    auto broken = jobs.async([]() -> int { throw std::runtime_error {"broken"}; });
+    auto nothing = jobs.async([] {});
+
+    REQUIRE(answer.get() == 42);
+    REQUIRE_THROWS_AS(broken.get(), std::runtime_error);
+    nothing.get();
+    REQUIRE(nothing.is_ready());
+  }
+
+  SECTION("jobs run after the jobs they depend on")
+  {
+    JobSystem jobs {threads(4)};
+    std::vector<int> order {};
+    std::mutex mutex {};
+    auto const log = [&order, &mutex](int const step) {
+      return [&order, &mutex, step] {
+        std::this_thread::sleep_for(std::chrono::milliseconds {1});
+        std::lock_guard<std::mutex> const lock {mutex};
+        order.push_back(step);
+      };
+    };
+
+    // a diamond: 1 before 2 and 3, both before 4
+    auto const first = jobs.schedule(log(1));
+    auto const left = jobs.schedule(log(2), {first});
+    auto const right = jobs.schedule(log(3), {first});
+    auto const last = jobs.schedule(log(4), {left, right, JobHandle {}});
+    jobs.wait(last);
+
+    REQUIRE(order.size() == 4);
+    REQUIRE(order.front() == 1);
+    REQUIRE(order.back() == 4);
+    REQUIRE(first.is_done());
+    REQUIRE(left.is_done());
+    REQUIRE(right.is_done());
+  }
+
+  SECTION("jobs may wait for the jobs they scheduled")
+  {
+    JobSystem jobs {threads(1)};
+    REQUIRE(fibonacci(jobs, 20) == 6765);
+
+    JobSystem more {threads(4)};
+    REQUIRE(more.async([&more] { return fibonacci(more, 24); }).get() == 46368);
+    auto const statistics = more.statistics();
+    REQUIRE(statistics.m_executed + statistics.m_helped > 0);
+  }
+
+  SECTION("parallel_for visits every index once")
+  {
+    JobSystem jobs {threads(3)};
+    std::vector<std::atomic<int>> visits(1000);
+    for (auto & visit : visits)
+      visit.store(0);
+
+    jobs.parallel_for(visits.size(), 64, [&visits](std::size_t const n) { ++visits[n]; });
+    auto const once = std::all_of(visits.begin(), visits.end(), [](std::atomic<int> const & visit) {
+      return visit.load() == 1;
+    });
+    REQUIRE(once);
+
+    REQUIRE_THROWS_AS(
+        jobs.parallel_for(10, 1, [](std::size_t const n) {
+          if (n == 7)
+            throw std::out_of_range {"seven"};
+        }),
+        std::out_of_range
+    );
+  }
+
+  SECTION("main thread jobs only run on the main thread")
+  {
+    JobSystem jobs {threads(2)};
+    auto const main = std::this_thread::get_id();
+
+    auto computed = jobs.async([] { return std::this_thread::get_id(); });
+    auto continued = jobs.async([] { return std::this_thread::get_id(); }, {computed.handle()},
+                                JobSystem::Affinity::MainThread);
+    REQUIRE(jobs.has_main_thread_jobs());
+
+    while (!computed.is_ready())
+      std::this_thread::yield();
+    REQUIRE_FALSE(continued.is_ready());
+    REQUIRE(jobs.run_main_thread_jobs() == 1);
+    REQUIRE_FALSE(jobs.has_main_thread_jobs());
+    REQUIRE(computed.get() != main);
+    REQUIRE(continued.get() == main);
+
+    // waiting on the main thread runs them as well
+    auto waited = jobs.async([] { return 7; }, {}, JobSystem::Affinity::MainThread);
+    REQUIRE(waited.get() == 7);
+    REQUIRE(jobs.run_main_thread_jobs() == 0);
+  }
+
+  SECTION("queued jobs run before the workers stop")
+  {
+    std::atomic<int> runs {0};
+    {
+      JobSystem jobs {threads(2)};
+      for (auto n = 0; n < 100; ++n)
+        jobs.schedule([&runs] { ++runs; });
+    }
+    REQUIRE(runs.load() == 100);
+  }
+
+  SECTION("workers may be pinned to cores")
+  {
+    JobSystem::Settings settings {threads(2)};
+    settings.m_pinned = true;
+    JobSystem jobs {settings};
+    REQUIRE(jobs.async([] { return 1; }).get() == 1);
+#if defined(__linux__)
+    REQUIRE(jobs.is_pinned());
+#endif
+  }
+}
+
+TEST_CASE("GameStateManager with a job system", "[core][jobs][GameStateManager]")
+{
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto const jobs = std::make_shared<JobSystem>(threads(2));
+  gsm->set_job_system(jobs);
+
+  SECTION("states are preloaded by the workers")
+  {
+    auto const state = std::make_shared<SlowGameState>(gsm);
+    auto const progress = gsm->preload_state(state);
+    while (gsm->is_loading())
+    {
+      gsm->commit_loaded_states();
+      std::this_thread::yield();
+    }
+
+    REQUIRE(progress->status() == LoadProgress::Status::Ready);
+    REQUIRE(std::addressof(gsm->current()) == state.get());
+    REQUIRE(state->m_loadedOn != std::this_thread::get_id());
+    REQUIRE(state->m_loadedOn != std::thread::id {});
+  }
+
+  SECTION("main thread jobs run during update")
+  {
+    gsm->push_state(std::make_shared<SlowGameState>(gsm));
+    REQUIRE(gsm->next_wakeup() == GameState::never());
+
+    auto const background = jobs->async([] { return 20; });
+    auto continued = jobs->async([] { return 22; }, {background.handle()}, JobSystem::Affinity::MainThread);
+    REQUIRE(gsm->next_wakeup() == sf::Time::Zero);
+
+    while (!continued.is_ready())
+    {
+      gsm->update(sf::milliseconds(10));
+      std::this_thread::yield();
+    }
+    REQUIRE(continued.get() == 22);
+  }
+
+  while (!gsm->is_empty())
+    gsm->pop_state();
+}
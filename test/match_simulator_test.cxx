@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "../game/job_system.hxx"
+#include "../game/match_simulator.hxx"
+#include "../game/resources.hxx"
+
+namespace {
+  void require_same(MatchSimulator::Statistics const & lhs, MatchSimulator::Statistics const & rhs)
+  {
+    REQUIRE(lhs.m_matches == rhs.m_matches);
+    REQUIRE(lhs.m_firstWins == rhs.m_firstWins);
+    REQUIRE(lhs.m_secondWins == rhs.m_secondWins);
+    REQUIRE(lhs.m_draws == rhs.m_draws);
+    REQUIRE(lhs.m_moves == rhs.m_moves);
+    REQUIRE(lhs.m_turns == rhs.m_turns);
+    REQUIRE(lhs.m_decks.size() == rhs.m_decks.size());
+    for (std::size_t n = 0; n < lhs.m_decks.size(); ++n)
+    {
+      REQUIRE(lhs.m_decks[n].m_matches == rhs.m_decks[n].m_matches);
+      REQUIRE(lhs.m_decks[n].m_wins == rhs.m_decks[n].m_wins);
+      REQUIRE(lhs.m_decks[n].m_draws == rhs.m_decks[n].m_draws);
+    }
+  }
+}
+
+TEST_CASE("Match simulator", "[core][match]")
+{
+  Resources resources {OVENBRICK_ASSET_PACK, 1024 * 1024};
+  CardDatabase const cards {resources.get("cards/cards.db")};
+
+  MatchSimulator::Settings settings {};
+  settings.m_matches = 24;
+  settings.m_decks = 4;
+  settings.m_seed = 7;
+  settings.m_computer.m_maxPlayouts = 8;
+  settings.m_computer.m_budget = std::chrono::seconds {30};
+  settings.m_reportInterval = 8;
+
+  SECTION("the statistics do not depend on the number of threads")
+  {
+    MatchSimulator const simulator {cards, settings};
+    JobSystem single {JobSystem::Settings {1, false}};
+    JobSystem many {JobSystem::Settings {3, false}};
+
+    auto const lhs = simulator.run(single);
+    auto const rhs = simulator.run(many);
+    REQUIRE(lhs.m_threads == 2);
+    REQUIRE(rhs.m_threads == 4);
+    require_same(lhs, rhs);
+  }
+
+  SECTION("every match is counted for both decks")
+  {
+    settings.m_computer.m_maxPlayouts = 0; // random moves
+    settings.m_matches = 200;
+    MatchSimulator const simulator {cards, settings};
+    JobSystem jobs {JobSystem::Settings {2, false}};
+
+    // reports may come from any thread, so only count them
+    unsigned reports = 0;
+    std::uint64_t reported = 0;
+    auto const statistics = simulator.run(jobs, [&reports, &reported](MatchSimulator::Statistics const & sofar) {
+      ++reports;
+      reported = std::max(reported, sofar.m_matches);
+    });
+    REQUIRE(reports > 0);
+    REQUIRE(reported < 200);
+    REQUIRE(statistics.m_matches == 200);
+    REQUIRE(statistics.m_firstWins + statistics.m_secondWins + statistics.m_draws == 200);
+
+    std::uint64_t deckMatches = 0;
+    for (auto const & deck : statistics.m_decks)
+    {
+      REQUIRE(deck.m_wins + deck.m_losses + deck.m_draws == deck.m_matches);
+      deckMatches += deck.m_matches;
+    }
+    REQUIRE(deckMatches == 400);
+
+    std::ostringstream out {};
+    write_json(out, statistics, cards);
+    auto const json = out.str();
+    REQUIRE(json.find("\"matches\": 200") != std::string::npos);
+    REQUIRE(json.back() == '\n');
+    REQUIRE(json.find('\n') == json.size() - 1);
+  }
+
+  SECTION("a single threaded search picks the same move as the background search")
+  {
+    MatchSimulator const simulator {cards, settings};
+    auto const & decks = simulator.decks();
+    Match match {cards, decks[0], decks[1], 3};
+
+    auto computer = settings.m_computer;
+    computer.m_threads = 1;
+    computer.m_maxPlayouts = 200;
+    MctsWorkspace workspace {};
+    MctsSearch search {computer};
+    for (unsigned move = 0; move < 8 && !match.is_over(); ++move)
+    {
+      search.start(match);
+      auto const expected = search.result();
+      REQUIRE(MctsSearch::run(match, computer, workspace) == expected);
+      match.apply(expected);
+    }
+  }
+}
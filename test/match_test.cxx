@@ -0,0 +1,426 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/Time.hpp>
+
+#include <SFML/Window/Event.hpp>
+
+#include "../game/game_state_manager.hxx"
+#include "../game/keyboard_layout.hxx"
+#include "../game/match.hxx"
+#include "../game/match_game_state.hxx"
+#include "../game/mcts.hxx"
+#include "../game/renderer.hxx"
+#include "../game/resources.hxx"
+
+namespace {
+  std::unique_ptr<CardDatabase> database(std::vector<CardDefinition> const & cards)
+  {
+    std::ostringstream out {};
+    CardDatabase::write(out, cards);
+    auto const image = out.str();
+    auto const buffer = std::make_shared<std::vector<char>>(image.begin(), image.end());
+    return std::unique_ptr<CardDatabase> {new CardDatabase {Asset {buffer, buffer->data(), buffer->size()}}};
+  }
+
+  CardDefinition minion(CardId id, std::uint8_t cost, std::uint8_t attack, std::uint8_t health,
+                        std::uint32_t keywords = 0)
+  {
+    return CardDefinition {id, "Minion " + std::to_string(id), CardType::Minion, cost, attack, health, keywords, ""};
+  }
+
+  Deck deck_of(CardDatabase const & cards, CardId id)
+  {
+    Deck deck {};
+    deck.fill(cards.find(id));
+    return deck;
+  }
+
+  bool has_move(Match const & match, Move const & move)
+  {
+    MoveList moves {};
+    match.legal_moves(moves);
+    return std::find(moves.begin(), moves.end(), move) != moves.end();
+  }
+
+  Move const END_TURN {Move::Kind::EndTurn, 0, 0};
+}
+
+TEST_CASE("Match rules", "[core][match]")
+{
+  auto const taunt = keyword_bit(Keyword::Taunt);
+  auto const charge = keyword_bit(Keyword::Charge);
+  auto const cards = database({
+      minion(1, 1, 1, 2),
+      minion(2, 1, 0, 5, taunt),
+      minion(3, 1, 1, 1, charge),
+      minion(4, 1, 1, 1, charge | keyword_bit(Keyword::Poisonous)),
+      minion(5, 1, 0, 5, taunt | keyword_bit(Keyword::DivineShield)),
+      CardDefinition {6, "Spell", CardType::Spell, 1, 3, 0, 0, ""},
+  });
+
+  SECTION("the match starts with the first player's first turn")
+  {
+    Match match {*cards, deck_of(*cards, 1), deck_of(*cards, 1), 0};
+    REQUIRE(match.active() == 0);
+    REQUIRE(match.turn() == 1);
+    REQUIRE(match.side(0).m_handSize == 4);
+    REQUIRE(match.side(1).m_handSize == 4);
+    REQUIRE(match.side(0).m_mana == 1);
+    REQUIRE(match.side(1).m_mana == 0);
+    REQUIRE(match.side(0).m_health == Match::STARTING_HEALTH);
+
+    MoveList moves {};
+    match.legal_moves(moves);
+    REQUIRE(moves.size() == 5);
+    REQUIRE(moves[0] == END_TURN);
+
+    match.apply(Move {Move::Kind::Play, 0, 0});
+    REQUIRE(match.side(0).m_boardSize == 1);
+    REQUIRE(match.side(0).m_handSize == 3);
+    REQUIRE(match.side(0).m_mana == 0);
+    REQUIRE_FALSE(has_move(match, Move {Move::Kind::Attack, 0, HERO_TARGET})); // no charge
+
+    match.apply(END_TURN);
+    REQUIRE(match.active() == 1);
+    REQUIRE(match.side(1).m_handSize == 5);
+    REQUIRE(match.side(1).m_mana == 1);
+  }
+
+  SECTION("taunt guards the hero, poisonous ignores health, divine shield absorbs a hit")
+  {
+    Match match {*cards, deck_of(*cards, 4), deck_of(*cards, 5), 0};
+    match.apply(END_TURN);
+    match.apply(Move {Move::Kind::Play, 0, 0});
+    match.apply(END_TURN);
+    match.apply(Move {Move::Kind::Play, 0, 0});
+    match.apply(Move {Move::Kind::Play, 0, 0});
+
+    REQUIRE(has_move(match, Move {Move::Kind::Attack, 0, 0}));
+    REQUIRE_FALSE(has_move(match, Move {Move::Kind::Attack, 0, HERO_TARGET}));
+
+    match.apply(Move {Move::Kind::Attack, 0, 0});
+    REQUIRE(match.side(1).m_boardSize == 1);
+    REQUIRE(match.side(1).m_board[0].m_health == 5);
+    REQUIRE_FALSE(match.side(1).m_board[0].m_flags & Minion::DivineShield);
+
+    match.apply(Move {Move::Kind::Attack, 1, 0});
+    REQUIRE(match.side(1).m_boardSize == 0);
+    REQUIRE(match.side(0).m_boardSize == 2);
+    REQUIRE_FALSE(has_move(match, Move {Move::Kind::Attack, 0, HERO_TARGET})); // attacked already
+  }
+
+  SECTION("spells damage the enemy hero")
+  {
+    Match match {*cards, deck_of(*cards, 6), deck_of(*cards, 1), 0};
+    match.apply(Move {Move::Kind::Play, 0, HERO_TARGET});
+    REQUIRE(match.side(1).m_health == Match::STARTING_HEALTH - 3);
+  }
+
+  SECTION("running out of cards causes fatigue")
+  {
+    Match match {*cards, deck_of(*cards, 2), deck_of(*cards, 2), 0};
+    while (!match.is_over())
+      match.apply(END_TURN);
+
+    // the second player started with more cards and runs out first
+    REQUIRE(match.result() == Match::Result::FirstWins);
+    REQUIRE(match.side(1).m_health == 0);
+    REQUIRE(match.side(1).m_fatigue > match.side(0).m_fatigue);
+    REQUIRE(match.turn() < Match::MAX_TURNS);
+
+    MoveList moves {};
+    match.legal_moves(moves);
+    REQUIRE(moves.empty());
+  }
+}
+
+TEST_CASE("Match hashing and undo", "[core][match]")
+{
+  auto const cards = database({
+      minion(1, 1, 1, 2),
+      minion(2, 2, 1, 4, keyword_bit(Keyword::Taunt)),
+      minion(3, 2, 3, 1, keyword_bit(Keyword::Charge)),
+      minion(4, 3, 2, 3, keyword_bit(Keyword::DivineShield)),
+      minion(5, 4, 3, 5, keyword_bit(Keyword::Lifesteal)),
+      minion(6, 4, 2, 4, keyword_bit(Keyword::Windfury)),
+      minion(7, 3, 1, 3, keyword_bit(Keyword::Stealth) | keyword_bit(Keyword::Poisonous)),
+      minion(8, 5, 5, 3, keyword_bit(Keyword::Rush)),
+      CardDefinition {9, "Scorch", CardType::Spell, 2, 3, 0, 0, ""},
+  });
+
+  std::mt19937 random {42};
+  for (std::uint64_t game = 0; game < 20; ++game)
+  {
+    Match match {*cards, Match::random_deck(*cards, game), Match::random_deck(*cards, game + 100), game};
+    auto const initial = match.hash();
+    REQUIRE(initial == match.compute_hash());
+
+    std::vector<Match::Undo> undos {};
+    std::vector<std::uint64_t> hashes {};
+    MoveList moves {};
+    while (!match.is_over())
+    {
+      match.legal_moves(moves);
+      REQUIRE_FALSE(moves.empty());
+      hashes.push_back(match.hash());
+      undos.push_back(match.apply(moves[random() % moves.size()]));
+      REQUIRE(match.hash() == match.compute_hash());
+      REQUIRE(match.hash() != hashes.back());
+    }
+
+    while (!undos.empty())
+    {
+      match.undo(undos.back());
+      undos.pop_back();
+      REQUIRE(match.hash() == hashes.back());
+      hashes.pop_back();
+    }
+    REQUIRE(match.hash() == initial);
+    REQUIRE(match.turn() == 1);
+    REQUIRE(match.side(0).m_handSize == 4);
+    REQUIRE(match.side(1).m_boardSize == 0);
+  }
+}
+
+TEST_CASE("Saving matches", "[core][match]")
+{
+  auto const cards = database({minion(1, 1, 1, 2), minion(2, 2, 1, 2), minion(3, 3, 1, 2)});
+  Match match {*cards, Match::random_deck(*cards, 1), Match::random_deck(*cards, 2), 3};
+  MoveList moves {};
+  for (unsigned n = 0; n < 12; ++n)
+  {
+    match.legal_moves(moves);
+    match.apply(moves[moves.size() - 1]);
+  }
+
+  std::ostringstream out {};
+  match.write(out);
+  auto const data = out.str();
+
+  SECTION("a match continues where it was left")
+  {
+    auto const read = Match::read(*cards, data.data(), data.size());
+    REQUIRE(read.hash() == match.hash());
+    REQUIRE(read.turn() == match.turn());
+    REQUIRE(read.active() == match.active());
+    REQUIRE(read.side(0).m_handSize == match.side(0).m_handSize);
+  }
+
+  SECTION("cards are found by id in a changed database")
+  {
+    auto const changed = database({minion(0, 5, 1, 2), minion(1, 1, 1, 2), minion(2, 2, 1, 2), minion(3, 3, 1, 2)});
+    auto const read = Match::read(*changed, data.data(), data.size());
+    REQUIRE(read.hash() == read.compute_hash());
+    auto const & side = read.side(match.active());
+    for (unsigned slot = 0; slot < side.m_handSize; ++slot)
+      REQUIRE(changed->id(side.m_hand[slot]) == cards->id(match.side(match.active()).m_hand[slot]));
+  }
+
+  SECTION("malformed matches are rejected")
+  {
+    auto const fewer = database({minion(1, 1, 1, 2)});
+    REQUIRE_THROWS_AS(Match::read(*fewer, data.data(), data.size()), std::runtime_error);
+    REQUIRE_THROWS_AS(Match::read(*cards, data.data(), data.size() - 1), std::runtime_error);
+    REQUIRE_THROWS_AS(Match::read(*cards, (data + '\0').data(), data.size() + 1), std::runtime_error);
+
+    // saves of another format are not mistaken for this one
+    auto other = data;
+    ++other[0];
+    REQUIRE_THROWS_AS(Match::read(*cards, other.data(), other.size()), std::runtime_error);
+  }
+}
+
+TEST_CASE("Monte-Carlo tree search", "[core][match]")
+{
+  auto const cards = database({minion(1, 1, Match::STARTING_HEALTH, 1, keyword_bit(Keyword::Charge))});
+  Match match {*cards, deck_of(*cards, 1), deck_of(*cards, 1), 0};
+
+  MctsSearch::Settings settings {};
+  settings.m_threads = 2;
+  settings.m_budget = std::chrono::seconds {30};
+  settings.m_maxPlayouts = 500;
+  MctsSearch search {settings};
+
+  SECTION("finds a lethal attack")
+  {
+    for (unsigned move = 0; move < 2; ++move)
+    {
+      search.start(match);
+      REQUIRE(search.is_running());
+      match.apply(search.result());
+      REQUIRE_FALSE(search.is_running());
+      REQUIRE(search.statistics().m_threads == 2);
+      REQUIRE(search.statistics().m_playouts == 1000);
+    }
+    REQUIRE(match.result() == Match::Result::FirstWins);
+  }
+
+  SECTION("forced moves and finished matches are not searched")
+  {
+    auto const expensive = database({minion(1, 5, 5, 5)});
+    Match other {*expensive, deck_of(*expensive, 1), deck_of(*expensive, 1), 0};
+    search.start(other);
+    REQUIRE(search.is_done());
+    REQUIRE(search.result() == END_TURN);
+    REQUIRE(search.statistics().m_threads == 0);
+
+    match.apply(Move {Move::Kind::Play, 0, 0});
+    match.apply(Move {Move::Kind::Attack, 0, HERO_TARGET});
+    REQUIRE_THROWS_AS(search.start(match), std::logic_error);
+  }
+
+  SECTION("cancelling stops early")
+  {
+    settings.m_maxPlayouts = 0;
+    MctsSearch endless {settings};
+    endless.start(match);
+    endless.cancel();
+    static_cast<void>(endless.result());
+    REQUIRE(endless.statistics().m_elapsed < std::chrono::seconds {30});
+  }
+}
+
+TEST_CASE("Match game state", "[core][match]")
+{
+  using clock = std::chrono::steady_clock;
+
+  KeyboardLayout::current = KeyboardLayout::SNES;
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto const resources = std::make_shared<Resources>(OVENBRICK_ASSET_PACK, 1024 * 1024);
+  auto const settings = std::make_shared<MctsSearch::Settings>();
+  settings->m_threads = 2;
+  settings->m_budget = std::chrono::milliseconds {100};
+
+  auto const renderer = std::make_shared<Renderer>(sf::Vector2u {320, 240});
+  auto const state = std::make_shared<MatchGameState>(gsm, resources, settings, renderer);
+  gsm->push_state(state);
+  REQUIRE(state->match() != nullptr);
+  REQUIRE(state->match()->active() == MatchGameState::PLAYER);
+
+  sf::Event event {};
+  event.type = sf::Event::KeyPressed;
+  event.key.code = KeyboardLayout::current.m_keyStart;
+  gsm->handle_event(event);
+  // actions are handed over with the next update
+  REQUIRE(state->match()->active() == MatchGameState::PLAYER);
+  gsm->update(sf::Time::Zero);
+  REQUIRE(state->match()->active() == MatchGameState::COMPUTER);
+
+  SECTION("the computer's thinking time is slept through")
+  {
+    REQUIRE(gsm->next_wakeup() == sf::Time::Zero);
+    gsm->render(0.f);
+    if (!state->search().is_forced())
+    {
+      REQUIRE(gsm->next_wakeup() == sf::milliseconds(100));
+      gsm->update(sf::milliseconds(30));
+      REQUIRE(gsm->next_wakeup() == sf::milliseconds(70));
+    }
+  }
+
+  SECTION("the move is taken on the first tick the search is done")
+  {
+    REQUIRE(gsm->next_wakeup() == sf::Time::Zero);
+
+    // the search starts with the update that ended the player's turn,
+    // every later tick passes the whole thinking time, so only the threads hold the move back
+    auto const thinkingTime = sf::microseconds(std::chrono::microseconds {settings->m_budget}.count());
+    auto thought = state->is_thinking();
+    auto const deadline = clock::now() + std::chrono::seconds {20};
+    while (state->match()->active() == MatchGameState::COMPUTER && !state->match()->is_over())
+    {
+      REQUIRE(clock::now() < deadline);
+      auto const & search = state->search();
+      auto const done = search.is_running() && search.is_done();
+      auto const before = state->match()->hash();
+      gsm->update(thinkingTime);
+      if (done)
+        REQUIRE(state->match()->hash() != before);
+      thought = thought || state->is_thinking();
+      std::this_thread::yield();
+    }
+    REQUIRE(thought);
+
+    // idle once the computer's move is on screen
+    REQUIRE(gsm->next_wakeup() == sf::Time::Zero);
+    gsm->render(0.f);
+    REQUIRE(gsm->next_wakeup() == GameState::never());
+  }
+
+  SECTION("thinking never blocks update")
+  {
+    // the threads only stop when cancelled, simulated time runs far ahead of them
+    auto const patient = std::make_shared<MctsSearch::Settings>(*settings);
+    patient->m_budget = std::chrono::hours {1};
+    auto const other = std::make_shared<GameStateManager>();
+    auto const thinker = std::make_shared<MatchGameState>(other, resources, patient, renderer);
+    other->push_state(thinker);
+
+    // the player passes until the computer has more than one move to choose from
+    auto const & search = thinker->search();
+    for (auto tick = 0; !search.is_running() || search.is_forced(); ++tick)
+    {
+      REQUIRE(tick < 1000);
+      REQUIRE_FALSE(thinker->match()->is_over());
+      if (thinker->match()->active() == MatchGameState::PLAYER)
+        other->handle_event(event);
+      other->update(sf::seconds(7200));
+    }
+
+    auto const before = thinker->match()->hash();
+    for (auto tick = 0; tick < 10; ++tick)
+    {
+      other->update(sf::seconds(7200));
+      REQUIRE(thinker->is_thinking());
+      REQUIRE_FALSE(search.is_done());
+    }
+    REQUIRE(thinker->match()->hash() == before);
+
+    // the frames do not spin while waiting for the threads
+    other->render(0.f);
+    REQUIRE(other->next_wakeup() > sf::Time::Zero);
+    REQUIRE(other->next_wakeup() < GameState::never());
+    other->pop_state();
+  }
+
+  SECTION("an unchanged table is not drawn again")
+  {
+    sf::RenderTexture screen {};
+    REQUIRE(screen.create(320, 240));
+    gsm->render(0.f);
+    renderer->present(screen);
+    REQUIRE(renderer->statistics().m_redrawnItems > 0);
+
+    gsm->render(0.f);
+    renderer->present(screen);
+    REQUIRE(renderer->statistics().m_redrawnItems == 0);
+  }
+
+  gsm->pop_state();
+}
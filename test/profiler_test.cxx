@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../game/profiler.hxx"
+
+#ifdef OVENBRICK_PROFILING
+#include <SFML/System/Time.hpp>
+
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+#endif
+
+TEST_CASE("LatencyHistogram", "[core][Profiler]")
+{
+  LatencyHistogram histogram {};
+
+  SECTION("Buckets cover all values without gaps")
+  {
+    REQUIRE(LatencyHistogram::bucket_of(0) == 0);
+    for (unsigned bucket = 1; bucket < LatencyHistogram::BUCKETS; ++bucket)
+    {
+      auto const lower = LatencyHistogram::bucket_limit(bucket - 1);
+      REQUIRE(LatencyHistogram::bucket_of(lower) == bucket);
+      REQUIRE(LatencyHistogram::bucket_of(lower - 1) == bucket - 1);
+    }
+  }
+
+  SECTION("Percentiles are accurate within a bucket")
+  {
+    for (std::uint64_t n = 1; n <= 1000; ++n)
+      histogram.record(n * 1000);
+
+    REQUIRE(histogram.count() == 1000);
+    REQUIRE(histogram.max() == 1000000);
+    REQUIRE(histogram.total() == 500500000);
+    REQUIRE(histogram.percentile(0.5) == Approx(500000).epsilon(0.125));
+    REQUIRE(histogram.percentile(0.99) == Approx(990000).epsilon(0.125));
+    REQUIRE(histogram.percentile(1.0) == 1000000);
+  }
+
+  SECTION("An empty histogram reports zero")
+  {
+    REQUIRE(histogram.percentile(0.5) == 0);
+    REQUIRE(histogram.max() == 0);
+  }
+
+  SECTION("Recording from multiple threads loses no samples")
+  {
+    constexpr auto const THREADS = 4;
+    constexpr auto const SAMPLES = 10000;
+
+    std::vector<std::thread> threads {};
+    for (auto t = 0; t < THREADS; ++t)
+      threads.emplace_back([&histogram, t] {
+        for (auto n = 0; n < SAMPLES; ++n)
+          histogram.record(static_cast<std::uint64_t>(t * SAMPLES + n));
+      });
+    for (auto & thread : threads)
+      thread.join();
+
+    REQUIRE(histogram.count() == THREADS * SAMPLES);
+    REQUIRE(histogram.max() == THREADS * SAMPLES - 1);
+  }
+}
+
+#ifdef OVENBRICK_PROFILING
+namespace {
+  struct ProfiledGameState final : public GameState
+  {
+    using GameState::GameState;
+
+    void set_up() override
+    {
+    }
+
+    void handle_event(sf::Event const & /* event */) override
+    {
+    }
+
+    void update(sf::Time const & /* elapsed */) override
+    {
+    }
+
+    void render(float /* alpha */) override
+    {
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+}
+
+TEST_CASE("GameStateManager is profiled per state", "[core][Profiler]")
+{
+  auto const gsm = std::make_shared<GameStateManager>();
+  auto & profile = Profiler::instance().profile(typeid(ProfiledGameState));
+  auto const updates = profile.m_update.count();
+
+  gsm->push_state(std::make_shared<ProfiledGameState>(gsm));
+  for (auto n = 0; n < 10; ++n)
+    gsm->update(sf::milliseconds(16));
+  gsm->pop_state();
+
+  REQUIRE(profile.m_update.count() == updates + 10);
+  REQUIRE(profile.m_setUp.count() >= 1);
+  REQUIRE(profile.m_tearDown.count() >= 1);
+
+  std::ostringstream json {};
+  Profiler::instance().write_json(json);
+  REQUIRE(json.str().find("ProfiledGameState") != std::string::npos);
+}
+#endif
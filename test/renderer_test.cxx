@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <vector>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/Graphics/Texture.hpp>
+
+#include "../game/renderer.hxx"
+
+namespace {
+  constexpr unsigned WIDTH = 320;
+  constexpr unsigned HEIGHT = 240;
+
+  Sprite card(float const x, float const y, sf::Texture const * texture = nullptr, int const layer = 0)
+  {
+    return Sprite {sf::FloatRect {x, y, 40.f, 50.f}, sf::FloatRect {0.f, 0.f, 16.f, 16.f}, texture, sf::Color::White,
+                   layer};
+  }
+
+  /**
+   * @brief A table with two rows of cards.
+   */
+  std::vector<Sprite> table(sf::Texture const & first, sf::Texture const & second)
+  {
+    std::vector<Sprite> sprites {};
+    for (unsigned n = 0; n < 7; ++n)
+    {
+      sprites.push_back(card(4.f + 45.f * n, 20.f, (n % 2) ? &first : &second));
+      sprites.push_back(card(4.f + 45.f * n, 100.f, (n % 2) ? &second : &first));
+    }
+    return sprites;
+  }
+
+  void submit(Renderer & renderer, std::vector<Sprite> const & sprites)
+  {
+    for (auto const & sprite : sprites)
+      renderer.draw(sprite);
+  }
+}
+
+TEST_CASE("Renderer", "[core][render]")
+{
+  sf::RenderTexture screen {};
+  REQUIRE(screen.create(WIDTH, HEIGHT));
+  sf::Texture first {};
+  REQUIRE(first.create(16, 16));
+  sf::Texture second {};
+  REQUIRE(second.create(16, 16));
+
+  Renderer renderer {sf::Vector2u {WIDTH, HEIGHT}};
+  auto sprites = table(first, second);
+  submit(renderer, sprites);
+  renderer.present(screen);
+
+  SECTION("the first frame is drawn completely, batched by texture")
+  {
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_items == sprites.size());
+    REQUIRE(statistics.m_redrawnItems == sprites.size());
+    REQUIRE(statistics.m_dirtyRegions == 1);
+    REQUIRE(statistics.m_redrawnPixels == WIDTH * HEIGHT);
+    REQUIRE(statistics.m_batches == 2);
+    REQUIRE(statistics.m_drawCalls == 4); // clear, two batches, present
+  }
+
+  SECTION("an unchanged frame is only presented")
+  {
+    submit(renderer, sprites);
+    renderer.present(screen);
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_items == sprites.size());
+    REQUIRE(statistics.m_redrawnItems == 0);
+    REQUIRE(statistics.m_dirtyRegions == 0);
+    REQUIRE(statistics.m_redrawnPixels == 0);
+    REQUIRE(statistics.m_drawCalls == 1);
+  }
+
+  SECTION("a changed sprite redraws its region only")
+  {
+    sprites[4].m_color = sf::Color::Red;
+    submit(renderer, sprites);
+    renderer.present(screen);
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_dirtyRegions == 1);
+    REQUIRE(statistics.m_redrawnPixels == 40 * 50);
+    REQUIRE(statistics.m_redrawnItems == 1);
+    REQUIRE(statistics.m_batches == 1);
+  }
+
+  SECTION("a moved sprite redraws where it was and where it is")
+  {
+    sprites[0].m_bounds.left = 200.f;
+    sprites[0].m_bounds.top = 180.f;
+    submit(renderer, sprites);
+    renderer.present(screen);
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_dirtyRegions == 2);
+    REQUIRE(statistics.m_redrawnPixels == 2 * 40 * 50);
+  }
+
+  SECTION("a removed sprite redraws the table below it")
+  {
+    sprites.pop_back();
+    submit(renderer, sprites);
+    renderer.present(screen);
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_dirtyRegions == 1);
+    REQUIRE(statistics.m_redrawnPixels == 40 * 50);
+    REQUIRE(statistics.m_redrawnItems == 0);
+  }
+
+  SECTION("scattered changes are merged into few regions")
+  {
+    for (std::size_t n = 0; n < sprites.size(); n += 4)
+      sprites[n].m_color = sf::Color::Blue;
+    submit(renderer, sprites);
+    renderer.present(screen);
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_dirtyRegions >= 1);
+    REQUIRE(statistics.m_dirtyRegions <= Renderer::MAX_DIRTY_REGIONS);
+    REQUIRE(statistics.m_redrawnPixels < WIDTH * HEIGHT);
+  }
+
+  SECTION("changing most of the screen redraws it as a whole")
+  {
+    std::vector<Sprite> moved {};
+    for (auto sprite : sprites)
+    {
+      sprite.m_bounds.top += 60.f;
+      moved.push_back(sprite);
+    }
+    moved.push_back(Sprite {sf::FloatRect {0.f, 0.f, 320.f, 240.f}, sf::FloatRect {}, nullptr, sf::Color::Black, -1});
+    submit(renderer, moved);
+    renderer.present(screen);
+    auto const & statistics = renderer.statistics();
+    REQUIRE(statistics.m_dirtyRegions == 1);
+    REQUIRE(statistics.m_redrawnPixels == WIDTH * HEIGHT);
+    REQUIRE(statistics.m_batches == 3);
+  }
+
+  SECTION("invalidating redraws everything")
+  {
+    renderer.invalidate();
+    submit(renderer, sprites);
+    renderer.present(screen);
+    REQUIRE(renderer.statistics().m_redrawnPixels == WIDTH * HEIGHT);
+  }
+}
@@ -14,17 +14,74 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
+
 #include <catch.hpp>
 
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 #include <SFML/Graphics/Font.hpp>
 
 #include "../game/resources.hxx"
 
-TEST_CASE("Embedded resources", "[core][resources]")
+namespace {
+  std::vector<char> compressible(std::size_t size, char c)
+  {
+    return std::vector<char>(size, c);
+  }
+}
+
+TEST_CASE("Packed resources", "[core][resources]")
 {
   SECTION("Fira Code can be loaded")
   {
+    Resources resources {OVENBRICK_ASSET_PACK, 1024 * 1024};
+
+    auto const asset = resources.get("fonts/FiraCode-Regular.ttf");
     sf::Font font;
-    REQUIRE(font.loadFromMemory(gFiraCodeData, gFiraCodeSize));
+    REQUIRE(font.loadFromMemory(asset.data(), asset.size()));
+  }
+
+  SECTION("Decoded assets are cached within the budget")
+  {
+    std::string const filename {"resources_test.pack"};
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      write_asset_pack(out, {
+          {"a", compressible(400, 'a')},
+          {"b", compressible(400, 'b')},
+          {"c", compressible(400, 'c')},
+          {"huge", compressible(4000, 'h')},
+      });
+    }
+
+    Resources resources {filename, 1000};
+    REQUIRE(resources.budget() == 1000);
+    REQUIRE(resources.cached_bytes() == 0);
+    REQUIRE_THROWS_AS(resources.get("missing"), std::out_of_range);
+
+    auto const a = resources.get("a");
+    REQUIRE(resources.get("a").data() == a.data());
+    auto const b = resources.get("b");
+    REQUIRE(resources.cached_bytes() == 800);
+
+    // a was used more recently than b, so b has to go
+    resources.get("a");
+    auto const c = resources.get("c");
+    REQUIRE(resources.cached_bytes() == 800);
+    REQUIRE(resources.get("c").data() == c.data());
+    REQUIRE(resources.get("a").data() == a.data());
+    REQUIRE(resources.get("b").data() != b.data());
+
+    // assets larger than the budget are decoded but not cached
+    auto const huge = resources.get("huge");
+    REQUIRE(huge.size() == 4000);
+    REQUIRE(huge.data()[3999] == 'h');
+    REQUIRE(resources.cached_bytes() == 800);
+
+    std::remove(filename.c_str());
   }
 }
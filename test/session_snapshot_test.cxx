@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../game/dummy_game_state.hxx"
+#include "../game/game_state_manager.hxx"
+#include "../game/match.hxx"
+#include "../game/match_game_state.hxx"
+#include "../game/renderer.hxx"
+#include "../game/resources.hxx"
+#include "../game/session_snapshot.hxx"
+#include "test_helpers.hxx"
+
+namespace {
+  struct TransientGameState final : public GameState
+  {
+    using GameState::GameState;
+
+    void set_up() override
+    {
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+    }
+
+    void render(float alpha) override
+    {
+    }
+
+    void handle_event(sf::Event const & event) override
+    {
+    }
+
+    void tear_down() override
+    {
+    }
+  };
+}
+
+TEST_CASE("Session snapshots", "[core][gsm]")
+{
+  std::string const filename {"session_snapshot_test.snapshot"};
+
+  SECTION("states are mapped in their order with aligned data")
+  {
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      write_session_snapshot(out, {{"bottom", {}}, {"top", {'a', 'b', 'c'}}});
+    }
+
+    SessionSnapshot const snapshot {filename};
+    REQUIRE(snapshot.size() == 2);
+    REQUIRE(snapshot.type(0) == "bottom");
+    REQUIRE(snapshot.type(1) == "top");
+    REQUIRE(snapshot.data(0).size() == 0);
+    auto const top = snapshot.data(1);
+    REQUIRE(std::string {top.data(), top.size()} == "abc");
+    REQUIRE(reinterpret_cast<std::uintptr_t>(top.data()) % 16 == 0);
+  }
+
+  SECTION("other files are rejected")
+  {
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      out << "not a snapshot at all";
+    }
+    REQUIRE_THROWS_AS(SessionSnapshot {filename}, std::runtime_error);
+    REQUIRE_THROWS_AS(SessionSnapshot {"missing.snapshot"}, std::runtime_error);
+  }
+
+  SECTION("the stack of states is resumed in the next session")
+  {
+    auto const resources = std::make_shared<Resources>(OVENBRICK_ASSET_PACK, 1024 * 1024);
+    auto const renderer = std::make_shared<Renderer>(sf::Vector2u {320, 240});
+    auto const settings = std::make_shared<MctsSearch::Settings>();
+    settings->m_threads = 1;
+    settings->m_seed = 5;
+
+    std::uint64_t hash = 0;
+    {
+      auto const gsm = std::make_shared<GameStateManager>();
+      gsm->push_state(std::make_shared<DummyGameState>(gsm));
+      gsm->push_state(std::make_shared<TransientGameState>(gsm));
+      auto const state = std::make_shared<MatchGameState>(gsm, resources, settings, renderer);
+      gsm->push_state(state);
+      hash = state->match()->hash();
+
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      REQUIRE(gsm->save(out) == 2);
+    }
+
+    // another seed would deal another match
+    settings->m_seed = 6;
+    auto const gsm = std::make_shared<GameStateManager>();
+    std::vector<std::string> created {};
+    auto const create = [&](std::string const & type) -> std::shared_ptr<GameState> {
+      created.push_back(type);
+      if (type == DummyGameState::TYPE_KEY)
+        return std::make_shared<DummyGameState>(gsm);
+      if (type == MatchGameState::TYPE_KEY)
+        return std::make_shared<MatchGameState>(gsm, resources, settings, renderer);
+      return nullptr;
+    };
+
+    SessionSnapshot const snapshot {filename};
+    REQUIRE(gsm->resume(snapshot, create).size() == 2);
+    commit_when_loaded(*gsm);
+    REQUIRE(created == std::vector<std::string> {DummyGameState::TYPE_KEY, MatchGameState::TYPE_KEY});
+
+    auto & top = dynamic_cast<MatchGameState &>(gsm->current());
+    REQUIRE(top.match()->hash() == hash);
+    gsm->pop_state();
+    REQUIRE_NOTHROW(dynamic_cast<DummyGameState &>(gsm->current()));
+    gsm->pop_state();
+    REQUIRE(gsm->is_empty());
+
+    // unknown states leave the stack alone
+    REQUIRE_THROWS_AS(gsm->resume(snapshot, [](std::string const &) { return nullptr; }), std::runtime_error);
+    REQUIRE_FALSE(gsm->is_loading());
+  }
+
+  SECTION("the snapshot is kept while it is still being resumed")
+  {
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      write_session_snapshot(out, {{DummyGameState::TYPE_KEY, {}}});
+    }
+
+    auto const gsm = std::make_shared<GameStateManager>();
+    {
+      SessionSnapshot const snapshot {filename};
+      gsm->resume(snapshot, [&gsm](std::string const &) { return std::make_shared<DummyGameState>(gsm); });
+    }
+    REQUIRE(gsm->is_loading());
+    save_session(*gsm, filename);
+    REQUIRE(std::ifstream {filename});
+    REQUIRE(SessionSnapshot {filename}.size() == 1);
+
+    commit_when_loaded(*gsm);
+    save_session(*gsm, filename);
+    REQUIRE(SessionSnapshot {filename}.size() == 1);
+    gsm->pop_state();
+
+    // nothing left to resume
+    save_session(*gsm, filename);
+    REQUIRE_FALSE(std::ifstream {filename});
+  }
+
+  SECTION("nothing is saved if the top state cannot be continued")
+  {
+    auto const resources = std::make_shared<Resources>(OVENBRICK_ASSET_PACK, 1024 * 1024);
+    auto const renderer = std::make_shared<Renderer>(sf::Vector2u {320, 240});
+    auto const settings = std::make_shared<MctsSearch::Settings>();
+    settings->m_threads = 1;
+
+    // a match which ended in the previous session
+    CardDatabase const cards {resources->get("cards/cards.db")};
+    Match match {cards, Match::random_deck(cards, 1), Match::random_deck(cards, 2), 3};
+    while (!match.is_over())
+      match.apply(Move {Move::Kind::EndTurn, 0, 0});
+    std::ostringstream finished {};
+    match.write(finished);
+    auto const data = finished.str();
+    {
+      std::ofstream out {filename, std::ios::binary | std::ios::trunc};
+      write_session_snapshot(out,
+                             {{DummyGameState::TYPE_KEY, {}},
+                              {MatchGameState::TYPE_KEY, std::vector<char> {data.begin(), data.end()}}});
+    }
+
+    auto const gsm = std::make_shared<GameStateManager>();
+    auto const create = [&](std::string const & type) -> std::shared_ptr<GameState> {
+      if (type == DummyGameState::TYPE_KEY)
+        return std::make_shared<DummyGameState>(gsm);
+      return std::make_shared<MatchGameState>(gsm, resources, settings, renderer);
+    };
+    {
+      SessionSnapshot const snapshot {filename};
+      gsm->resume(snapshot, create);
+      commit_when_loaded(*gsm);
+    }
+    REQUIRE(dynamic_cast<MatchGameState &>(gsm->current()).match()->is_over());
+
+    // the dummy screen below would be resumed alone
+    std::ostringstream out {};
+    REQUIRE(gsm->save(out) == 0);
+    REQUIRE(out.str().empty());
+
+    gsm->push_state(std::make_shared<TransientGameState>(gsm));
+    REQUIRE(gsm->save(out) == 0);
+    gsm->pop_state();
+    gsm->pop_state();
+    REQUIRE(gsm->save(out) == 1);
+    gsm->pop_state();
+  }
+
+  std::remove(filename.c_str());
+}
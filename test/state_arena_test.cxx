@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <memory>
+
+#include "../game/game_state_manager.hxx"
+#include "../game/game_state.hxx"
+
+namespace {
+  struct ArenaGameState final : public GameState
+  {
+    ArenaVector<std::uint64_t> m_values;
+    std::size_t m_usedAtTearDown = 0;
+
+    explicit ArenaGameState(std::shared_ptr<GameStateManager> gsm)
+        : GameState {std::move(gsm)}, m_values {ArenaAllocator<std::uint64_t> {arena()}}
+    {
+    }
+
+    void set_up() override
+    {
+      for (std::uint64_t n = 0; n < 10000; ++n)
+        m_values.push_back(n);
+    }
+
+    void update(sf::Time const & elapsed) override
+    {
+    }
+
+    void render(float alpha) override
+    {
+    }
+
+    void handle_event(sf::Event const & event) override
+    {
+    }
+
+    void tear_down() override
+    {
+      m_usedAtTearDown = arena().used();
+      ArenaVector<std::uint64_t> {m_values.get_allocator()}.swap(m_values);
+    }
+  };
+
+  bool is_aligned(void const * pointer, std::size_t const alignment)
+  {
+    return reinterpret_cast<std::uintptr_t>(pointer) % alignment == 0;
+  }
+}
+
+TEST_CASE("State arenas", "[core][gsm]")
+{
+  StateArena arena {};
+
+  SECTION("allocations are aligned and packed into few blocks")
+  {
+    auto const a = static_cast<char *>(arena.allocate(3, 1));
+    auto const b = arena.allocate(8, 8);
+    auto const c = arena.allocate(64, 64);
+    REQUIRE(is_aligned(b, 8));
+    REQUIRE(is_aligned(c, 64));
+    REQUIRE(static_cast<char *>(b) - a < 16);
+    REQUIRE(arena.blocks() == 1);
+    REQUIRE(arena.reserved() == StateArena::FIRST_BLOCK);
+
+    // blocks double, larger allocations get a block of their own
+    arena.allocate(StateArena::FIRST_BLOCK, 16);
+    REQUIRE(arena.blocks() == 2);
+    REQUIRE(arena.reserved() == 3 * StateArena::FIRST_BLOCK);
+    arena.allocate(2 * StateArena::MAX_BLOCK, 16);
+    REQUIRE(arena.blocks() == 3);
+    REQUIRE(arena.reserved() > 2 * StateArena::MAX_BLOCK);
+  }
+
+  SECTION("only the most recent allocation is given back")
+  {
+    auto const a = arena.allocate(100, 4);
+    auto const b = arena.allocate(100, 4);
+    auto const used = arena.used();
+    arena.deallocate(a, 100);
+    REQUIRE(arena.used() == used);
+    arena.deallocate(b, 100);
+    REQUIRE(arena.used() == used - 100);
+    REQUIRE(arena.allocate(100, 4) == b);
+  }
+
+  SECTION("a vector reserving up front uses just its buffer")
+  {
+    ArenaVector<int> values {ArenaAllocator<int> {arena}};
+    values.reserve(5000);
+    for (int n = 0; n < 5000; ++n)
+      values.push_back(n);
+    REQUIRE(values[4999] == 4999);
+    REQUIRE(arena.used() == values.capacity() * sizeof(int));
+
+    // its buffer is the most recent allocation
+    ArenaVector<int> {values.get_allocator()}.swap(values);
+    REQUIRE(arena.used() == 0);
+  }
+
+  SECTION("a growing vector leaves its previous buffers behind")
+  {
+    ArenaVector<int> values {ArenaAllocator<int> {arena}};
+    for (int n = 0; n < 5000; ++n)
+      values.push_back(n);
+    REQUIRE(values[4999] == 4999);
+    REQUIRE(arena.used() > values.capacity() * sizeof(int));
+
+    // the last buffer is the most recent allocation, the others stay
+    auto const used = arena.used();
+    auto const bytes = values.capacity() * sizeof(int);
+    ArenaVector<int> {values.get_allocator()}.swap(values);
+    REQUIRE(arena.used() == used - bytes);
+  }
+
+  SECTION("release returns all blocks and resets the high-water mark")
+  {
+    arena.allocate(5000, 8);
+
+    REQUIRE(arena.high_water_mark() >= 5000);
+    arena.release();
+    REQUIRE(arena.used() == 0);
+    REQUIRE(arena.reserved() == 0);
+    REQUIRE(arena.blocks() == 0);
+    REQUIRE(arena.high_water_mark() == 0);
+  }
+
+  SECTION("popping a state releases its arena after tear_down")
+  {
+    auto const gsm = std::make_shared<GameStateManager>();
+    auto const state = std::make_shared<ArenaGameState>(gsm);
+    gsm->push_state(state);
+    REQUIRE(state->arena().used() >= 10000 * sizeof(std::uint64_t));
+    REQUIRE(state->arena().blocks() > 0);
+
+    gsm->pop_state();
+    REQUIRE(state->m_usedAtTearDown >= 10000 * sizeof(std::uint64_t));
+    REQUIRE(state->m_values.empty());
+    REQUIRE(state->arena().blocks() == 0);
+    REQUIRE(state->arena().high_water_mark() == 0);
+
+    // the state may be pushed again, and counts its arena from scratch
+    gsm->push_state(state);
+    REQUIRE(state->m_values.size() == 10000);
+    REQUIRE(state->arena().high_water_mark() == state->arena().used());
+    gsm->pop_state();
+  }
+}
@@ -14,6 +14,29 @@
 //
 ///////////////////////////////////////////////////////////////////////////////
 
-#include <incbin.h>
 
-INCBIN(FiraCode, "@CMAKE_SOURCE_DIR@/contrib/FiraCode/distr/ttf/FiraCode-Regular.ttf");
+#ifndef OVENBRICK_TEST_HELPERS_HXX
+#define OVENBRICK_TEST_HELPERS_HXX
+
+#include <catch.hpp>
+
+#include <chrono>
+#include <thread>
+
+#include "../game/game_state_manager.hxx"
+
+/**
+ * @brief Commit the states being preloaded until none are left, failing after 10 seconds.
+ */
+inline void commit_when_loaded(GameStateManager & gsm)
+{
+  auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds {10};
+  while (gsm.is_loading())
+  {
+    REQUIRE(std::chrono::steady_clock::now() < deadline);
+    gsm.commit_loaded_states();
+    std::this_thread::sleep_for(std::chrono::milliseconds {1});
+  }
+}
+
+#endif // OVENBRICK_TEST_HELPERS_HXX
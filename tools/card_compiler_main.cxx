@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "../game/card_database.hxx"
+
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+
+namespace {
+  std::uint8_t byte(pt::ptree const & card, std::string const & key, CardId id)
+  {
+    auto const value = card.get<unsigned>(key, 0);
+    if (value > 255)
+      throw std::runtime_error {"Card " + std::to_string(id) + ": " + key + " exceeds 255"}; // NOLINT(cert-err60-cpp)
+    return static_cast<std::uint8_t>(value);
+  }
+
+  CardDefinition read_card(pt::ptree const & card)
+  {
+    CardDefinition definition {};
+    definition.m_id = card.get<CardId>("id");
+    auto const context = "Card " + std::to_string(definition.m_id) + ": ";
+
+    definition.m_name = card.get<std::string>("name");
+    if (definition.m_name.empty())
+      throw std::runtime_error {context + "empty name"}; // NOLINT(cert-err60-cpp)
+
+    auto const type = card.get<std::string>("type");
+    if (!from_string(type, definition.m_type))
+      throw std::runtime_error {context + "unknown type " + type}; // NOLINT(cert-err60-cpp)
+
+    definition.m_cost = byte(card, "cost", definition.m_id);
+    definition.m_attack = byte(card, "attack", definition.m_id);
+    definition.m_health = byte(card, "health", definition.m_id);
+    if (definition.m_type != CardType::Spell && definition.m_health == 0)
+      throw std::runtime_error {context + "needs health (or durability)"}; // NOLINT(cert-err60-cpp)
+
+    definition.m_keywords = 0;
+    if (auto const keywords = card.get_child_optional("keywords"))
+    {
+      for (auto const & entry : *keywords)
+      {
+        auto const name = entry.second.get_value<std::string>();
+        Keyword keyword {};
+        if (!from_string(name, keyword))
+          throw std::runtime_error {context + "unknown keyword " + name}; // NOLINT(cert-err60-cpp)
+        definition.m_keywords |= keyword_bit(keyword);
+      }
+    }
+
+    definition.m_text = card.get<std::string>("text", "");
+    return definition;
+  }
+}
+
+/**
+ * @brief Compiles human-editable card sources (JSON) into a CardDatabase.
+ * @param argc Number of command line parameters (including the program name).
+ * @param argv Parameters as an array of strings.
+ * @return 0 on success.
+ */
+int main(int argc, char ** argv)
+{
+  std::string in {};
+  std::string out {};
+
+  po::options_description desc {"Allowed options"};
+  desc.add_options()
+      ("help,h", "show this help")
+      ("in,i", po::value<std::string>(&in)->required(), "set the path of the card sources")
+      ("out,o", po::value<std::string>(&out)->required(), "set the path of the card database");
+
+  try
+  {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+
+    pt::ptree sources {};
+    pt::read_json(in, sources);
+
+    std::vector<CardDefinition> cards {};
+    for (auto const & entry : sources.get_child("cards"))
+      cards.push_back(read_card(entry.second));
+
+    std::ofstream file {out, std::ios::binary | std::ios::trunc};
+    CardDatabase::write(file, cards);
+    if (!file.flush())
+      throw std::runtime_error {"Cannot write " + out}; // NOLINT(cert-err60-cpp)
+
+    std::cout << cards.size() << " cards compiled" << std::endl;
+  }
+  catch (std::exception const & error)
+  {
+    std::cerr << in << ": " << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
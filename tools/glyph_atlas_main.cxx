@@ -0,0 +1,272 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "../game/glyph_atlas.hxx"
+
+namespace po = boost::program_options;
+
+namespace {
+  constexpr unsigned PADDING = 1; ///< Empty pixels around every glyph, so filtering never bleeds.
+
+  struct CodepointRange final
+  {
+    std::uint32_t m_first;
+    std::uint32_t m_last;
+  };
+
+  void validate(boost::any & value, std::vector<std::string> const & values, CodepointRange *, int)
+  {
+    po::validators::check_first_occurrence(value);
+    auto const & single = po::validators::get_single_string(values);
+
+    try
+    {
+      auto const separator = single.find('-');
+      auto const first = std::stoul(single.substr(0, separator), nullptr, 0);
+      auto const last = (separator == std::string::npos) ? first : std::stoul(single.substr(separator + 1), nullptr, 0);
+      if (first > last || last > 0x10ffff)
+        throw po::validation_error {po::validation_error::invalid_option_value}; // NOLINT(cert-err60-cpp)
+      value = CodepointRange {static_cast<std::uint32_t>(first), static_cast<std::uint32_t>(last)};
+    }
+    catch (std::logic_error const &)
+    {
+      throw po::validation_error {po::validation_error::invalid_option_value}; // NOLINT(cert-err60-cpp)
+    }
+  }
+
+  struct Bitmap final
+  {
+    GlyphAtlas::Glyph m_glyph;
+    std::vector<std::uint8_t> m_coverage;
+  };
+
+  class FreeType final
+  {
+    FT_Library m_library = nullptr;
+    FT_Face m_face = nullptr;
+
+  public:
+    explicit FreeType(std::string const & filename)
+    {
+      if (FT_Init_FreeType(&m_library) != 0)
+        throw std::runtime_error {"Cannot initialize FreeType"}; // NOLINT(cert-err60-cpp)
+      if (FT_New_Face(m_library, filename.c_str(), 0, &m_face) != 0)
+      {
+        FT_Done_FreeType(m_library);
+        throw std::runtime_error {"Cannot load font " + filename}; // NOLINT(cert-err60-cpp)
+      }
+    }
+
+    FreeType(FreeType const &) = delete;
+    FreeType & operator=(FreeType const &) = delete;
+
+    ~FreeType()
+    {
+      FT_Done_Face(m_face);
+      FT_Done_FreeType(m_library);
+    }
+
+    GlyphAtlas::Face face(unsigned const pixelSize)
+    {
+      if (FT_Set_Pixel_Sizes(m_face, 0, pixelSize) != 0)
+        throw std::runtime_error {"Cannot use size " + std::to_string(pixelSize)}; // NOLINT(cert-err60-cpp)
+
+      auto const & metrics = m_face->size->metrics;
+      GlyphAtlas::Face face {};
+      face.m_pixelSize = pixelSize;
+      face.m_lineSpacing = static_cast<std::int32_t>((metrics.height + 63) / 64);
+      face.m_ascent = static_cast<std::int32_t>((metrics.ascender + 63) / 64);
+      return face;
+    }
+
+    bool rasterize(std::uint32_t const codepoint, Bitmap & bitmap)
+    {
+      auto const index = FT_Get_Char_Index(m_face, codepoint);
+      if (index == 0 || FT_Load_Glyph(m_face, index, FT_LOAD_RENDER | FT_LOAD_TARGET_LIGHT) != 0)
+        return false;
+
+      auto const slot = m_face->glyph;
+      auto const & source = slot->bitmap;
+      if (source.pixel_mode != FT_PIXEL_MODE_GRAY)
+        return false;
+
+      auto & glyph = bitmap.m_glyph;
+      glyph = GlyphAtlas::Glyph {};
+      glyph.m_codepoint = codepoint;
+      glyph.m_width = static_cast<std::uint16_t>(source.width);
+      glyph.m_height = static_cast<std::uint16_t>(source.rows);
+      glyph.m_left = static_cast<std::int16_t>(slot->bitmap_left);
+      glyph.m_top = static_cast<std::int16_t>(slot->bitmap_top);
+      glyph.m_advance = static_cast<std::int16_t>((slot->advance.x + 63) / 64);
+
+      bitmap.m_coverage.resize(std::size_t {source.width} * source.rows);
+      for (unsigned row = 0; row < source.rows; ++row)
+        std::copy_n(source.buffer + static_cast<std::ptrdiff_t>(row) * source.pitch, source.width,
+                    bitmap.m_coverage.begin() + static_cast<std::ptrdiff_t>(row) * source.width);
+      return true;
+    }
+  };
+
+  /**
+   * @brief Place the glyphs on shelves, tallest first, and copy their coverage into the atlas.
+   */
+  void pack(std::vector<Bitmap> & bitmaps, GlyphAtlas::Data & atlas)
+  {
+    std::vector<Bitmap *> order {};
+    for (auto & bitmap : bitmaps)
+      order.push_back(&bitmap);
+    std::stable_sort(order.begin(), order.end(), [](Bitmap const * lhs, Bitmap const * rhs) {
+      return lhs->m_glyph.m_height > rhs->m_glyph.m_height;
+    });
+
+    unsigned x = PADDING;
+    unsigned y = PADDING;
+    unsigned shelf = 0;
+    for (auto const bitmap : order)
+    {
+      auto & glyph = bitmap->m_glyph;
+      if (glyph.m_width + 2 * PADDING > atlas.m_width)
+        throw std::runtime_error {"Atlas too narrow for glyph " + std::to_string(glyph.m_codepoint)}; // NOLINT(cert-err60-cpp)
+
+      if (x + glyph.m_width + PADDING > atlas.m_width)
+      {
+        x = PADDING;
+        y += shelf + PADDING;
+        shelf = 0;
+      }
+
+      glyph.m_x = static_cast<std::uint16_t>(x);
+      glyph.m_y = static_cast<std::uint16_t>(y);
+      x += glyph.m_width + PADDING;
+      shelf = std::max<unsigned>(shelf, glyph.m_height);
+    }
+
+    // round up, so the texture stays friendly to older GPUs
+    atlas.m_height = 1;
+    while (atlas.m_height < y + shelf + PADDING)
+      atlas.m_height *= 2;
+    atlas.m_coverage.assign(std::size_t {atlas.m_width} * atlas.m_height, 0);
+
+    for (auto const & bitmap : bitmaps)
+    {
+      auto const & glyph = bitmap.m_glyph;
+      for (unsigned row = 0; row < glyph.m_height; ++row)
+        std::copy_n(bitmap.m_coverage.begin() + static_cast<std::ptrdiff_t>(row) * glyph.m_width, glyph.m_width,
+                    atlas.m_coverage.begin() + static_cast<std::ptrdiff_t>(glyph.m_y + row) * atlas.m_width + glyph.m_x);
+    }
+  }
+}
+
+/**
+ * @brief Rasterizes glyphs of a font into a GlyphAtlas.
+ * @param argc Number of command line parameters (including the program name).
+ * @param argv Parameters as an array of strings.
+ * @return 0 on success.
+ */
+int main(int argc, char ** argv)
+{
+  std::string font {};
+  std::string out {};
+  std::vector<unsigned> sizes {};
+  std::vector<CodepointRange> ranges {};
+  unsigned width = 256;
+
+  po::options_description desc {"Allowed options"};
+  desc.add_options()
+      ("help,h", "show this help")
+      ("font,f", po::value<std::string>(&font)->required(), "set the path of the font")
+      ("out,o", po::value<std::string>(&out)->required(), "set the path of the atlas")
+      ("size,s", po::value<std::vector<unsigned>>(&sizes)->required(), "add a pixel size (repeatable)")
+      ("range,r", po::value<std::vector<CodepointRange>>(&ranges)->required(),
+       "add a codepoint range like 0x20-0x7e (repeatable)")
+      ("width,w", po::value<unsigned>(&width)->default_value(width), "set the width of the atlas in pixels");
+
+  try
+  {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+
+    FreeType freeType {font};
+    GlyphAtlas::Data atlas {};
+    atlas.m_width = width;
+
+    std::vector<Bitmap> bitmaps {};
+    for (auto const size : sizes)
+    {
+      auto face = freeType.face(size);
+      face.m_firstGlyph = static_cast<std::uint32_t>(bitmaps.size());
+
+      // codepoints in ascending order, so lookups can bisect
+      std::vector<std::uint32_t> codepoints {};
+      for (auto const & range : ranges)
+        for (auto codepoint = range.m_first; codepoint <= range.m_last; ++codepoint)
+          codepoints.push_back(codepoint);
+      std::sort(codepoints.begin(), codepoints.end());
+      codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+
+      Bitmap bitmap {};
+      for (auto const codepoint : codepoints)
+        if (freeType.rasterize(codepoint, bitmap))
+          bitmaps.push_back(bitmap);
+
+      face.m_glyphCount = static_cast<std::uint32_t>(bitmaps.size() - face.m_firstGlyph);
+      atlas.m_faces.push_back(face);
+    }
+
+    pack(bitmaps, atlas);
+    for (auto const & bitmap : bitmaps)
+      atlas.m_glyphs.push_back(bitmap.m_glyph);
+
+    std::ofstream file {out, std::ios::binary | std::ios::trunc};
+    GlyphAtlas::write(file, atlas);
+    if (!file.flush())
+      throw std::runtime_error {"Cannot write " + out}; // NOLINT(cert-err60-cpp)
+
+    std::cout << atlas.m_glyphs.size() << " glyphs in " << atlas.m_faces.size() << " sizes, "
+              << atlas.m_width << "x" << atlas.m_height << " pixels" << std::endl;
+  }
+  catch (std::exception const & error)
+  {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "../game/asset_pack.hxx"
+
+namespace po = boost::program_options;
+
+namespace {
+  AssetSource read_source(std::string const & argument)
+  {
+    auto const separator = argument.find('=');
+    if (separator == std::string::npos || separator == 0)
+      throw po::validation_error {po::validation_error::invalid_option_value, "asset", argument}; // NOLINT(cert-err60-cpp)
+
+    auto const filename = argument.substr(separator + 1);
+    std::ifstream in {filename, std::ios::binary};
+    if (!in)
+      throw std::runtime_error {"Cannot read " + filename}; // NOLINT(cert-err60-cpp)
+
+    return AssetSource {
+        argument.substr(0, separator),
+        std::vector<char> {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}}
+    };
+  }
+}
+
+/**
+ * @brief Packs assets into an indexed asset pack.
+ * @param argc Number of command line parameters (including the program name).
+ * @param argv Parameters as an array of strings.
+ * @return 0 on success.
+ */
+int main(int argc, char ** argv)
+{
+  std::string out {};
+  int level = 9;
+  std::vector<std::string> assets {};
+  std::vector<std::string> stored {};
+
+  po::options_description desc {"Allowed options"};
+  desc.add_options()
+      ("help,h", "show this help")
+      ("out,o", po::value<std::string>(&out)->required(), "set the path of the asset pack")
+      ("level,l", po::value<int>(&level)->default_value(level), "set the zlib compression level (0..9)")
+      ("store,s", po::value<std::vector<std::string>>(&stored), "never compress the asset of this name (repeatable)")
+      ("asset", po::value<std::vector<std::string>>(&assets), "an asset as name=path");
+  po::positional_options_description positional {};
+  positional.add("asset", -1);
+
+  try
+  {
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    if (vm.count("help"))
+    {
+      std::cout << "Usage: ovenbrick_pack --out <pack> name=path...\n" << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+
+    std::vector<AssetSource> sources {};
+    sources.reserve(assets.size());
+    for (auto const & asset : assets)
+    {
+      sources.push_back(read_source(asset));
+      auto & source = sources.back();
+      source.m_compress = std::find(stored.begin(), stored.end(), source.m_name) == stored.end();
+    }
+
+    std::ofstream file {out, std::ios::binary | std::ios::trunc};
+    write_asset_pack(file, sources, level);
+    if (!file.flush())
+      throw std::runtime_error {"Cannot write " + out}; // NOLINT(cert-err60-cpp)
+  }
+  catch (std::exception const & error)
+  {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
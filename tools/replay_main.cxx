@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/program_options.hpp>
+
+#include "../game/dummy_game_state.hxx"
+#include "../game/game_state_manager.hxx"
+#include "../game/input_actions.hxx"
+#include "../game/input_trace.hxx"
+#include "../game/keyboard_layout.hxx"
+#include "../game/match_game_state.hxx"
+#include "../game/renderer.hxx"
+#include "../game/resources.hxx"
+
+namespace logging = boost::log;
+namespace po = boost::program_options;
+
+namespace {
+  unsigned const SCREEN_WIDTH = 320;
+  unsigned const SCREEN_HEIGHT = 240;
+}
+
+/**
+ * @brief Replays a session recorded with ovenbrick --record as fast as possible and reports frame times.
+ * @param argc Number of command line parameters (including the program name).
+ * @param argv Parameters as an array of strings.
+ * @return 0 on success, 1 if the replay failed or did not end like the recorded session.
+ */
+int main(int argc, char ** argv)
+{
+  std::string tracePath {};
+  std::string assets {"ovenbrick.pack"};
+
+  po::options_description desc {"Allowed options"};
+  desc.add_options()
+      ("help,h", "show this help")
+      ("assets,a", po::value<std::string>(&assets)->default_value(assets), "set the path of the asset pack")
+      ("trace", po::value<std::string>(&tracePath)->required(), "the recorded session");
+  po::positional_options_description positional {};
+  positional.add("trace", 1);
+
+  try
+  {
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+    if (vm.count("help"))
+    {
+      std::cout << "Usage: ovenbrick_replay [--assets <pack>] <trace>\n" << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+
+    // the game logs every move
+    logging::core::get()->set_filter(logging::trivial::severity >= logging::trivial::warning);
+
+    std::ifstream in {tracePath, std::ios::binary};
+    if (!in)
+      throw std::runtime_error {"Cannot read " + tracePath}; // NOLINT(cert-err60-cpp)
+    InputTrace trace {in};
+
+    auto const & session = trace.session();
+    if (!parse_layout(session.m_keyLayout, KeyboardLayout::current))
+      throw std::runtime_error {"Unknown keyboard layout " + session.m_keyLayout}; // NOLINT(cert-err60-cpp)
+    auto const computer = std::make_shared<MctsSearch::Settings>();
+    computer->m_threads = session.m_computerThreads;
+    computer->m_budget = session.m_computerBudget;
+    computer->m_maxPlayouts = session.m_computerPlayouts;
+    computer->m_seed = session.m_seed;
+    if (computer->m_threads == 0 || computer->m_maxPlayouts == 0)
+      std::cerr << "The session was recorded without a playout limit or thread count,"
+                << " the computer's moves depend on timing and the replay may end differently" << std::endl;
+
+    auto const gsm = std::make_shared<GameStateManager>();
+    auto const resources = std::make_shared<Resources>(assets, 16 * 1024 * 1024);
+    auto const renderer = std::make_shared<Renderer>(sf::Vector2u {SCREEN_WIDTH, SCREEN_HEIGHT});
+    gsm->set_renderer(renderer);
+    sf::RenderTexture screen {};
+    if (!screen.create(SCREEN_WIDTH, SCREEN_HEIGHT))
+      throw std::runtime_error {"Cannot create the offscreen target"}; // NOLINT(cert-err60-cpp)
+
+    // the states the game preloads, in the same order
+    auto const match = std::make_shared<MatchGameState>(gsm, resources, computer, renderer);
+    std::vector<std::shared_ptr<GameState>> states {std::make_shared<DummyGameState>(gsm), match};
+    std::size_t committed = 0;
+
+    InputReplay replay {trace, *gsm};
+    replay.run(
+        [&states, &committed]() -> std::shared_ptr<GameState> {
+          return (committed < states.size()) ? states[committed++] : nullptr;
+        },
+        [&renderer, &screen] { renderer->present(screen); });
+
+    auto const & statistics = replay.statistics();
+    auto const & frameTimes = replay.frame_times();
+    auto const checksum = match->match() ? match->match()->hash() : 0;
+    auto const seconds = static_cast<double>(statistics.m_elapsed.count()) / 1e9;
+    auto const matches = statistics.m_hasChecksum && statistics.m_checksum == checksum;
+
+    std::cout << "{\"trace\": \"" << tracePath << "\""
+              << ", \"frames\": " << statistics.m_frames
+              << ", \"events\": " << statistics.m_events
+              << ", \"ticks\": " << statistics.m_ticks
+              << ", \"collects\": " << statistics.m_collects
+              << ", \"simulated_seconds\": " << statistics.m_simulated.asSeconds()
+              << ", \"seconds\": " << seconds
+              << ", \"frames_per_second\": " << (seconds > 0.0 ? statistics.m_frames / seconds : 0.0)
+              << ", \"mean_frame_ns\": " << (frameTimes.count() ? frameTimes.total() / frameTimes.count() : 0)
+              << ", \"p50_frame_ns\": " << frameTimes.percentile(0.5)
+              << ", \"p99_frame_ns\": " << frameTimes.percentile(0.99)
+              << ", \"max_frame_ns\": " << frameTimes.max()
+              << ", \"searches_cut_short\": " << match->searches_cut_short()
+              << ", \"truncated\": " << (trace.is_truncated() ? "true" : "false")
+              << ", \"checksum\": \"" << (statistics.m_hasChecksum ? (matches ? "match" : "mismatch") : "missing")
+              << "\"}" << std::endl;
+
+    while (!gsm->is_empty())
+      gsm->pop_state();
+
+    if (match->searches_cut_short() > 0)
+      std::cerr << match->searches_cut_short() << " of the computer's searches ran out of thinking time"
+                << " before the playout limit, this machine is too slow to replay the session exactly" << std::endl;
+    if (statistics.m_hasChecksum && !matches)
+    {
+      std::cerr << "The replay ended differently than the recorded session" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch (std::exception const & error)
+  {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
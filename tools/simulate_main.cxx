@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2018, Felix Bytow <drako@drako.guru>
+//
+// This code is licensed under the MIT License (MIT).
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "../game/card_database.hxx"
+#include "../game/job_system.hxx"
+#include "../game/match_simulator.hxx"
+#include "../game/resources.hxx"
+
+namespace po = boost::program_options;
+
+/**
+ * @brief Plays the computer against itself on all cores and streams win rates as JSON lines.
+ * @param argc Number of command line parameters (including the program name).
+ * @param argv Parameters as an array of strings.
+ * @return 0 on success.
+ */
+int main(int argc, char ** argv)
+{
+  std::string assets {"ovenbrick.pack"};
+  std::string out {};
+  MatchSimulator::Settings settings {};
+  settings.m_computer.m_maxPlayouts = 100;
+  JobSystem::Settings jobSettings {};
+
+  po::options_description desc {"Allowed options"};
+  desc.add_options()
+      ("help,h", "show this help")
+      ("assets,a", po::value<std::string>(&assets)->default_value(assets), "set the path of the asset pack")
+      ("out,o", po::value<std::string>(&out), "write the statistics to this file instead of stdout")
+      ("matches,m", po::value<std::uint64_t>(&settings.m_matches)->default_value(settings.m_matches),
+       "set the number of matches to play")
+      ("decks,d", po::value<std::size_t>(&settings.m_decks)->default_value(settings.m_decks),
+       "set the number of random decks playing against each other")
+      ("seed,s", po::value<std::uint64_t>(&settings.m_seed)->default_value(settings.m_seed),
+       "seed the decks and the matches")
+      ("playouts,p", po::value<std::uint64_t>(&settings.m_computer.m_maxPlayouts)
+           ->default_value(settings.m_computer.m_maxPlayouts),
+       "set the playouts the computer spends on each move (0 plays random moves)")
+      ("report-every,r", po::value<std::uint64_t>(&settings.m_reportInterval)
+           ->default_value(settings.m_reportInterval),
+       "write the statistics so far after this many matches (0 only writes the final ones)")
+      ("threads,t", po::value<unsigned>(&jobSettings.m_threads)->default_value(jobSettings.m_threads),
+       "set the number of worker threads besides the main thread (0 uses all cores)")
+      ("pin-threads", po::bool_switch(&jobSettings.m_pinned), "bind every worker thread to a core of its own");
+
+  try
+  {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help"))
+    {
+      std::cout << "Usage: ovenbrick_simulate [--matches <n>] [--out <file>]\n" << desc << std::endl;
+      return EXIT_SUCCESS;
+    }
+    po::notify(vm);
+
+    std::ofstream file {};
+    if (!out.empty())
+    {
+      file.open(out, std::ios::trunc);
+      if (!file)
+        throw std::runtime_error {"Cannot write " + out}; // NOLINT(cert-err60-cpp)
+    }
+    auto & stream = out.empty() ? std::cout : file;
+
+    Resources resources {assets, 16 * 1024 * 1024};
+    CardDatabase const cards {resources.get("cards/cards.db")};
+    MatchSimulator const simulator {cards, settings};
+    JobSystem jobs {jobSettings};
+
+    auto const statistics = simulator.run(jobs, [&stream, &cards](MatchSimulator::Statistics const & sofar) {
+      write_json(stream, sofar, cards);
+      stream.flush();
+    });
+    write_json(stream, statistics, cards);
+    if (!stream.flush())
+      throw std::runtime_error {"Cannot write " + out}; // NOLINT(cert-err60-cpp)
+
+    std::cerr << statistics.m_matches << " matches in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(statistics.m_elapsed).count() << "ms: "
+              << statistics.matches_per_second_per_core() << " matches per second per core on "
+              << statistics.m_threads << " threads" << std::endl;
+  }
+  catch (std::exception const & error)
+  {
+    std::cerr << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}